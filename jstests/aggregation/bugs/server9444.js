@@ -44,7 +44,14 @@ var groupCode = 16945;
 var sortCode = 16819;
 var sortLimitCode = 16820;
 
+var groupMetricsBefore = sharded ? null : db.serverStatus().metrics.aggregate.group;
 test([{$group: {_id: '$_id', bigStr: {$first: '$bigStr'}}}], groupCode);
+if (!sharded) {
+    // serverStatus counts the spills of the $group that was allowed to use the disk.
+    var groupMetrics = db.serverStatus().metrics.aggregate.group;
+    assert.gt(groupMetrics.spills, groupMetricsBefore.spills, tojson(groupMetrics));
+    assert.gt(groupMetrics.spilledGroups, groupMetricsBefore.spilledGroups, tojson(groupMetrics));
+}
 
 // sorting with _id would use index which doesn't require extsort
 test([{$sort: {random: 1}}], sortCode);
@@ -0,0 +1,67 @@
+// Tests that a mongod serving its connections from a small pool of ingress worker threads handles
+// many concurrent clients, exhaust cursors, clients that disconnect and requests that block.
+(function() {
+    'use strict';
+
+    var conn = MongoRunner.runMongod({ingressWorkerThreads: 2});
+    assert.neq(null, conn, "mongod failed to start with ingressWorkerThreads");
+    var db = conn.getDB("test");
+    var coll = db.ingress_worker_threads;
+    coll.drop();
+
+    // More clients than workers, each issuing several round trips.
+    var numClients = 8;
+    var shells = [];
+    for (var i = 0; i < numClients; i++) {
+        var code = "for (var j = 0; j < 100; j++) {" +
+            "    assert.writeOK(db.ingress_worker_threads.insert({client: " + i + ", j: j}));" +
+            "}" +
+            "assert.eq(100, db.ingress_worker_threads.find({client: " + i + "}).itcount());";
+        shells.push(startParallelShell(code, conn.port));
+    }
+    shells.forEach(function(join) {
+        join();
+    });
+    assert.eq(numClients * 100, coll.count());
+
+    // Exhaust cursors send several replies for a single request.
+    assert.eq(numClients * 100,
+              coll.find().batchSize(10).addOption(DBQuery.Option.exhaust).itcount());
+
+    // Requests that block must not starve the others: keep more of them running than there are
+    // workers, and check that other clients are still served meanwhile.
+    var numSleepers = 4;
+    var sleepSecs = 30;
+    var sleepers = [];
+    for (var i = 0; i < numSleepers; i++) {
+        var code = "assert.commandWorked(db.adminCommand({sleep: 1, lock: 'none', secs: " +
+            sleepSecs + "}));";
+        sleepers.push(startParallelShell(code, conn.port));
+    }
+    var start = new Date();
+    assert.soon(function() {
+        var ops = db.currentOp({"query.sleep": 1}).inprog;
+        return ops.length === numSleepers;
+    }, "sleep commands did not all start", 10 * 1000);
+    assert.writeOK(coll.insert({afterSleepers: true}));
+    assert.eq(1, coll.find({afterSleepers: true}).itcount());
+    assert.lt(new Date() - start,
+              sleepSecs * 1000,
+              "requests were not served while the workers were blocked");
+    sleepers.forEach(function(join) {
+        join();
+    });
+
+    // Connections that come and go must not leak connection tickets.
+    var before = db.serverStatus().connections.current;
+    for (var i = 0; i < 20; i++) {
+        var other = new Mongo(conn.host);
+        assert.eq(1, other.getDB("admin").runCommand({ping: 1}).ok);
+    }
+    gc();
+    assert.soon(function() {
+        return db.serverStatus().connections.current <= before;
+    });
+
+    MongoRunner.stopMongod(conn);
+})();
@@ -0,0 +1,93 @@
+// Tests that the queryShapeStats command and the $queryShapeStats aggregation stage report the
+// queries executed by find, count, distinct and aggregate, grouped by command and query shape.
+(function() {
+    'use strict';
+
+    var conn = MongoRunner.runMongod({});
+    assert.neq(null, conn, "mongod failed to start");
+    var db = conn.getDB("test");
+    var coll = db.query_shape_stats;
+    var otherColl = db.query_shape_stats_other;
+    coll.drop();
+    otherColl.drop();
+
+    for (var i = 0; i < 10; i++) {
+        assert.writeOK(coll.insert({_id: i, a: i, b: i % 2}));
+    }
+    assert.writeOK(otherColl.insert({a: 1}));
+
+    function shapesOf(command) {
+        var res = assert.commandWorked(db.adminCommand({queryShapeStats: 1}));
+        assert.eq(false, res.truncated, tojson(res));
+        return res.shapes.filter(function(shape) {
+            return shape.ns === coll.getFullName() && shape.command === command;
+        });
+    }
+
+    // Queries of the same shape are aggregated, whatever the values they compare to.
+    assert.eq(1, coll.find({a: 1}).itcount());
+    assert.eq(1, coll.find({a: 2}).itcount());
+    assert.eq(5, coll.find({b: 1}).itcount());
+    var finds = shapesOf("find");
+    assert.eq(2, finds.length, tojson(finds));
+    var byA = finds.filter(function(shape) {
+        return shape.query.hasOwnProperty("a");
+    })[0];
+    assert.eq({a: 1}, byA.query, tojson(byA));
+    assert.eq(2, byA.count, tojson(byA));
+    assert.eq(2, byA.nreturned, tojson(byA));
+    assert.eq(20, byA.docsExamined, tojson(byA));
+
+    // Other commands are recorded as shapes of their own, even for the same filter.
+    assert.eq(1, coll.count({a: 1}));
+    assert.eq([0, 1], coll.distinct("b", {a: {$lt: 2}}).sort());
+    assert.eq(1, coll.aggregate([{$match: {a: 1}}]).itcount());
+
+    var counts = shapesOf("count");
+    assert.eq(1, counts.length, tojson(counts));
+    assert.eq({a: 1}, counts[0].query, tojson(counts));
+    assert.eq(1, counts[0].count, tojson(counts));
+
+    var distincts = shapesOf("distinct");
+    assert.eq(1, distincts.length, tojson(distincts));
+    assert.eq({a: {$lt: 2}}, distincts[0].query, tojson(distincts));
+
+    var aggregates = shapesOf("aggregate");
+    assert.eq(1, aggregates.length, tojson(aggregates));
+    assert.eq({a: 1}, aggregates[0].query, tojson(aggregates));
+    assert.eq(1, aggregates[0].nreturned, tojson(aggregates));
+
+    // Large filters are kept as a truncated summary.
+    var values = [];
+    for (var i = 0; i < 1000; i++) {
+        values.push("value" + i);
+    }
+    assert.eq(0, coll.find({a: {$in: values}, b: 3}).itcount());
+    var truncated = shapesOf("find").filter(function(shape) {
+        return shape.query.hasOwnProperty("$truncated");
+    });
+    assert.eq(1, truncated.length, tojson(truncated));
+    assert.lte(truncated[0].query.$truncated.length, 1024, tojson(truncated));
+
+    // $queryShapeStats only returns the shapes of the aggregated collection.
+    assert.eq(1, otherColl.find({a: 1}).itcount());
+    var stageShapes = otherColl.aggregate([{$queryShapeStats: {}}]).toArray();
+    assert.eq(1, stageShapes.length, tojson(stageShapes));
+    assert.eq(otherColl.getFullName(), stageShapes[0].ns, tojson(stageShapes));
+    assert.eq("find", stageShapes[0].command, tojson(stageShapes));
+    assert.eq({a: 1}, stageShapes[0].query, tojson(stageShapes));
+    assert(stageShapes[0].hasOwnProperty("host"), tojson(stageShapes));
+
+    assert.commandFailed(
+        otherColl.runCommand("aggregate", {pipeline: [{$queryShapeStats: {a: 1}}]}));
+
+    // No shapes are recorded when the statistics are disabled.
+    assert.commandWorked(db.adminCommand({setParameter: 1, internalQueryShapeStatsMaxShapes: 0}));
+    assert.eq(0, coll.find({c: 1, a: 1}).itcount());
+    var disabled = shapesOf("find").filter(function(shape) {
+        return shape.query.hasOwnProperty("c");
+    });
+    assert.eq(0, disabled.length, tojson(disabled));
+
+    MongoRunner.stopMongod(conn);
+})();
@@ -0,0 +1,86 @@
+/**
+ * Test that the TTL monitor deletes expired documents in batches of ttlDeleteBatchSize, with
+ * ascending and descending TTL indexes, and that the ttl.deleteBatches and ttl.backlog metrics
+ * account for them.
+ */
+(function() {
+    "use strict";
+
+    var conn = MongoRunner.runMongod({setParameter: "ttlMonitorSleepSecs=1"});
+    assert.neq(null, conn, "mongod was unable to start up");
+
+    var testDB = conn.getDB("test");
+    assert.commandWorked(testDB.adminCommand({setParameter: 1, ttlMonitorEnabled: false}));
+
+    var kBatchSize = 10;
+    assert.commandWorked(testDB.adminCommand({setParameter: 1, ttlDeleteBatchSize: kBatchSize}));
+
+    var now = Date.now();
+    var expired = new Date(now - 60 * 1000);
+    var notExpired = new Date(now + 24 * 60 * 60 * 1000);
+
+    // 'ascending' holds 95 expired documents, 3 documents with an array of an expired and a
+    // current date, and 5 documents which have not expired.
+    var ascending = testDB.ttl_batched_deletes_ascending;
+    assert.commandWorked(ascending.ensureIndex({date: 1}, {expireAfterSeconds: 0}));
+    var bulk = ascending.initializeUnorderedBulkOp();
+    for (var i = 0; i < 95; i++) {
+        bulk.insert({date: new Date(expired.getTime() - i * 1000)});
+    }
+    for (var i = 0; i < 3; i++) {
+        bulk.insert({date: [expired, notExpired]});
+    }
+    for (var i = 0; i < 5; i++) {
+        bulk.insert({date: notExpired});
+    }
+    assert.writeOK(bulk.execute());
+
+    // 'descending' holds 25 expired documents.
+    var descending = testDB.ttl_batched_deletes_descending;
+    assert.commandWorked(descending.ensureIndex({date: -1}, {expireAfterSeconds: 0}));
+    bulk = descending.initializeUnorderedBulkOp();
+    for (var i = 0; i < 25; i++) {
+        bulk.insert({date: new Date(expired.getTime() - i * 1000)});
+    }
+    assert.writeOK(bulk.execute());
+
+    var kNumExpired = 98 + 25;
+    // Every batch but the last of each index is full.
+    var kNumBatches = Math.ceil(98 / kBatchSize) + Math.ceil(25 / kBatchSize);
+
+    function ttlMetrics() {
+        return testDB.serverStatus().metrics.ttl;
+    }
+
+    var before = ttlMetrics();
+    assert.eq(0, before.backlog, tojson(before));
+    assert.commandWorked(testDB.adminCommand({setParameter: 1, ttlMonitorEnabled: true}));
+
+    var timeoutSeconds = 30;
+    assert.soon(
+        function checkIfTTLMonitorRan() {
+            // The backlog never counts more than the documents that were expired to begin with.
+            var metrics = ttlMetrics();
+            assert.lte(metrics.backlog, kNumExpired, tojson(metrics));
+
+            // The 'ttl.passes' metric is incremented when the TTL monitor starts processing the
+            // indexes, so we wait for it to be incremented twice to know that the TTL monitor
+            // finished processing the indexes at least once.
+            return metrics.passes >= before.passes + 2;
+        },
+        function msg() {
+            return "TTL monitor didn't run within " + timeoutSeconds + " seconds";
+        },
+        timeoutSeconds * 1000);
+
+    assert.eq(5, ascending.count());
+    assert.eq(5, ascending.count({date: notExpired}));
+    assert.eq(0, descending.count());
+
+    var after = ttlMetrics();
+    assert.eq(kNumExpired, after.deletedDocuments - before.deletedDocuments, tojson(after));
+    assert.eq(kNumBatches, after.deleteBatches - before.deleteBatches, tojson(after));
+    assert.eq(0, after.backlog, tojson(after));
+
+    MongoRunner.stopMongod(conn);
+})();
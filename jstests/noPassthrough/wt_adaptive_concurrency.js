@@ -0,0 +1,89 @@
+// Tests that replication on a secondary stays within its transaction ticket bounds, with and
+// without wiredTigerAdaptiveConcurrency. Internal operations only take reserved tickets when
+// adaptive concurrency is enabled, and never exceed the tickets plus the reserve.
+(function() {
+    'use strict';
+
+    if (jsTest.options().storageEngine && jsTest.options().storageEngine !== "wiredTiger") {
+        jsTestLog("Skipping test because storageEngine is not wiredTiger");
+        return;
+    }
+
+    var kTickets = 5;
+    var name = "wt_adaptive_concurrency";
+    var replTest = new ReplSetTest({name: name, nodes: [{}, {rsConfig: {priority: 0}}]});
+    replTest.startSet();
+    replTest.initiate();
+
+    var primary = replTest.getPrimary();
+    var secondary = replTest.liveNodes.slaves[0];
+    assert.commandWorked(secondary.adminCommand(
+        {setParameter: 1, wiredTigerConcurrentWriteTransactions: kTickets}));
+    assert.commandWorked(secondary.adminCommand(
+        {setParameter: 1, wiredTigerConcurrentReadTransactions: kTickets}));
+
+    var coll = primary.getDB(name)[name];
+
+    function ticketStats() {
+        return secondary.adminCommand({serverStatus: 1}).wiredTiger.concurrentTransactions;
+    }
+
+    function checkBounds(stats) {
+        ['write', 'read'].forEach(function(kind) {
+            var tickets = stats[kind];
+            assert.lte(tickets.totalTickets, kTickets, tojson(stats));
+            assert.lte(tickets.out, tickets.totalTickets, tojson(stats));
+            assert.lte(tickets.reserved.out, tickets.reserved.totalTickets, tojson(stats));
+        });
+    }
+
+    // Replicates inserts from several parallel clients while sampling the secondary's tickets.
+    function replicateUnderLoad() {
+        var shells = [];
+        for (var i = 0; i < 8; i++) {
+            shells.push(startParallelShell(
+                "var bulk = db.getSiblingDB('" + name + "')." + name +
+                    ".initializeUnorderedBulkOp();" +
+                    "for (var j = 0; j < 2000; j++) { bulk.insert({client: " + i +
+                    ", j: j, pad: new Array(100).join('x')}); }" +
+                    "assert.writeOK(bulk.execute());",
+                primary.port));
+        }
+        var samples = 0;
+        var done = false;
+        while (!done) {
+            checkBounds(ticketStats());
+            samples++;
+            done = coll.count() === shells.length * 2000 * (replicateUnderLoad.round + 1);
+        }
+        shells.forEach(function(join) {
+            join();
+        });
+        replTest.awaitReplication();
+        replicateUnderLoad.round++;
+        checkBounds(ticketStats());
+        jsTestLog("sampled the secondary's tickets " + samples + " times");
+    }
+    replicateUnderLoad.round = 0;
+
+    // Without adaptive concurrency, internal operations queue for tickets like any other.
+    replicateUnderLoad();
+    var stats = ticketStats();
+    assert.eq(0, stats.write.admittedFromReserve, tojson(stats));
+    assert.eq(0, stats.read.admittedFromReserve, tojson(stats));
+
+    // With it, they may use the reserve, but stay within its bounds.
+    assert.commandWorked(
+        secondary.adminCommand({setParameter: 1, wiredTigerAdaptiveConcurrency: true}));
+    replicateUnderLoad();
+
+    // Turning it off puts the withheld tickets back.
+    assert.commandWorked(
+        secondary.adminCommand({setParameter: 1, wiredTigerAdaptiveConcurrency: false}));
+    assert.soon(function() {
+        var stats = ticketStats();
+        return stats.write.totalTickets === kTickets && stats.read.totalTickets === kTickets;
+    }, "withheld tickets were not restored");
+
+    replTest.stopSet();
+})();
@@ -0,0 +1,168 @@
+// Tests that $lookup returns the same results whichever join strategy it picks, and that the
+// serverStatus metrics report the strategy used.
+(function() {
+    "use strict";
+
+    var local = db.lookup_join_strategies_local;
+    var foreign = db.lookup_join_strategies_foreign;
+    local.drop();
+    foreign.drop();
+
+    var localDocs = [
+        {_id: 0, a: 1},
+        {_id: 1, a: null},
+        {_id: 2},
+        {_id: 3, a: [1, 2]},
+        {_id: 4, a: /^x/},
+        {_id: 5, a: "xyz"},
+        {_id: 6, a: 1.0},
+        {_id: 7, a: {c: 1}},
+        {_id: 8, a: 2},
+    ];
+    var foreignDocs = [
+        {_id: 0, b: 1},
+        {_id: 1, b: null},
+        {_id: 2},
+        {_id: 3, b: [1, 2]},
+        {_id: 4, b: [2, 3]},
+        {_id: 5, b: /^x/},
+        {_id: 6, b: "xyz"},
+        {_id: 7, b: [{c: 1}, [1, 2]]},
+        {_id: 8, b: NumberLong(2)},
+    ];
+    localDocs.forEach(function(doc) {
+        assert.writeOK(local.insert(doc));
+    });
+    foreignDocs.forEach(function(doc) {
+        assert.writeOK(foreign.insert(doc));
+    });
+
+    var lookup = {
+        $lookup: {from: foreign.getName(), localField: "a", foreignField: "b", as: "joined"}
+    };
+
+    function sortJoined(doc) {
+        doc.joined.sort(function(x, y) {
+            return x._id - y._id;
+        });
+        return doc;
+    }
+
+    function lookupMetrics() {
+        return db.serverStatus().metrics.aggregate.lookup;
+    }
+
+    function setJoinParameters(batchSize, hashJoinMaxDocuments) {
+        assert.commandWorked(db.adminCommand({
+            setParameter: 1,
+            internalDocumentSourceLookupBatchSize: batchSize,
+            internalDocumentSourceLookupHashJoinMaxDocuments: hashJoinMaxDocuments
+        }));
+    }
+
+    function runWith(batchSize, hashJoinMaxDocuments) {
+        setJoinParameters(batchSize, hashJoinMaxDocuments);
+
+        var before = lookupMetrics();
+        var joined = local.aggregate([lookup, {$sort: {_id: 1}}]).toArray().map(sortJoined);
+        var unwound = local.aggregate([
+                               lookup,
+                               {$unwind: {path: "$joined", preserveNullAndEmptyArrays: true}},
+                               {$sort: {_id: 1, "joined._id": 1}}
+                           ]).toArray();
+        var after = lookupMetrics();
+        var blocks = {};
+        ["nestedLoopBlocks", "batchedInBlocks", "hashBlocks"].forEach(function(name) {
+            blocks[name] = after[name] - before[name];
+        });
+        return {blocks: blocks, joined: joined, unwound: unwound};
+    }
+
+    var original = assert.commandWorked(db.adminCommand({
+        getParameter: 1,
+        internalDocumentSourceLookupBatchSize: 1,
+        internalDocumentSourceLookupHashJoinMaxDocuments: 1
+    }));
+
+    try {
+        var nestedLoop = runWith(1, 0);
+        var batchedIn = runWith(3, 0);
+        var hash = runWith(3, 1000);
+
+        assert.eq({nestedLoopBlocks: 2 * localDocs.length, batchedInBlocks: 0, hashBlocks: 0},
+                  nestedLoop.blocks);
+        assert.eq({nestedLoopBlocks: 0, batchedInBlocks: 6, hashBlocks: 0}, batchedIn.blocks);
+        assert.eq({nestedLoopBlocks: 0, batchedInBlocks: 0, hashBlocks: 6}, hash.blocks);
+
+        // Explain does not run the join, and does not report on it.
+        var explain = local.aggregate([lookup], {explain: true});
+        assert(!explain.stages[1].$lookup.hasOwnProperty("joinStats"), tojson(explain));
+
+        assert.eq(nestedLoop.joined, batchedIn.joined);
+        assert.eq(nestedLoop.joined, hash.joined);
+        assert.eq(nestedLoop.unwound, batchedIn.unwound);
+        assert.eq(nestedLoop.unwound, hash.unwound);
+
+        // Sanity check the reference results.
+        assert.eq([0, 3], nestedLoop.joined[0].joined.map(function(doc) {
+            return doc._id;
+        }));
+        assert.eq([1, 2], nestedLoop.joined[2].joined.map(function(doc) {
+            return doc._id;
+        }));
+
+        // The same local value is only looked up once per block.
+        assert.commandWorked(db.adminCommand(
+            {setParameter: 1, internalDocumentSourceLookupHashJoinMaxDocuments: 0}));
+        var sameValue = db.lookup_join_strategies_same;
+        sameValue.drop();
+        for (var i = 0; i < 50; i++) {
+            assert.writeOK(sameValue.insert({_id: i, a: 1}));
+        }
+        var results = sameValue.aggregate([lookup]).toArray();
+        assert.eq(50, results.length);
+        results.forEach(function(doc) {
+            assert.eq(2, doc.joined.length, tojson(doc));
+        });
+
+        // Local values too large to fit in a single $in query are split over several.
+        var large = db.lookup_join_strategies_large;
+        large.drop();
+        var padding = new Array(1024 * 1024).join("x");
+        for (var i = 0; i < 20; i++) {
+            assert.writeOK(large.insert({_id: i, a: padding + i}));
+        }
+        assert.writeOK(foreign.insert({_id: "large", b: padding + 7}));
+        setJoinParameters(20, 0);
+        results =
+            large.aggregate([lookup, {$project: {joined: "$joined._id"}}, {$sort: {_id: 1}}])
+                .toArray();
+        assert.eq(20, results.length);
+        results.forEach(function(doc) {
+            assert.eq(doc._id === 7 ? ["large"] : [], doc.joined, tojson(doc));
+        });
+        assert.writeOK(foreign.remove({_id: "large"}));
+
+        // The hash join reloads the foreign collection for each block, so documents inserted into
+        // it while the aggregation is running are seen by the blocks joined afterwards.
+        setJoinParameters(3, 1000);
+        var res = assert.commandWorked(db.runCommand({
+            aggregate: sameValue.getName(),
+            pipeline: [lookup],
+            cursor: {batchSize: 1}
+        }));
+        assert.eq(2, res.cursor.firstBatch[0].joined.length);
+        assert.writeOK(foreign.insert({_id: "late", b: 1}));
+        results = new DBCommandCursor(db.getMongo(), res).toArray();
+        assert.eq(50, results.length);
+        assert.eq(3, results[49].joined.length, tojson(results[49]));
+        assert.writeOK(foreign.remove({_id: "late"}));
+    } finally {
+        assert.commandWorked(db.adminCommand({
+            setParameter: 1,
+            internalDocumentSourceLookupBatchSize: original.internalDocumentSourceLookupBatchSize,
+            internalDocumentSourceLookupHashJoinMaxDocuments:
+                original.internalDocumentSourceLookupHashJoinMaxDocuments
+        }));
+    }
+})();
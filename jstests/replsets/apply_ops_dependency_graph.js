@@ -0,0 +1,50 @@
+// Check that a secondary applying batches through the oplog dependency graph ends up with the
+// same documents as the primary when many operations target the same documents, and that the
+// dependency graph metrics are reported in serverStatus.
+
+(function() {
+    "use strict";
+
+    var replTest = new ReplSetTest({name: 'apply_ops_dependency_graph',
+                                    nodes: 2,
+                                    nodeOptions: {setParameter: "replApplyUsingDependencyGraph=true"}});
+    replTest.startSet();
+    replTest.initiate();
+
+    var master = replTest.getPrimary();
+    var slave = replTest.liveNodes.slaves[0];
+
+    var masterColl = master.getDB("test").dependency_graph;
+    var slaveColl = slave.getDB("test").dependency_graph;
+
+    // Interleave inserts, updates and deletes on a small set of hot documents so that each
+    // batch contains long chains of dependent operations.
+    const nDocuments = 100;
+    var batch = masterColl.initializeOrderedBulkOp();
+    for (var i = 0; i < nDocuments; i++) {
+        batch.insert({_id: i, n: 0});
+    }
+    for (var round = 0; round < 20; round++) {
+        for (var i = 0; i < nDocuments; i++) {
+            batch.find({_id: i}).updateOne({$inc: {n: 1}});
+        }
+    }
+    for (var i = 0; i < nDocuments; i += 2) {
+        batch.find({_id: i}).removeOne();
+    }
+    assert.writeOK(batch.execute());
+    replTest.awaitReplication();
+
+    assert.eq(nDocuments / 2, slaveColl.count());
+    slaveColl.find().forEach(function(doc) {
+        assert.eq(1, doc._id % 2, tojson(doc));
+        assert.eq(20, doc.n, tojson(doc));
+    });
+
+    var metrics = slave.getDB("admin").serverStatus().metrics.repl.apply.dependencyGraph;
+    assert.gt(metrics.batches.num, 0, tojson(metrics));
+    assert.gt(metrics.chains, 0, tojson(metrics));
+    assert.gt(metrics.criticalPathOps, 0, tojson(metrics));
+
+    replTest.stopSet();
+})();
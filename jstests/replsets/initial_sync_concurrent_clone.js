@@ -0,0 +1,72 @@
+// Tests that initial sync clones the collections of a database concurrently when
+// initialSyncMaxConcurrentCollectionCloners is above one, and that replSetGetStatus reports the
+// progress of each collection while initial sync runs.
+
+(function() {
+    'use strict';
+
+    var name = 'initial_sync_concurrent_clone';
+    var replTest = new ReplSetTest({name: name, nodes: 1});
+    replTest.startSet();
+    replTest.initiate();
+
+    var primary = replTest.getPrimary();
+    var testDB = primary.getDB('test');
+
+    var kNumCollections = 6;
+    var kNumDocs = 1000;
+    for (var i = 0; i < kNumCollections; i++) {
+        var coll = testDB['coll' + i];
+        assert.commandWorked(coll.ensureIndex({x: 1}));
+        var bulk = coll.initializeUnorderedBulkOp();
+        for (var j = 0; j < kNumDocs; j++) {
+            bulk.insert({_id: j, x: j});
+        }
+        assert.writeOK(bulk.execute());
+    }
+
+    // Pause the new node once it has cloned the documents, before it builds the secondary
+    // indexes. It only starts initial sync once it is part of the config.
+    var secondary = replTest.add({setParameter: 'initialSyncMaxConcurrentCollectionCloners=3'});
+    assert.commandWorked(secondary.adminCommand(
+        {configureFailPoint: 'initialSyncHangAfterDataCloning', mode: 'alwaysOn'}));
+    replTest.reInitiate();
+
+    var progress;
+    assert.soon(function() {
+        var status = assert.commandWorked(secondary.adminCommand({replSetGetStatus: 1}));
+        if (!status.initialSyncStatus || !status.initialSyncStatus.databases.test) {
+            return false;
+        }
+        progress = status.initialSyncStatus.databases.test;
+        return progress.length === kNumCollections && progress.every(function(coll) {
+            return coll.end !== undefined;
+        });
+    }, 'initial sync did not report the progress of every collection');
+
+    progress.forEach(function(coll) {
+        assert.eq(kNumDocs, coll.documentsCopied, tojson(coll));
+        assert.gt(coll.bytesCopied, 0, tojson(coll));
+        assert.gt(coll.fetchedBatches, 0, tojson(coll));
+        assert.lte(coll.start, coll.end, tojson(coll));
+    });
+
+    assert.commandWorked(secondary.adminCommand(
+        {configureFailPoint: 'initialSyncHangAfterDataCloning', mode: 'off'}));
+    replTest.awaitSecondaryNodes();
+    replTest.awaitReplication();
+
+    // The progress is only reported while initial sync runs.
+    var status = assert.commandWorked(secondary.adminCommand({replSetGetStatus: 1}));
+    assert(!status.initialSyncStatus, tojson(status));
+
+    secondary.setSlaveOk();
+    var secondaryDB = secondary.getDB('test');
+    for (var i = 0; i < kNumCollections; i++) {
+        var coll = secondaryDB['coll' + i];
+        assert.eq(kNumDocs, coll.find().itcount());
+        assert.eq(2, coll.getIndexes().length, tojson(coll.getIndexes()));
+    }
+
+    replTest.stopSet();
+})();
@@ -0,0 +1,135 @@
+// Tests that with readFromCommittedSnapshotDuringBatchApplication set, reads on a secondary which is
+// applying a batch are served from the committed snapshot if it is recent enough, and wait for
+// the batch otherwise. Checks the repl.snapshotReads metrics for both cases.
+(function() {
+    'use strict';
+
+    var name = "read_committed_during_batch_application";
+    var replTest = new ReplSetTest(
+        {name: name, nodes: 3, nodeOptions: {enableMajorityReadConcern: ''}});
+    var nodes = replTest.nodeList();
+
+    try {
+        replTest.startSet();
+    } catch (e) {
+        var conn = MongoRunner.runMongod();
+        if (!conn.getDB('admin').serverStatus().storageEngine.supportsCommittedReads) {
+            jsTest.log("skipping test since storage engine doesn't support committed reads");
+            MongoRunner.stopMongod(conn);
+            return;
+        }
+        throw e;
+    }
+
+    replTest.initiate({
+        "_id": name,
+        "members": [
+            {"_id": 0, "host": nodes[0]},
+            {"_id": 1, "host": nodes[1], priority: 0},
+            {"_id": 2, "host": nodes[2], arbiterOnly: true}
+        ]
+    });
+
+    var primary = replTest.getPrimary();
+    var secondary = replTest.liveNodes.slaves[0];
+    secondary.setSlaveOk();
+
+    var collPrimary = primary.getDB(name)[name];
+    var dbSecondary = secondary.getDB(name);
+
+    assert.commandWorked(secondary.adminCommand(
+        {setParameter: 1, readFromCommittedSnapshotDuringBatchApplication: true}));
+
+    function snapshotReads() {
+        return dbSecondary.serverStatus().metrics.repl.snapshotReads;
+    }
+
+    function waitForCommittedSnapshot(id) {
+        assert.soon(function() {
+            var res = dbSecondary.runCommand(
+                {find: name, filter: {_id: id}, readConcern: {level: "majority"}});
+            return res.ok && res.cursor.firstBatch.length === 1;
+        }, "committed snapshot on the secondary does not include _id " + id);
+    }
+
+    function hangBatchApplication() {
+        assert.commandWorked(secondary.adminCommand(
+            {configureFailPoint: 'rsSyncApplyHangDuringBatch', mode: 'alwaysOn'}));
+    }
+
+    function waitForBatchToHang(logLinesBefore) {
+        assert.soon(function() {
+            var log = secondary.adminCommand({getLog: "global"}).log;
+            for (var i = logLinesBefore; i < log.length; i++) {
+                if (log[i].indexOf("rsSyncApplyHangDuringBatch fail point enabled") !== -1) {
+                    return true;
+                }
+            }
+            return false;
+        }, "batch application did not reach the fail point");
+    }
+
+    function logLines() {
+        return secondary.adminCommand({getLog: "global"}).log.length;
+    }
+
+    function releaseBatchApplication() {
+        assert.commandWorked(secondary.adminCommand(
+            {configureFailPoint: 'rsSyncApplyHangDuringBatch', mode: 'off'}));
+    }
+
+    // A recent committed snapshot is read instead of waiting for the batch.
+    assert.writeOK(collPrimary.insert({_id: 0}, {writeConcern: {w: 2, wtimeout: 60 * 1000}}));
+    waitForCommittedSnapshot(0);
+
+    var before = snapshotReads();
+    var linesBefore = logLines();
+    hangBatchApplication();
+    assert.writeOK(collPrimary.insert({_id: 1}));
+    waitForBatchToHang(linesBefore);
+
+    var res = assert.commandWorked(dbSecondary.runCommand({find: name, sort: {_id: 1}}));
+    assert.eq([{_id: 0}], res.cursor.firstBatch);
+
+    var after = snapshotReads();
+    assert.eq(before.staleness.num + 1, after.staleness.num, tojson(after));
+    assert.eq(before.fallbacks, after.fallbacks, tojson(after));
+
+    releaseBatchApplication();
+    waitForCommittedSnapshot(1);
+
+    // A committed snapshot which lags the last applied operation by more than
+    // readFromCommittedSnapshotMaxStalenessSecs is not used, and the read waits for the batch.
+    assert.commandWorked(
+        secondary.adminCommand({configureFailPoint: 'disableSnapshotting', mode: 'alwaysOn'}));
+    sleep(2500);
+    assert.writeOK(collPrimary.insert({_id: 2}, {writeConcern: {w: 2, wtimeout: 60 * 1000}}));
+
+    before = snapshotReads();
+    linesBefore = logLines();
+    hangBatchApplication();
+    assert.writeOK(collPrimary.insert({_id: 3}));
+    waitForBatchToHang(linesBefore);
+
+    var awaitRead = startParallelShell(
+        "db.getMongo().setSlaveOk();" +
+            "var docs = db.getSiblingDB('" + name + "')." + name +
+            ".find().sort({_id: 1}).toArray();" +
+            "assert.eq([{_id: 0}, {_id: 1}, {_id: 2}, {_id: 3}], docs);",
+        secondary.port);
+
+    assert.soon(function() {
+        return snapshotReads().fallbacks > before.fallbacks;
+    }, "read did not fall back to waiting for the batch");
+
+    releaseBatchApplication();
+    awaitRead();
+
+    after = snapshotReads();
+    assert.eq(before.staleness.num, after.staleness.num, tojson(after));
+    assert.eq(before.fallbacks + 1, after.fallbacks, tojson(after));
+
+    assert.commandWorked(
+        secondary.adminCommand({configureFailPoint: 'disableSnapshotting', mode: 'off'}));
+    replTest.stopSet();
+}());
@@ -0,0 +1,115 @@
+// Tests that documents deleted and reinserted in a chunk while it is being cloned end up on the
+// recipient exactly once and with their latest contents. The recipient fetches the _migrateClone
+// batches on a separate thread, buffering at most migrateCloneMaxBufferedBatches of them, so the
+// migration is run with one buffered batch and with several. The chunk spans several batches.
+// Deletes made after the donor recorded the documents to clone are skipped through the donor's
+// set of deleted clone locations, and their record ids may be reused by the reinserts.
+
+load('./jstests/libs/chunk_manipulation_util.js');
+
+(function() {
+    'use strict';
+
+    var staticMongod = MongoRunner.runMongod({});  // For startParallelOps.
+    var st = new ShardingTest({shards: 2, mongos: 1});
+    st.stopBalancer();
+
+    var mongos = st.s0;
+    var admin = mongos.getDB('admin');
+    var dbName = 'test';
+    var collName = 'migration_clone_concurrent_writes';
+    var ns = dbName + '.' + collName;
+    var coll = mongos.getCollection(ns);
+
+    assert.commandWorked(admin.runCommand({enableSharding: dbName}));
+    st.ensurePrimaryShard(dbName, st.shard0.shardName);
+    assert.commandWorked(admin.runCommand({shardCollection: ns, key: {_id: 1}}));
+
+    // 64 documents of 512KB make up about three _migrateClone batches of at most 16MB.
+    var kNumDocs = 64;
+    var pad = new Array(512 * 1024).join('x');
+    var bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < kNumDocs; i++) {
+        bulk.insert({_id: i, pad: pad, version: 0});
+    }
+    assert.writeOK(bulk.execute());
+
+    // Moves the single chunk to 'recipient'. While the recipient is paused before cloning, deletes
+    // some documents and reinserts some of them. Then rewrites others while the clone runs.
+    // Returns the expected version of each remaining document.
+    function migrateWithConcurrentWrites(recipient, maxBufferedBatches, round) {
+        jsTest.log('Migrating to ' + recipient.shardName + ' with ' + maxBufferedBatches +
+                   ' buffered clone batches');
+        assert.commandWorked(recipient.adminCommand(
+            {setParameter: 1, migrateCloneMaxBufferedBatches: maxBufferedBatches}));
+
+        pauseMigrateAtStep(recipient, migrateStepNames.deletedPriorDataInRange);
+        var joinMoveChunk =
+            moveChunkParallel(staticMongod, mongos.host, {_id: 0}, null, ns, recipient.shardName);
+        waitForMigrateStep(recipient, migrateStepNames.deletedPriorDataInRange);
+
+        // The donor has recorded the documents to clone, and the recipient has not fetched any.
+        var expected = {};
+        for (var i = 0; i < kNumDocs; i++) {
+            expected[i] = coll.findOne({_id: i}, {version: 1}).version;
+        }
+        for (var i = 0; i < 16; i += 2) {
+            assert.writeOK(coll.remove({_id: i}));
+            delete expected[i];
+        }
+        for (var i = 0; i < 16; i += 4) {
+            assert.writeOK(coll.insert({_id: i, pad: pad, version: round}));
+            expected[i] = round;
+        }
+
+        // Rewrite the second quarter of the documents while the batches are being fetched.
+        pauseMigrateAtStep(recipient, migrateStepNames.cloned);
+        var awaitWrites = startParallelShell(
+            'var coll = db.getSiblingDB("' + dbName + '").' + collName + ';' +
+                'var pad = new Array(512 * 1024).join("x");' +
+                'for (var i = 16; i < 32; i++) {' +
+                '    assert.writeOK(coll.remove({_id: i}));' +
+                '    assert.writeOK(coll.insert({_id: i, pad: pad, version: ' + round + '}));' +
+                '}',
+            mongos.port);
+        for (var i = 16; i < 32; i++) {
+            expected[i] = round;
+        }
+        unpauseMigrateAtStep(recipient, migrateStepNames.deletedPriorDataInRange);
+        waitForMigrateStep(recipient, migrateStepNames.cloned);
+        awaitWrites();
+        unpauseMigrateAtStep(recipient, migrateStepNames.cloned);
+        joinMoveChunk();
+
+        return expected;
+    }
+
+    function checkDocuments(shard, expected) {
+        var shardColl = shard.getCollection(ns);
+        var docs = shardColl.find({}, {version: 1}).sort({_id: 1}).toArray();
+        assert.eq(Object.keys(expected).length, docs.length, tojson(docs));
+        docs.forEach(function(doc) {
+            assert.eq(expected[doc._id], doc.version, 'unexpected version of ' + tojson(doc));
+        });
+        assert.eq(Object.keys(expected).length, coll.find().itcount());
+    }
+
+    var expected = migrateWithConcurrentWrites(st.shard1, 1, 1);
+    checkDocuments(st.shard1, expected);
+    assert.eq(0, st.shard0.getCollection(ns).count());
+
+    // Move the chunk back, reinserting the documents deleted by the first round.
+    assert.writeOK(coll.remove({}));
+    bulk = coll.initializeUnorderedBulkOp();
+    for (var i = 0; i < kNumDocs; i++) {
+        bulk.insert({_id: i, pad: pad, version: 0});
+    }
+    assert.writeOK(bulk.execute());
+
+    expected = migrateWithConcurrentWrites(st.shard0, 4, 2);
+    checkDocuments(st.shard0, expected);
+    assert.eq(0, st.shard1.getCollection(ns).count());
+
+    st.stop();
+    MongoRunner.stopMongod(staticMongod);
+})();
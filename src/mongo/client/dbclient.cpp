@@ -875,6 +875,8 @@ StatusWith<executor::RemoteCommandResponse> initWireVersion(DBClientConnection*
             bob.append("hostInfo", sb.str());
         }
 
+        conn->port().compressorManager().clientBegin(&bob);
+
         Date_t start{Date_t::now()};
         auto result =
             conn->runCommandWithMetadata("admin", "isMaster", rpc::makeEmptyMetadata(), bob.done());
@@ -882,6 +884,8 @@ StatusWith<executor::RemoteCommandResponse> initWireVersion(DBClientConnection*
 
         BSONObj isMasterObj = result->getCommandReply().getOwned();
 
+        conn->port().compressorManager().clientFinish(isMasterObj);
+
         if (isMasterObj.hasField("minWireVersion") && isMasterObj.hasField("maxWireVersion")) {
             int minWireVersion = isMasterObj["minWireVersion"].numberInt();
             int maxWireVersion = isMasterObj["maxWireVersion"].numberInt();
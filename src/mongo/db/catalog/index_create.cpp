@@ -34,6 +34,7 @@
 
 #include "mongo/db/catalog/index_create.h"
 
+#include <algorithm>
 
 #include "mongo/base/error_codes.h"
 #include "mongo/client/dbclientinterface.h"
@@ -48,7 +49,12 @@
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
 #include "mongo/stdx/mutex.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/log.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/progress_meter.h"
@@ -59,6 +65,8 @@ using std::unique_ptr;
 using std::string;
 using std::endl;
 
+MONGO_EXPORT_SERVER_PARAMETER(indexBuildThreads, int, 1);
+
 /**
  * On rollback sets MultiIndexBlock::_needToCleanup to true.
  */
@@ -93,6 +101,288 @@ private:
     MultiIndexBlock* const _indexer;
 };
 
+/**
+ * Generates and sorts the keys of a foreground index build on a pool of worker threads.
+ *
+ * The collection scan stays on the thread of the operation, which hands the documents over in
+ * batches. Each batch is split into one contiguous range of documents per worker, and every
+ * worker has its own BulkBuilder for each index, so that key generation and sorting need no
+ * synchronization. The BulkBuilders of an index are merged when it is loaded. The scan fills the
+ * next batch while the workers process the previous one, and the keys of the next indexes are
+ * sorted while an index is loaded.
+ */
+class MultiIndexBlock::ParallelBulkBuild {
+    MONGO_DISALLOW_COPYING(ParallelBulkBuild);
+
+public:
+    using BulkBuilder = IndexAccessMethod::BulkBuilder;
+
+    ParallelBulkBuild(const std::vector<IndexToBuild>& indexes, size_t numThreads);
+    ~ParallelBulkBuild();
+
+    /**
+     * Adds a copy of 'doc' to the current batch, and hands the batch to the workers once it is
+     * full. Returns the first error hit by a worker.
+     */
+    Status add(const BSONObj& doc, const RecordId& loc);
+
+    /**
+     * Hands the last batch to the workers and starts sorting the keys of every index once all of
+     * them are generated. Returns the first error hit by a worker.
+     */
+    Status doneAdding();
+
+    /**
+     * Waits until the keys of the index at 'indexNum' are sorted and moves its BulkBuilders into
+     * 'bulks'. Returns the first error hit by a worker, or the interruption of 'txn' while
+     * waiting if 'mayInterrupt' is true.
+     */
+    Status takeSortedBulks(OperationContext* txn,
+                           bool mayInterrupt,
+                           size_t indexNum,
+                           std::vector<std::unique_ptr<BulkBuilder>>* bulks);
+
+private:
+    struct Index {
+        IndexAccessMethod* real;
+        const MatchExpression* filterExpression;
+        InsertDeleteOptions options;
+
+        // One per worker.
+        std::vector<std::unique_ptr<BulkBuilder>> bulks;
+        size_t sortsRemaining = 0;
+    };
+
+    using Batch = std::vector<std::pair<BSONObj, RecordId>>;
+
+    // A batch is handed to the workers once it reaches either limit.
+    static const size_t kMaxBatchDocuments = 10 * 1000;
+    static const size_t kMaxBatchBytes = 16 * 1024 * 1024;
+
+    // Each worker spills its keys to its own files, and a smaller share of the memory makes it
+    // spill more often. The BulkBuilders share a budget of kMaxSpillFiles open spill files, and
+    // each merges its files into one when it reaches its share, but no fewer than
+    // kMinSpillFilesPerBulk.
+    static const size_t kMaxSpillFiles = 512;
+    static const size_t kMinSpillFilesPerBulk = 8;
+
+    // How often takeSortedBulks() checks for interruption while it waits.
+    static const Milliseconds kInterruptCheckPeriod;
+
+    Status _handOffBatch();
+    void _generateKeys(size_t worker, size_t begin, size_t end);
+    void _sort(size_t indexNum, size_t worker);
+
+    void _setError(const Status& status);
+    Status _getError();
+
+    const size_t _numThreads;
+    std::vector<Index> _indexes;
+
+    Batch _filling;
+    size_t _fillingBytes = 0;
+    Batch _processing;
+
+    // Set on the first error, or when the build is abandoned, so that the workers stop early.
+    AtomicWord<bool> _stopping{false};
+
+    // Guards _status and Index::sortsRemaining.
+    stdx::mutex _mutex;
+    stdx::condition_variable _sorted;
+    Status _status = Status::OK();
+
+    ThreadPool _pool;
+};
+
+namespace {
+
+ThreadPool::Options makeIndexBuildPoolOptions(size_t numThreads) {
+    ThreadPool::Options options;
+    options.poolName = "IndexBuild";
+    options.threadNamePrefix = "indexBuild-";
+    options.minThreads = numThreads;
+    options.maxThreads = numThreads;
+    return options;
+}
+
+}  // namespace
+
+const size_t MultiIndexBlock::ParallelBulkBuild::kMaxBatchDocuments;
+const size_t MultiIndexBlock::ParallelBulkBuild::kMaxBatchBytes;
+const size_t MultiIndexBlock::ParallelBulkBuild::kMaxSpillFiles;
+const size_t MultiIndexBlock::ParallelBulkBuild::kMinSpillFilesPerBulk;
+const Milliseconds MultiIndexBlock::ParallelBulkBuild::kInterruptCheckPeriod(100);
+
+MultiIndexBlock::ParallelBulkBuild::ParallelBulkBuild(const std::vector<IndexToBuild>& indexes,
+                                                      size_t numThreads)
+    : _numThreads(numThreads), _pool(makeIndexBuildPoolOptions(numThreads)) {
+    // The workers share the memory a single BulkBuilder would use.
+    const size_t maxMemoryUsageBytes =
+        IndexAccessMethod::kDefaultBulkBuilderMemoryUsageBytes / numThreads;
+    const size_t maxSpillFiles =
+        std::max(kMinSpillFilesPerBulk, kMaxSpillFiles / (numThreads * indexes.size()));
+
+    for (const IndexToBuild& indexToBuild : indexes) {
+        Index index;
+        index.real = indexToBuild.real;
+        index.filterExpression = indexToBuild.filterExpression;
+        index.options = indexToBuild.options;
+        for (size_t i = 0; i < numThreads; i++) {
+            index.bulks.push_back(index.real->initiateBulk(maxMemoryUsageBytes, maxSpillFiles));
+        }
+        _indexes.push_back(std::move(index));
+    }
+
+    _pool.startup();
+}
+
+MultiIndexBlock::ParallelBulkBuild::~ParallelBulkBuild() {
+    _stopping.store(true);
+    _pool.shutdown();
+    _pool.join();
+}
+
+Status MultiIndexBlock::ParallelBulkBuild::add(const BSONObj& doc, const RecordId& loc) {
+    _filling.emplace_back(doc.getOwned(), loc);
+    _fillingBytes += doc.objsize();
+    if (_filling.size() < kMaxBatchDocuments && _fillingBytes < kMaxBatchBytes) {
+        return Status::OK();
+    }
+    return _handOffBatch();
+}
+
+Status MultiIndexBlock::ParallelBulkBuild::doneAdding() {
+    Status status = _handOffBatch();
+    if (!status.isOK()) {
+        return status;
+    }
+
+    _pool.waitForIdle();
+    status = _getError();
+    if (!status.isOK()) {
+        return status;
+    }
+    _processing.clear();
+
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        for (Index& index : _indexes) {
+            index.sortsRemaining = _numThreads;
+        }
+    }
+
+    // Sort the indexes in the order they are loaded in.
+    for (size_t i = 0; i < _indexes.size(); i++) {
+        for (size_t worker = 0; worker < _numThreads; worker++) {
+            invariantOK(_pool.schedule([this, i, worker] { _sort(i, worker); }));
+        }
+    }
+    return Status::OK();
+}
+
+Status MultiIndexBlock::ParallelBulkBuild::takeSortedBulks(
+    OperationContext* txn,
+    bool mayInterrupt,
+    size_t indexNum,
+    std::vector<std::unique_ptr<BulkBuilder>>* bulks) {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    Index& index = _indexes[indexNum];
+    while (!_sorted.wait_for(
+        lk, kInterruptCheckPeriod, [&index] { return index.sortsRemaining == 0; })) {
+        if (!mayInterrupt) {
+            continue;
+        }
+        Status interruptStatus = txn->checkForInterruptNoAssert();
+        if (!interruptStatus.isOK()) {
+            // Have the workers skip the sorts which have not started yet.
+            _stopping.store(true);
+            return interruptStatus;
+        }
+    }
+    if (!_status.isOK()) {
+        return _status;
+    }
+
+    *bulks = std::move(index.bulks);
+    return Status::OK();
+}
+
+Status MultiIndexBlock::ParallelBulkBuild::_handOffBatch() {
+    // Wait for the workers to be done with the previous batch.
+    _pool.waitForIdle();
+    Status status = _getError();
+    if (!status.isOK()) {
+        return status;
+    }
+
+    _processing.clear();
+    _processing.swap(_filling);
+    _fillingBytes = 0;
+
+    const size_t size = _processing.size();
+    for (size_t worker = 0; worker < _numThreads; worker++) {
+        const size_t begin = size * worker / _numThreads;
+        const size_t end = size * (worker + 1) / _numThreads;
+        if (begin < end) {
+            invariantOK(_pool.schedule(
+                [this, worker, begin, end] { _generateKeys(worker, begin, end); }));
+        }
+    }
+    return Status::OK();
+}
+
+void MultiIndexBlock::ParallelBulkBuild::_generateKeys(size_t worker, size_t begin, size_t end) {
+    try {
+        for (size_t i = begin; i < end && !_stopping.load(); i++) {
+            const BSONObj& doc = _processing[i].first;
+            const RecordId& loc = _processing[i].second;
+            for (Index& index : _indexes) {
+                if (index.filterExpression && !index.filterExpression->matchesBSON(doc)) {
+                    continue;
+                }
+
+                int64_t unused;
+                Status status = index.bulks[worker]->insert(NULL, doc, loc, index.options, &unused);
+                if (!status.isOK()) {
+                    _setError(status);
+                    return;
+                }
+            }
+        }
+    } catch (...) {
+        _setError(exceptionToStatus());
+    }
+}
+
+void MultiIndexBlock::ParallelBulkBuild::_sort(size_t indexNum, size_t worker) {
+    Index& index = _indexes[indexNum];
+    if (!_stopping.load()) {
+        try {
+            index.bulks[worker]->sort();
+        } catch (...) {
+            _setError(exceptionToStatus());
+        }
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (--index.sortsRemaining == 0) {
+        _sorted.notify_all();
+    }
+}
+
+void MultiIndexBlock::ParallelBulkBuild::_setError(const Status& status) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_status.isOK()) {
+        _status = status;
+    }
+    _stopping.store(true);
+}
+
+Status MultiIndexBlock::ParallelBulkBuild::_getError() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _status;
+}
+
 MultiIndexBlock::MultiIndexBlock(OperationContext* txn, Collection* collection)
     : _collection(collection),
       _txn(txn),
@@ -102,6 +392,9 @@ MultiIndexBlock::MultiIndexBlock(OperationContext* txn, Collection* collection)
       _needToCleanup(true) {}
 
 MultiIndexBlock::~MultiIndexBlock() {
+    // The workers must be stopped before the indexes they generate keys for are dropped.
+    _parallelBulkBuild.reset();
+
     if (!_needToCleanup || _indexes.empty())
         return;
     while (true) {
@@ -227,6 +520,19 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
 
     unsigned long long n = 0;
 
+    // Only foreground builds use BulkBuilders, which are what can be filled on several threads.
+    const bool allBulk = std::all_of(_indexes.begin(),
+                                     _indexes.end(),
+                                     [](const IndexToBuild& index) { return bool(index.bulk); });
+    const int numThreads = indexBuildThreads.load();
+    if (allBulk && numThreads > 1 && !_indexes.empty()) {
+        log() << "\t generating and sorting keys on " << numThreads << " threads";
+        _parallelBulkBuild = stdx::make_unique<ParallelBulkBuild>(_indexes, numThreads);
+        for (IndexToBuild& index : _indexes) {
+            index.bulk.reset();
+        }
+    }
+
     unique_ptr<PlanExecutor> exec(InternalPlanner::collectionScan(
         _txn, _collection->ns().ns(), _collection, PlanExecutor::YIELD_MANUAL));
     if (_buildInBackground) {
@@ -257,6 +563,19 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
             // Done before insert so we can retry document if it WCEs.
             progress->setTotalWhileRunning(_collection->numRecords(_txn));
 
+            if (_parallelBulkBuild) {
+                // Failing to add keys to a BulkBuilder fails the build, as in insert().
+                Status ret = _parallelBulkBuild->add(objToIndex.value(), loc);
+                if (!ret.isOK()) {
+                    return ret;
+                }
+
+                progress->hit();
+                n++;
+                retries = 0;
+                continue;
+            }
+
             WriteUnitOfWork wunit(_txn);
             Status ret = insert(objToIndex.value(), loc);
             if (ret.isOK()) {
@@ -292,6 +611,13 @@ Status MultiIndexBlock::insertAllDocumentsInCollection(std::set<RecordId>* dupsO
                 WorkingSetCommon::toStatusString(objToIndex.value()),
             state == PlanExecutor::IS_EOF);
 
+    if (_parallelBulkBuild) {
+        Status ret = _parallelBulkBuild->doneAdding();
+        if (!ret.isOK()) {
+            return ret;
+        }
+    }
+
     progress->finished();
 
     Status ret = doneInserting(dupsOut);
@@ -326,12 +652,23 @@ Status MultiIndexBlock::insert(const BSONObj& doc, const RecordId& loc) {
 
 Status MultiIndexBlock::doneInserting(std::set<RecordId>* dupsOut) {
     for (size_t i = 0; i < _indexes.size(); i++) {
-        if (_indexes[i].bulk == NULL)
+        std::vector<std::unique_ptr<IndexAccessMethod::BulkBuilder>> bulks;
+        if (_parallelBulkBuild) {
+            Status status =
+                _parallelBulkBuild->takeSortedBulks(_txn, _allowInterruption, i, &bulks);
+            if (!status.isOK()) {
+                return status;
+            }
+        } else if (_indexes[i].bulk) {
+            bulks.push_back(std::move(_indexes[i].bulk));
+        } else {
             continue;
+        }
+
         LOG(1) << "\t bulk commit starting for index: "
                << _indexes[i].block->getEntry()->descriptor()->indexName();
         Status status = _indexes[i].real->commitBulk(_txn,
-                                                     std::move(_indexes[i].bulk),
+                                                     std::move(bulks),
                                                      _allowInterruption,
                                                      _indexes[i].options.dupsAllowed,
                                                      dupsOut);
@@ -340,10 +677,12 @@ Status MultiIndexBlock::doneInserting(std::set<RecordId>* dupsOut) {
         }
     }
 
+    _parallelBulkBuild.reset();
     return Status::OK();
 }
 
 void MultiIndexBlock::abortWithoutCleanup() {
+    _parallelBulkBuild.reset();
     _indexes.clear();
     _needToCleanup = false;
 }
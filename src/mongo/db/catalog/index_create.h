@@ -30,6 +30,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
@@ -47,6 +48,10 @@ class BSONObj;
 class Collection;
 class OperationContext;
 
+// Number of threads that generate and sort the keys of foreground index builds. With a single
+// thread, keys are generated and sorted on the thread running the build.
+extern std::atomic<int> indexBuildThreads;  // NOLINT
+
 /**
  * Builds one or more indexes.
  *
@@ -127,6 +132,9 @@ public:
      * the set rather than failing the build. Documents added to this set are not indexed, so
      * callers MUST either fail this index build or delete the documents from the collection.
      *
+     * Foreground builds generate and sort keys on indexBuildThreads threads, while the collection
+     * scan and the loading of the sorted keys into each index stay on the calling thread.
+     *
      * Can throw an exception if interrupted.
      *
      * Should not be called inside of a WriteUnitOfWork.
@@ -190,6 +198,7 @@ public:
 private:
     class SetNeedToCleanupOnRollback;
     class CleanupIndexesVectorOnRollback;
+    class ParallelBulkBuild;
 
     struct IndexToBuild {
 #if defined(_MSC_VER) && _MSC_VER < 1900  // MVSC++ <= 2013 can't generate default move operations
@@ -222,6 +231,10 @@ private:
 
     std::vector<IndexToBuild> _indexes;
 
+    // Set while insertAllDocumentsInCollection() builds the indexes on several threads, in which
+    // case it owns the BulkBuilders instead of _indexes.
+    std::unique_ptr<ParallelBulkBuild> _parallelBulkBuild;
+
     std::unique_ptr<BackgroundOperation> _backgroundOperation;
 
     // Pointers not owned here and must outlive 'this'
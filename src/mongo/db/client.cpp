@@ -43,6 +43,7 @@
 #include "mongo/base/status.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/service_context.h"
+#include "mongo/stdx/mutex.h"
 #include "mongo/stdx/thread.h"
 #include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/exit.h"
@@ -91,6 +92,24 @@ void Client::destroy() {
     currentClient.reset(nullptr);
 }
 
+ServiceContext::UniqueClient Client::releaseCurrent() {
+    invariant(currentClient.get());
+    invariant(currentClient.get()->get());
+    return std::move(*currentClient.get());
+}
+
+void Client::setCurrent(ServiceContext::UniqueClient client) {
+    invariant(client);
+    invariant(currentClient.getMake()->get() == nullptr);
+
+    setThreadName(client->desc().c_str());
+    {
+        stdx::lock_guard<Client> lk(*client);
+        client->_threadId = stdx::this_thread::get_id();
+    }
+    *currentClient.get() = std::move(client);
+}
+
 namespace {
 int64_t generateSeed(const std::string& desc) {
     size_t seed = 0;
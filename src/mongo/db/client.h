@@ -90,6 +90,20 @@ public:
      */
     static void destroy();
 
+    /**
+     * Detaches the Client object stored in TLS for the current thread and returns it. The current
+     * thread must have a Client.
+     *
+     * Used to serve a connection from whichever thread is free, together with setCurrent().
+     */
+    static ServiceContext::UniqueClient releaseCurrent();
+
+    /**
+     * Stores 'client' in TLS for the current thread, which must not already have a Client, and
+     * names the thread after it.
+     */
+    static void setCurrent(ServiceContext::UniqueClient client);
+
     std::string clientAddress(bool includePort = false) const;
     const std::string& desc() const {
         return _desc;
@@ -166,7 +180,7 @@ private:
     const std::string _desc;
 
     // OS id of the thread, which owns this client
-    const stdx::thread::id _threadId;
+    stdx::thread::id _threadId;
 
     // > 0 for things "conn", 0 otherwise
     const ConnectionId _connectionId;
@@ -44,7 +44,9 @@
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/document_validation.h"
 #include "mongo/db/catalog/index_create.h"
+#include "mongo/db/client.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/commands/copydb.h"
 #include "mongo/db/commands/rename_collection.h"
@@ -56,10 +58,12 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/op_observer.h"
+#include "mongo/db/operation_context_impl.h"
 #include "mongo/db/repl/isself.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/storage_options.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
@@ -77,6 +81,91 @@ MONGO_EXPORT_SERVER_PARAMETER(skipCorruptDocumentsWhenCloning, bool, false);
 
 BSONElement getErrField(const BSONObj& o);
 
+namespace {
+
+/**
+ * Connects to the source of a copyDb, authenticating as the internal user if auth is enabled.
+ */
+Status connectToSource(const ConnectionString& cs, unique_ptr<DBClientBase>* conn) {
+    std::string errmsg;
+    unique_ptr<DBClientBase> con(cs.connect(errmsg));
+    if (!con.get()) {
+        return Status(ErrorCodes::HostUnreachable, errmsg);
+    }
+
+    if (getGlobalAuthorizationManager()->isAuthEnabled() && !con->authenticateInternalUser()) {
+        return Status(ErrorCodes::AuthenticationFailed, "Unable to authenticate as internal user");
+    }
+
+    *conn = std::move(con);
+    return Status::OK();
+}
+
+}  // namespace
+
+void CloneProgress::onCollectionStart(const NamespaceString& ns) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    CollectionStats& stats = _collections[ns.ns()];
+    stats = CollectionStats();
+    stats.start = Date_t::now();
+}
+
+void CloneProgress::onBatch(const NamespaceString& ns, long long documents, long long bytes) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    CollectionStats& stats = _collections[ns.ns()];
+    stats.documentsCopied += documents;
+    stats.bytesCopied += bytes;
+    stats.fetchedBatches++;
+}
+
+void CloneProgress::onCollectionEnd(const NamespaceString& ns) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _collections[ns.ns()].end = Date_t::now();
+}
+
+void CloneProgress::clear() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _collections.clear();
+}
+
+bool CloneProgress::empty() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _collections.empty();
+}
+
+void CloneProgress::append(BSONObjBuilder* builder) const {
+    const Date_t now = Date_t::now();
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    BSONObjBuilder dbsBuilder(builder->subobjStart("databases"));
+    auto it = _collections.begin();
+    while (it != _collections.end()) {
+        const StringData dbName = nsToDatabaseSubstring(it->first);
+        BSONArrayBuilder collsBuilder(dbsBuilder.subarrayStart(dbName));
+        for (; it != _collections.end() && nsToDatabaseSubstring(it->first) == dbName; ++it) {
+            const CollectionStats& stats = it->second;
+            BSONObjBuilder collBuilder(collsBuilder.subobjStart());
+            collBuilder.append("ns", it->first);
+            collBuilder.appendNumber("documentsCopied", stats.documentsCopied);
+            collBuilder.appendNumber("bytesCopied", stats.bytesCopied);
+            collBuilder.appendNumber("fetchedBatches", stats.fetchedBatches);
+            collBuilder.appendDate("start", stats.start);
+            if (stats.end != Date_t()) {
+                collBuilder.appendDate("end", stats.end);
+            }
+
+            // Collections still being copied report their throughput so far
+            const Date_t end = (stats.end != Date_t()) ? stats.end : now;
+            const long long elapsedMillis = durationCount<Milliseconds>(end - stats.start);
+            collBuilder.appendNumber("elapsedMillis", elapsedMillis);
+            if (elapsedMillis > 0) {
+                collBuilder.append("documentsPerSecond",
+                                   stats.documentsCopied * 1000.0 / elapsedMillis);
+            }
+        }
+    }
+}
+
 /* for index info object:
      { "name" : "name_1" , "ns" : "foo.index3" , "key" :  { "name" : 1.0 } }
    we need to fix up the value in the "ns" parameter so that the name prefix is correct on a
@@ -154,6 +243,9 @@ struct Cloner::Fun {
             MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "createCollection", to_collection.ns());
         }
 
+        long long batchDocuments = 0;
+        long long batchBytes = 0;
+
         while (i.moreInCurrentBatch()) {
             if (numSeen % 128 == 127) {
                 time_t now = time(0);
@@ -234,11 +326,17 @@ struct Cloner::Fun {
                 wunit.commit();
             }
             MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "cloner insert", to_collection.ns());
+            batchDocuments++;
+            batchBytes += tmp.objsize();
             RARELY if (time(0) - saveLast > 60) {
                 log() << numSeen << " objects cloned so far from collection " << from_collection;
                 saveLast = time(0);
             }
         }
+
+        if (progress) {
+            progress->onBatch(from_collection, batchDocuments, batchBytes);
+        }
     }
 
     time_t lastLog;
@@ -252,6 +350,7 @@ struct Cloner::Fun {
     time_t saveLast;
     bool _mayYield;
     bool _mayBeInterrupted;
+    CloneProgress* progress;
 };
 
 /* copy the specified collection
@@ -265,7 +364,8 @@ void Cloner::copy(OperationContext* txn,
                   bool slaveOk,
                   bool mayYield,
                   bool mayBeInterrupted,
-                  Query query) {
+                  Query query,
+                  CloneProgress* progress) {
     LOG(2) << "\t\tcloning collection " << from_collection << " to " << to_collection << " on "
            << _conn->getServerAddress() << " with filter " << query.toString() << endl;
 
@@ -277,6 +377,7 @@ void Cloner::copy(OperationContext* txn,
     f.saveLast = time(0);
     f._mayYield = mayYield;
     f._mayBeInterrupted = mayBeInterrupted;
+    f.progress = progress;
 
     int options = QueryOption_NoCursorTimeout | (slaveOk ? QueryOption_SlaveOk : 0);
     {
@@ -460,6 +561,160 @@ bool Cloner::copyCollection(OperationContext* txn,
     return true;
 }
 
+void Cloner::copyCollectionData(OperationContext* txn,
+                                const string& toDBName,
+                                const BSONObj& collection,
+                                const CloneOptions& opts,
+                                bool masterSameProcess) {
+    const char* collectionName = collection["name"].valuestr();
+    BSONObj options = collection.getObjectField("options");
+
+    const NamespaceString from_name(opts.fromDB, collectionName);
+    const NamespaceString to_name(toDBName, collectionName);
+
+    LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
+    Query q;
+    if (opts.snapshot)
+        q.snapshot();
+
+    if (opts.progress) {
+        opts.progress->onCollectionStart(from_name);
+    }
+
+    copy(txn,
+         toDBName,
+         from_name,
+         options,
+         to_name,
+         masterSameProcess,
+         opts.slaveOk,
+         opts.mayYield,
+         opts.mayBeInterrupted,
+         q,
+         opts.progress);
+
+    if (opts.progress) {
+        opts.progress->onCollectionEnd(from_name);
+    }
+
+    // Copy releases the lock, so we need to re-load the database. This should
+    // probably throw if the database has changed in between, but for now preserve
+    // the existing behaviour.
+    Database* db = dbHolder().get(txn, toDBName);
+    uassert(18645, str::stream() << "database " << toDBName << " dropped during clone", db);
+
+    Collection* c = db->getCollection(to_name);
+    if (c && !c->getIndexCatalog()->haveIdIndex(txn)) {
+        // We need to drop objects with duplicate _ids because we didn't do a true
+        // snapshot and this is before applying oplog operations that occur during the
+        // initial sync.
+        set<RecordId> dups;
+
+        MultiIndexBlock indexer(txn, c);
+        if (opts.mayBeInterrupted) {
+            indexer.allowInterruption();
+        }
+
+        uassertStatusOK(indexer.init(c->getIndexCatalog()->getDefaultIdIndexSpec()));
+        uassertStatusOK(indexer.insertAllDocumentsInCollection(&dups));
+
+        // This must be done before we commit the indexer. See the comment about
+        // dupsAllowed in IndexCatalog::_unindexRecord and SERVER-17487.
+        for (set<RecordId>::const_iterator it = dups.begin(); it != dups.end(); ++it) {
+            WriteUnitOfWork wunit(txn);
+            c->deleteDocument(txn, *it, true, true);
+            wunit.commit();
+        }
+
+        if (!dups.empty()) {
+            log() << "index build dropped: " << dups.size() << " dups";
+        }
+
+        WriteUnitOfWork wunit(txn);
+        indexer.commit();
+        if (txn->writesAreReplicated()) {
+            getGlobalServiceContext()->getOpObserver()->onCreateIndex(
+                txn,
+                c->ns().getSystemIndexesCollection().c_str(),
+                c->getIndexCatalog()->getDefaultIdIndexSpec());
+        }
+        wunit.commit();
+    }
+}
+
+Status Cloner::copyCollectionsConcurrently(OperationContext* txn,
+                                           const string& toDBName,
+                                           const ConnectionString& cs,
+                                           const list<BSONObj>& collections,
+                                           const CloneOptions& opts) {
+    invariant(!txn->lockState()->isLocked());
+
+    const bool writesAreReplicated = txn->writesAreReplicated();
+    const bool validationDisabled = documentValidationDisabled(txn);
+
+    stdx::mutex mutex;
+    list<BSONObj>::const_iterator next = collections.begin();
+    Status status = Status::OK();
+
+    // Each worker copies the next collection nobody has started on yet, until there are none
+    // left or one of them fails. Memory is bounded by one cursor batch per worker.
+    auto worker = [&] {
+        Client::initThread("clonerWorker");
+        OperationContextImpl workerTxn;
+        workerTxn.setReplicatedWrites(writesAreReplicated);
+        documentValidationDisabled(&workerTxn) = validationDisabled;
+
+        try {
+            Cloner cloner;
+            Status connectStatus = connectToSource(cs, &cloner._conn);
+            if (!connectStatus.isOK()) {
+                stdx::lock_guard<stdx::mutex> lk(mutex);
+                if (status.isOK()) {
+                    status = connectStatus;
+                }
+                return;
+            }
+
+            while (true) {
+                BSONObj collection;
+                {
+                    stdx::lock_guard<stdx::mutex> lk(mutex);
+                    if (!status.isOK() || next == collections.end()) {
+                        return;
+                    }
+                    collection = *next++;
+                }
+
+                ScopedTransaction transaction(&workerTxn, MODE_IX);
+                Lock::DBLock dbWrite(workerTxn.lockState(), toDBName, MODE_X);
+                cloner.copyCollectionData(&workerTxn, toDBName, collection, opts, false);
+            }
+        } catch (...) {
+            // The copy on this thread failed, so let the others stop at their next collection
+            const Status workerStatus = exceptionToStatus();
+            stdx::lock_guard<stdx::mutex> lk(mutex);
+            if (status.isOK()) {
+                status = workerStatus;
+            }
+        }
+    };
+
+    const size_t numWorkers =
+        std::min(collections.size(), static_cast<size_t>(opts.maxConcurrentCollections));
+    LOG(1) << "\t copying " << collections.size() << " collections of " << opts.fromDB << " on "
+           << numWorkers << " threads";
+
+    vector<stdx::thread> workers;
+    for (size_t i = 0; i < numWorkers; i++) {
+        workers.emplace_back(worker);
+    }
+    for (auto&& thread : workers) {
+        thread.join();
+    }
+
+    return status;
+}
+
 Status Cloner::copyDb(OperationContext* txn,
                       const std::string& toDBName,
                       const string& masterHost,
@@ -494,24 +749,19 @@ Status Cloner::copyDb(OperationContext* txn,
         }
     }
 
+    // Concurrent copies make connections of their own, which cannot stand in for one the caller
+    // has set up
+    const bool mayCopyConcurrently = !_conn.get() && !masterSameProcess;
+
     {
         // setup connection
         if (_conn.get()) {
             // nothing to do
         } else if (!masterSameProcess) {
-            std::string errmsg;
-            unique_ptr<DBClientBase> con(cs.connect(errmsg));
-            if (!con.get()) {
-                return Status(ErrorCodes::HostUnreachable, errmsg);
-            }
-
-            if (getGlobalAuthorizationManager()->isAuthEnabled() &&
-                !con->authenticateInternalUser()) {
-                return Status(ErrorCodes::AuthenticationFailed,
-                              "Unable to authenticate as internal user");
+            Status status = connectToSource(cs, &_conn);
+            if (!status.isOK()) {
+                return status;
             }
-
-            _conn = std::move(con);
         } else {
             _conn.reset(new DBDirectClient(txn));
         }
@@ -593,7 +843,6 @@ Status Cloner::copyDb(OperationContext* txn,
             const char* collectionName = collection["name"].valuestr();
             BSONObj options = collection.getObjectField("options");
 
-            const NamespaceString from_name(opts.fromDB, collectionName);
             const NamespaceString to_name(toDBName, collectionName);
 
             Database* db = dbHolder().openDb(txn, toDBName);
@@ -617,65 +866,25 @@ Status Cloner::copyDb(OperationContext* txn,
                 }
                 MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "createCollection", to_name.ns());
             }
+        }
 
-            LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
-            Query q;
-            if (opts.snapshot)
-                q.snapshot();
-
-            copy(txn,
-                 toDBName,
-                 from_name,
-                 options,
-                 to_name,
-                 masterSameProcess,
-                 opts.slaveOk,
-                 opts.mayYield,
-                 opts.mayBeInterrupted,
-                 q);
-
-            // Copy releases the lock, so we need to re-load the database. This should
-            // probably throw if the database has changed in between, but for now preserve
-            // the existing behaviour.
-            db = dbHolder().get(txn, toDBName);
-            uassert(18645, str::stream() << "database " << toDBName << " dropped during clone", db);
-
-            Collection* c = db->getCollection(to_name);
-            if (c && !c->getIndexCatalog()->haveIdIndex(txn)) {
-                // We need to drop objects with duplicate _ids because we didn't do a true
-                // snapshot and this is before applying oplog operations that occur during the
-                // initial sync.
-                set<RecordId> dups;
-
-                MultiIndexBlock indexer(txn, c);
-                if (opts.mayBeInterrupted) {
-                    indexer.allowInterruption();
-                }
-
-                uassertStatusOK(indexer.init(c->getIndexCatalog()->getDefaultIdIndexSpec()));
-                uassertStatusOK(indexer.insertAllDocumentsInCollection(&dups));
-
-                // This must be done before we commit the indexer. See the comment about
-                // dupsAllowed in IndexCatalog::_unindexRecord and SERVER-17487.
-                for (set<RecordId>::const_iterator it = dups.begin(); it != dups.end(); ++it) {
-                    WriteUnitOfWork wunit(txn);
-                    c->deleteDocument(txn, *it, true, true);
-                    wunit.commit();
-                }
-
-                if (!dups.empty()) {
-                    log() << "index build dropped: " << dups.size() << " dups";
+        bool copied = false;
+        if (mayCopyConcurrently && opts.maxConcurrentCollections > 1 && toClone.size() > 1) {
+            // The collections are copied by threads of their own, which cannot wait for the
+            // locks held by this one. If the caller locked recursively, copy them here instead.
+            Lock::TempRelease tempRelease(txn->lockState());
+            if (!txn->lockState()->isLocked()) {
+                Status status = copyCollectionsConcurrently(txn, toDBName, cs, toClone, opts);
+                if (!status.isOK()) {
+                    return status;
                 }
+                copied = true;
+            }
+        }
 
-                WriteUnitOfWork wunit(txn);
-                indexer.commit();
-                if (txn->writesAreReplicated()) {
-                    getGlobalServiceContext()->getOpObserver()->onCreateIndex(
-                        txn,
-                        c->ns().getSystemIndexesCollection().c_str(),
-                        c->getIndexCatalog()->getDefaultIdIndexSpec());
-                }
-                wunit.commit();
+        if (!copied) {
+            for (list<BSONObj>::iterator i = toClone.begin(); i != toClone.end(); i++) {
+                copyCollectionData(txn, toDBName, *i, opts, masterSameProcess);
             }
         }
     }
@@ -30,16 +30,61 @@
 
 #pragma once
 
+#include <list>
+#include <map>
+
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/base/disallow_copying.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
+class BSONObjBuilder;
 struct CloneOptions;
+class ConnectionString;
 class DBClientBase;
 class NamespaceString;
 class OperationContext;
 
+/**
+ * Progress of the collections copied by Cloner::copyDb, so that it can be reported while the
+ * cloner runs. Thread-safe.
+ */
+class CloneProgress {
+    MONGO_DISALLOW_COPYING(CloneProgress);
+
+public:
+    CloneProgress() = default;
+
+    void onCollectionStart(const NamespaceString& ns);
+    void onBatch(const NamespaceString& ns, long long documents, long long bytes);
+    void onCollectionEnd(const NamespaceString& ns);
+
+    void clear();
+    bool empty() const;
+
+    /**
+     * Appends the documents and bytes copied for each collection, with the time spent on it and
+     * the resulting throughput, grouped by database under 'databases'.
+     */
+    void append(BSONObjBuilder* builder) const;
+
+private:
+    struct CollectionStats {
+        Date_t start;
+        Date_t end;
+        long long documentsCopied = 0;
+        long long bytesCopied = 0;
+        long long fetchedBatches = 0;
+    };
+
+    mutable stdx::mutex _mutex;
+
+    // Keyed by namespace, so the collections of a database are adjacent
+    std::map<std::string, CollectionStats> _collections;
+};
+
 
 class Cloner {
     MONGO_DISALLOW_COPYING(Cloner);
@@ -78,7 +123,29 @@ private:
               bool slaveOk,
               bool mayYield,
               bool mayBeInterrupted,
-              Query q);
+              Query q,
+              CloneProgress* progress = nullptr);
+
+    /**
+     * Copies the documents of a collection created by copyDb and builds its _id index. Must be
+     * called with the destination database locked in MODE_X.
+     */
+    void copyCollectionData(OperationContext* txn,
+                            const std::string& toDBName,
+                            const BSONObj& collection,
+                            const CloneOptions& opts,
+                            bool masterSameProcess);
+
+    /**
+     * Runs copyCollectionData for the collections on up to opts.maxConcurrentCollections
+     * threads, each with its own client, connection to the source and locks. Returns the first
+     * error any of them ran into, after all of them stopped. Must be called without any locks.
+     */
+    Status copyCollectionsConcurrently(OperationContext* txn,
+                                       const std::string& toDBName,
+                                       const ConnectionString& cs,
+                                       const std::list<BSONObj>& collections,
+                                       const CloneOptions& opts);
 
     void copyIndexes(OperationContext* txn,
                      const std::string& toDBName,
@@ -111,6 +178,9 @@ struct CloneOptions {
 
         syncData = true;
         syncIndexes = true;
+
+        maxConcurrentCollections = 1;
+        progress = nullptr;
     }
 
     std::string fromDB;
@@ -124,6 +194,13 @@ struct CloneOptions {
 
     bool syncData;
     bool syncIndexes;
+
+    // Number of collections whose documents are copied at the same time. Collections are only
+    // copied concurrently from another process and when copyDb can release the caller's locks.
+    int maxConcurrentCollections;
+
+    // If set, records the progress of each collection whose documents are copied
+    CloneProgress* progress;
 };
 
 }  // namespace mongo
@@ -40,6 +40,7 @@
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/range_preserver.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/stats/query_shape_stats.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
@@ -166,6 +167,16 @@ public:
             collection->infoCache()->notifyOfQuery(txn, summaryStats.indexesUsed);
         }
 
+        // Counts which are answered from the collection's metadata have no canonical query.
+        if (const CanonicalQuery* cq = exec->getCanonicalQuery()) {
+            QueryShapeStats::Execution execution;
+            execution.micros = CurOp::get(txn)->elapsedMicros();
+            execution.keysExamined = summaryStats.totalKeysExamined;
+            execution.docsExamined = summaryStats.totalDocsExamined;
+            execution.nreturned = summaryStats.nReturned;
+            QueryShapeStats::get(txn->getServiceContext()).record("count", *cq, execution);
+        }
+
         // Plan is done executing. We just need to pull the count out of the root stage.
         invariant(STAGE_COUNT == exec->getRootStage()->stageType());
         CountStage* countStage = static_cast<CountStage*>(exec->getRootStage());
@@ -41,6 +41,7 @@
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/commands.h"
+#include "mongo/db/curop.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/instance.h"
@@ -49,6 +50,7 @@
 #include "mongo/db/query/find_common.h"
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/query/query_planner_common.h"
+#include "mongo/db/stats/query_shape_stats.h"
 #include "mongo/util/log.h"
 #include "mongo/util/timer.h"
 
@@ -233,6 +235,15 @@ public:
         Explain::getSummaryStats(*executor.getValue(), &stats);
         collection->infoCache()->notifyOfQuery(txn, stats.indexesUsed);
 
+        if (const CanonicalQuery* cq = executor.getValue()->getCanonicalQuery()) {
+            QueryShapeStats::Execution execution;
+            execution.micros = CurOp::get(txn)->elapsedMicros();
+            execution.keysExamined = stats.totalKeysExamined;
+            execution.docsExamined = stats.totalDocsExamined;
+            execution.nreturned = stats.nReturned;
+            QueryShapeStats::get(txn->getServiceContext()).record("distinct", *cq, execution);
+        }
+
         verify(start == bb.buf());
 
         result.appendArray("values", arr.done());
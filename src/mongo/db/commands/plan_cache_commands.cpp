@@ -265,6 +265,13 @@ Status PlanCacheListQueryShapes::list(const PlanCache& planCache, BSONObjBuilder
     }
     arrayBuilder.doneFast();
 
+    const PlanCache::Stats stats = planCache.getStats();
+    BSONObjBuilder statsBuilder(bob->subobjStart("stats"));
+    statsBuilder.append("hits", stats.hits);
+    statsBuilder.append("misses", stats.misses);
+    statsBuilder.append("lockWaits", stats.lockWaits);
+    statsBuilder.doneFast();
+
     return Status::OK();
 }
 
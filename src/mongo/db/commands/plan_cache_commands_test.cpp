@@ -144,6 +144,30 @@ TEST(PlanCacheCommandsTest, planCacheListQueryShapesOneKey) {
     ASSERT_EQUALS(shapes[0].getObjectField("projection"), cq->getParsed().getProj());
 }
 
+TEST(PlanCacheCommandsTest, planCacheListQueryShapesStats) {
+    auto statusWithCQ = CanonicalQuery::canonicalize(nss, fromjson("{a: 1}"));
+    ASSERT_OK(statusWithCQ.getStatus());
+    unique_ptr<CanonicalQuery> cq = std::move(statusWithCQ.getValue());
+
+    // Look up a query before and after adding it to the plan cache.
+    PlanCache planCache;
+    CachedSolution* rawSolution;
+    ASSERT_NOT_OK(planCache.get(*cq, &rawSolution));
+    QuerySolution qs;
+    qs.cacheData.reset(createSolutionCacheData());
+    std::vector<QuerySolution*> solns;
+    solns.push_back(&qs);
+    planCache.add(*cq, solns, createDecision(1U));
+    ASSERT_OK(planCache.get(*cq, &rawSolution));
+    delete rawSolution;
+
+    BSONObjBuilder bob;
+    ASSERT_OK(PlanCacheListQueryShapes::list(planCache, &bob));
+    BSONObj resultObj = bob.obj();
+    ASSERT_EQUALS(resultObj.getObjectField("stats"),
+                  BSON("hits" << 1LL << "misses" << 1LL << "lockWaits" << 0LL));
+}
+
 /**
  * Tests for planCacheClear
  */
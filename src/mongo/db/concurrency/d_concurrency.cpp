@@ -72,7 +72,7 @@ Lock::GlobalLock::GlobalLock(Locker* locker, LockMode lockMode, EnqueueOnly enqu
 }
 
 void Lock::GlobalLock::_enqueue(LockMode lockMode) {
-    if (!_locker->isBatchWriter()) {
+    if (!_locker->isBatchWriter() && _locker->shouldConflictWithSecondaryBatchApplication()) {
         _pbwm.lock(MODE_IS);
     }
 
@@ -128,6 +128,38 @@ TEST(DConcurrency, GlobalLockX_TimeoutDueToGlobalLockX) {
     ASSERT(!globalWriteTry.isLocked());
 }
 
+TEST(DConcurrency, GlobalLockTakesParallelBatchWriterMode) {
+    DefaultLockerImpl ls;
+    Lock::GlobalLock globalRead(&ls, MODE_IS, 0);
+    ASSERT(globalRead.isLocked());
+    ASSERT_EQUALS(MODE_IS, ls.getLockMode(resourceIdParallelBatchWriterMode));
+}
+
+TEST(DConcurrency, GlobalLockDoesNotConflictWithBatchApplicationIfDisabled) {
+    DefaultLockerImpl lsBatchWriter;
+    Lock::ParallelBatchWriterMode pbwm(&lsBatchWriter);
+
+    DefaultLockerImpl ls;
+    ls.setShouldConflictWithSecondaryBatchApplication(false);
+    {
+        Lock::GlobalLock globalRead(&ls, MODE_IS, 1);
+        ASSERT(globalRead.isLocked());
+        ASSERT_EQUALS(MODE_NONE, ls.getLockMode(resourceIdParallelBatchWriterMode));
+    }
+    ASSERT(!ls.isLocked());
+}
+
+TEST(DConcurrency, ParallelBatchWriterModeTryLock) {
+    DefaultLockerImpl ls;
+    ASSERT_EQUALS(LOCK_OK, ls.lock(resourceIdParallelBatchWriterMode, MODE_IS, 0));
+    ASSERT(ls.unlock(resourceIdParallelBatchWriterMode));
+
+    DefaultLockerImpl lsBatchWriter;
+    Lock::ParallelBatchWriterMode pbwm(&lsBatchWriter);
+    ASSERT_EQUALS(LOCK_TIMEOUT, ls.lock(resourceIdParallelBatchWriterMode, MODE_IS, 0));
+    ASSERT_EQUALS(MODE_NONE, ls.getLockMode(resourceIdParallelBatchWriterMode));
+}
+
 TEST(DConcurrency, TempReleaseGlobalWrite) {
     MMAPV1LockerImpl ls;
     Lock::GlobalWrite globalWrite(&ls);
@@ -74,6 +74,34 @@ TEST(Deadlock, Simple) {
     locker2.unlock(resIdA);
 }
 
+TEST(Deadlock, FastIntentHolder) {
+    const ResourceId resIdA(RESOURCE_DATABASE, std::string("A"));
+    const ResourceId resIdB(RESOURCE_DATABASE, std::string("B"));
+
+    LockerForTests locker1(MODE_IX);
+    LockerForTests locker2(MODE_IX);
+
+    // Intent locks on databases are granted on the fast path
+    ASSERT_EQUALS(LOCK_OK, locker1.lockBegin(resIdA, MODE_IX));
+    ASSERT_EQUALS(LOCK_OK, locker2.lockBegin(resIdB, MODE_X));
+
+    // 1 -> 2
+    ASSERT_EQUALS(LOCK_WAITING, locker1.lockBegin(resIdB, MODE_X));
+
+    // 2 -> 1, through the fast path holder, which this migrates to the lock head
+    ASSERT_EQUALS(LOCK_WAITING, locker2.lockBegin(resIdA, MODE_X));
+
+    DeadlockDetector wfg1(*getGlobalLockManager(), &locker1);
+    ASSERT(wfg1.check().hasCycle());
+
+    DeadlockDetector wfg2(*getGlobalLockManager(), &locker2);
+    ASSERT(wfg2.check().hasCycle());
+
+    // Cleanup, so that LockerImpl doesn't complain about leaked locks
+    locker1.unlock(resIdB);
+    locker2.unlock(resIdA);
+}
+
 TEST(Deadlock, SimpleUpgrade) {
     const ResourceId resId(RESOURCE_DATABASE, std::string("A"));
 
@@ -98,6 +98,26 @@ uint32_t modeMask(LockMode mode) {
     return 1 << mode;
 }
 
+bool isIntentMode(LockMode mode) {
+    return (modeMask(mode) & intentModes) != 0;
+}
+
+/**
+ * Whether the resource is acquired in intent mode by practically every operation, which makes
+ * it worth keeping striped intent queues for it.
+ */
+bool isFastIntentResource(ResourceId resId) {
+    const ResourceType resType = resId.getType();
+    return resType == RESOURCE_GLOBAL || resType == RESOURCE_DATABASE;
+}
+
+/**
+ * Requests which change the scheduling policy of the lock must go on the LockHead.
+ */
+bool isFastIntentRequest(const LockRequest* request, LockMode mode) {
+    return isIntentMode(mode) && !request->enqueueAtFront && !request->compatibleFirst;
+}
+
 
 /**
  * Maps the resource id to a human-readable string.
@@ -127,6 +147,97 @@ static_assert((sizeof(LockRequestStatusNames) / sizeof(LockRequestStatusNames[0]
 }  // namespace
 
 
+/**
+ * Striped counters of the intent mode requests granted on a global or database resource. These
+ * resources are acquired by practically every operation, so without this all intent requests
+ * would serialize on the same few partition and bucket mutexes.
+ *
+ * While 'blocked' is zero, IS and IX requests are granted by incrementing the counter for their
+ * mode on the stripe of the requester's locker, without taking any mutex. The requester then
+ * re-checks 'blocked' and backs off to the LockHead if it got set in the meantime. Before a
+ * request in a non-intent mode is put on the LockHead, 'blocked' is set under the bucket mutex
+ * and the counters of every stripe are moved to the LockHead's granted counts, so the conflict
+ * checks of the LockHead account for them. Because the increment comes before the re-check and
+ * the store of 'blocked' comes before the counters are moved, each increment is either moved or
+ * backed off. Counters are interchangeable between the requests of the same stripe and mode,
+ * so releasing a request decrements its stripe's counter if it is not zero and otherwise the
+ * count moved to the LockHead.
+ *
+ * Counters do not say which lockers hold the lock, so the deadlock detector cannot follow them.
+ * Lockers migrate their own fast path requests to the LockHead's granted queue before they wait
+ * on any lock (see LockManager::migrateFastIntentRequest).
+ *
+ * The memory and lifetime is controlled entirely by the LockManager class. A slot is released
+ * by LockManager::cleanupUnusedLocks once no requests are using it. Lock-free lookups may race
+ * with that, which is why acquirers re-check 'resourceId' after incrementing.
+ */
+struct FastIntentLock {
+    // Must be a power of two
+    static const unsigned kNumStripes = 16;
+
+    struct Stripe {
+        // Granted MODE_IS and MODE_IX requests, indexed by countIndex
+        AtomicUInt32 counts[2];
+
+        // Keeps stripes used by different lockers off each other's cache lines
+        char padding[64];
+    };
+
+    static unsigned countIndex(LockMode mode) {
+        dassert(isIntentMode(mode));
+        return mode == MODE_IX ? 1 : 0;
+    }
+
+    AtomicUInt32& count(const LockRequest* request, LockMode mode) {
+        return stripes[request->locker->getId() % kNumStripes].counts[countIndex(mode)];
+    }
+
+    /**
+     * Marks the request as granted on the fast path. The caller is responsible for counting it.
+     */
+    void newRequest(LockRequest* request, LockMode mode) {
+        dassert(isIntentMode(mode));
+
+        request->lock = NULL;
+        request->partitionedLock = NULL;
+        request->fastIntentLock = this;
+        request->recursiveCount = 1;
+        request->status = LockRequest::STATUS_GRANTED;
+        request->partitioned = false;
+        request->mode = mode;
+    }
+
+    /**
+     * Decrements the counter unless it is zero. Returns whether it was decremented.
+     */
+    static bool tryDecrement(AtomicUInt32& count) {
+        unsigned current = count.load();
+        while (current > 0) {
+            const unsigned previous = count.compareAndSwap(current, current - 1);
+            if (previous == current) {
+                return true;
+            }
+            current = previous;
+        }
+
+        return false;
+    }
+
+    // Resource for which this slot is claimed, zero if it was never claimed or
+    // kReleasedFastIntentLock if it was released since.
+    AtomicWord<unsigned long long> resourceId;
+
+    // Non-zero while the LockHead for the resource has non-intent modes granted or pending, or
+    // while the slot is being released
+    AtomicUInt32 blocked;
+
+    // LockHead of the resource for which this slot is claimed. Only read or written under the
+    // bucket mutex of that resource.
+    LockHead* lockHead = NULL;
+
+    Stripe stripes[kNumStripes];
+};
+
 /**
  * There is one of these objects for each resource that has a lock request. Empty objects
  * (i.e. LockHead with no requests) are allowed to exist on the lock manager's hash table.
@@ -154,6 +265,9 @@ struct LockHead {
 
         conversionsCount = 0;
         compatibleFirstCount = 0;
+
+        fastIntentLock = NULL;
+        memset(fastIntentCounts, 0, sizeof(fastIntentCounts));
     }
 
     /**
@@ -331,6 +445,19 @@ struct LockHead {
     // be switched to compatible-first. As long as this value is > 0, the policy will stay
     // compatible-first.
     uint32_t compatibleFirstCount;
+
+    //
+    // Fast path intent requests
+    //
+
+    // Intent requests granted without going through this LockHead, or NULL if the resource
+    // does not use them. Only changes when the LockHead has no requests.
+    FastIntentLock* fastIntentLock;
+
+    // Requests granted on the fast path, which were counted on the stripes of fastIntentLock
+    // when it got blocked. Included in grantedCounts, but not on the granted queue. Indexed by
+    // FastIntentLock::countIndex.
+    uint32_t fastIntentCounts[2];
 };
 
 /**
@@ -420,9 +547,18 @@ const unsigned LockManager::_numLockBuckets(128);
 // The exact value doesn't appear very important, but should be power of two
 const unsigned LockManager::_numPartitions = 32;
 
-LockManager::LockManager() {
+// There is one global resource and typically few databases. If a resource cannot find a free
+// slot within a few probes, it simply keeps using the partitioned lock heads.
+const unsigned LockManager::_numFastIntentLocks = 128;
+const unsigned kMaxFastIntentLockProbes = 8;
+
+// Marks a released FastIntentLock slot, which lookups must probe past
+const unsigned long long kReleasedFastIntentLock = ~0ULL;
+
+LockManager::LockManager(bool fastIntentLocks) {
     _lockBuckets = new LockBucket[_numLockBuckets];
     _partitions = new Partition[_numPartitions];
+    _fastIntentLocks = fastIntentLocks ? new FastIntentLock[_numFastIntentLocks] : NULL;
 }
 
 LockManager::~LockManager() {
@@ -435,6 +571,7 @@ LockManager::~LockManager() {
 
     delete[] _lockBuckets;
     delete[] _partitions;
+    delete[] _fastIntentLocks;
 }
 
 LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mode) {
@@ -443,6 +580,13 @@ LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mo
 
     request->partitioned = (mode == MODE_IX || mode == MODE_IS);
 
+    // Fast path for intent locks on the most frequently acquired resources
+    if (_fastIntentLocks && isFastIntentResource(resId) && isFastIntentRequest(request, mode)) {
+        if (_tryFastIntentLock(resId, request, mode)) {
+            return LOCK_OK;
+        }
+    }
+
     // For intent modes, try the PartitionedLockHead
     if (request->partitioned) {
         Partition* partition = _getPartition(request);
@@ -466,8 +610,23 @@ LockResult LockManager::lock(ResourceId resId, LockRequest* request, LockMode mo
 
     LockHead* lock = bucket->findOrInsert(resId);
 
+    // Resources with striped intent queues are never partitioned. Conflicting requests
+    // must stop the fast path before they are queued.
+    FastIntentLock* const fastLock = _attachFastIntentLock(lock);
+    if (fastLock) {
+        if (!isIntentMode(mode)) {
+            _blockFastIntentLock(lock);
+        } else if (isFastIntentRequest(request, mode) && !fastLock->blocked.load()) {
+            // Nothing can block or release it while we hold the bucket mutex
+            fastLock->count(request, mode).fetchAndAdd(1);
+            fastLock->newRequest(request, mode);
+            return LOCK_OK;
+        }
+    }
+
     // Start a partitioned lock if possible
-    if (request->partitioned && !(lock->grantedModes & (~intentModes)) && !lock->conflictModes) {
+    if (!fastLock && request->partitioned && !(lock->grantedModes & (~intentModes)) &&
+        !lock->conflictModes) {
         Partition* partition = _getPartition(request);
         stdx::lock_guard<SimpleMutex> scopedLock(partition->mutex);
         PartitionedLockHead* partitionedLock = partition->findOrInsert(resId);
@@ -517,10 +676,18 @@ LockResult LockManager::convert(ResourceId resId, LockRequest* request, LockMode
 
     LockHead* const lock = it->second;
 
+    if (request->fastIntentLock) {
+        _migrateFastIntentRequest(lock, request);
+    }
+
     if (lock->partitioned()) {
         lock->migratePartitionedLockHeads();
     }
 
+    if (!isIntentMode(newMode)) {
+        _blockFastIntentLock(lock);
+    }
+
     // Construct granted mask without our current mode, so that it is not counted as
     // conflicting
     uint32_t grantedModesWithoutCurrentRequest = 0;
@@ -572,6 +739,15 @@ bool LockManager::unlock(LockRequest* request) {
         return false;
     }
 
+    if (request->fastIntentLock) {
+        // Unlocking a lock that was acquired on the fast path. Only the owner moves such
+        // requests to the lock head, so it is still counted on the fast intent lock.
+        invariant(request->status == LockRequest::STATUS_GRANTED);
+        _fastIntentUnlock(request->fastIntentLock, request, request->mode);
+        request->fastIntentLock = NULL;
+        return true;
+    }
+
     if (request->partitioned) {
         // Unlocking a lock that was acquired as partitioned. The lock request may since have
         // moved to the lock head, but there is no safe way to find out without synchronizing
@@ -639,7 +815,7 @@ bool LockManager::unlock(LockRequest* request) {
 }
 
 void LockManager::downgrade(LockRequest* request, LockMode newMode) {
-    invariant(request->lock);
+    invariant(request->lock || request->fastIntentLock);
     invariant(request->status == LockRequest::STATUS_GRANTED);
     invariant(request->recursiveCount > 0);
 
@@ -648,6 +824,12 @@ void LockManager::downgrade(LockRequest* request, LockMode newMode) {
     invariant((LockConflictsTable[request->mode] | LockConflictsTable[newMode]) ==
               LockConflictsTable[request->mode]);
 
+    if (request->fastIntentLock) {
+        // Only IX -> IS is possible here. The count of the IX request may have been moved to
+        // the lock head, so it cannot simply be exchanged for an IS count on the stripe.
+        migrateFastIntentRequest(request);
+    }
+
     LockHead* lock = request->lock;
 
     LockBucket* bucket = _getBucket(lock->resourceId);
@@ -682,6 +864,12 @@ void LockManager::cleanupUnusedLocks() {
                 invariant(lock->conversionsCount == 0);
                 invariant(lock->compatibleFirstCount == 0);
 
+                // Fast path requests are not on the LockHead, so keep it while there are any
+                if (lock->fastIntentLock && !_releaseFastIntentLock(lock)) {
+                    it++;
+                    continue;
+                }
+
                 bucket->data.erase(it++);
                 deletedLockHeads++;
                 delete lock;
@@ -793,12 +981,216 @@ void LockManager::_onLockModeChanged(LockHead* lock, bool checkConflictQueue) {
         }
     }
 
+    // Once nothing conflicts with intent modes anymore, let them bypass the LockHead again
+    FastIntentLock* const fastLock = lock->fastIntentLock;
+    if (fastLock && !(lock->grantedModes & ~intentModes) && !lock->conflictModes &&
+        fastLock->blocked.load()) {
+        fastLock->blocked.store(0);
+    }
+
     // This is a convenient place to check that the state of the two request queues is in sync
     // with the bitmask on the modes.
-    dassert((lock->grantedModes == 0) ^ (lock->grantedList._front != NULL));
+    dassert((lock->grantedModes == 0) ^
+            (lock->grantedList._front != NULL || lock->fastIntentCounts[0] ||
+             lock->fastIntentCounts[1]));
     dassert((lock->conflictModes == 0) ^ (lock->conflictList._front != NULL));
 }
 
+void LockManager::migrateFastIntentRequest(LockRequest* request) {
+    FastIntentLock* const fastLock = request->fastIntentLock;
+    invariant(fastLock);
+
+    // The slot cannot be released or claimed by another resource while the request is counted
+    // on it, so its resource id is stable
+    const uint64_t key = fastLock->resourceId.load();
+    LockBucket* bucket = &_lockBuckets[key % _numLockBuckets];
+    stdx::lock_guard<SimpleMutex> scopedLock(bucket->mutex);
+
+    invariant(fastLock->resourceId.load() == key);
+    _migrateFastIntentRequest(fastLock->lockHead, request);
+}
+
+bool LockManager::_tryFastIntentLock(ResourceId resId, LockRequest* request, LockMode mode) {
+    FastIntentLock* const fastLock = _findFastIntentLock(resId);
+    if (!fastLock) {
+        return false;
+    }
+
+    fastLock->count(request, mode).fetchAndAdd(1);
+
+    // The slot may have been blocked or released since it was looked up. If not, anyone who
+    // blocks it from now on will see the increment.
+    if (!fastLock->blocked.load() && fastLock->resourceId.load() == static_cast<uint64_t>(resId)) {
+        fastLock->newRequest(request, mode);
+        return true;
+    }
+
+    _fastIntentUnlock(fastLock, request, mode);
+    return false;
+}
+
+void LockManager::_fastIntentUnlock(FastIntentLock* fastLock,
+                                    const LockRequest* request,
+                                    LockMode mode) {
+    AtomicUInt32& count = fastLock->count(request, mode);
+    if (FastIntentLock::tryDecrement(count)) {
+        return;
+    }
+
+    // The count was moved to the LockHead when the slot got blocked. If this is a backed off
+    // request of a resource whose slot was released in the meantime, that is the LockHead of
+    // the resource which claimed the slot since, so look it up from the slot.
+    while (true) {
+        const uint64_t key = fastLock->resourceId.load();
+        LockBucket* bucket = &_lockBuckets[key % _numLockBuckets];
+        stdx::lock_guard<SimpleMutex> scopedLock(bucket->mutex);
+
+        if (fastLock->resourceId.load() != key) {
+            continue;
+        }
+
+        // Another request of the same stripe and mode may have been counted since
+        if (FastIntentLock::tryDecrement(count)) {
+            return;
+        }
+
+        LockHead* const lock = fastLock->lockHead;
+        invariant(lock);
+
+        const unsigned index = FastIntentLock::countIndex(mode);
+        invariant(lock->fastIntentCounts[index] > 0);
+        lock->fastIntentCounts[index]--;
+        lock->decGrantedModeCount(mode);
+
+        _onLockModeChanged(lock, lock->grantedCounts[mode] == 0);
+        return;
+    }
+}
+
+FastIntentLock* LockManager::_findFastIntentLock(ResourceId resId) const {
+    const uint64_t key = resId;
+    for (unsigned probe = 0; probe < kMaxFastIntentLockProbes; probe++) {
+        FastIntentLock* const slot = &_fastIntentLocks[(key + probe) % _numFastIntentLocks];
+        const uint64_t slotKey = slot->resourceId.load();
+        if (slotKey == key) {
+            return slot;
+        }
+
+        // Slots are claimed in probe order, so the key cannot be past a never claimed one
+        if (slotKey == 0) {
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+FastIntentLock* LockManager::_attachFastIntentLock(LockHead* lock) {
+    if (lock->fastIntentLock || !_fastIntentLocks || !isFastIntentResource(lock->resourceId)) {
+        return lock->fastIntentLock;
+    }
+
+    const uint64_t key = lock->resourceId;
+    stdx::lock_guard<SimpleMutex> scopedLock(_fastIntentLocksMutex);
+
+    // A slot is only claimed by a resource with a LockHead and is released together with it,
+    // so there is no slot for this resource yet. Reuse the first released one on the way.
+    FastIntentLock* freeSlot = NULL;
+    for (unsigned probe = 0; probe < kMaxFastIntentLockProbes; probe++) {
+        FastIntentLock* const slot = &_fastIntentLocks[(key + probe) % _numFastIntentLocks];
+        const uint64_t slotKey = slot->resourceId.load();
+        invariant(slotKey != key);
+
+        if (slotKey == 0 || slotKey == kReleasedFastIntentLock) {
+            if (!freeSlot) {
+                freeSlot = slot;
+            }
+            if (slotKey == 0) {
+                break;
+            }
+        }
+    }
+
+    if (!freeSlot) {
+        return NULL;
+    }
+
+    freeSlot->lockHead = lock;
+    freeSlot->blocked.store(0);
+    freeSlot->resourceId.store(key);
+
+    lock->fastIntentLock = freeSlot;
+    return freeSlot;
+}
+
+bool LockManager::_releaseFastIntentLock(LockHead* lock) {
+    FastIntentLock* const fastLock = lock->fastIntentLock;
+
+    // Same as blocking, except that the counts are only checked. Requests which back off after
+    // seeing the slot blocked leave their increment until they are done.
+    fastLock->blocked.store(1);
+    for (unsigned i = 0; i < FastIntentLock::kNumStripes; i++) {
+        FastIntentLock::Stripe& stripe = fastLock->stripes[i];
+        if (stripe.counts[0].load() || stripe.counts[1].load()) {
+            fastLock->blocked.store(0);
+            return false;
+        }
+    }
+
+    stdx::lock_guard<SimpleMutex> scopedLock(_fastIntentLocksMutex);
+    fastLock->resourceId.store(kReleasedFastIntentLock);
+    fastLock->lockHead = NULL;
+    lock->fastIntentLock = NULL;
+    return true;
+}
+
+void LockManager::_blockFastIntentLock(LockHead* lock) {
+    FastIntentLock* const fastLock = _attachFastIntentLock(lock);
+    if (!fastLock || fastLock->blocked.load()) {
+        return;
+    }
+
+    invariant(!(lock->grantedModes & ~intentModes) && !lock->conflictModes);
+
+    // Migration time: block the fast path and move the counts of each stripe to the LockHead.
+    // Increments which come after this are backed off by their requester.
+    fastLock->blocked.store(1);
+    for (unsigned i = 0; i < FastIntentLock::kNumStripes; i++) {
+        FastIntentLock::Stripe& stripe = fastLock->stripes[i];
+        for (unsigned index = 0; index < 2; index++) {
+            const unsigned count = stripe.counts[index].swap(0);
+            if (!count) {
+                continue;
+            }
+
+            const LockMode mode = index ? MODE_IX : MODE_IS;
+            lock->fastIntentCounts[index] += count;
+            lock->grantedCounts[mode] += count;
+            lock->grantedModes |= modeMask(mode);
+        }
+    }
+}
+
+void LockManager::_migrateFastIntentRequest(LockHead* lock, LockRequest* request) {
+    invariant(request->status == LockRequest::STATUS_GRANTED);
+    invariant(lock->fastIntentLock == request->fastIntentLock);
+
+    // Exchanges one of the counts of the stripe or of the LockHead for the request itself,
+    // which keeps its recursiveCount
+    const unsigned index = FastIntentLock::countIndex(request->mode);
+    AtomicUInt32& count = request->fastIntentLock->count(request, request->mode);
+    if (!FastIntentLock::tryDecrement(count)) {
+        invariant(lock->fastIntentCounts[index] > 0);
+        lock->fastIntentCounts[index]--;
+        lock->decGrantedModeCount(request->mode);
+    }
+
+    request->lock = lock;
+    request->fastIntentLock = NULL;
+    lock->grantedList.push_back(request);
+    lock->incGrantedModeCount(request->mode);
+}
+
 LockManager::LockBucket* LockManager::_getBucket(ResourceId resId) const {
     return &_lockBuckets[resId % _numLockBuckets];
 }
@@ -825,7 +1217,7 @@ void LockManager::_dumpBucket(const LockBucket* bucket) const {
          it++) {
         const LockHead* lock = it->second;
 
-        if (lock->grantedList.empty()) {
+        if (lock->grantedList.empty() && !lock->fastIntentLock) {
             // If there are no granted requests, this lock is empty, so no need to print it
             continue;
         }
@@ -833,6 +1225,19 @@ void LockManager::_dumpBucket(const LockBucket* bucket) const {
         StringBuilder sb;
         sb << "Lock @ " << lock << ": " << lock->resourceId.toString() << '\n';
 
+        if (lock->fastIntentLock) {
+            unsigned fastCounts[2] = {0, 0};
+            for (unsigned i = 0; i < FastIntentLock::kNumStripes; i++) {
+                fastCounts[0] += lock->fastIntentLock->stripes[i].counts[0].load();
+                fastCounts[1] += lock->fastIntentLock->stripes[i].counts[1].load();
+            }
+
+            sb << "FAST (Blocked = " << lock->fastIntentLock->blocked.load() << "): "
+               << "IS = " << fastCounts[0] << "; IX = " << fastCounts[1] << "; "
+               << "Moved IS = " << lock->fastIntentCounts[0] << "; "
+               << "Moved IX = " << lock->fastIntentCounts[1] << '\n';
+        }
+
         sb << "GRANTED:\n";
         for (const LockRequest* iter = lock->grantedList._front; iter != NULL; iter = iter->next) {
             sb << '\t' << "LockRequest " << iter->locker->getId() << " @ " << iter->locker << ": "
@@ -1089,6 +1494,8 @@ void LockRequest::initNew(Locker* locker, LockGrantNotification* notify) {
     recursiveCount = 0;
 
     lock = NULL;
+    partitionedLock = NULL;
+    fastIntentLock = NULL;
     prev = NULL;
     next = NULL;
     status = STATUS_NEW;
@@ -51,7 +51,13 @@ class LockManager {
     MONGO_DISALLOW_COPYING(LockManager);
 
 public:
-    LockManager();
+    /**
+     * @param fastIntentLocks Whether intent mode requests on the global and database resources
+     *          may be granted by incrementing per-locker striped counters, without any mutex,
+     *          while no conflicting mode is held or requested. Only meant to be disabled for
+     *          testing and benchmarking.
+     */
+    explicit LockManager(bool fastIntentLocks = true);
     ~LockManager();
 
     /**
@@ -109,6 +115,15 @@ public:
      */
     void downgrade(LockRequest* request, LockMode newMode);
 
+    /**
+     * Moves a request which was granted on the fast path to the granted queue of its LockHead,
+     * where the deadlock detector can see it. Lockers call this for each of their fast path
+     * requests before they wait for a lock. Must be called on the thread owning the request.
+     *
+     * @param request Granted request, which has a non-NULL fastIntentLock.
+     */
+    void migrateFastIntentRequest(LockRequest* request);
+
     /**
      * Iterates through all buckets and deletes all locks, which have no requests on them. This
      * call is kind of expensive and should only be used for reducing the memory footprint of
@@ -178,11 +193,68 @@ private:
      */
     void _onLockModeChanged(LockHead* lock, bool checkConflictQueue);
 
+    /**
+     * Attempts to grant an intent mode request by counting it on the stripe of the resource's
+     * FastIntentLock, without taking any mutex. Fails if the resource has no FastIntentLock or
+     * if a conflicting mode is held or pending on it, in which case the caller must use the
+     * regular LockHead.
+     */
+    bool _tryFastIntentLock(ResourceId resId, LockRequest* request, LockMode mode);
+
+    /**
+     * Releases one count of the specified mode from the request's stripe or, if the stripe's
+     * counts have been moved to the LockHead, from the LockHead. Only takes the bucket mutex in
+     * the latter case.
+     */
+    void _fastIntentUnlock(FastIntentLock* fastLock, const LockRequest* request, LockMode mode);
+
+    /**
+     * Lock-free lookup of the FastIntentLock for the specified resource. Returns NULL if the
+     * resource has not claimed one. The result must be validated after counting a request.
+     */
+    FastIntentLock* _findFastIntentLock(ResourceId resId) const;
+
+    /**
+     * Looks up or claims a FastIntentLock for the specified resource and attaches it to the
+     * LockHead. Returns NULL if the resource is not eligible for the fast path or if there are
+     * no slots left. MUST be called under the lock bucket's mutex.
+     */
+    FastIntentLock* _attachFastIntentLock(LockHead* lock);
+
+    /**
+     * Detaches and frees the LockHead's FastIntentLock, unless there are requests on it.
+     * Returns whether it was released. MUST be called under the lock bucket's mutex.
+     */
+    bool _releaseFastIntentLock(LockHead* lock);
+
+    /**
+     * Prevents any new requests from being granted on the fast path and moves the counts of the
+     * already granted ones to the LockHead's granted counts. Must be called before a request in
+     * a non-intent mode is queued on a LockHead. MUST be called under the lock bucket's mutex.
+     */
+    void _blockFastIntentLock(LockHead* lock);
+
+    /**
+     * Moves a single request granted on the fast path to the granted queue of its LockHead, so
+     * that it can be converted or seen by the deadlock detector. MUST be called under the lock
+     * bucket's mutex.
+     */
+    void _migrateFastIntentRequest(LockHead* lock, LockRequest* request);
+
     static const unsigned _numLockBuckets;
     LockBucket* _lockBuckets;
 
     static const unsigned _numPartitions;
     Partition* _partitions;
+
+    // Open-addressed table of FastIntentLocks, keyed by resource id. Slots are claimed and
+    // released under the bucket mutex of their resource and _fastIntentLocksMutex. NULL if the
+    // fast path is disabled.
+    static const unsigned _numFastIntentLocks;
+    FastIntentLock* _fastIntentLocks;
+
+    // Serializes claiming and releasing of _fastIntentLocks slots by different buckets
+    SimpleMutex _fastIntentLocksMutex;
 };
 
 
@@ -40,6 +40,7 @@ namespace mongo {
 
 class Locker;
 
+struct FastIntentLock;
 struct LockHead;
 struct PartitionedLockHead;
 
@@ -386,6 +387,12 @@ struct LockRequest {
     // only transition from 'partitionedLock' to 'lock', never the other way around.
     PartitionedLockHead* partitionedLock;
 
+    // Pointer to the fast intent lock through which this request was granted, or null if it
+    // was not granted on the fast path. Such requests are only counted on a stripe of it until
+    // their owner migrates them to the LockHead, which sets 'lock' and resets this field. Only
+    // the owning thread reads or writes this field.
+    FastIntentLock* fastIntentLock;
+
     // The reason intrusive linked list is used instead of the std::list class is to allow
     // for entries to be removed from the middle of the list in O(1) time, if they are known
     // instead of having to search for them and we cannot persist iterators, because the list
@@ -26,7 +26,12 @@
  *    it in the license file.
  */
 
+#include <string>
+#include <vector>
+
 #include "mongo/db/concurrency/lock_manager_test_help.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
 
 namespace mongo {
@@ -855,4 +860,237 @@ TEST(LockManager, Fairness) {
     ASSERT(lockMgr.unlock(&requestIX1));
 }
 
+TEST(LockManager, FastIntentBlockedByConflict) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    MMAPV1LockerImpl lockerIS;
+    LockRequestCombo requestIS(&lockerIS);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIS, MODE_IS));
+    ASSERT(requestIS.fastIntentLock != NULL);
+
+    MMAPV1LockerImpl lockerIX;
+    LockRequestCombo requestIX(&lockerIX);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIX, MODE_IX));
+    ASSERT(requestIX.fastIntentLock != NULL);
+
+    // The conflicting request must wait for the fast path holders to drain
+    MMAPV1LockerImpl lockerX;
+    LockRequestCombo requestX(&lockerX);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestX, MODE_X));
+
+    // Intent requests can no longer bypass it
+    MMAPV1LockerImpl lockerIS1;
+    LockRequestCombo requestIS1(&lockerIS1);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestIS1, MODE_IS));
+    ASSERT(requestIS1.fastIntentLock == NULL);
+
+    ASSERT(lockMgr.unlock(&requestIS));
+    ASSERT_EQ(0, requestX.numNotifies);
+
+    ASSERT(lockMgr.unlock(&requestIX));
+    ASSERT_EQ(LOCK_OK, requestX.lastResult);
+    ASSERT_EQ(1, requestX.numNotifies);
+    ASSERT_EQ(0, requestIS1.numNotifies);
+
+    ASSERT(lockMgr.unlock(&requestX));
+    ASSERT_EQ(LOCK_OK, requestIS1.lastResult);
+    ASSERT_EQ(1, requestIS1.numNotifies);
+
+    // Once the conflict is gone, intent requests use the fast path again
+    MMAPV1LockerImpl lockerIX1;
+    LockRequestCombo requestIX1(&lockerIX1);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &requestIX1, MODE_IX));
+    ASSERT(requestIX1.fastIntentLock != NULL);
+
+    ASSERT(lockMgr.unlock(&requestIS1));
+    ASSERT(lockMgr.unlock(&requestIX1));
+}
+
+TEST(LockManager, FastIntentConvertUp) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_GLOBAL, ResourceId::SINGLETON_GLOBAL);
+
+    MMAPV1LockerImpl locker1;
+    LockRequestCombo request1(&locker1);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_IS));
+    ASSERT(request1.fastIntentLock != NULL);
+
+    MMAPV1LockerImpl locker2;
+    LockRequestCombo request2(&locker2);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request2, MODE_IS));
+
+    // The converted request moves to the LockHead
+    ASSERT(LOCK_OK == lockMgr.convert(resId, &request1, MODE_IX));
+    ASSERT(request1.fastIntentLock == NULL);
+    ASSERT(request1.mode == MODE_IX);
+    ASSERT(request1.recursiveCount == 2);
+
+    // Conflicting conversion waits for the remaining fast path holder
+    ASSERT(LOCK_WAITING == lockMgr.convert(resId, &request1, MODE_X));
+    ASSERT(request1.status == LockRequest::STATUS_CONVERTING);
+
+    ASSERT(lockMgr.unlock(&request2));
+    ASSERT_EQ(LOCK_OK, request1.lastResult);
+    ASSERT_EQ(1, request1.numNotifies);
+    ASSERT(request1.mode == MODE_X);
+
+    ASSERT(!lockMgr.unlock(&request1));
+    ASSERT(!lockMgr.unlock(&request1));
+    ASSERT(lockMgr.unlock(&request1));
+}
+
+TEST(LockManager, FastIntentDowngrade) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    MMAPV1LockerImpl locker1;
+    LockRequestCombo request1(&locker1);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_IX));
+    ASSERT(request1.fastIntentLock != NULL);
+
+    MMAPV1LockerImpl locker2;
+    LockRequestCombo request2(&locker2);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &request2, MODE_S));
+
+    // Downgrading the fast path holder removes the conflict
+    lockMgr.downgrade(&request1, MODE_IS);
+    ASSERT(request1.mode == MODE_IS);
+    ASSERT_EQ(LOCK_OK, request2.lastResult);
+    ASSERT_EQ(1, request2.numNotifies);
+
+    ASSERT(lockMgr.unlock(&request2));
+    ASSERT(lockMgr.unlock(&request1));
+}
+
+TEST(LockManager, FastIntentMigratedByOwner) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    MMAPV1LockerImpl locker1;
+    LockRequestCombo request1(&locker1);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_IX));
+    ASSERT(request1.fastIntentLock != NULL);
+
+    MMAPV1LockerImpl locker2;
+    LockRequestCombo request2(&locker2);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request2, MODE_IX));
+
+    // The conflicting request only sees the counts of the fast path holders
+    MMAPV1LockerImpl lockerX;
+    LockRequestCombo requestX(&lockerX);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &requestX, MODE_X));
+
+    // The owner exchanges one of the counts for its request
+    lockMgr.migrateFastIntentRequest(&request1);
+    ASSERT(request1.fastIntentLock == NULL);
+    ASSERT(request1.lock != NULL);
+    ASSERT(request1.mode == MODE_IX);
+
+    ASSERT(lockMgr.unlock(&request2));
+    ASSERT_EQ(0, requestX.numNotifies);
+
+    ASSERT(lockMgr.unlock(&request1));
+    ASSERT_EQ(LOCK_OK, requestX.lastResult);
+    ASSERT_EQ(1, requestX.numNotifies);
+
+    ASSERT(lockMgr.unlock(&requestX));
+}
+
+TEST(LockManager, FastIntentDisabled) {
+    LockManager lockMgr(false);
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    MMAPV1LockerImpl locker;
+    LockRequestCombo request(&locker);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request, MODE_IX));
+    ASSERT(request.fastIntentLock == NULL);
+
+    ASSERT(lockMgr.unlock(&request));
+}
+
+TEST(LockManager, FastIntentReleasedWhenUnused) {
+    LockManager lockMgr;
+
+    // More resources than there are fast intent locks, each of which is used once
+    for (int i = 0; i < 1000; i++) {
+        const ResourceId resId(RESOURCE_DATABASE, "TestDB" + std::to_string(i));
+
+        MMAPV1LockerImpl locker;
+        LockRequestCombo request(&locker);
+        ASSERT(LOCK_OK == lockMgr.lock(resId, &request, MODE_IX));
+        ASSERT(request.fastIntentLock != NULL);
+        ASSERT(lockMgr.unlock(&request));
+
+        lockMgr.cleanupUnusedLocks();
+    }
+}
+
+TEST(LockManager, FastIntentNotReleasedWhileHeld) {
+    LockManager lockMgr;
+    const ResourceId resId(RESOURCE_DATABASE, std::string("TestDB"));
+
+    MMAPV1LockerImpl locker1;
+    LockRequestCombo request1(&locker1);
+    ASSERT(LOCK_OK == lockMgr.lock(resId, &request1, MODE_IS));
+    ASSERT(request1.fastIntentLock != NULL);
+
+    lockMgr.cleanupUnusedLocks();
+
+    MMAPV1LockerImpl locker2;
+    LockRequestCombo request2(&locker2);
+    ASSERT(LOCK_WAITING == lockMgr.lock(resId, &request2, MODE_X));
+
+    ASSERT(lockMgr.unlock(&request1));
+    ASSERT_EQ(LOCK_OK, request2.lastResult);
+    ASSERT_EQ(1, request2.numNotifies);
+
+    ASSERT(lockMgr.unlock(&request2));
+}
+
+TEST(LockManager, FastIntentExcludedByExclusiveConcurrently) {
+    const int kNumIntentThreads = 4;
+    const int kNumIntentIters = 20 * 1000;
+    const int kNumExclusiveIters = 200;
+
+    AtomicInt32 intentHolders;
+    AtomicInt32 exclusiveHolders;
+    AtomicInt32 violations;
+
+    std::vector<stdx::thread> threads;
+    for (int i = 0; i < kNumIntentThreads; i++) {
+        threads.emplace_back([&] {
+            DefaultLockerImpl locker;
+            for (int j = 0; j < kNumIntentIters; j++) {
+                locker.lockGlobal(j % 2 ? MODE_IS : MODE_IX);
+                intentHolders.addAndFetch(1);
+                if (exclusiveHolders.load()) {
+                    violations.addAndFetch(1);
+                }
+                intentHolders.subtractAndFetch(1);
+                locker.unlockAll();
+            }
+        });
+    }
+
+    threads.emplace_back([&] {
+        DefaultLockerImpl locker;
+        for (int j = 0; j < kNumExclusiveIters; j++) {
+            locker.lockGlobal(MODE_X);
+            exclusiveHolders.addAndFetch(1);
+            if (intentHolders.load()) {
+                violations.addAndFetch(1);
+            }
+            exclusiveHolders.subtractAndFetch(1);
+            locker.unlockAll();
+        }
+    });
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(0, violations.load());
+}
+
 }  // namespace mongo
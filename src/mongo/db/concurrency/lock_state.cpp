@@ -647,6 +647,14 @@ LockResult LockerImpl<IsForMMAPV1>::lockBegin(ResourceId resId, LockMode mode) {
     if (result == LOCK_WAITING) {
         globalStats.recordWait(_id, resId, mode);
         _stats.recordWait(resId, mode);
+
+        // Locks granted on the fast path are only counted, so make them visible to deadlock
+        // detection before waiting
+        for (LockRequestsMap::Iterator iter = _requests.begin(); !iter.finished(); iter.next()) {
+            if (iter->fastIntentLock) {
+                globalLockManager.migrateFastIntentRequest(iter.objAddr());
+            }
+        }
     }
 
     return result;
@@ -244,10 +244,18 @@ public:
         return _batchWriter;
     }
 
+    virtual void setShouldConflictWithSecondaryBatchApplication(bool newValue) {
+        _shouldConflictWithSecondaryBatchApplication = newValue;
+    }
+    virtual bool shouldConflictWithSecondaryBatchApplication() const {
+        return _shouldConflictWithSecondaryBatchApplication;
+    }
+
     virtual bool hasStrongLocks() const;
 
 private:
     bool _batchWriter;
+    bool _shouldConflictWithSecondaryBatchApplication = true;
 };
 
 typedef LockerImpl<false> DefaultLockerImpl;
@@ -284,6 +284,14 @@ public:
     virtual void setIsBatchWriter(bool newValue) = 0;
     virtual bool isBatchWriter() const = 0;
 
+    /**
+     * If set to false, acquiring the global lock will not take the ParallelBatchWriterMode lock,
+     * so this locker will not wait for a secondary to finish applying its current batch. Only
+     * operations which read from a snapshot taken between batches may turn this off.
+     */
+    virtual void setShouldConflictWithSecondaryBatchApplication(bool newValue) = 0;
+    virtual bool shouldConflictWithSecondaryBatchApplication() const = 0;
+
     /**
      * A string lock is MODE_X or MODE_S.
      * These are incompatible with other locks and therefore are strong.
@@ -26,39 +26,40 @@
  *    it in the license file.
  */
 
-#include "mongo/base/counter.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/operation_context.h"
 #include "mongo/db/commands/server_status_metric.h"
+#include "mongo/util/concurrency/striped_counter.h"
 
 namespace mongo {
 namespace {
-Counter64 returnedCounter;
-Counter64 insertedCounter;
-Counter64 updatedCounter;
-Counter64 deletedCounter;
-Counter64 scannedCounter;
-Counter64 scannedObjectCounter;
+StripedCounter64 returnedCounter;
+StripedCounter64 insertedCounter;
+StripedCounter64 updatedCounter;
+StripedCounter64 deletedCounter;
+StripedCounter64 scannedCounter;
+StripedCounter64 scannedObjectCounter;
 
-ServerStatusMetricField<Counter64> displayReturned("document.returned", &returnedCounter);
-ServerStatusMetricField<Counter64> displayUpdated("document.updated", &updatedCounter);
-ServerStatusMetricField<Counter64> displayInserted("document.inserted", &insertedCounter);
-ServerStatusMetricField<Counter64> displayDeleted("document.deleted", &deletedCounter);
-ServerStatusMetricField<Counter64> displayScanned("queryExecutor.scanned", &scannedCounter);
-ServerStatusMetricField<Counter64> displayScannedObjects("queryExecutor.scannedObjects",
-                                                         &scannedObjectCounter);
+ServerStatusMetricField<StripedCounter64> displayReturned("document.returned", &returnedCounter);
+ServerStatusMetricField<StripedCounter64> displayUpdated("document.updated", &updatedCounter);
+ServerStatusMetricField<StripedCounter64> displayInserted("document.inserted", &insertedCounter);
+ServerStatusMetricField<StripedCounter64> displayDeleted("document.deleted", &deletedCounter);
+ServerStatusMetricField<StripedCounter64> displayScanned("queryExecutor.scanned",
+                                                         &scannedCounter);
+ServerStatusMetricField<StripedCounter64> displayScannedObjects("queryExecutor.scannedObjects",
+                                                                &scannedObjectCounter);
 
-Counter64 idhackCounter;
-Counter64 scanAndOrderCounter;
-Counter64 fastmodCounter;
-Counter64 writeConflictsCounter;
+StripedCounter64 idhackCounter;
+StripedCounter64 scanAndOrderCounter;
+StripedCounter64 fastmodCounter;
+StripedCounter64 writeConflictsCounter;
 
-ServerStatusMetricField<Counter64> displayIdhack("operation.idhack", &idhackCounter);
-ServerStatusMetricField<Counter64> displayScanAndOrder("operation.scanAndOrder",
-                                                       &scanAndOrderCounter);
-ServerStatusMetricField<Counter64> displayFastMod("operation.fastmod", &fastmodCounter);
-ServerStatusMetricField<Counter64> displayWriteConflicts("operation.writeConflicts",
-                                                         &writeConflictsCounter);
+ServerStatusMetricField<StripedCounter64> displayIdhack("operation.idhack", &idhackCounter);
+ServerStatusMetricField<StripedCounter64> displayScanAndOrder("operation.scanAndOrder",
+                                                              &scanAndOrderCounter);
+ServerStatusMetricField<StripedCounter64> displayFastMod("operation.fastmod", &fastmodCounter);
+ServerStatusMetricField<StripedCounter64> displayWriteConflicts("operation.writeConflicts",
+                                                                &writeConflictsCounter);
 
 }  // namespace
 
@@ -51,6 +51,7 @@
 #include <signal.h>
 #include <string>
 
+#include "mongo/base/checked_cast.h"
 #include "mongo/base/init.h"
 #include "mongo/base/initializer.h"
 #include "mongo/base/status.h"
@@ -218,6 +219,28 @@ public:
     virtual void close() {
         Client::destroy();
     }
+
+    virtual bool supportsDetachedConnections() const {
+        return true;
+    }
+
+    virtual std::unique_ptr<ConnectionState> detachConnection() {
+        return stdx::make_unique<DetachedClient>(Client::releaseCurrent());
+    }
+
+    virtual void attachConnection(std::unique_ptr<ConnectionState> state) {
+        Client::setCurrent(std::move(checked_cast<DetachedClient*>(state.get())->client));
+    }
+
+private:
+    /**
+     * The Client of a connection which is not currently being served by any thread.
+     */
+    struct DetachedClient : public ConnectionState {
+        explicit DetachedClient(ServiceContext::UniqueClient client) : client(std::move(client)) {}
+
+        ServiceContext::UniqueClient client;
+    };
 };
 
 static void logStartup(OperationContext* txn) {
@@ -463,6 +486,7 @@ static void _initAndListen(int listenPort) {
     MessageServer::Options options;
     options.port = listenPort;
     options.ipList = serverGlobalParams.bind_ip;
+    options.ingressWorkerThreads = serverGlobalParams.ingressWorkerThreads;
 
     MessageServer* server = createServer(options, new MyMessageHandler());
     server->setAsTimeTracker();
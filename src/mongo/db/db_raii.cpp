@@ -33,13 +33,42 @@
 #include "mongo/db/catalog/database_holder.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
+#include "mongo/base/counter.h"
 #include "mongo/db/client.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/stats/timer_stats.h"
 #include "mongo/db/stats/top.h"
+#include "mongo/db/storage/snapshot_manager.h"
 #include "mongo/s/d_state.h"
 
 namespace mongo {
+namespace {
+
+// When set, reads on a secondary which would otherwise wait for the current oplog batch to be
+// applied are served from the latest committed snapshot instead. This only has an effect when
+// committed snapshots are maintained, for example with --enableMajorityReadConcern.
+MONGO_EXPORT_SERVER_PARAMETER(readFromCommittedSnapshotDuringBatchApplication, bool, false);
+
+// Reads only use the committed snapshot instead of waiting for the batch if it is at most this
+// many seconds behind the last applied operation.
+MONGO_EXPORT_SERVER_PARAMETER(readFromCommittedSnapshotMaxStalenessSecs, int, 1);
+
+// Number of reads served from the committed snapshot during batch application, and how far, in
+// milliseconds, that snapshot lagged behind the last applied operation.
+TimerStats snapshotReadStalenessStats;
+ServerStatusMetricField<TimerStats> displaySnapshotReadStaleness(
+    "repl.snapshotReads.staleness", &snapshotReadStalenessStats);
+
+// Reads which could not use the committed snapshot and waited for batch application instead,
+// because there was no committed snapshot, it was too stale or the collection was newer than it.
+Counter64 snapshotReadFallbacksStats;
+ServerStatusMetricField<Counter64> displaySnapshotReadFallbacks("repl.snapshotReads.fallbacks",
+                                                                &snapshotReadFallbacksStats);
+
+}  // namespace
 
 AutoGetDb::AutoGetDb(OperationContext* txn, StringData ns, LockMode mode)
     : _dbLock(txn->lockState(), ns, mode), _db(dbHolder().get(txn, ns)) {}
@@ -72,9 +101,17 @@ AutoGetCollectionForRead::AutoGetCollectionForRead(OperationContext* txn, const
 
 AutoGetCollectionForRead::AutoGetCollectionForRead(OperationContext* txn,
                                                    const NamespaceString& nss)
-    : _txn(txn), _transaction(txn, MODE_IS) {
+    : _txn(txn),
+      _transaction(txn, MODE_IS),
+      _shouldConflictWithSecondaryBatchApplication(
+          txn->lockState()->shouldConflictWithSecondaryBatchApplication()) {
     {
-        _autoColl.emplace(txn, nss, MODE_IS);
+        if (_shouldReadAroundBatchApplication()) {
+            _lockAroundBatchApplication(nss);
+        } else {
+            _autoColl.emplace(txn, nss, MODE_IS);
+        }
+
         auto curOp = CurOp::get(_txn);
         stdx::lock_guard<Client> lk(*_txn->getClient());
 
@@ -99,6 +136,15 @@ AutoGetCollectionForRead::AutoGetCollectionForRead(OperationContext* txn,
 }
 
 AutoGetCollectionForRead::~AutoGetCollectionForRead() {
+    _txn->lockState()->setShouldConflictWithSecondaryBatchApplication(
+        _shouldConflictWithSecondaryBatchApplication);
+
+    // Later reads of the same operation must see the latest data again.
+    if (_readingFromCommittedSnapshot) {
+        _txn->recoveryUnit()->abandonSnapshot();
+        _txn->recoveryUnit()->clearReadFromMajorityCommittedSnapshot();
+    }
+
     // Report time spent in read lock
     auto currentOp = CurOp::get(_txn);
     Top::get(_txn->getClient()->getServiceContext())
@@ -142,6 +188,85 @@ void AutoGetCollectionForRead::_ensureMajorityCommittedSnapshotIsValid(const Nam
     }
 }
 
+bool AutoGetCollectionForRead::_shouldReadAroundBatchApplication() {
+    if (!readFromCommittedSnapshotDuringBatchApplication) {
+        return false;
+    }
+
+    // Nested lock acquisitions keep the mode chosen by the outermost one.
+    Locker* const locker = _txn->lockState();
+    if (locker->isLocked() || locker->isBatchWriter() ||
+        !locker->shouldConflictWithSecondaryBatchApplication()) {
+        return false;
+    }
+
+    if (!_txn->getServiceContext()->getGlobalStorageEngine()->getSnapshotManager()) {
+        return false;
+    }
+
+    if (!repl::ReplicationCoordinator::get(_txn)->getMemberState().secondary()) {
+        return false;
+    }
+
+    // Committed snapshots are only taken between batches, so reads from them never need to wait.
+    if (_txn->recoveryUnit()->isReadingFromMajorityCommittedSnapshot()) {
+        return true;
+    }
+
+    // Otherwise only give up reading the latest data if a batch is being applied, or is waiting
+    // for readers to drain before it starts.
+    if (locker->lock(resourceIdParallelBatchWriterMode, MODE_IS, 0) == LOCK_OK) {
+        locker->unlock(resourceIdParallelBatchWriterMode);
+        return false;
+    }
+    return true;
+}
+
+void AutoGetCollectionForRead::_lockAroundBatchApplication(const NamespaceString& nss) {
+    Locker* const locker = _txn->lockState();
+    locker->setShouldConflictWithSecondaryBatchApplication(false);
+    _autoColl.emplace(_txn, nss, MODE_IS);
+
+    RecoveryUnit* const recoveryUnit = _txn->recoveryUnit();
+    if (recoveryUnit->isReadingFromMajorityCommittedSnapshot()) {
+        // The snapshot is validated against the collection like for any other committed read.
+        return;
+    }
+
+    // The committed snapshot only moves forward between batches, so it cannot become older than
+    // measured here.
+    auto replCoord = repl::ReplicationCoordinator::get(_txn);
+    const auto lastApplied = replCoord->getMyLastOptime().getTimestamp();
+    const auto snapshotTime = replCoord->getCurrentCommittedSnapshotOpTime().getTimestamp();
+    const int stalenessSecs = lastApplied.getSecs() > snapshotTime.getSecs()
+        ? lastApplied.getSecs() - snapshotTime.getSecs()
+        : 0;
+
+    // If the collection is visible in the committed snapshot now, it will also be visible in the
+    // snapshot used by the read.
+    const auto committedSnapshot = _txn->getServiceContext()
+                                       ->getGlobalStorageEngine()
+                                       ->getSnapshotManager()
+                                       ->getMinSnapshotForNextCommittedRead();
+    const auto coll = _autoColl->getCollection();
+    const auto minSnapshot = coll ? coll->getMinimumVisibleSnapshot() : boost::none;
+    if (!committedSnapshot || (minSnapshot && *minSnapshot > *committedSnapshot) ||
+        stalenessSecs > readFromCommittedSnapshotMaxStalenessSecs) {
+        snapshotReadFallbacksStats.increment();
+
+        _autoColl = boost::none;
+        locker->setShouldConflictWithSecondaryBatchApplication(true);
+        _autoColl.emplace(_txn, nss, MODE_IS);
+        return;
+    }
+
+    recoveryUnit->abandonSnapshot();
+    uassertStatusOK(recoveryUnit->setReadFromMajorityCommittedSnapshot());
+    _readingFromCommittedSnapshot = true;
+
+    snapshotReadStalenessStats.recordMillis(stalenessSecs * 1000);
+}
+
 OldClientContext::OldClientContext(OperationContext* txn,
                                    const std::string& ns,
                                    Database* db,
@@ -133,6 +133,12 @@ private:
  *
  * It is guaranteed that locks will be released when this object goes out of scope, therefore
  * database and collection references returned by this class should not be retained.
+ *
+ * If readFromCommittedSnapshotDuringBatchApplication is set, then on a secondary which is applying
+ * a batch of oplog entries, the read is served from the latest committed snapshot instead of
+ * waiting for the batch to finish. This requires that snapshot to be at most
+ * readFromCommittedSnapshotMaxStalenessSecs behind the last applied operation. The recovery unit
+ * goes back to reading the latest data when this object goes out of scope.
  */
 class AutoGetCollectionForRead {
     MONGO_DISALLOW_COPYING(AutoGetCollectionForRead);
@@ -154,10 +160,27 @@ private:
     void _init(const std::string& ns, StringData coll);
     void _ensureMajorityCommittedSnapshotIsValid(const NamespaceString& nss);
 
+    /**
+     * Returns true if this read should not wait for the secondary batch application which is
+     * currently in progress, or which is waiting to start.
+     */
+    bool _shouldReadAroundBatchApplication();
+
+    /**
+     * Locks the collection without conflicting with secondary batch application and switches the
+     * operation to read from the committed snapshot. Falls back to a regular lock acquisition if
+     * the committed snapshot cannot be used for this collection.
+     */
+    void _lockAroundBatchApplication(const NamespaceString& nss);
+
     const Timer _timer;
     OperationContext* const _txn;
     const ScopedTransaction _transaction;
+    const bool _shouldConflictWithSecondaryBatchApplication;
     boost::optional<AutoGetCollection> _autoColl;
+
+    // Whether _lockAroundBatchApplication switched the recovery unit to the committed snapshot
+    bool _readingFromCommittedSnapshot = false;
 };
 
 /**
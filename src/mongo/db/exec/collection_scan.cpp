@@ -30,6 +30,8 @@
 
 #include "mongo/db/exec/collection_scan.h"
 
+#include <algorithm>
+
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/exec/collection_scan_common.h"
 #include "mongo/db/exec/filter.h"
@@ -38,6 +40,8 @@
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/catalog/collection.h"
+#include "mongo/db/matcher/selection_bitmap.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/record_fetcher.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/util/fail_point_service.h"
@@ -54,6 +58,14 @@ using stdx::make_unique;
 // static
 const char* CollectionScan::kStageType = "COLLSCAN";
 
+namespace {
+
+// Stop reading records into a batch once it holds this many bytes of documents. This also bounds
+// how much a single work() call reads between two yield points.
+const size_t kMaxBatchBytes = 1024 * 1024;
+
+}  // namespace
+
 CollectionScan::CollectionScan(OperationContext* txn,
                                const CollectionScanParams& params,
                                WorkingSet* workingSet,
@@ -63,7 +75,9 @@ CollectionScan::CollectionScan(OperationContext* txn,
       _filter(filter),
       _params(params),
       _isDead(false),
-      _wsidForFetch(_workingSet->allocate()) {
+      _wsidForFetch(_workingSet->allocate()),
+      _useBatches(filter && !params.tailable && params.start.isNull() && 0 == params.maxScan &&
+                  internalQueryExecCollectionScanBatchSize.load() > 1) {
     // Explain reports the direction of the collection scan.
     _specificStats.direction = params.direction;
 }
@@ -92,6 +106,18 @@ PlanStage::StageState CollectionScan::work(WorkingSetID* out) {
         return PlanStage::IS_EOF;
     }
 
+    if (_batchFiltered) {
+        if (_batchPos < _batchIds.size()) {
+            return returnFromBatch(out);
+        }
+        clearBatch();
+    }
+
+    if (_cursorExhausted) {
+        _commonStats.isEOF = true;
+        return PlanStage::IS_EOF;
+    }
+
     boost::optional<Record> record;
     const bool needToMakeCursor = !_cursor;
     try {
@@ -124,6 +150,10 @@ PlanStage::StageState CollectionScan::work(WorkingSetID* out) {
 
         if (_lastSeenId.isNull() && !_params.start.isNull()) {
             record = _cursor->seekExact(_params.start);
+        } else if (_useBatches) {
+            // A write conflict leaves the records read so far in the batch, to be completed
+            // after the yield.
+            return fillBatch(out);
         } else {
             // See if the record we're about to access is in memory. If not, pass a fetch
             // request up.
@@ -186,6 +216,118 @@ PlanStage::StageState CollectionScan::returnIfMatches(WorkingSetMember* member,
     }
 }
 
+PlanStage::StageState CollectionScan::fillBatch(WorkingSetID* out) {
+    const size_t batchSize = std::max(1, internalQueryExecCollectionScanBatchSize.load());
+
+    while (_batchIds.size() < batchSize && _batchBuffer.size() < kMaxBatchBytes) {
+        // See if the record we're about to access is in memory. If not, filter what we have or
+        // pass a fetch request up.
+        if (auto fetcher = _cursor->fetcherForNext()) {
+            if (!_batchIds.empty()) {
+                break;
+            }
+
+            WorkingSetMember* member = _workingSet->get(_wsidForFetch);
+            member->setFetcher(fetcher.release());
+            *out = _wsidForFetch;
+            _commonStats.needYield++;
+            return PlanStage::NEED_YIELD;
+        }
+
+        boost::optional<Record> record = _cursor->next();
+        if (!record) {
+            _cursorExhausted = true;
+            break;
+        }
+
+        _lastSeenId = record->id;
+
+        // The record is only valid until the cursor moves. Copy it into the batch buffer, which
+        // is reused from batch to batch, and only make owned copies of the matching documents.
+        _batchOffsets.push_back(_batchBuffer.size());
+        _batchBuffer.insert(
+            _batchBuffer.end(), record->data.data(), record->data.data() + record->data.size());
+        _batchIds.push_back(record->id);
+        _batchSnapshots.push_back(getOpCtx()->recoveryUnit()->getSnapshotId());
+    }
+
+    filterBatch();
+
+    if (_batchPos < _batchIds.size()) {
+        return returnFromBatch(out);
+    }
+
+    clearBatch();
+
+    if (_cursorExhausted) {
+        _commonStats.isEOF = true;
+        return PlanStage::IS_EOF;
+    }
+
+    ++_commonStats.needTime;
+    return PlanStage::NEED_TIME;
+}
+
+void CollectionScan::filterBatch() {
+    _specificStats.docsTested += _batchIds.size();
+
+    // The buffer does not move while the batch is being filtered.
+    std::vector<BSONObj> docs;
+    docs.reserve(_batchOffsets.size());
+    for (size_t offset : _batchOffsets) {
+        docs.emplace_back(_batchBuffer.data() + offset);
+    }
+
+    SelectionBitmap selection(docs.size());
+    _filter->matchesBatch(docs.data(), &selection);
+
+    size_t kept = 0;
+    selection.forEachSelected([&](size_t i) {
+        _batchIds[kept] = _batchIds[i];
+        _batchSnapshots[kept] = _batchSnapshots[i];
+        _batchDocs.push_back(docs[i].getOwned());
+        kept++;
+    });
+
+    _batchIds.resize(kept);
+    _batchSnapshots.resize(kept);
+
+    _batchOffsets.clear();
+    _batchBuffer.clear();
+    if (_batchBuffer.capacity() > 2 * kMaxBatchBytes) {
+        // Do not hold on to the memory of an unusually large document.
+        std::vector<char>().swap(_batchBuffer);
+    }
+
+    _batchFiltered = true;
+    _batchPos = 0;
+}
+
+PlanStage::StageState CollectionScan::returnFromBatch(WorkingSetID* out) {
+    invariant(_batchFiltered && _batchPos < _batchIds.size());
+    const size_t pos = _batchPos++;
+
+    WorkingSetID id = _workingSet->allocate();
+    WorkingSetMember* member = _workingSet->get(id);
+    member->loc = _batchIds[pos];
+    member->obj = {_batchSnapshots[pos], std::move(_batchDocs[pos])};
+    _workingSet->transitionToLocAndObj(id);
+
+    *out = id;
+    ++_commonStats.advanced;
+    return PlanStage::ADVANCED;
+}
+
+void CollectionScan::clearBatch() {
+    _batchIds.clear();
+    _batchOffsets.clear();
+    _batchBuffer.clear();
+    _batchDocs.clear();
+    _batchSnapshots.clear();
+    _batchFiltered = false;
+    _batchPos = 0;
+}
+
 bool CollectionScan::isEOF() {
     return _commonStats.isEOF || _isDead;
 }
@@ -194,13 +336,28 @@ void CollectionScan::doInvalidate(OperationContext* txn,
                                   const RecordId& id,
                                   InvalidationType type) {
     // We don't care about mutations since we apply any filters to the result when we (possibly)
-    // return it.
+    // return it. Documents of a batch were filtered earlier, but they carry the snapshot they
+    // were read in so that consumers which care can refetch them.
     if (INVALIDATION_DELETION != type) {
         return;
     }
 
     // If we're here, 'id' is being deleted.
 
+    // Records of the current batch which have not been returned yet are dropped.
+    for (size_t i = _batchFiltered ? _batchPos : 0; i < _batchIds.size(); ++i) {
+        if (_batchIds[i] == id) {
+            _batchIds.erase(_batchIds.begin() + i);
+            if (_batchFiltered) {
+                _batchDocs.erase(_batchDocs.begin() + i);
+            } else {
+                _batchOffsets.erase(_batchOffsets.begin() + i);
+            }
+            _batchSnapshots.erase(_batchSnapshots.begin() + i);
+            break;
+        }
+    }
+
     // Deletions can harm the underlying RecordCursor so we must pass them down.
     if (_cursor) {
         _cursor->invalidate(txn, id);
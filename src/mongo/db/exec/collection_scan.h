@@ -29,11 +29,13 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "mongo/db/exec/collection_scan_common.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/db/record_id.h"
+#include "mongo/db/storage/snapshot.h"
 
 namespace mongo {
 
@@ -45,6 +47,12 @@ class OperationContext;
  * Scans over a collection, starting at the RecordId provided in params and continuing until
  * there are no more records in the collection.
  *
+ * When the scan has a filter and is neither tailable nor bounded by 'start' or 'maxScan', it reads
+ * up to internalQueryExecCollectionScanBatchSize records at a time and applies the filter to all
+ * of them with MatchExpression::matchesBatch(). All of these records are read in a single work()
+ * call, so the scan can only yield between batches. A batch stops early at 1MB of documents and
+ * at the first record which is not in memory.
+ *
  * Preconditions: Valid RecordId.
  */
 class CollectionScan final : public PlanStage {
@@ -80,6 +88,24 @@ private:
      */
     StageState returnIfMatches(WorkingSetMember* member, WorkingSetID memberID, WorkingSetID* out);
 
+    /**
+     * Reads records into the batch until it is full, the cursor is exhausted or the next record
+     * is not in memory. Applies the filter to the batch unless a yield is needed first.
+     */
+    StageState fillBatch(WorkingSetID* out);
+
+    /**
+     * Applies the filter to the batch, keeping only the documents which pass it.
+     */
+    void filterBatch();
+
+    /**
+     * Returns the next document of a filtered batch.
+     */
+    StageState returnFromBatch(WorkingSetID* out);
+
+    void clearBatch();
+
     // WorkingSet is not owned by us.
     WorkingSet* _workingSet;
 
@@ -99,6 +125,24 @@ private:
     // should remain in the INVALID state.
     const WorkingSetID _wsidForFetch;
 
+    // Whether the filter is applied to batches of records, see fillBatch().
+    const bool _useBatches;
+
+    // The records of the current batch. Until the batch is filtered, the documents are copied
+    // back to back into _batchBuffer, at _batchOffsets. Once it is filtered, only the ones which
+    // passed the filter are left, as owned copies in _batchDocs, and they are returned starting
+    // at _batchPos.
+    std::vector<RecordId> _batchIds;
+    std::vector<size_t> _batchOffsets;
+    std::vector<char> _batchBuffer;
+    std::vector<BSONObj> _batchDocs;
+    std::vector<SnapshotId> _batchSnapshots;
+    bool _batchFiltered = false;
+    size_t _batchPos = 0;
+
+    // Set once the cursor returned EOF while filling a batch.
+    bool _cursorExhausted = false;
+
     // Stats
     CollectionScanStats _specificStats;
 };
@@ -220,7 +220,7 @@ PlanStage::StageState IndexScan::work(WorkingSetID* out) {
     if (_params.addKeyMetadata) {
         BSONObjBuilder bob;
         bob.appendKeys(_keyPattern, kv->key);
-        member->addComputed(new IndexKeyComputedData(bob.obj()));
+        member->emplaceComputed<IndexKeyComputedData>(bob.obj());
     }
 
     *out = id;
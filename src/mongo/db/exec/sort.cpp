@@ -31,6 +31,8 @@
 #include "mongo/db/exec/sort.h"
 
 #include <algorithm>
+#include <cstring>
+#include <limits>
 
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/index_names.h"
@@ -52,6 +54,49 @@ using std::unique_ptr;
 using std::vector;
 using stdx::make_unique;
 
+namespace {
+
+// Orders keys by prefix with an LSD radix sort, one pass per byte. Passes over a byte that is the
+// same in every key (the KeyString type byte of a single-typed field, the high bytes of small
+// numbers) are skipped. Stable, so keys with equal prefixes keep their insertion order.
+template <typename Key>
+void radixSortByPrefix(std::vector<Key>* keys) {
+    const size_t n = keys->size();
+    if (n < 2) {
+        return;
+    }
+
+    // Build all eight histograms in a single read of the input.
+    std::vector<size_t> counts(8 * 256, 0);
+    for (const Key& key : *keys) {
+        for (size_t byte = 0; byte < 8; ++byte) {
+            ++counts[byte * 256 + ((key.prefix >> (8 * byte)) & 0xff)];
+        }
+    }
+
+    std::vector<Key> scratch(n);
+    for (size_t byte = 0; byte < 8; ++byte) {
+        size_t* histogram = &counts[byte * 256];
+        const unsigned shift = 8 * byte;
+        if (histogram[((*keys)[0].prefix >> shift) & 0xff] == n) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < 256; ++bucket) {
+            const size_t count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += count;
+        }
+        for (const Key& key : *keys) {
+            scratch[histogram[(key.prefix >> shift) & 0xff]++] = key;
+        }
+        keys->swap(scratch);
+    }
+}
+
+}  // namespace
+
 // static
 const char* SortStage::kStageType = "SORT";
 
@@ -91,6 +136,14 @@ SortStage::SortStage(OperationContext* opCtx,
         const WorkingSetComparator& cmp = *_sortKeyComparator;
         _dataSet.reset(new SortableDataItemSet(cmp));
     }
+
+    // Without a limit every key is compared O(log n) times, so it pays to encode each one up
+    // front. An Ordering can only describe 32 fields; longer patterns keep using woCompare().
+    if (_limit == 0 && sortComparator.nFields() <= 32) {
+        _keyOrdering = Ordering::make(sortComparator);
+        _encodedKeyOffsets.push_back(0);
+        _memUsage += encodedKeysMemUsage();
+    }
 }
 
 SortStage::~SortStage() {}
@@ -254,8 +307,11 @@ const SpecificStats* SortStage::getSpecificStats() const {
  * make sure we're not using too much memory.
  *
  * limit == 0:
- *     addToBuffer() - Adds item to vector.
- *     sortBuffer() - Sorts vector.
+ *     addToBuffer() - Adds item to vector. Encodes its sort key as a KeyString
+ *                     unless the pattern is too long for an Ordering or a key
+ *                     holds a type KeyString cannot encode.
+ *     sortBuffer() - Sorts vector, by radix on the encoded key prefixes
+ *                    when the keys were encoded.
  * limit == 1:
  *     addToBuffer() - Replaces first item in vector with max of
  *                     current and new item.
@@ -275,6 +331,12 @@ void SortStage::addToBuffer(const SortableDataItem& item) {
     if (_limit == 0) {
         // Ensure that the BSONObj underlying the WorkingSetMember is owned in case we yield.
         member->makeObjOwnedIfNeeded();
+        if (_keyOrdering && !KeyString::canEncode(item.sortKey)) {
+            abandonEncodedKeys();
+        }
+        if (_keyOrdering) {
+            encodeSortKey(item);
+        }
         _data.push_back(item);
         _memUsage += member->getMemUsage();
     } else if (_limit == 1) {
@@ -335,8 +397,92 @@ void SortStage::addToBuffer(const SortableDataItem& item) {
     }
 }
 
+size_t SortStage::encodedKeysMemUsage() const {
+    return _encodedKeyBytes.capacity() + _encodedKeyOffsets.capacity() * sizeof(size_t) +
+        _encodedKeys.capacity() * sizeof(EncodedSortKey);
+}
+
+void SortStage::abandonEncodedKeys() {
+    _memUsage -= encodedKeysMemUsage();
+    std::vector<char>().swap(_encodedKeyBytes);
+    std::vector<size_t>().swap(_encodedKeyOffsets);
+    std::vector<EncodedSortKey>().swap(_encodedKeys);
+    _keyOrdering = boost::none;
+}
+
+void SortStage::encodeSortKey(const SortableDataItem& item) {
+    invariant(_data.size() < std::numeric_limits<uint32_t>::max());
+    const size_t memUsageBefore = encodedKeysMemUsage();
+
+    _keyString.resetToKey(item.sortKey, *_keyOrdering);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(_keyString.getBuffer());
+    const size_t size = _keyString.getSize();
+
+    EncodedSortKey key;
+    key.prefix = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        key.prefix = (key.prefix << 8) | (i < size ? bytes[i] : 0);
+    }
+    key.index = _data.size();
+    _encodedKeys.push_back(key);
+
+    _encodedKeyBytes.insert(_encodedKeyBytes.end(), bytes, bytes + size);
+    _encodedKeyOffsets.push_back(_encodedKeyBytes.size());
+
+    // The encoded keys count towards the memory limit like the items they belong to.
+    _memUsage += encodedKeysMemUsage() - memUsageBefore;
+}
+
+void SortStage::sortEncodedKeys() {
+    radixSortByPrefix(&_encodedKeys);
+
+    // Keys shorter than eight bytes are zero-padded, which never reorders them relative to a
+    // longer key, so only items with identical prefixes still need comparing.
+    auto fullCompare = [this](const EncodedSortKey& lhs, const EncodedSortKey& rhs) {
+        const size_t lhsBegin = _encodedKeyOffsets[lhs.index];
+        const size_t lhsSize = _encodedKeyOffsets[lhs.index + 1] - lhsBegin;
+        const size_t rhsBegin = _encodedKeyOffsets[rhs.index];
+        const size_t rhsSize = _encodedKeyOffsets[rhs.index + 1] - rhsBegin;
+        int result = memcmp(&_encodedKeyBytes[0] + lhsBegin,
+                            &_encodedKeyBytes[0] + rhsBegin,
+                            std::min(lhsSize, rhsSize));
+        if (0 != result) {
+            return result < 0;
+        }
+        if (lhsSize != rhsSize) {
+            return lhsSize < rhsSize;
+        }
+        // Indices use RecordId as an additional sort key so we must as well.
+        return _data[lhs.index].loc < _data[rhs.index].loc;
+    };
+
+    auto runBegin = _encodedKeys.begin();
+    while (runBegin != _encodedKeys.end()) {
+        auto runEnd = runBegin + 1;
+        while (runEnd != _encodedKeys.end() && runEnd->prefix == runBegin->prefix) {
+            ++runEnd;
+        }
+        if (runEnd - runBegin > 1) {
+            std::sort(runBegin, runEnd, fullCompare);
+        }
+        runBegin = runEnd;
+    }
+
+    vector<SortableDataItem> sortedData;
+    sortedData.reserve(_data.size());
+    for (const EncodedSortKey& key : _encodedKeys) {
+        sortedData.push_back(_data[key.index]);
+    }
+    _data.swap(sortedData);
+
+    // The encoded keys are not needed once the order is known.
+    abandonEncodedKeys();
+}
+
 void SortStage::sortBuffer() {
-    if (_limit == 0) {
+    if (_keyOrdering) {
+        sortEncodedKeys();
+    } else if (_limit == 0) {
         const WorkingSetComparator& cmp = *_sortKeyComparator;
         std::sort(_data.begin(), _data.end(), cmp);
     } else if (_limit == 1) {
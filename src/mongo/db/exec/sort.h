@@ -28,15 +28,18 @@
 
 #pragma once
 
-#include <vector>
+#include <boost/optional.hpp>
 #include <set>
+#include <vector>
 
+#include "mongo/bson/ordering.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/sort_key_generator.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/query/index_bounds.h"
 #include "mongo/db/record_id.h"
+#include "mongo/db/storage/key_string.h"
 #include "mongo/platform/unordered_map.h"
 
 namespace mongo {
@@ -136,6 +139,39 @@ private:
         BSONObj pattern;
     };
 
+    // Sort key of an item in _data, encoded once as KeyString bytes so that comparing two keys is
+    // a memcmp(). The first eight bytes are also packed big-endian into 'prefix', which is all the
+    // radix pass in sortBuffer() looks at and usually all that is needed to order two items.
+    struct EncodedSortKey {
+        uint64_t prefix;
+        // Position of the item in _data, and of its key boundaries in _encodedKeyOffsets.
+        uint32_t index;
+    };
+
+    /**
+     * Appends the KeyString encoding of 'item.sortKey' to _encodedKeyBytes and records it in
+     * _encodedKeys. Only used when _keyOrdering is set.
+     */
+    void encodeSortKey(const SortableDataItem& item);
+
+    /**
+     * Orders _data by the encoded sort keys: a radix sort on the key prefixes followed by a full
+     * comparison, with RecordId as tie-breaker, within each run of equal prefixes.
+     */
+    void sortEncodedKeys();
+
+    /**
+     * Returns the memory held by the encoded sort keys, which is included in _memUsage.
+     */
+    size_t encodedKeysMemUsage() const;
+
+    /**
+     * Frees the encoded sort keys, removes them from _memUsage and clears _keyOrdering, so that
+     * sortBuffer() falls back to the comparator. Used once the keys are sorted and when a key
+     * holds a type KeyString cannot encode.
+     */
+    void abandonEncodedKeys();
+
     /**
      * Inserts one item into data buffer (vector or set).
      * If limit is exceeded, remove item with lowest key.
@@ -165,6 +201,20 @@ private:
     typedef std::set<SortableDataItem, WorkingSetComparator> SortableDataItemSet;
     std::unique_ptr<SortableDataItemSet> _dataSet;
 
+    // Set when there is no limit, the sort pattern fits in an Ordering and every key so far can be
+    // encoded. Keys are then sorted through their KeyString encoding rather than with the
+    // comparator above, which orders them the same way but costs a BSON walk per comparison.
+    boost::optional<Ordering> _keyOrdering;
+
+    // Reused for encoding each sort key.
+    KeyString _keyString;
+
+    // The encoded sort keys of _data, back to back. Key i spans
+    // [_encodedKeyOffsets[i], _encodedKeyOffsets[i + 1]) of _encodedKeyBytes.
+    std::vector<char> _encodedKeyBytes;
+    std::vector<size_t> _encodedKeyOffsets;
+    std::vector<EncodedSortKey> _encodedKeys;
+
     // Iterates through _data post-sort returning it.
     std::vector<SortableDataItem>::iterator _resultIterator;
 
@@ -305,7 +305,7 @@ PlanStage::StageState SortKeyGeneratorStage::work(WorkingSetID* out) {
         }
 
         // Add the sort key to the WSM as computed data.
-        member->addComputed(new SortKeyComputedData(sortKey));
+        member->emplaceComputed<SortKeyComputedData>(sortKey);
 
         return PlanStage::ADVANCED;
     }
@@ -34,6 +34,7 @@
 
 #include "mongo/db/exec/queued_data_stage.h"
 #include "mongo/db/json.h"
+#include "mongo/platform/random.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/unittest/unittest.h"
 
@@ -189,6 +190,106 @@ TEST(SortStageTest, SortDescending) {
              "{output: [{a: 3}, {a: 2}, {a: 1}]}");
 }
 
+TEST(SortStageTest, SortCompoundMixedDirections) {
+    testWork("{a: 1, b: -1}",
+             "{}",
+             0,
+             "{input: [{a: 2, b: 1}, {a: 1, b: 1}, {a: 2, b: 3}, {a: 1, b: 2}]}",
+             "{output: [{a: 1, b: 2}, {a: 1, b: 1}, {a: 2, b: 3}, {a: 2, b: 1}]}");
+}
+
+TEST(SortStageTest, SortMixedTypes) {
+    testWork("{a: 1}",
+             "{}",
+             0,
+             "{input: [{a: 'x'}, {a: 2.5}, {a: null}, {a: {b: 1}}, {a: -3}, {a: true}]}",
+             "{output: [{a: null}, {a: -3}, {a: 2.5}, {a: 'x'}, {a: {b: 1}}, {a: true}]}");
+}
+
+TEST(SortStageTest, SortKeysSharingLongPrefix) {
+    testWork("{a: -1}",
+             "{}",
+             0,
+             "{input: [{a: 'abcdefghij2'}, {a: 'abcdefghij'}, {a: 'abcdefghij10'}, {a: 'abc'}]}",
+             "{output: [{a: 'abcdefghij2'}, {a: 'abcdefghij10'}, {a: 'abcdefghij'}, {a: 'abc'}]}");
+}
+
+TEST(SortStageTest, SortKeysKeyStringCannotEncode) {
+    // KeyString has no encoding for decimals, so once one shows up the keys seen so far are
+    // dropped and the whole input is sorted with the comparator.
+    if (!Decimal128::enabled) {
+        return;
+    }
+    testWork("{a: 1}",
+             "{}",
+             0,
+             "{input: [{a: 2}, {a: 3}, {a: NumberDecimal('1.5')}, {a: {b: NumberDecimal('0')}}, "
+             "{a: 1}]}",
+             "{output: [{a: 1}, {a: NumberDecimal('1.5')}, {a: 2}, {a: 3}, "
+             "{a: {b: NumberDecimal('0')}}]}");
+}
+
+TEST(SortStageTest, SortManyKeysMatchesBSONOrder) {
+    WorkingSet ws;
+    auto queuedDataStage = stdx::make_unique<QueuedDataStage>(nullptr, &ws);
+
+    // Numbers of every width, strings sharing prefixes longer than eight bytes and repeated
+    // values, so every part of the radix pass and its tie-breaking gets exercised.
+    PseudoRandom rand(42);
+    const int kNumDocs = 5000;
+    for (int i = 0; i < kNumDocs; ++i) {
+        BSONObjBuilder bob;
+        switch (rand.nextInt32(4)) {
+            case 0:
+                bob.append("a", rand.nextInt32(100));
+                break;
+            case 1:
+                bob.append("a", static_cast<long long>(rand.nextInt64()));
+                break;
+            case 2:
+                bob.append("a", static_cast<double>(rand.nextInt32()) / 7);
+                break;
+            default:
+                bob.append("a", "commonprefix" + std::to_string(rand.nextInt32(1000)));
+                break;
+        }
+        bob.append("b", rand.nextInt32(3));
+
+        WorkingSetID id = ws.allocate();
+        WorkingSetMember* wsm = ws.get(id);
+        wsm->obj = Snapshotted<BSONObj>(SnapshotId(), bob.obj());
+        wsm->transitionToOwnedObj();
+        queuedDataStage->pushBack(id);
+    }
+
+    SortStageParams params;
+    params.pattern = fromjson("{b: -1, a: 1}");
+    auto sortKeyGen = stdx::make_unique<SortKeyGeneratorStage>(
+        nullptr, queuedDataStage.release(), &ws, params.pattern, BSONObj());
+    SortStage sort(nullptr, params, &ws, sortKeyGen.release());
+
+    WorkingSetID id = WorkingSet::INVALID_ID;
+    PlanStage::StageState state = PlanStage::NEED_TIME;
+    while (state == PlanStage::NEED_TIME) {
+        state = sort.work(&id);
+    }
+
+    // woCompare() matches fields by position, so compare the sort keys rather than the documents.
+    int count = 0;
+    BSONObj previous;
+    while (state == PlanStage::ADVANCED) {
+        BSONObj key = ws.get(id)->obj.value().extractFields(params.pattern);
+        if (count > 0) {
+            ASSERT_LESS_THAN_OR_EQUALS(previous.woCompare(key, params.pattern, false), 0);
+        }
+        previous = key;
+        ++count;
+        state = sort.work(&id);
+    }
+    ASSERT_EQUALS(state, PlanStage::IS_EOF);
+    ASSERT_EQUALS(count, kNumDocs);
+}
+
 TEST(SortStageTest, SortIrrelevantSortKey) {
     testWork("{b: 1}",
              "{}",
@@ -266,7 +266,7 @@ PlanStage::StageState TextOrStage::returnResults(WorkingSetID* out) {
     WorkingSetMember* wsm = _ws->get(textRecordData.wsid);
 
     // Populate the working set member with the text score and return it.
-    wsm->addComputed(new TextScoreComputedData(textRecordData.score));
+    wsm->emplaceComputed<TextScoreComputedData>(textRecordData.score);
     *out = textRecordData.wsid;
     return PlanStage::ADVANCED;
 }
@@ -28,6 +28,9 @@
 
 #include "mongo/db/exec/working_set.h"
 
+#include <algorithm>
+#include <new>
+
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/record_fetcher.h"
@@ -36,15 +39,81 @@ namespace mongo {
 
 using std::string;
 
+//
+// WorkingSetArena
+//
+
+const size_t WorkingSetArena::kMaxAllocationSize;
+const size_t WorkingSetArena::kAlignment;
+const size_t WorkingSetArena::kNumSizeClasses;
+const size_t WorkingSetArena::kMinBlockSize;
+const size_t WorkingSetArena::kMaxBlockSize;
+
+WorkingSetArena::WorkingSetArena() {
+    std::fill(_freeLists, _freeLists + kNumSizeClasses, nullptr);
+}
+
+void* WorkingSetArena::allocate(size_t size) {
+    invariant(size > 0 && size <= kMaxAllocationSize);
+    _stats.allocations++;
+
+    const size_t sc = sizeClass(size);
+    if (FreeChunk* chunk = _freeLists[sc]) {
+        _freeLists[sc] = chunk->next;
+        return chunk;
+    }
+
+    const size_t roundedSize = (sc + 1) * kAlignment;
+    if (static_cast<size_t>(_end - _next) < roundedSize) {
+        // The rest of the current block is abandoned. It is smaller than any allocation.
+        _blocks.emplace_back(new char[_nextBlockSize]);
+        _next = _blocks.back().get();
+        _end = _next + _nextBlockSize;
+        _stats.blocks++;
+        _stats.bytes += _nextBlockSize;
+        _nextBlockSize = std::min(_nextBlockSize * 2, kMaxBlockSize);
+    }
+
+    void* memory = _next;
+    _next += roundedSize;
+    return memory;
+}
+
+void WorkingSetArena::deallocate(void* ptr, size_t size) {
+    const size_t sc = sizeClass(size);
+    FreeChunk* chunk = static_cast<FreeChunk*>(ptr);
+    chunk->next = _freeLists[sc];
+    _freeLists[sc] = chunk;
+}
+
+void WorkingSetArena::clear() {
+    _blocks.clear();
+    _nextBlockSize = kMinBlockSize;
+    _next = nullptr;
+    _end = nullptr;
+    std::fill(_freeLists, _freeLists + kNumSizeClasses, nullptr);
+}
+
+//
+// WorkingSet
+//
+
 WorkingSet::MemberHolder::MemberHolder() : member(NULL) {}
 WorkingSet::MemberHolder::~MemberHolder() {}
 
 WorkingSet::WorkingSet() : _freeList(INVALID_ID) {}
 
 WorkingSet::~WorkingSet() {
+    _destroyMembers();
+}
+
+void WorkingSet::_destroyMembers() {
+    // Members may return computed data to the arena, so they are destroyed before clearing it.
     for (size_t i = 0; i < _data.size(); i++) {
-        delete _data[i].member;
+        _data[i].member->~WorkingSetMember();
     }
+    _data.clear();
+    _arena.clear();
 }
 
 WorkingSetID WorkingSet::allocate() {
@@ -55,7 +124,13 @@ WorkingSetID WorkingSet::allocate() {
         WorkingSetID id = _data.size();
         _data.resize(_data.size() + 1);
         _data.back().nextFreeOrSelf = id;
-        _data.back().member = new WorkingSetMember();
+
+        static_assert(sizeof(WorkingSetMember) <= WorkingSetArena::kMaxAllocationSize,
+                      "WorkingSetMember must fit into a WorkingSetArena allocation");
+        WorkingSetMember* member = new (_arena.allocate(sizeof(WorkingSetMember)))
+            WorkingSetMember();
+        member->_arena = &_arena;
+        _data.back().member = member;
         return id;
     }
 
@@ -93,10 +168,7 @@ bool WorkingSet::isFlagged(WorkingSetID id) const {
 }
 
 void WorkingSet::clear() {
-    for (size_t i = 0; i < _data.size(); i++) {
-        delete _data[i].member;
-    }
-    _data.clear();
+    _destroyMembers();
 
     // Since working set is now empty, the free list pointer should
     // point to nothing.
@@ -186,8 +258,23 @@ const WorkingSetComputedData* WorkingSetMember::getComputed(
 }
 
 void WorkingSetMember::addComputed(WorkingSetComputedData* data) {
-    verify(!hasComputed(data->type()));
-    _computed[data->type()].reset(data);
+    _setComputed(ComputedDataPtr(data));
+}
+
+void WorkingSetMember::_setComputed(ComputedDataPtr data) {
+    const WorkingSetComputedDataType type = data->type();
+    verify(!hasComputed(type));
+    _computed[type] = std::move(data);
+}
+
+void WorkingSetComputedDataDeleter::operator()(WorkingSetComputedData* data) const {
+    if (!arena) {
+        delete data;
+        return;
+    }
+
+    data->~WorkingSetComputedData();
+    arena->deallocate(data, size);
 }
 
 void WorkingSetMember::setFetcher(RecordFetcher* fetcher) {
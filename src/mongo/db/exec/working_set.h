@@ -28,8 +28,11 @@
 
 #pragma once
 
-#include <vector>
+#include <memory>
+#include <new>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/db/jsobj.h"
@@ -45,6 +48,86 @@ class WorkingSetMember;
 
 typedef size_t WorkingSetID;
 
+/**
+ * Memory for the members of a WorkingSet and for their computed data, which lives as long as the
+ * WorkingSet, and so as long as the PlanExecutor owning it.
+ *
+ * Allocations are carved out of blocks that are only returned to the heap in bulk, by clear() or
+ * on destruction. Deallocated memory is kept on a free list per size class and reused by later
+ * allocations of the same size class, so that streaming through many results does not grow the
+ * arena beyond the peak number of live allocations.
+ *
+ * Nothing allocated from the arena refers to storage engine memory, so yielding, saving and
+ * restoring a plan has no effect on it.
+ */
+class WorkingSetArena {
+    MONGO_DISALLOW_COPYING(WorkingSetArena);
+
+public:
+    // The largest allocation the arena serves.
+    static const size_t kMaxAllocationSize = 256;
+
+    struct Stats {
+        // Number of allocations served, each of which would otherwise have been a heap
+        // allocation.
+        size_t allocations = 0;
+
+        // Number of blocks allocated from the heap to serve them, and their total size.
+        size_t blocks = 0;
+        size_t bytes = 0;
+    };
+
+    WorkingSetArena();
+
+    /**
+     * Returns memory for an object of 'size' bytes, which may not exceed kMaxAllocationSize.
+     */
+    void* allocate(size_t size);
+
+    /**
+     * Makes memory returned by allocate() for 'size' bytes available to later allocations.
+     */
+    void deallocate(void* ptr, size_t size);
+
+    /**
+     * Returns all blocks to the heap. Everything allocated from the arena must have been
+     * destroyed beforehand. Does not reset the stats.
+     */
+    void clear();
+
+    const Stats& getStats() const {
+        return _stats;
+    }
+
+private:
+    static const size_t kAlignment = 16;
+    static const size_t kNumSizeClasses = kMaxAllocationSize / kAlignment;
+
+    // Blocks start small, for the many queries which only ever have a few results in flight,
+    // and double in size up to the maximum.
+    static const size_t kMinBlockSize = 4 * 1024;
+    static const size_t kMaxBlockSize = 1024 * 1024;
+
+    struct FreeChunk {
+        FreeChunk* next;
+    };
+
+    static size_t sizeClass(size_t size) {
+        return (size + kAlignment - 1) / kAlignment - 1;
+    }
+
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    size_t _nextBlockSize = kMinBlockSize;
+
+    // The unused part of the last block.
+    char* _next = nullptr;
+    char* _end = nullptr;
+
+    FreeChunk* _freeLists[kNumSizeClasses];
+
+    Stats _stats;
+};
+
 /**
  * All data in use by a query.  Data is passed through the stage tree by referencing the ID of
  * an element of the working set.  Stages can add elements to the working set, delete elements
@@ -139,7 +222,20 @@ public:
      */
     std::vector<WorkingSetID> getAndClearYieldSensitiveIds();
 
+    /**
+     * Returns how many allocations the members of this working set and their computed data made
+     * from its arena, and how much memory the arena took from the heap for them.
+     */
+    const WorkingSetArena::Stats& getArenaStats() const {
+        return _arena.getStats();
+    }
+
 private:
+    /**
+     * Destroys all members and returns their memory to the heap.
+     */
+    void _destroyMembers();
+
     struct MemberHolder {
         MemberHolder();
         ~MemberHolder();
@@ -147,10 +243,13 @@ private:
         // Free list link if freed. Points to self if in use.
         WorkingSetID nextFreeOrSelf;
 
-        // Owning pointer
+        // Owning pointer, allocated from _arena.
         WorkingSetMember* member;
     };
 
+    // Must outlive the members.
+    WorkingSetArena _arena;
+
     // All WorkingSetIDs are indexes into this, except for INVALID_ID.
     // Elements are added to _freeList rather than removed when freed.
     std::vector<MemberHolder> _data;
@@ -229,6 +328,19 @@ private:
     WorkingSetComputedDataType _type;
 };
 
+/**
+ * Destroys computed data, and returns its memory to the heap, or to 'arena' if set.
+ */
+struct WorkingSetComputedDataDeleter {
+    WorkingSetComputedDataDeleter() = default;
+    WorkingSetComputedDataDeleter(WorkingSetArena* arena, size_t size) : arena(arena), size(size) {}
+
+    void operator()(WorkingSetComputedData* data) const;
+
+    WorkingSetArena* arena = nullptr;
+    size_t size = 0;
+};
+
 /**
  * The type of the data passed between query stages.  In particular:
  *
@@ -306,6 +418,13 @@ public:
     const WorkingSetComputedData* getComputed(const WorkingSetComputedDataType type) const;
     void addComputed(WorkingSetComputedData* data);
 
+    /**
+     * Constructs computed data of type T from 'args' and adds it. The data is allocated from the
+     * arena of the WorkingSet this member belongs to, if any.
+     */
+    template <typename T, typename... Args>
+    void emplaceComputed(Args&&... args);
+
     //
     // Fetching
     //
@@ -334,11 +453,41 @@ public:
 private:
     friend class WorkingSet;
 
+    using ComputedDataPtr =
+        std::unique_ptr<WorkingSetComputedData, WorkingSetComputedDataDeleter>;
+
+    void _setComputed(ComputedDataPtr data);
+
     MemberState _state = WorkingSetMember::INVALID;
 
-    std::unique_ptr<WorkingSetComputedData> _computed[WSM_COMPUTED_NUM_TYPES];
+    // Set if this member belongs to a WorkingSet.
+    WorkingSetArena* _arena = nullptr;
+
+    ComputedDataPtr _computed[WSM_COMPUTED_NUM_TYPES];
 
     std::unique_ptr<RecordFetcher> _fetcher;
 };
 
+template <typename T, typename... Args>
+void WorkingSetMember::emplaceComputed(Args&&... args) {
+    static_assert(sizeof(T) <= WorkingSetArena::kMaxAllocationSize,
+                  "computed data must fit into a WorkingSetArena allocation");
+
+    if (!_arena) {
+        addComputed(new T(std::forward<Args>(args)...));
+        return;
+    }
+
+    void* memory = _arena->allocate(sizeof(T));
+    T* data;
+    try {
+        data = new (memory) T(std::forward<Args>(args)...);
+    } catch (...) {
+        _arena->deallocate(memory, sizeof(T));
+        throw;
+    }
+
+    _setComputed(ComputedDataPtr(data, WorkingSetComputedDataDeleter(_arena, sizeof(T))));
+}
+
 }  // namespace mongo
@@ -32,6 +32,7 @@
 
 
 #include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_computed_data.h"
 #include "mongo/db/json.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/storage/snapshot.h"
@@ -154,4 +155,76 @@ TEST_F(WorkingSetFixture, getDottedFieldFromIndex) {
     ASSERT_FALSE(member->getFieldDotted("y", &elt));
 }
 
+TEST(WorkingSetArenaTest, ReusesDeallocatedMemoryOfTheSameSizeClass) {
+    WorkingSetArena arena;
+    void* first = arena.allocate(40);
+    void* second = arena.allocate(40);
+    ASSERT_NOT_EQUALS(first, second);
+
+    arena.deallocate(first, 40);
+    ASSERT_EQUALS(first, arena.allocate(48));
+
+    arena.deallocate(second, 40);
+    ASSERT_NOT_EQUALS(second, arena.allocate(64));
+    ASSERT_EQUALS(second, arena.allocate(33));
+
+    ASSERT_EQUALS(5U, arena.getStats().allocations);
+    ASSERT_EQUALS(1U, arena.getStats().blocks);
+}
+
+TEST(WorkingSetArenaTest, AllocatesGrowingBlocks) {
+    WorkingSetArena arena;
+    const size_t numAllocations = 100 * 1000;
+    for (size_t i = 0; i < numAllocations; i++) {
+        ASSERT(arena.allocate(WorkingSetArena::kMaxAllocationSize));
+    }
+
+    const WorkingSetArena::Stats& stats = arena.getStats();
+    ASSERT_EQUALS(numAllocations, stats.allocations);
+    ASSERT_GREATER_THAN_OR_EQUALS(stats.bytes,
+                                  numAllocations * WorkingSetArena::kMaxAllocationSize);
+    ASSERT_LESS_THAN(stats.blocks, 50U);
+
+    // Clearing returns the blocks, so that the next allocation takes a new one.
+    const size_t blocks = stats.blocks;
+    arena.clear();
+    ASSERT(arena.allocate(1));
+    ASSERT_EQUALS(blocks + 1, stats.blocks);
+}
+
+TEST_F(WorkingSetFixture, ComputedDataIsAllocatedFromTheArena) {
+    member->emplaceComputed<SortKeyComputedData>(BSON("" << 1));
+    ASSERT_TRUE(member->hasComputed(WSM_SORT_KEY));
+    ASSERT_EQUALS(1, static_cast<const SortKeyComputedData*>(member->getComputed(WSM_SORT_KEY))
+                         ->getSortKey()
+                         .firstElement()
+                         .numberInt());
+
+    // The member and its computed data.
+    const size_t allocations = ws->getArenaStats().allocations;
+    ASSERT_EQUALS(2U, allocations);
+
+    // Freed members and computed data are reused, without taking more memory from the heap.
+    const size_t blocks = ws->getArenaStats().blocks;
+    for (int i = 0; i < 1000; i++) {
+        ws->free(id);
+        id = ws->allocate();
+        member = ws->get(id);
+        ASSERT_FALSE(member->hasComputed(WSM_SORT_KEY));
+        member->emplaceComputed<SortKeyComputedData>(BSON("" << i));
+        member->emplaceComputed<TextScoreComputedData>(1.5);
+    }
+    ASSERT_EQUALS(blocks, ws->getArenaStats().blocks);
+}
+
+TEST(WorkingSetMemberTest, ComputedDataOfStandaloneMemberIsOnTheHeap) {
+    WorkingSetMember member;
+    member.emplaceComputed<TextScoreComputedData>(2.5);
+    ASSERT_EQUALS(2.5,
+                  static_cast<const TextScoreComputedData*>(
+                      member.getComputed(WSM_COMPUTED_TEXT_SCORE))->getScore());
+    member.clear();
+    ASSERT_FALSE(member.hasComputed(WSM_COMPUTED_TEXT_SCORE));
+}
+
 }  // namespace
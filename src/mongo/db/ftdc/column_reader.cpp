@@ -0,0 +1,188 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/ftdc/column_reader.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <fstream>
+
+#include "mongo/db/ftdc/constants.h"
+#include "mongo/db/ftdc/util.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+Status FTDCColumnReader::open(const boost::filesystem::path& file) {
+    return _reader.open(file);
+}
+
+StatusWith<bool> FTDCColumnReader::hasNext() {
+    while (true) {
+        auto swDoc = _reader.readDocument();
+        if (!swDoc.isOK()) {
+            return swDoc.getStatus();
+        }
+
+        const BSONObj& doc = swDoc.getValue();
+        if (doc.isEmpty()) {
+            return {false};
+        }
+
+        auto swType = FTDCBSONUtil::getBSONDocumentType(doc);
+        if (!swType.isOK()) {
+            return swType.getStatus();
+        }
+
+        Status status = Status::OK();
+        switch (swType.getValue()) {
+            case FTDCBSONUtil::FTDCType::kMetadata:
+                continue;
+
+            case FTDCBSONUtil::FTDCType::kMetricChunk:
+                status = FTDCBSONUtil::getColumnsFromMetricDoc(doc, &_decompressor, &_columns);
+                break;
+
+            case FTDCBSONUtil::FTDCType::kMetricColumns:
+                status = FTDCBSONUtil::getColumnsFromMetricColumnsDoc(doc, &_compressor, &_columns);
+                break;
+        }
+
+        if (!status.isOK()) {
+            return status;
+        }
+
+        return {true};
+    }
+}
+
+std::vector<boost::filesystem::path> FTDCColumnarConverter::listFiles(
+    const boost::filesystem::path& dir) {
+    const auto interimFile = FTDCUtil::getInterimFile(dir);
+    const auto interimTempFile = FTDCUtil::getInterimTempFile(dir);
+
+    std::vector<boost::filesystem::path> files;
+
+    boost::filesystem::directory_iterator di(dir);
+    for (; di != boost::filesystem::directory_iterator(); di++) {
+        const auto& file = di->path();
+        std::string str = file.filename().generic_string();
+        if (str.compare(0, strlen(kFTDCArchiveFile), kFTDCArchiveFile) == 0 &&
+            file != interimFile && file != interimTempFile) {
+            files.emplace_back(file);
+        }
+    }
+
+    // Archive file names end with the time they were created
+    std::sort(files.begin(), files.end());
+
+    // The interim file has the most recent chunk, which is not in any archive file yet
+    if (boost::filesystem::exists(interimFile)) {
+        files.emplace_back(interimFile);
+    }
+
+    return files;
+}
+
+Status FTDCColumnarConverter::convert(const std::vector<boost::filesystem::path>& files,
+                                      const boost::filesystem::path& output) {
+    std::ofstream stream(output.c_str(),
+                         std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!stream.is_open()) {
+        return {ErrorCodes::FileStreamFailed, "Failed to open file " + output.generic_string()};
+    }
+
+    for (const auto& file : files) {
+        FTDCFileReader reader;
+        Status status = reader.open(file);
+        if (!status.isOK()) {
+            return status;
+        }
+
+        _stats.files++;
+        _stats.inputBytes += boost::filesystem::file_size(file);
+
+        while (true) {
+            auto swDoc = reader.readDocument();
+            if (!swDoc.isOK()) {
+                return swDoc.getStatus();
+            }
+
+            if (swDoc.getValue().isEmpty()) {
+                break;
+            }
+
+            BSONObj doc = swDoc.getValue();
+
+            auto swType = FTDCBSONUtil::getBSONDocumentType(doc);
+            if (!swType.isOK()) {
+                return swType.getStatus();
+            }
+
+            if (swType.getValue() == FTDCBSONUtil::FTDCType::kMetricChunk) {
+                status = FTDCBSONUtil::getColumnsFromMetricDoc(doc, &_decompressor, &_columns);
+                if (!status.isOK()) {
+                    return status;
+                }
+
+                auto swColumnsDoc =
+                    FTDCBSONUtil::createBSONMetricColumnsDocument(_columns, &_compressor);
+                if (!swColumnsDoc.isOK()) {
+                    return swColumnsDoc.getStatus();
+                }
+
+                doc = swColumnsDoc.getValue();
+
+                _stats.chunks++;
+                _stats.samples += _columns.getSamplesCount();
+            }
+
+            stream.write(doc.objdata(), doc.objsize());
+            if (stream.fail()) {
+                return {ErrorCodes::FileStreamFailed,
+                        str::stream() << "Failed to write to file \'" << output.generic_string()
+                                      << "\'"};
+            }
+
+            _stats.outputBytes += doc.objsize();
+        }
+    }
+
+    stream.close();
+    if (stream.fail()) {
+        return {ErrorCodes::FileStreamFailed,
+                str::stream() << "Failed to close file \'" << output.generic_string() << "\'"};
+    }
+
+    return Status::OK();
+}
+
+}  // namespace mongo
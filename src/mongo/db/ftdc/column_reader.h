@@ -0,0 +1,131 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/base/status_with.h"
+#include "mongo/db/ftdc/block_compressor.h"
+#include "mongo/db/ftdc/columns.h"
+#include "mongo/db/ftdc/decompressor.h"
+#include "mongo/db/ftdc/file_reader.h"
+
+namespace mongo {
+
+/**
+ * Reads the metric chunks of a file, either an FTDC file written by the server or a file written
+ * by FTDCColumnarConverter, decoded into columns. Metadata documents are skipped.
+ *
+ * Meant for offline analysis of FTDC data.
+ */
+class FTDCColumnReader {
+    MONGO_DISALLOW_COPYING(FTDCColumnReader);
+
+public:
+    FTDCColumnReader() = default;
+
+    /**
+     * Open the specified file
+     */
+    Status open(const boost::filesystem::path& file);
+
+    /**
+     * Returns true if a chunk was decoded and can be retrieved with next().
+     * Returns false if the end of the file has been reached.
+     * Return other error codes if the file is corrupt.
+     */
+    StatusWith<bool> hasNext();
+
+    /**
+     * Returns the columns of the chunk decoded by the last call to hasNext(). They are
+     * overwritten by the next call to hasNext().
+     */
+    const FTDCMetricColumns& next() const {
+        return _columns;
+    }
+
+private:
+    FTDCFileReader _reader;
+
+    // Decodes metric chunks
+    FTDCDecompressor _decompressor;
+
+    // Decodes metric columns
+    BlockCompressor _compressor;
+
+    FTDCMetricColumns _columns;
+};
+
+/**
+ * Converts FTDC files into a single file of metric columns documents, which FTDCColumnReader
+ * decodes without any per-sample work. Metadata documents are copied as is.
+ */
+class FTDCColumnarConverter {
+    MONGO_DISALLOW_COPYING(FTDCColumnarConverter);
+
+public:
+    struct Stats {
+        std::size_t files{0};
+        std::size_t chunks{0};
+        std::size_t samples{0};
+        std::uint64_t inputBytes{0};
+        std::uint64_t outputBytes{0};
+    };
+
+    FTDCColumnarConverter() = default;
+
+    /**
+     * Lists the metric files in an FTDC directory in the order they were written, including
+     * the interim file.
+     */
+    static std::vector<boost::filesystem::path> listFiles(const boost::filesystem::path& dir);
+
+    /**
+     * Converts the specified FTDC files, in order, into 'output', which is overwritten.
+     */
+    Status convert(const std::vector<boost::filesystem::path>& files,
+                   const boost::filesystem::path& output);
+
+    const Stats& getStats() const {
+        return _stats;
+    }
+
+private:
+    FTDCDecompressor _decompressor;
+    BlockCompressor _compressor;
+    FTDCMetricColumns _columns;
+
+    Stats _stats;
+};
+
+}  // namespace mongo
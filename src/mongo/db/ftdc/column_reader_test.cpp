@@ -0,0 +1,262 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/filesystem.hpp>
+#include <random>
+
+#include "mongo/bson/bsonmisc.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/ftdc/column_reader.h"
+#include "mongo/db/ftdc/columns.h"
+#include "mongo/db/ftdc/compressor.h"
+#include "mongo/db/ftdc/config.h"
+#include "mongo/db/ftdc/decompressor.h"
+#include "mongo/db/ftdc/file_writer.h"
+#include "mongo/db/ftdc/ftdc_test.h"
+#include "mongo/db/ftdc/util.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * Generates samples with metrics that stay the same, change by small and large amounts, and
+ * go backwards, so that all the ways the compressor encodes deltas are used.
+ */
+BSONObj makeSample(std::mt19937_64& random, int i) {
+    return BSON("start" << Date_t::fromMillisSinceEpoch(1000LL * i) << "name"
+                        << "joe"
+                        << "counters"
+                        << BSON("flat" << 7 << "small" << i * 3 << "large"
+                                       << static_cast<long long>(i) * 1000003 << "random"
+                                       << static_cast<long long>(random() >> 1))
+                        << "opTime" << Timestamp(1000 + i, i % 5) << "flag" << (i % 3 == 0)
+                        << "array" << BSON_ARRAY(i % 200 << 5 << -i)
+                        << "end" << Date_t::fromMillisSinceEpoch(1000LL * i + 3));
+}
+
+/**
+ * Checks that 'columns' holds the metrics of 'docs', one sample per document.
+ */
+void validateColumns(const FTDCMetricColumns& columns, const std::vector<BSONObj>& docs) {
+    ASSERT_EQUALS(columns.getSamplesCount(), docs.size());
+
+    for (std::size_t j = 0; j < docs.size(); j++) {
+        std::vector<std::uint64_t> metrics;
+        ASSERT_OK(FTDCBSONUtil::extractMetricsFromDocument(docs[j], docs[j], &metrics));
+        ASSERT_EQUALS(columns.getMetricsCount(), metrics.size());
+
+        for (std::size_t i = 0; i < metrics.size(); i++) {
+            ASSERT_EQUALS(columns.getColumn(i)[j], metrics[i]);
+        }
+    }
+}
+
+/**
+ * Compresses 'count' generated samples into a single chunk.
+ */
+std::vector<BSONObj> compressSamples(FTDCCompressor* compressor, int count) {
+    std::mt19937_64 random(1);
+    std::vector<BSONObj> docs;
+
+    for (int i = 0; i < count; i++) {
+        docs.emplace_back(makeSample(random, i));
+        auto st = compressor->addSample(docs.back(), Date_t());
+        ASSERT_OK(st.getStatus());
+        ASSERT_FALSE(st.getValue().is_initialized());
+    }
+
+    return docs;
+}
+
+TEST(FTDCColumnsTest, MetricNames) {
+    BSONObj doc = BSON("a" << 1 << "s"
+                           << "string"
+                           << "b" << BSON("c" << 2.0 << "d" << true << "e" << BSONObj()) << "t"
+                           << Timestamp(5, 6) << "arr" << BSON_ARRAY(1 << "x" << 3) << "f"
+                           << Date_t());
+
+    std::vector<std::string> names;
+    ASSERT_OK(FTDCBSONUtil::extractMetricNamesFromDocument(doc, &names));
+
+    std::vector<std::string> expected{"a", "b.c", "b.d", "t.t", "t.i", "arr.0", "arr.2", "f"};
+    ASSERT_TRUE(names == expected);
+
+    std::vector<std::uint64_t> metrics;
+    ASSERT_OK(FTDCBSONUtil::extractMetricsFromDocument(doc, doc, &metrics));
+    ASSERT_EQUALS(names.size(), metrics.size());
+}
+
+TEST(FTDCColumnsTest, UncompressColumns) {
+    FTDCConfig config;
+    FTDCCompressor compressor(&config);
+
+    std::vector<BSONObj> docs = compressSamples(&compressor, 250);
+
+    auto swBuf = compressor.getCompressedSamples();
+    ASSERT_OK(swBuf.getStatus());
+    ConstDataRange buf = std::get<0>(swBuf.getValue());
+
+    FTDCDecompressor decompressor;
+
+    FTDCMetricColumns columns;
+    ASSERT_OK(decompressor.uncompressColumns(buf, Date_t::fromMillisSinceEpoch(42), &columns));
+    ASSERT_EQUALS(Date_t::fromMillisSinceEpoch(42), columns.getId());
+    validateColumns(columns, docs);
+
+    std::size_t small = columns.findMetric("counters.small");
+    ASSERT_LESS_THAN(small, columns.getMetricsCount());
+    ASSERT_EQUALS(columns.getColumn(small)[100], 300U);
+    ASSERT_EQUALS(columns.findMetric("name"), columns.getMetricsCount());
+
+    // Both decoders must agree
+    auto swDocs = decompressor.uncompress(buf);
+    ASSERT_OK(swDocs.getStatus());
+    ValidateDocumentList(swDocs.getValue(), docs);
+}
+
+TEST(FTDCColumnsTest, UncompressColumnsCorrupt) {
+    FTDCConfig config;
+    FTDCCompressor compressor(&config);
+
+    compressSamples(&compressor, 20);
+
+    auto swBuf = compressor.getCompressedSamples();
+    ASSERT_OK(swBuf.getStatus());
+    ConstDataRange buf = std::get<0>(swBuf.getValue());
+
+    FTDCDecompressor decompressor;
+    FTDCMetricColumns columns;
+    ASSERT_NOT_OK(
+        decompressor.uncompressColumns({buf.data(), buf.length() / 2}, Date_t(), &columns));
+}
+
+TEST(FTDCColumnsTest, MetricColumnsDocumentRoundTrip) {
+    FTDCConfig config;
+    FTDCCompressor compressor(&config);
+
+    std::vector<BSONObj> docs = compressSamples(&compressor, 100);
+
+    auto swBuf = compressor.getCompressedSamples();
+    ASSERT_OK(swBuf.getStatus());
+
+    FTDCDecompressor decompressor;
+    FTDCMetricColumns columns;
+    ASSERT_OK(decompressor.uncompressColumns(
+        std::get<0>(swBuf.getValue()), Date_t::fromMillisSinceEpoch(7), &columns));
+
+    BlockCompressor blockCompressor;
+    auto swDoc = FTDCBSONUtil::createBSONMetricColumnsDocument(columns, &blockCompressor);
+    ASSERT_OK(swDoc.getStatus());
+
+    auto swType = FTDCBSONUtil::getBSONDocumentType(swDoc.getValue());
+    ASSERT_OK(swType.getStatus());
+    ASSERT_TRUE(swType.getValue() == FTDCBSONUtil::FTDCType::kMetricColumns);
+
+    FTDCMetricColumns roundTripped;
+    ASSERT_OK(FTDCBSONUtil::getColumnsFromMetricColumnsDoc(
+        swDoc.getValue(), &blockCompressor, &roundTripped));
+
+    ASSERT_EQUALS(Date_t::fromMillisSinceEpoch(7), roundTripped.getId());
+    ASSERT_TRUE(columns.getNames() == roundTripped.getNames());
+    validateColumns(roundTripped, docs);
+}
+
+TEST(FTDCColumnsTest, ConvertDirectory) {
+    unittest::TempDir tempdir("metrics_testpath");
+    boost::filesystem::path dir(tempdir.path());
+    boost::filesystem::path output = dir.parent_path() / "metrics_columns_test.out";
+
+    FTDCConfig config;
+    FTDCFileWriter writer(&config);
+    ASSERT_OK(writer.open(dir / "metrics.2016-01-01T00-00-00Z-00000"));
+
+    std::mt19937_64 random(1);
+    std::vector<BSONObj> docs;
+
+    ASSERT_OK(writer.writeMetadata(BSON("host"
+                                        << "localhost"),
+                                   Date_t()));
+    for (int i = 0; i < 1000; i++) {
+        docs.emplace_back(makeSample(random, i));
+        ASSERT_OK(writer.writeSample(docs.back(), Date_t()));
+    }
+    writer.close();
+
+    auto files = FTDCColumnarConverter::listFiles(dir);
+    ASSERT_EQUALS(1U, files.size());
+
+    FTDCColumnarConverter converter;
+    ASSERT_OK(converter.convert(files, output));
+    ASSERT_EQUALS(1U, converter.getStats().files);
+
+    // Both the original and the converted file decode into the same columns
+    for (const auto& file : {files[0], output}) {
+        FTDCColumnReader reader;
+        ASSERT_OK(reader.open(file));
+
+        std::size_t pos = 0;
+        std::size_t chunks = 0;
+        while (true) {
+            auto sw = reader.hasNext();
+            ASSERT_OK(sw.getStatus());
+            if (!sw.getValue()) {
+                break;
+            }
+
+            const FTDCMetricColumns& columns = reader.next();
+            std::vector<BSONObj> chunkDocs(docs.begin() + pos,
+                                           docs.begin() + pos + columns.getSamplesCount());
+            validateColumns(columns, chunkDocs);
+
+            pos += columns.getSamplesCount();
+            chunks++;
+        }
+
+        ASSERT_EQUALS(docs.size(), pos);
+        ASSERT_EQUALS(converter.getStats().chunks, chunks);
+    }
+
+    // The document reader returns the metadata but does not understand the columns
+    FTDCFileReader reader;
+    ASSERT_OK(reader.open(output));
+    auto sw = reader.hasNext();
+    ASSERT_OK(sw.getStatus());
+    ASSERT_TRUE(sw.getValue());
+    ASSERT_TRUE(std::get<0>(reader.next()) == FTDCBSONUtil::FTDCType::kMetadata);
+    ASSERT_NOT_OK(reader.hasNext());
+
+    boost::filesystem::remove(output);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,112 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+/**
+ * The samples of one metric chunk, stored as one contiguous array per metric instead of one
+ * BSON document per sample. This is the layout that offline time-series analysis of FTDC data
+ * wants, and it can be filled without constructing any documents.
+ *
+ * Sample 0 of each column is the value from the chunk's reference document, so each column has
+ * the same number of entries as FTDCDecompressor::uncompress returns documents.
+ */
+class FTDCMetricColumns {
+    MONGO_DISALLOW_COPYING(FTDCMetricColumns);
+
+public:
+    FTDCMetricColumns() = default;
+
+    /**
+     * Resizes the columns for the specified metrics and number of samples. The contents of the
+     * columns are unspecified until they are filled by the caller.
+     */
+    void reset(Date_t id, std::vector<std::string> names, std::uint32_t samplesCount);
+
+    /**
+     * The _id of the metric chunk these columns were decoded from.
+     */
+    Date_t getId() const {
+        return _id;
+    }
+
+    std::size_t getMetricsCount() const {
+        return _names.size();
+    }
+
+    std::uint32_t getSamplesCount() const {
+        return _samplesCount;
+    }
+
+    const std::vector<std::string>& getNames() const {
+        return _names;
+    }
+
+    /**
+     * Returns the index of the metric with the specified dotted name, or getMetricsCount() if
+     * there is no such metric.
+     */
+    std::size_t findMetric(StringData name) const;
+
+    const std::uint64_t* getColumn(std::size_t metric) const {
+        return _values.data() + metric * _samplesCount;
+    }
+
+    std::uint64_t* getColumn(std::size_t metric) {
+        return _values.data() + metric * _samplesCount;
+    }
+
+    /**
+     * All columns back to back, getMetricsCount() * getSamplesCount() values.
+     */
+    const std::vector<std::uint64_t>& getValues() const {
+        return _values;
+    }
+
+private:
+    Date_t _id;
+
+    std::vector<std::string> _names;
+
+    std::uint32_t _samplesCount{0};
+
+    std::vector<std::uint64_t> _values;
+};
+
+}  // namespace mongo
@@ -39,6 +39,9 @@ extern const char kFTDCDocField[];
 
 extern const char kFTDCDocsField[];
 
+extern const char kFTDCNamesField[];
+extern const char kFTDCCountField[];
+
 extern const char kFTDCCollectStartField[];
 extern const char kFTDCCollectEndField[];
 
@@ -30,8 +30,12 @@
 
 #include "mongo/db/ftdc/decompressor.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "mongo/base/data_range_cursor.h"
 #include "mongo/base/data_type_validated.h"
+#include "mongo/db/ftdc/columns.h"
 #include "mongo/db/ftdc/compressor.h"
 #include "mongo/db/ftdc/util.h"
 #include "mongo/db/ftdc/varint.h"
@@ -41,13 +45,86 @@
 
 namespace mongo {
 
-StatusWith<std::vector<BSONObj>> FTDCDecompressor::uncompress(ConstDataRange buf) {
+namespace {
+
+/**
+ * Decodes 'count' deltas written by FTDCCompressor: varints, where each zero is followed by the
+ * number of additional zeroes in the run.
+ *
+ * Most deltas are small enough to fit in a single byte. Eight input bytes at a time are checked
+ * for continuation bits and zero bytes with a few word operations; if there are neither, they
+ * are eight deltas, which are widened in a loop the compiler vectorizes. Anything else goes
+ * through the regular varint decoder.
+ */
+Status decodeDeltas(ConstDataRangeCursor* cursor, std::uint64_t* deltas, std::size_t count) {
+    const std::uint64_t kHighBits = 0x8080808080808080ULL;
+    const std::uint64_t kLowBits = 0x0101010101010101ULL;
+
+    const char* const begin = cursor->data();
+    const char* const end = begin + cursor->length();
+    const char* ptr = begin;
+
+    std::size_t pos = 0;
+    while (pos < count) {
+        if (end - ptr >= 8 && count - pos >= 8) {
+            std::uint64_t word;
+            std::memcpy(&word, ptr, sizeof(word));
+
+            // The second term has a high bit set iff some byte is zero
+            if (((word | ((word - kLowBits) & ~word)) & kHighBits) == 0) {
+                const unsigned char* bytes = reinterpret_cast<const unsigned char*>(ptr);
+                for (std::size_t i = 0; i < 8; i++) {
+                    deltas[pos + i] = bytes[i];
+                }
+
+                ptr += 8;
+                pos += 8;
+                continue;
+            }
+        }
+
+        FTDCVarInt delta;
+        std::size_t advanced;
+        Status status = DataType::load(&delta, ptr, end - ptr, &advanced, ptr - begin);
+        if (!status.isOK()) {
+            return status;
+        }
+        ptr += advanced;
+
+        deltas[pos++] = delta;
+
+        if (delta == 0) {
+            FTDCVarInt zeroes;
+            status = DataType::load(&zeroes, ptr, end - ptr, &advanced, ptr - begin);
+            if (!status.isOK()) {
+                return status;
+            }
+            ptr += advanced;
+
+            // A run of zeroes may extend past the last delta
+            const std::size_t runLength = std::min(static_cast<std::uint64_t>(count - pos),
+                                                   static_cast<std::uint64_t>(zeroes));
+            std::fill(deltas + pos, deltas + pos + runLength, 0);
+            pos += runLength;
+        }
+    }
+
+    return cursor->advance(ptr - begin);
+}
+
+}  // namespace
+
+Status FTDCDecompressor::_uncompressHeader(ConstDataRange buf,
+                                           ConstDataRangeCursor* cursor,
+                                           BSONObj* ref,
+                                           std::vector<std::uint64_t>* metrics,
+                                           std::uint32_t* sampleCount) {
     ConstDataRangeCursor compressedDataRange(buf);
 
     // Read the length of the uncompressed buffer
     auto swUncompressedLength = compressedDataRange.readAndAdvance<LittleEndian<std::uint32_t>>();
     if (!swUncompressedLength.isOK()) {
-        return {swUncompressedLength.getStatus()};
+        return swUncompressedLength.getStatus();
     }
 
     // Now uncompress the data
@@ -61,7 +138,7 @@ StatusWith<std::vector<BSONObj>> FTDCDecompressor::uncompress(ConstDataRange buf
     auto statusUncompress = _compressor.uncompress(compressedDataRange, uncompressedLength);
 
     if (!statusUncompress.isOK()) {
-        return {statusUncompress.getStatus()};
+        return statusUncompress.getStatus();
     }
 
     ConstDataRangeCursor cdc = statusUncompress.getValue();
@@ -69,15 +146,15 @@ StatusWith<std::vector<BSONObj>> FTDCDecompressor::uncompress(ConstDataRange buf
     // The document is not part of any checksum so we must validate it is correct
     auto swRef = cdc.readAndAdvance<Validated<BSONObj>>();
     if (!swRef.isOK()) {
-        return {swRef.getStatus()};
+        return swRef.getStatus();
     }
 
-    BSONObj ref = swRef.getValue();
+    *ref = swRef.getValue();
 
     // Read count of metrics
     auto swMetricsCount = cdc.readAndAdvance<LittleEndian<std::uint32_t>>();
     if (!swMetricsCount.isOK()) {
-        return {swMetricsCount.getStatus()};
+        return swMetricsCount.getStatus();
     }
 
     std::uint32_t metricsCount = swMetricsCount.getValue();
@@ -85,30 +162,46 @@ StatusWith<std::vector<BSONObj>> FTDCDecompressor::uncompress(ConstDataRange buf
     // Read count of samples
     auto swSampleCount = cdc.readAndAdvance<LittleEndian<std::uint32_t>>();
     if (!swSampleCount.isOK()) {
-        return {swSampleCount.getStatus()};
+        return swSampleCount.getStatus();
     }
 
-    std::uint32_t sampleCount = swSampleCount.getValue();
+    *sampleCount = swSampleCount.getValue();
 
     // Limit size of the buffer we need for metrics and samples
-    if (metricsCount * sampleCount > 1000000) {
+    if (metricsCount * *sampleCount > 1000000) {
         return Status(ErrorCodes::InvalidLength,
                       "Metrics Count and Sample Count have exceeded the allowable range.");
     }
 
-    std::vector<std::uint64_t> metrics;
-
-    metrics.reserve(metricsCount);
+    metrics->clear();
+    metrics->reserve(metricsCount);
 
     // We pass the reference document as both the reference document and current document as we only
     // want the array of metrics.
-    (void)FTDCBSONUtil::extractMetricsFromDocument(ref, ref, &metrics);
+    (void)FTDCBSONUtil::extractMetricsFromDocument(*ref, *ref, metrics);
 
-    if (metrics.size() != metricsCount) {
+    if (metrics->size() != metricsCount) {
         return {ErrorCodes::BadValue,
                 "The metrics in the reference document and metrics count do not match"};
     }
 
+    *cursor = cdc;
+    return Status::OK();
+}
+
+StatusWith<std::vector<BSONObj>> FTDCDecompressor::uncompress(ConstDataRange buf) {
+    ConstDataRangeCursor cdc(nullptr, nullptr);
+    BSONObj ref;
+    std::vector<std::uint64_t> metrics;
+    std::uint32_t sampleCount;
+
+    Status status = _uncompressHeader(buf, &cdc, &ref, &metrics, &sampleCount);
+    if (!status.isOK()) {
+        return status;
+    }
+
+    const std::uint32_t metricsCount = metrics.size();
+
     std::vector<BSONObj> docs;
 
     // Allocate space for the reference document + samples
@@ -122,39 +215,13 @@ StatusWith<std::vector<BSONObj>> FTDCDecompressor::uncompress(ConstDataRange buf
     }
 
     // Read the samples
-    std::vector<std::uint64_t> deltas(metricsCount * sampleCount);
+    std::vector<std::uint64_t>& deltas = _deltas;
+    deltas.resize(metricsCount * sampleCount);
 
     // decompress the deltas
-    std::uint64_t zeroesCount = 0;
-
-    auto cdrc = ConstDataRangeCursor(cdc);
-
-    for (std::uint32_t i = 0; i < metricsCount; i++) {
-        for (std::uint32_t j = 0; j < sampleCount; j++) {
-            if (zeroesCount) {
-                deltas[FTDCCompressor::getArrayOffset(sampleCount, j, i)] = 0;
-                zeroesCount--;
-                continue;
-            }
-
-            auto swDelta = cdrc.readAndAdvance<FTDCVarInt>();
-
-            if (!swDelta.isOK()) {
-                return swDelta.getStatus();
-            }
-
-            if (swDelta.getValue() == 0) {
-                auto swZero = cdrc.readAndAdvance<FTDCVarInt>();
-
-                if (!swZero.isOK()) {
-                    return swDelta.getStatus();
-                }
-
-                zeroesCount = swZero.getValue();
-            }
-
-            deltas[FTDCCompressor::getArrayOffset(sampleCount, j, i)] = swDelta.getValue();
-        }
+    status = decodeDeltas(&cdc, deltas.data(), deltas.size());
+    if (!status.isOK()) {
+        return status;
     }
 
     // Inflate the deltas
@@ -180,4 +247,57 @@ StatusWith<std::vector<BSONObj>> FTDCDecompressor::uncompress(ConstDataRange buf
     return {docs};
 }
 
+Status FTDCDecompressor::uncompressColumns(ConstDataRange buf,
+                                           Date_t id,
+                                           FTDCMetricColumns* columns) {
+    ConstDataRangeCursor cdc(nullptr, nullptr);
+    BSONObj ref;
+    std::vector<std::uint64_t> metrics;
+    std::uint32_t sampleCount;
+
+    Status status = _uncompressHeader(buf, &cdc, &ref, &metrics, &sampleCount);
+    if (!status.isOK()) {
+        return status;
+    }
+
+    std::vector<std::string> names;
+    status = FTDCBSONUtil::extractMetricNamesFromDocument(ref, &names);
+    if (!status.isOK()) {
+        return status;
+    }
+
+    if (names.size() != metrics.size()) {
+        return {ErrorCodes::BadValue,
+                "The metric names in the reference document and metrics count do not match"};
+    }
+
+    const std::uint32_t metricsCount = metrics.size();
+
+    _deltas.resize(metricsCount * sampleCount);
+
+    status = decodeDeltas(&cdc, _deltas.data(), _deltas.size());
+    if (!status.isOK()) {
+        return status;
+    }
+
+    // The deltas are stored metric by metric, so each column is the running sum of a contiguous
+    // range of deltas, starting from the reference document's value.
+    columns->reset(id, std::move(names), sampleCount + 1);
+
+    for (std::uint32_t i = 0; i < metricsCount; i++) {
+        const std::uint64_t* deltas =
+            _deltas.data() + FTDCCompressor::getArrayOffset(sampleCount, 0, i);
+        std::uint64_t* column = columns->getColumn(i);
+
+        std::uint64_t value = metrics[i];
+        column[0] = value;
+        for (std::uint32_t j = 0; j < sampleCount; j++) {
+            value += deltas[j];
+            column[j + 1] = value;
+        }
+    }
+
+    return Status::OK();
+}
+
 }  // namespace mongo
@@ -31,13 +31,17 @@
 #include <vector>
 
 #include "mongo/base/data_range.h"
+#include "mongo/base/data_range_cursor.h"
 #include "mongo/base/disallow_copying.h"
 #include "mongo/base/status_with.h"
 #include "mongo/db/ftdc/block_compressor.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 
+class FTDCMetricColumns;
+
 /**
  * Inflates a compressed chunk of metrics into a list of BSON documents
  */
@@ -56,8 +60,30 @@ public:
      */
     StatusWith<std::vector<BSONObj>> uncompress(ConstDataRange buf);
 
+    /**
+     * Inflates a compressed chunk of metrics into one column per metric, without constructing
+     * any documents. The column for metric i holds the same values as the i-th metric of the
+     * documents uncompress() returns, including the reference document as sample 0.
+     *
+     * Will fail if the chunk is corrupt or too short.
+     */
+    Status uncompressColumns(ConstDataRange buf, Date_t id, FTDCMetricColumns* columns);
+
 private:
+    /**
+     * Uncompresses the chunk and reads its header. On success, 'cursor' is positioned at the
+     * encoded deltas and 'metrics' contains the values of the reference document.
+     */
+    Status _uncompressHeader(ConstDataRange buf,
+                             ConstDataRangeCursor* cursor,
+                             BSONObj* ref,
+                             std::vector<std::uint64_t>* metrics,
+                             std::uint32_t* sampleCount);
+
     BlockCompressor _compressor;
+
+    // Scratch space for decoded deltas, reused across chunks
+    std::vector<std::uint64_t> _deltas;
 };
 
 }  // namespace mongo
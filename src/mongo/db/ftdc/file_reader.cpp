@@ -102,6 +102,10 @@ StatusWith<bool> FTDCFileReader::hasNext() {
 
                 // There is always at least the reference document
                 _pos = 0;
+            } else {
+                return {ErrorCodes::BadValue,
+                        str::stream() << "Metric columns in file \'" << _file.generic_string()
+                                      << "\' can only be read with FTDCColumnReader"};
             }
 
             return {true};
@@ -74,9 +74,12 @@ public:
      */
     std::tuple<FTDCBSONUtil::FTDCType, const BSONObj&, Date_t> next();
 
-private:
     /**
      * Read a document from the file. If the file is corrupt, returns an appropriate status.
+     * Returns an empty document at the end of the file.
+     *
+     * The returned document is unowned and valid until the next read. For readers that want
+     * the stored documents rather than the samples; do not mix with hasNext() and next().
      */
     StatusWith<BSONObj> readDocument();
 
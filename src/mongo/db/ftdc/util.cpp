@@ -34,9 +34,12 @@
 
 #include <boost/filesystem.hpp>
 
+#include "mongo/base/data_view.h"
 #include "mongo/bson/bsonobjbuilder.h"
 #include "mongo/bson/util/bson_extract.h"
 #include "mongo/config.h"
+#include "mongo/db/ftdc/block_compressor.h"
+#include "mongo/db/ftdc/columns.h"
 #include "mongo/db/ftdc/config.h"
 #include "mongo/db/ftdc/constants.h"
 #include "mongo/db/jsobj.h"
@@ -60,6 +63,9 @@ const char kFTDCDocField[] = "doc";
 
 const char kFTDCDocsField[] = "docs";
 
+const char kFTDCNamesField[] = "names";
+const char kFTDCCountField[] = "count";
+
 const char kFTDCCollectStartField[] = "start";
 const char kFTDCCollectEndField[] = "end";
 
@@ -67,6 +73,10 @@ const std::uint64_t FTDCConfig::kPeriodMillisDefault = 1000;
 
 const std::size_t kMaxRecursion = 10;
 
+// Upper bound on the number of values in a metric columns document, twice the limit on the
+// number of deltas in a metric chunk
+const std::size_t kMaxColumnValues = 2 * 1000 * 1000;
+
 namespace FTDCUtil {
 
 namespace {
@@ -222,6 +232,60 @@ StatusWith<bool> extractMetricsFromDocument(const BSONObj& referenceDoc,
     return extractMetricsFromDocument(referenceDoc, currentDoc, metrics, true, 0);
 }
 
+namespace {
+
+Status extractMetricNamesFromDocument(const BSONObj& referenceDoc,
+                                      const std::string& prefix,
+                                      std::vector<std::string>* names,
+                                      size_t recursion) {
+    if (recursion > kMaxRecursion) {
+        return {ErrorCodes::BadValue, "Recursion limit reached."};
+    }
+
+    BSONObjIterator iterator(referenceDoc);
+    while (iterator.more()) {
+        BSONElement currentElement = iterator.next();
+        std::string name = prefix + currentElement.fieldName();
+
+        switch (currentElement.type()) {
+            case NumberDouble:
+            case NumberInt:
+            case NumberLong:
+            case NumberDecimal:
+            case Bool:
+            case Date:
+                names->emplace_back(std::move(name));
+                break;
+
+            case bsonTimestamp:
+                names->emplace_back(name + ".t");
+                names->emplace_back(name + ".i");
+                break;
+
+            case Object:
+            case Array: {
+                Status s = extractMetricNamesFromDocument(
+                    currentElement.Obj(), name + '.', names, recursion + 1);
+                if (!s.isOK()) {
+                    return s;
+                }
+            } break;
+
+            default:
+                break;
+        }
+    }
+
+    return Status::OK();
+}
+
+}  // namespace
+
+Status extractMetricNamesFromDocument(const BSONObj& referenceDoc,
+                                      std::vector<std::string>* names) {
+    return extractMetricNamesFromDocument(referenceDoc, "", names, 0);
+}
+
 namespace {
 Status constructDocumentFromMetrics(const BSONObj& referenceDocument,
                                     BSONObjBuilder& builder,
@@ -348,6 +412,35 @@ BSONObj createBSONMetricChunkDocument(ConstDataRange buf, Date_t date) {
     return builder.obj();
 }
 
+StatusWith<BSONObj> createBSONMetricColumnsDocument(const FTDCMetricColumns& columns,
+                                                    BlockCompressor* compressor) {
+    const std::vector<std::uint64_t>& values = columns.getValues();
+
+    std::vector<char> buffer(values.size() * sizeof(std::uint64_t));
+    DataView view(buffer.data());
+    for (std::size_t i = 0; i < values.size(); i++) {
+        view.write<LittleEndian<std::uint64_t>>(values[i], i * sizeof(std::uint64_t));
+    }
+
+    auto swCompressed = compressor->compress({buffer.data(), buffer.size()});
+    if (!swCompressed.isOK()) {
+        return swCompressed.getStatus();
+    }
+
+    const ConstDataRange& compressed = swCompressed.getValue();
+
+    BSONObjBuilder builder;
+
+    builder.appendDate(kFTDCIdField, columns.getId());
+    builder.appendNumber(kFTDCTypeField, static_cast<int>(FTDCType::kMetricColumns));
+    builder.append(kFTDCNamesField, columns.getNames());
+    builder.appendNumber(kFTDCCountField, static_cast<int>(columns.getSamplesCount()));
+    builder.appendBinData(
+        kFTDCDataField, compressed.length(), BinDataType::BinDataGeneral, compressed.data());
+
+    return builder.obj();
+}
+
 StatusWith<Date_t> getBSONDocumentId(const BSONObj& obj) {
     BSONElement element;
 
@@ -368,7 +461,8 @@ StatusWith<FTDCType> getBSONDocumentType(const BSONObj& obj) {
     }
 
     if (static_cast<FTDCType>(value) != FTDCType::kMetricChunk &&
-        static_cast<FTDCType>(value) != FTDCType::kMetadata) {
+        static_cast<FTDCType>(value) != FTDCType::kMetadata &&
+        static_cast<FTDCType>(value) != FTDCType::kMetricColumns) {
         return {ErrorCodes::BadValue,
                 str::stream() << "Field '" << std::string(kFTDCTypeField)
                               << "' is not an expected value, found '" << value << "'"};
@@ -417,6 +511,117 @@ StatusWith<std::vector<BSONObj>> getMetricsFromMetricDoc(const BSONObj& obj,
     return decompressor->uncompress({buffer, static_cast<std::size_t>(length)});
 }
 
+Status getColumnsFromMetricDoc(const BSONObj& obj,
+                               FTDCDecompressor* decompressor,
+                               FTDCMetricColumns* columns) {
+    if (kDebugBuild) {
+        auto swType = getBSONDocumentType(obj);
+        dassert(swType.isOK() && swType.getValue() == FTDCType::kMetricChunk);
+    }
+
+    auto swId = getBSONDocumentId(obj);
+    if (!swId.isOK()) {
+        return swId.getStatus();
+    }
+
+    BSONElement element;
+
+    Status status = bsonExtractTypedField(obj, kFTDCDataField, BSONType::BinData, &element);
+    if (!status.isOK()) {
+        return status;
+    }
+
+    int length;
+    const char* buffer = element.binData(length);
+    if (length < 0) {
+        return {ErrorCodes::BadValue,
+                str::stream() << "Field " << std::string(kFTDCTypeField) << " is not a BinData."};
+    }
+
+    return decompressor->uncompressColumns(
+        {buffer, static_cast<std::size_t>(length)}, swId.getValue(), columns);
+}
+
+Status getColumnsFromMetricColumnsDoc(const BSONObj& obj,
+                                      BlockCompressor* compressor,
+                                      FTDCMetricColumns* columns) {
+    if (kDebugBuild) {
+        auto swType = getBSONDocumentType(obj);
+        dassert(swType.isOK() && swType.getValue() == FTDCType::kMetricColumns);
+    }
+
+    auto swId = getBSONDocumentId(obj);
+    if (!swId.isOK()) {
+        return swId.getStatus();
+    }
+
+    BSONElement namesElement;
+    Status status = bsonExtractTypedField(obj, kFTDCNamesField, BSONType::Array, &namesElement);
+    if (!status.isOK()) {
+        return status;
+    }
+
+    std::vector<std::string> names;
+    for (const auto& nameElement : namesElement.Obj()) {
+        if (nameElement.type() != String) {
+            return {ErrorCodes::BadValue,
+                    str::stream() << "Field '" << std::string(kFTDCNamesField)
+                                  << "' must only contain strings"};
+        }
+        names.emplace_back(nameElement.String());
+    }
+
+    long long samplesCount;
+    status = bsonExtractIntegerField(obj, kFTDCCountField, &samplesCount);
+    if (!status.isOK()) {
+        return status;
+    }
+
+    if (samplesCount < 0 ||
+        static_cast<std::uint64_t>(samplesCount) * names.size() > kMaxColumnValues) {
+        return {ErrorCodes::InvalidLength,
+                "Metrics Count and Sample Count have exceeded the allowable range."};
+    }
+
+    BSONElement dataElement;
+    status = bsonExtractTypedField(obj, kFTDCDataField, BSONType::BinData, &dataElement);
+    if (!status.isOK()) {
+        return status;
+    }
+
+    int length;
+    const char* buffer = dataElement.binData(length);
+    if (length < 0) {
+        return {ErrorCodes::BadValue,
+                str::stream() << "Field " << std::string(kFTDCDataField) << " is not a BinData."};
+    }
+
+    const std::size_t expectedLength = samplesCount * names.size() * sizeof(std::uint64_t);
+
+    auto swBuffer =
+        compressor->uncompress({buffer, static_cast<std::size_t>(length)}, expectedLength);
+    if (!swBuffer.isOK()) {
+        return swBuffer.getStatus();
+    }
+
+    const ConstDataRange& data = swBuffer.getValue();
+    if (data.length() != expectedLength) {
+        return {ErrorCodes::InvalidLength,
+                "The length of the metric columns does not match the metrics and sample counts"};
+    }
+
+    columns->reset(swId.getValue(), std::move(names), samplesCount);
+
+    // Columns are stored back to back in the same order as they are kept in memory
+    ConstDataView view(data.data());
+    std::uint64_t* values = columns->getColumn(0);
+    for (std::size_t i = 0; i < columns->getValues().size(); i++) {
+        values[i] = view.read<LittleEndian<std::uint64_t>>(i * sizeof(std::uint64_t));
+    }
+
+    return Status::OK();
+}
+
 }  // namespace FTDCBSONUtil
 
 }  // namespace mongo
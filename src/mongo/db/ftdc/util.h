@@ -29,6 +29,7 @@
 #pragma once
 
 #include <boost/filesystem/path.hpp>
+#include <string>
 #include <vector>
 
 #include "mongo/base/status.h"
@@ -38,6 +39,9 @@
 
 namespace mongo {
 
+class BlockCompressor;
+class FTDCMetricColumns;
+
 /**
  * Utilities for inflating and deflating BSON documents and metric arrays
  */
@@ -62,6 +66,14 @@ enum class FTDCType : std::int32_t {
     * See createBSONMetricChunkDocument
     */
     kMetricChunk = 1,
+
+    /**
+    * A metric columns chunk holds the samples of a metric chunk as one block-compressed array
+    * per metric. Only written by the offline conversion tool, never by the server.
+    *
+    * See createBSONMetricColumnsDocument
+    */
+    kMetricColumns = 2,
 };
 
 
@@ -97,6 +109,14 @@ StatusWith<bool> extractMetricsFromDocument(const BSONObj& referenceDoc,
                                             const BSONObj& doc,
                                             std::vector<std::uint64_t>* metrics);
 
+/**
+ * Extract the names of the metrics of a document, in the order extractMetricsFromDocument
+ * extracts their values. Names are the dotted paths of the fields. Timestamps are two metrics,
+ * named by appending ".t" and ".i".
+ */
+Status extractMetricNamesFromDocument(const BSONObj& referenceDoc,
+                                      std::vector<std::string>* names);
+
 /**
  * Construct a document from a reference document and array of metrics.
  *
@@ -148,6 +168,22 @@ BSONObj createBSONMetadataDocument(const BSONObj& metadata, Date_t date);
  */
 BSONObj createBSONMetricChunkDocument(ConstDataRange buf, Date_t now);
 
+/**
+ * Create a BSON metric columns document for storage. The columns are stored back to back as
+ * little-endian 64-bit integers in a single zlib compressed block.
+ *
+ * Example:
+ * {
+ *  "_id" : Date_t
+ *  "type" : 2
+ *  "names" : [ "start", "serverStatus.uptime", ... ]
+ *  "count" : <samples per metric>
+ *  "data" : BinData(...)
+ * }
+ */
+StatusWith<BSONObj> createBSONMetricColumnsDocument(const FTDCMetricColumns& columns,
+                                                    BlockCompressor* compressor);
+
 /**
  * Get the _id field of a BSON document
  */
@@ -168,6 +204,21 @@ StatusWith<BSONObj> getBSONDocumentFromMetadataDoc(const BSONObj& obj);
  */
 StatusWith<std::vector<BSONObj>> getMetricsFromMetricDoc(const BSONObj& obj,
                                                          FTDCDecompressor* decompressor);
+
+/**
+ * Decode the compressed chunk of a metric document into columns, without materializing the
+ * documents.
+ */
+Status getColumnsFromMetricDoc(const BSONObj& obj,
+                               FTDCDecompressor* decompressor,
+                               FTDCMetricColumns* columns);
+
+/**
+ * Decode a metric columns document.
+ */
+Status getColumnsFromMetricColumnsDoc(const BSONObj& obj,
+                                      BlockCompressor* compressor,
+                                      FTDCMetricColumns* columns);
 }  // namespace FTDCBSONUtil
 
 
@@ -323,17 +323,24 @@ Status IndexAccessMethod::update(OperationContext* txn,
     return Status::OK();
 }
 
-std::unique_ptr<IndexAccessMethod::BulkBuilder> IndexAccessMethod::initiateBulk() {
-    return std::unique_ptr<BulkBuilder>(new BulkBuilder(this, _descriptor));
+const size_t IndexAccessMethod::kDefaultBulkBuilderMemoryUsageBytes;
+
+std::unique_ptr<IndexAccessMethod::BulkBuilder> IndexAccessMethod::initiateBulk(
+    size_t maxMemoryUsageBytes, size_t maxSpillFiles) {
+    return std::unique_ptr<BulkBuilder>(
+        new BulkBuilder(this, _descriptor, maxMemoryUsageBytes, maxSpillFiles));
 }
 
 IndexAccessMethod::BulkBuilder::BulkBuilder(const IndexAccessMethod* index,
-                                            const IndexDescriptor* descriptor)
+                                            const IndexDescriptor* descriptor,
+                                            size_t maxMemoryUsageBytes,
+                                            size_t maxSpillFiles)
     : _sorter(Sorter::make(
           SortOptions()
               .TempDir(storageGlobalParams.dbpath + "/_tmp")
               .ExtSortAllowed()
-              .MaxMemoryUsageBytes(100 * 1024 * 1024),
+              .MaxMemoryUsageBytes(maxMemoryUsageBytes)
+              .MaxSpillFiles(maxSpillFiles),
           BtreeExternalSortComparison(descriptor->keyPattern(), descriptor->version()))),
       _real(index) {}
 
@@ -359,20 +366,54 @@ Status IndexAccessMethod::BulkBuilder::insert(OperationContext* txn,
     return Status::OK();
 }
 
+void IndexAccessMethod::BulkBuilder::sort() {
+    if (!_sorted) {
+        _sorted.reset(_sorter->done());
+    }
+}
 
 Status IndexAccessMethod::commitBulk(OperationContext* txn,
                                      std::unique_ptr<BulkBuilder> bulk,
                                      bool mayInterrupt,
                                      bool dupsAllowed,
                                      set<RecordId>* dupsToDrop) {
+    std::vector<std::unique_ptr<BulkBuilder>> bulks;
+    bulks.push_back(std::move(bulk));
+    return commitBulk(txn, std::move(bulks), mayInterrupt, dupsAllowed, dupsToDrop);
+}
+
+Status IndexAccessMethod::commitBulk(OperationContext* txn,
+                                     std::vector<std::unique_ptr<BulkBuilder>> bulks,
+                                     bool mayInterrupt,
+                                     bool dupsAllowed,
+                                     set<RecordId>* dupsToDrop) {
     Timer timer;
 
-    std::unique_ptr<BulkBuilder::Sorter::Iterator> i(bulk->_sorter->done());
+    invariant(!bulks.empty());
+    std::vector<std::shared_ptr<BulkBuilder::Sorter::Iterator>> sorted;
+    int64_t keysInserted = 0;
+    bool isMultiKey = false;
+    for (auto&& bulk : bulks) {
+        bulk->sort();
+        sorted.push_back(bulk->_sorted);
+        keysInserted += bulk->_keysInserted;
+        isMultiKey = isMultiKey || bulk->_isMultiKey;
+    }
+
+    std::shared_ptr<BulkBuilder::Sorter::Iterator> i;
+    if (sorted.size() == 1) {
+        i = sorted.front();
+    } else {
+        i.reset(BulkBuilder::Sorter::Iterator::merge(
+            sorted,
+            SortOptions(),
+            BtreeExternalSortComparison(_descriptor->keyPattern(), _descriptor->version())));
+    }
 
     stdx::unique_lock<Client> lk(*txn->getClient());
     ProgressMeterHolder pm(*txn->setMessage_inlock("Index Bulk Build: (2/3) btree bottom up",
                                                    "Index: (2/3) BTree Bottom Up Progress",
-                                                   bulk->_keysInserted,
+                                                   keysInserted,
                                                    10));
     lk.unlock();
 
@@ -381,7 +422,7 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
     MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
         WriteUnitOfWork wunit(txn);
 
-        if (bulk->_isMultiKey) {
+        if (isMultiKey) {
             _btreeState->setMultikey(txn);
         }
 
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/db/index/index_descriptor.h"
@@ -197,27 +198,45 @@ public:
                       const InsertDeleteOptions& options,
                       int64_t* numInserted);
 
+        /**
+         * Sorts the keys inserted so far, so that commitBulk only has to load them. No keys may
+         * be inserted afterwards. Unlike commitBulk, this does not need an OperationContext and
+         * may be called from any thread.
+         */
+        void sort();
+
     private:
         friend class IndexAccessMethod;
 
         using Sorter = mongo::Sorter<BSONObj, RecordId>;
 
-        BulkBuilder(const IndexAccessMethod* index, const IndexDescriptor* descriptor);
+        BulkBuilder(const IndexAccessMethod* index,
+                    const IndexDescriptor* descriptor,
+                    size_t maxMemoryUsageBytes,
+                    size_t maxSpillFiles);
 
         std::unique_ptr<Sorter> _sorter;
+        std::shared_ptr<Sorter::Iterator> _sorted;  // Set by sort().
         const IndexAccessMethod* _real;
         int64_t _keysInserted = 0;
         bool _isMultiKey = false;
     };
 
+    // How much memory a BulkBuilder uses for keys by default before spilling them to disk.
+    static const size_t kDefaultBulkBuilderMemoryUsageBytes = 100 * 1024 * 1024;
+
     /**
      * Starts a bulk operation.
      * You work on the returned BulkBuilder and then call commitBulk.
      * This can return NULL, meaning bulk mode is not available.
+     * If 'maxSpillFiles' is not 0, the BulkBuilder merges the files it spilled keys to into one
+     * whenever it has that many of them.
      *
      * It is only legal to initiate bulk when the index is new and empty.
      */
-    std::unique_ptr<BulkBuilder> initiateBulk();
+    std::unique_ptr<BulkBuilder> initiateBulk(
+        size_t maxMemoryUsageBytes = kDefaultBulkBuilderMemoryUsageBytes,
+        size_t maxSpillFiles = 0);
 
     /**
      * Call this when you are ready to finish your bulk work.
@@ -234,6 +253,16 @@ public:
                       bool dupsAllowed,
                       std::set<RecordId>* dups);
 
+    /**
+     * Like commitBulk above, but loads the keys of several BulkBuilders of this index, which were
+     * filled independently of each other, as one sorted sequence.
+     */
+    Status commitBulk(OperationContext* txn,
+                      std::vector<std::unique_ptr<BulkBuilder>> bulks,
+                      bool mayInterrupt,
+                      bool dupsAllowed,
+                      std::set<RecordId>* dups);
+
     /**
      * Fills 'keys' with the keys that should be generated for 'obj' on this index.
      */
@@ -32,6 +32,7 @@
 
 #include "mongo/bson/bsonobj.h"
 #include "mongo/bson/bsonmisc.h"
+#include "mongo/db/matcher/selection_bitmap.h"
 
 namespace mongo {
 
@@ -55,6 +56,10 @@ bool MatchExpression::matchesBSON(const BSONObj& doc, MatchDetails* details) con
     return matches(&mydoc, details);
 }
 
+void MatchExpression::matchesBatch(const BSONObj* docs, SelectionBitmap* selection) const {
+    selection->retainIf([&](std::size_t i) { return matchesBSON(docs[i]); });
+}
+
 
 void AtomicMatchExpression::debugString(StringBuilder& debug, int level) const {
     _debugAddSpace(debug, level);
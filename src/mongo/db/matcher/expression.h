@@ -42,6 +42,7 @@
 namespace mongo {
 
 class MatchExpression;
+class SelectionBitmap;
 class TreeMatchExpression;
 
 typedef StatusWith<std::unique_ptr<MatchExpression>> StatusWithMatchExpression;
@@ -203,6 +204,15 @@ public:
      */
     virtual bool matchesSingleElement(const BSONElement& e) const = 0;
 
+    /**
+     * Evaluates the predicate over a batch of documents. 'docs' holds selection->size()
+     * documents; on return only the documents that were selected and match remain selected.
+     *
+     * The default implementation calls matchesBSON() for every selected document. Expressions
+     * override it to share work across the batch.
+     */
+    virtual void matchesBatch(const BSONObj* docs, SelectionBitmap* selection) const;
+
     //
     // Tagging mechanism: Hang data off of the tree for retrieval later.
     //
@@ -0,0 +1,231 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <limits>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/expression_parser.h"
+#include "mongo/db/matcher/selection_bitmap.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+std::unique_ptr<MatchExpression> parse(const BSONObj& query) {
+    StatusWithMatchExpression result = MatchExpressionParser::parse(query);
+    ASSERT_OK(result.getStatus());
+    return std::move(result.getValue());
+}
+
+/**
+ * Documents holding values of every kind the batch kernels special case at the top level and
+ * under a nested path.
+ */
+std::vector<BSONObj> makeDocs() {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const long long bigLong = (1LL << 53) + 1;
+
+    std::vector<BSONObj> values{
+        BSON("" << 5),
+        BSON("" << 7),
+        BSON("" << -3),
+        BSON("" << 5LL),
+        BSON("" << 6LL),
+        BSON("" << bigLong),
+        BSON("" << bigLong - 1),
+        BSON("" << 5.0),
+        BSON("" << 5.5),
+        BSON("" << -0.0),
+        BSON("" << nan),
+        BSON("" << static_cast<double>(1LL << 53)),
+        BSON("" << std::numeric_limits<double>::infinity()),
+        BSON(""
+             << "5"),
+        BSON("" << BSONNULL),
+        BSON("" << BSONUndefined),
+        BSON("" << true),
+        BSON("" << MINKEY),
+        BSON("" << MAXKEY),
+        BSON("" << BSON_ARRAY(1 << 5 << 9)),
+        BSON("" << BSON_ARRAY(BSON_ARRAY(5))),
+        BSON("" << BSONArray()),
+        BSON("" << BSON("x" << 5)),
+    };
+
+    std::vector<BSONObj> docs;
+    docs.push_back(BSONObj());
+    docs.push_back(BSON("b" << 1));
+    for (const auto& value : values) {
+        BSONElement e = value.firstElement();
+        docs.push_back(BSON("_id" << 1 << "a" << e << "b" << 2));
+        docs.push_back(BSON("a" << BSON("x" << e)));
+        docs.push_back(BSON("a" << BSON_ARRAY(BSON("x" << e) << BSON("x" << 1)) << "b" << e));
+    }
+    return docs;
+}
+
+/**
+ * Checks that evaluating 'query' over a batch selects exactly the documents matchesBSON()
+ * accepts, whatever was selected on entry.
+ */
+void checkBatch(const BSONObj& query, const std::vector<BSONObj>& docs) {
+    std::unique_ptr<MatchExpression> expr = parse(query);
+
+    SelectionBitmap selection(docs.size());
+    expr->matchesBatch(docs.data(), &selection);
+
+    ASSERT_EQUALS(docs.size(), selection.size());
+    for (size_t i = 0; i < docs.size(); i++) {
+        if (expr->matchesBSON(docs[i]) != selection.test(i)) {
+            FAIL(str::stream() << "batch and document results differ for " << query << " on "
+                               << docs[i]);
+        }
+    }
+
+    // Documents which are not selected on entry stay that way
+    SelectionBitmap odd(docs.size(), false);
+    for (size_t i = 1; i < docs.size(); i += 2) {
+        odd.set(i);
+    }
+    expr->matchesBatch(docs.data(), &odd);
+    for (size_t i = 0; i < docs.size(); i++) {
+        ASSERT_EQUALS(i % 2 == 1 && selection.test(i), odd.test(i));
+    }
+}
+
+TEST(SelectionBitmapTest, Basic) {
+    SelectionBitmap all(130);
+    ASSERT_EQUALS(130U, all.size());
+    ASSERT_EQUALS(130U, all.count());
+    ASSERT_TRUE(all.test(0));
+    ASSERT_TRUE(all.test(129));
+
+    SelectionBitmap none(130, false);
+    ASSERT_TRUE(none.none());
+    none.set(3);
+    none.set(64);
+    none.set(129);
+    ASSERT_EQUALS(3U, none.count());
+
+    std::vector<size_t> selected;
+    none.forEachSelected([&](size_t i) { selected.push_back(i); });
+    ASSERT_TRUE((selected == std::vector<size_t>{3, 64, 129}));
+
+    all.subtract(none);
+    ASSERT_EQUALS(127U, all.count());
+    ASSERT_FALSE(all.test(64));
+
+    all.retainIf([](size_t i) { return i % 2 == 0; });
+    ASSERT_EQUALS(64U, all.count());
+    ASSERT_FALSE(all.test(1));
+    ASSERT_TRUE(all.test(2));
+
+    all.unionWith(none);
+    ASSERT_EQUALS(67U, all.count());
+
+    none.clear(64);
+    ASSERT_FALSE(none.test(64));
+    ASSERT_EQUALS(2U, none.count());
+
+    SelectionBitmap empty(0);
+    ASSERT_TRUE(empty.none());
+}
+
+TEST(MatchExpressionBatchTest, Comparisons) {
+    std::vector<BSONObj> docs = makeDocs();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const long long bigLong = (1LL << 53) + 1;
+
+    std::vector<BSONObj> operands{BSON("" << 5),
+                                  BSON("" << 5LL),
+                                  BSON("" << 5.0),
+                                  BSON("" << 5.5),
+                                  BSON("" << -0.0),
+                                  BSON("" << 0),
+                                  BSON("" << bigLong),
+                                  BSON("" << static_cast<double>(1LL << 53)),
+                                  BSON("" << nan),
+                                  BSON(""
+                                       << "5"),
+                                  BSON("" << BSONNULL),
+                                  BSON("" << MINKEY),
+                                  BSON("" << MAXKEY),
+                                  BSON("" << BSON_ARRAY(5))};
+
+    for (const char* op : {"$eq", "$lt", "$lte", "$gt", "$gte"}) {
+        for (const auto& operand : operands) {
+            for (const char* path : {"a", "a.x", "b"}) {
+                checkBatch(BSON(path << BSON(op << operand.firstElement())), docs);
+            }
+        }
+    }
+}
+
+TEST(MatchExpressionBatchTest, OtherLeaves) {
+    std::vector<BSONObj> docs = makeDocs();
+
+    for (const char* query : {"{a: {$in: [5, '5', null]}}",
+                              "{a: {$in: [5.5, /^5/]}}",
+                              "{'a.x': {$in: [1, 7]}}",
+                              "{a: {$exists: true}}",
+                              "{a: {$exists: false}}",
+                              "{a: {$mod: [2, 1]}}",
+                              "{a: /5/}",
+                              "{a: {$type: 16}}",
+                              "{a: {$size: 3}}",
+                              "{a: {$elemMatch: {x: 1}}}",
+                              "{a: {$ne: 5}}",
+                              "{a: {$nin: [5, 7]}}",
+                              "{a: {$not: {$gt: 5}}}",
+                              "{a: {$bitsAllSet: [0, 2]}}"}) {
+        checkBatch(fromjson(query), docs);
+    }
+}
+
+TEST(MatchExpressionBatchTest, Trees) {
+    std::vector<BSONObj> docs = makeDocs();
+
+    for (const char* query : {"{a: {$gte: 5}, b: 2}",
+                              "{a: {$gt: 0, $lt: 6}}",
+                              "{$and: [{a: 5}, {b: {$exists: true}}]}",
+                              "{$or: [{a: 5}, {b: 2}, {'a.x': 5}]}",
+                              "{$or: [{a: {$lt: 0}}, {$and: [{b: 2}, {a: {$gt: 6}}]}]}",
+                              "{$nor: [{a: 5}, {b: 2}]}",
+                              "{$or: [{a: 'nothing'}, {b: 'nothing'}]}",
+                              "{$and: [{a: 'nothing'}, {b: 2}]}"}) {
+        checkBatch(fromjson(query), docs);
+    }
+}
+
+}  // namespace
+}  // namespace mongo
@@ -44,11 +44,34 @@
 
 namespace mongo {
 
+namespace {
+
+/**
+ * Returns -1, 0 or 1 without branching.
+ */
+template <typename T>
+int compareNumbers(T lhs, T rhs) {
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+}  // namespace
+
 Status LeafMatchExpression::initPath(StringData path) {
     _path = path;
+    _isTopLevelPath = !path.empty() && path.find('.') == std::string::npos;
     return _elementPath.init(_path);
 }
 
+void LeafMatchExpression::matchesBatch(const BSONObj* docs, SelectionBitmap* selection) const {
+    if (!_isTopLevelPath) {
+        MatchExpression::matchesBatch(docs, selection);
+        return;
+    }
+
+    matchesTopLevelBatch(
+        docs, selection, [this](const BSONElement& e) { return matchesSingleElement(e); });
+}
+
 
 bool LeafMatchExpression::matches(const MatchableDocument* doc, MatchDetails* details) const {
     MatchableDocument::IteratorHolder cursor(doc, &_elementPath);
@@ -102,6 +125,69 @@ Status ComparisonMatchExpression::init(StringData path, const BSONElement& rhs)
 }
 
 
+void ComparisonMatchExpression::matchesBatch(const BSONObj* docs,
+                                             SelectionBitmap* selection) const {
+    const BSONType rhsType = _rhs.type();
+    if (!isTopLevelPath() ||
+        (rhsType != NumberInt && rhsType != NumberLong && rhsType != NumberDouble) ||
+        std::isnan(_rhs.numberDouble())) {
+        LeafMatchExpression::matchesBatch(docs, selection);
+        return;
+    }
+
+    // Bit 'cmp + 1' is set when a comparison result of 'cmp' satisfies the operator.
+    unsigned resultMask = 0;
+    switch (matchType()) {
+        case LT:
+            resultMask = 0x1;
+            break;
+        case LTE:
+            resultMask = 0x3;
+            break;
+        case EQ:
+            resultMask = 0x2;
+            break;
+        case GT:
+            resultMask = 0x4;
+            break;
+        case GTE:
+            resultMask = 0x6;
+            break;
+        default:
+            fassertFailed(34365);
+    }
+
+    // Pairs of number types compared here are converted without losing precision. Any other
+    // element goes through matchesSingleElement().
+    const double rhsDouble = _rhs.numberDouble();
+    const long long rhsLong = _rhs.numberLong();
+
+    matchesTopLevelBatch(docs, selection, [&](const BSONElement& e) {
+        int cmp;
+        switch (e.type()) {
+            case NumberInt:
+                cmp = rhsType == NumberLong ? compareNumbers<long long>(e._numberInt(), rhsLong)
+                                            : compareNumbers<double>(e._numberInt(), rhsDouble);
+                break;
+            case NumberLong:
+                if (rhsType == NumberDouble) {
+                    return matchesSingleElement(e);
+                }
+                cmp = compareNumbers<long long>(e._numberLong(), rhsLong);
+                break;
+            case NumberDouble:
+                if (rhsType == NumberLong || std::isnan(e._numberDouble())) {
+                    return matchesSingleElement(e);
+                }
+                cmp = compareNumbers<double>(e._numberDouble(), rhsDouble);
+                break;
+            default:
+                return matchesSingleElement(e);
+        }
+        return ((resultMask >> (cmp + 1)) & 1) != 0;
+    });
+}
+
 bool ComparisonMatchExpression::matchesSingleElement(const BSONElement& e) const {
     // log() << "\t ComparisonMatchExpression e: " << e << " _rhs: " << _rhs << "\n"
     //<< toString() << std::endl;
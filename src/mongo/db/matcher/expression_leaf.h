@@ -35,6 +35,7 @@
 #include "mongo/bson/bsonobj.h"
 #include "mongo/bson/bsonmisc.h"
 #include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/selection_bitmap.h"
 #include "mongo/stdx/memory.h"
 
 namespace pcrecpp {
@@ -66,6 +67,8 @@ public:
 
     virtual bool matchesSingleElement(const BSONElement& e) const = 0;
 
+    virtual void matchesBatch(const BSONObj* docs, SelectionBitmap* selection) const;
+
     virtual const StringData path() const {
         return _path;
     }
@@ -73,9 +76,37 @@ public:
 protected:
     Status initPath(StringData path);
 
+    /**
+     * True if the path is a single field name, in which case every document has at most one
+     * element at the path unless that element is an array.
+     */
+    bool isTopLevelPath() const {
+        return _isTopLevelPath;
+    }
+
+    /**
+     * Keeps the selected documents of a batch for which 'matchesElement' returns true for the
+     * element at the top level path, which is EOO if the field is missing. Documents holding an
+     * array at the path go through matches() instead.
+     */
+    template <typename MatchesElement>
+    void matchesTopLevelBatch(const BSONObj* docs,
+                              SelectionBitmap* selection,
+                              const MatchesElement& matchesElement) const {
+        dassert(_isTopLevelPath);
+        selection->retainIf([&](std::size_t i) {
+            BSONElement e = docs[i].getField(_path);
+            if (e.type() == Array) {
+                return matchesBSON(docs[i]);
+            }
+            return matchesElement(e);
+        });
+    }
+
 private:
     StringData _path;
     ElementPath _elementPath;
+    bool _isTopLevelPath = false;
 };
 
 /**
@@ -91,6 +122,12 @@ public:
 
     virtual bool matchesSingleElement(const BSONElement& e) const;
 
+    /**
+     * Compares numbers of the same kind as the operand without going through
+     * matchesSingleElement().
+     */
+    virtual void matchesBatch(const BSONObj* docs, SelectionBitmap* selection) const;
+
     virtual const BSONElement& getRHS() const {
         return _rhs;
     }
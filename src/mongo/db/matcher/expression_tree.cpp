@@ -33,6 +33,7 @@
 #include "mongo/bson/bsonobj.h"
 #include "mongo/bson/bsonmisc.h"
 #include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/matcher/selection_bitmap.h"
 
 namespace mongo {
 
@@ -100,6 +101,13 @@ bool AndMatchExpression::matchesSingleElement(const BSONElement& e) const {
     return true;
 }
 
+void AndMatchExpression::matchesBatch(const BSONObj* docs, SelectionBitmap* selection) const {
+    // Each child only looks at the documents that matched all the children before it
+    for (size_t i = 0; i < numChildren() && !selection->none(); i++) {
+        getChild(i)->matchesBatch(docs, selection);
+    }
+}
+
 
 void AndMatchExpression::debugString(StringBuilder& debug, int level) const {
     _debugAddSpace(debug, level);
@@ -132,6 +140,19 @@ bool OrMatchExpression::matchesSingleElement(const BSONElement& e) const {
     return false;
 }
 
+void OrMatchExpression::matchesBatch(const BSONObj* docs, SelectionBitmap* selection) const {
+    // Each child only looks at the documents that none of the children before it matched
+    SelectionBitmap remaining(*selection);
+    SelectionBitmap matched(selection->size(), false);
+    for (size_t i = 0; i < numChildren() && !remaining.none(); i++) {
+        SelectionBitmap child(remaining);
+        getChild(i)->matchesBatch(docs, &child);
+        matched.unionWith(child);
+        remaining.subtract(child);
+    }
+    *selection = std::move(matched);
+}
+
 
 void OrMatchExpression::debugString(StringBuilder& debug, int level) const {
     _debugAddSpace(debug, level);
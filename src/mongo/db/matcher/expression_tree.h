@@ -87,6 +87,7 @@ public:
 
     virtual bool matches(const MatchableDocument* doc, MatchDetails* details = 0) const;
     virtual bool matchesSingleElement(const BSONElement& e) const;
+    virtual void matchesBatch(const BSONObj* docs, SelectionBitmap* selection) const;
 
     virtual std::unique_ptr<MatchExpression> shallowClone() const {
         std::unique_ptr<AndMatchExpression> self = stdx::make_unique<AndMatchExpression>();
@@ -111,6 +112,7 @@ public:
 
     virtual bool matches(const MatchableDocument* doc, MatchDetails* details = 0) const;
     virtual bool matchesSingleElement(const BSONElement& e) const;
+    virtual void matchesBatch(const BSONObj* docs, SelectionBitmap* selection) const;
 
     virtual std::unique_ptr<MatchExpression> shallowClone() const {
         std::unique_ptr<OrMatchExpression> self = stdx::make_unique<OrMatchExpression>();
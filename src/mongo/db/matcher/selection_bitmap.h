@@ -0,0 +1,160 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mongo/platform/bits.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+/**
+ * One bit per document of a batch, set when the document is selected. Used to evaluate a
+ * MatchExpression over many documents at once, see MatchExpression::matchesBatch().
+ */
+class SelectionBitmap {
+public:
+    SelectionBitmap() = default;
+
+    explicit SelectionBitmap(std::size_t size, bool selected = true) {
+        reset(size, selected);
+    }
+
+    /**
+     * Resizes the bitmap to 'size' documents which are all either selected or not.
+     */
+    void reset(std::size_t size, bool selected = true) {
+        _size = size;
+        _words.assign((size + kBitsPerWord - 1) / kBitsPerWord, selected ? ~Word(0) : Word(0));
+        if (selected && (size % kBitsPerWord)) {
+            _words.back() = (Word(1) << (size % kBitsPerWord)) - 1;
+        }
+    }
+
+    std::size_t size() const {
+        return _size;
+    }
+
+    bool test(std::size_t i) const {
+        dassert(i < _size);
+        return (_words[i / kBitsPerWord] >> (i % kBitsPerWord)) & 1;
+    }
+
+    void set(std::size_t i) {
+        dassert(i < _size);
+        _words[i / kBitsPerWord] |= Word(1) << (i % kBitsPerWord);
+    }
+
+    void clear(std::size_t i) {
+        dassert(i < _size);
+        _words[i / kBitsPerWord] &= ~(Word(1) << (i % kBitsPerWord));
+    }
+
+    /**
+     * Returns the number of selected documents.
+     */
+    std::size_t count() const {
+        std::size_t count = 0;
+        for (Word word : _words) {
+            for (; word; word &= word - 1) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    bool none() const {
+        for (Word word : _words) {
+            if (word) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Selects the documents selected in either bitmap.
+     */
+    void unionWith(const SelectionBitmap& other) {
+        dassert(_size == other._size);
+        for (std::size_t i = 0; i < _words.size(); i++) {
+            _words[i] |= other._words[i];
+        }
+    }
+
+    /**
+     * Deselects the documents selected in 'other'.
+     */
+    void subtract(const SelectionBitmap& other) {
+        dassert(_size == other._size);
+        for (std::size_t i = 0; i < _words.size(); i++) {
+            _words[i] &= ~other._words[i];
+        }
+    }
+
+    /**
+     * Calls 'fn' with the index of each selected document, in order.
+     */
+    template <typename Fn>
+    void forEachSelected(const Fn& fn) const {
+        for (std::size_t w = 0; w < _words.size(); w++) {
+            for (Word word = _words[w]; word; word &= word - 1) {
+                fn(w * kBitsPerWord + countTrailingZeros64(word));
+            }
+        }
+    }
+
+    /**
+     * Calls 'predicate' with the index of each selected document and deselects the documents for
+     * which it returns false. The new bits of a word are stored all at once.
+     */
+    template <typename Predicate>
+    void retainIf(const Predicate& predicate) {
+        for (std::size_t w = 0; w < _words.size(); w++) {
+            Word retained = 0;
+            for (Word word = _words[w]; word; word &= word - 1) {
+                const int bit = countTrailingZeros64(word);
+                retained |= Word(predicate(w * kBitsPerWord + bit) ? 1 : 0) << bit;
+            }
+            _words[w] = retained;
+        }
+    }
+
+private:
+    typedef std::uint64_t Word;
+    static const std::size_t kBitsPerWord = 64;
+
+    std::vector<Word> _words;
+    std::size_t _size = 0;
+};
+
+}  // namespace mongo
@@ -44,6 +44,7 @@
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/collection_index_usage_tracker.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/matcher/expression_leaf.h"
 #include "mongo/db/matcher/matcher.h"
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/document.h"
@@ -294,6 +295,12 @@ public:
         virtual CollectionIndexUsageMap getIndexStats(OperationContext* opCtx,
                                                       const NamespaceString& ns) = 0;
 
+        /**
+         * Returns the statistics of the query shapes executed on 'ns', most expensive first.
+         */
+        virtual std::vector<BSONObj> getQueryShapeStats(OperationContext* opCtx,
+                                                        const NamespaceString& ns) = 0;
+
         // Add new methods as needed.
     };
 
@@ -387,6 +394,12 @@ private:
 
     void loadBatch();
 
+    /**
+     * Adds the execution of the query to the query shape statistics, once the executor is
+     * exhausted. The latency is that of the operation which exhausted it.
+     */
+    void recordQueryShape();
+
     std::deque<Document> _currentBatch;
 
     // BSONObj members must outlive _projection and cursor.
@@ -436,6 +449,28 @@ public:
         _doingMerge = doingMerge;
     }
 
+    /**
+     * Counters describing how the partitioned hash table behaved during populate().
+     */
+    struct PartitionStats {
+        long long spilledPartitions = 0;
+        long long spills = 0;
+        long long spilledGroups = 0;
+        long long foldedRuns = 0;
+        long long sortedFallbacks = 0;
+        // The most runs a partition held at once.
+        long long maxSpilledRuns = 0;
+    };
+
+    const PartitionStats& getPartitionStats() const {
+        return _partitionStats;
+    }
+
+    /// Lowers the memory budget, 100MB by default, so that tests can exercise spilling.
+    void setMaxMemoryUsageBytes(int maxMemoryUsageBytes) {
+        _maxMemoryUsageBytes = maxMemoryUsageBytes;
+    }
+
     /**
       Create a grouping DocumentSource from BSON.
 
@@ -457,12 +492,83 @@ public:
 private:
     explicit DocumentSourceGroup(const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
 
+    typedef std::vector<boost::intrusive_ptr<Accumulator>> Accumulators;
+    typedef std::unordered_map<Value, Accumulators, Value::Hash> GroupsMap;
+
+    /**
+     * The group keys are hash partitioned. Only partitions that overflow memory are written to
+     * disk, as unsorted runs of partial aggregates, and each of them is re-aggregated on its own
+     * once the input is exhausted. Partitions that never overflowed are returned straight from
+     * memory.
+     */
+    struct Partition {
+        GroupsMap groups;
+        long long memoryUsageBytes = 0;
+        // Runs of partial aggregates flushed to disk, empty unless this partition spilled.
+        std::vector<std::shared_ptr<Sorter<Value, Value>::Iterator>> spilledRuns;
+        // Merge level of each of the spilledRuns, which never increases from a run to the next.
+        std::vector<size_t> spilledRunLevels;
+    };
+
+    static const size_t kNumPartitions = 32;
+
+    // Number of runs of the same level that spillPartition() folds into a run of the next level.
+    static const size_t kMaxSpilledRunsPerPartition = 4;
+
     /// Spill groups map to disk and returns an iterator to the file.
-    std::shared_ptr<Sorter<Value, Value>::Iterator> spill();
+    std::shared_ptr<Sorter<Value, Value>::Iterator> spill(GroupsMap* groups);
 
     // Only used by spill. Would be function-local if that were legal in C++03.
     class SpillSTLComparator;
 
+    /**
+     * Writes the partial aggregates of 'partition' to a new unsorted run on disk and frees them.
+     */
+    void spillPartition(Partition* partition);
+
+    /**
+     * Spills the partition using the most memory. Used when the whole table is over budget.
+     */
+    void spillLargestPartition();
+
+    /**
+     * Re-aggregates the spilled runs of 'partition' into its groups map. If the partition alone
+     * does not fit in memory, falls back to sorting it to disk and sets up _sorterIterator.
+     */
+    void loadSpilledPartition(Partition* partition);
+
+    /**
+     * Prepares the partition at _currentPartition to be returned, re-aggregating it if needed.
+     */
+    void startPartition();
+
+    /**
+     * Releases the current partition and moves on to the next one to output. Returns false once
+     * all of them have been returned.
+     */
+    bool advancePartition();
+
+    /**
+     * Returns the next group from _sorterIterator, resetting it after its last group.
+     */
+    Document getNextSorted();
+
+    /**
+     * Serializes the partial aggregates of one group for the sorter. Inverse of
+     * mergeAccumulatorStates.
+     */
+    Value serializeAccumulators(const Accumulators& accumulators) const;
+
+    /**
+     * Merges partial aggregates produced by serializeAccumulators into 'accumulators'.
+     */
+    void mergeAccumulatorStates(const Value& states, Accumulators* accumulators) const;
+
+    /**
+     * Creates a fresh set of accumulators for a new group.
+     */
+    Accumulators makeAccumulators() const;
+
     /*
       Before returning anything, this source must fetch everything from
       the underlying source and group it.  populate() is used to do that
@@ -489,9 +595,9 @@ private:
     Value expandId(const Value& val);
 
 
-    typedef std::vector<boost::intrusive_ptr<Accumulator>> Accumulators;
-    typedef std::unordered_map<Value, Accumulators, Value::Hash> GroupsMap;
-    GroupsMap groups;
+    std::vector<Partition> _partitions;
+    long long _memoryUsageBytes;
+    PartitionStats _partitionStats;
 
     /*
       The field names for the result documents and the accumulator
@@ -513,17 +619,19 @@ private:
     Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
 
     bool _doingMerge;
-    bool _spilled;
     const bool _extSortAllowed;
-    const int _maxMemoryUsageBytes;
+    int _maxMemoryUsageBytes;
     std::unique_ptr<Variables> _variables;
     std::vector<std::string> _idFieldNames;  // used when id is a document
     std::vector<boost::intrusive_ptr<Expression>> _idExpressions;
 
-    // only used when !_spilled
+    // Partitions are returned in this order: the ones held in memory first, then the spilled
+    // ones, so that the memory of the former is released before the latter are re-aggregated.
+    std::vector<size_t> _outputOrder;
+    size_t _currentPartition;
     GroupsMap::iterator groupsIterator;
 
-    // only used when _spilled
+    // only used while returning a partition that had to be sorted to disk
     std::unique_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
     std::pair<Value, Value> _firstPartOfNextGroup;
     Value _currentId;
@@ -556,6 +664,34 @@ private:
     std::string _processName;
 };
 
+/**
+ * Provides a document source interface to retrieve the query shape statistics of a given
+ * namespace. Each document returned represents a single query shape and mongod instance.
+ */
+class DocumentSourceQueryShapeStats final : public DocumentSource,
+                                            public DocumentSourceNeedsMongod {
+public:
+    // virtuals from DocumentSource
+    boost::optional<Document> getNext() final;
+    const char* getSourceName() const final;
+    Value serialize(bool explain = false) const final;
+
+    bool isValidInitialSource() const final {
+        return true;
+    }
+
+    static boost::intrusive_ptr<DocumentSource> createFromBson(
+        BSONElement elem, const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+private:
+    DocumentSourceQueryShapeStats(const boost::intrusive_ptr<ExpressionContext>& pExpCtx);
+
+    bool _populated = false;
+    std::vector<BSONObj> _shapes;
+    std::vector<BSONObj>::const_iterator _shapesIter;
+    std::string _processName;
+};
+
 class DocumentSourceMatch final : public DocumentSource {
 public:
     // virtuals from DocumentSource
@@ -1288,8 +1424,120 @@ private:
         invariant(false);
     }
 
+    /**
+     * How documents from the foreign collection are matched against the input documents.
+     */
+    enum class JoinStrategy {
+        // Not chosen yet; decided when the first block of input is read.
+        kUndecided,
+        // One query against the foreign collection per input document.
+        kNestedLoop,
+        // One {foreignField: {$in: [...]}} query per block of input documents.
+        kBatchedIn,
+        // The whole foreign collection is loaded once and indexed in memory.
+        kHash,
+    };
+
+    /**
+     * An input document together with the foreign documents that match it.
+     */
+    struct MatchedInput {
+        Document input;
+        std::vector<Value> matches;
+        long long matchesBytes = 0;
+        // Set when the matches did not fit in the bytes buffered for the block. They are then
+        // looked up again, on their own, once this input is returned.
+        bool deferred = false;
+    };
+
+    /**
+     * One distinct value of the local field within a block of input documents.
+     */
+    struct LocalKey {
+        Value value;
+        // Holds 'value' as a BSONElement, which 'matcher' refers to.
+        BSONObj valueHolder;
+        // Null if 'value' cannot be part of an $in query, see canUseIn().
+        std::unique_ptr<EqualityMatchExpression> matcher;
+        // Indexes into the block of the inputs which have this value.
+        std::vector<size_t> inputs;
+        // The sequence number of the last foreign document appended for this key.
+        long long lastMatchedDoc = -1;
+        // Which of the $in queries of the block looks this key up, see joinBatchedIn().
+        size_t inQuery = 0;
+    };
+
+    typedef std::unordered_map<Value, size_t, Value::Hash> LocalKeyIndex;
+
     boost::optional<Document> unwindResult();
     BSONObj queryForInput(const Document& input) const;
+    BSONObj queryForValue(const Value& localFieldVal) const;
+
+    /**
+     * Returns the next input document with its matches, reading and joining the next block of
+     * input when the current one is used up. Returns boost::none once the input is exhausted.
+     */
+    boost::optional<MatchedInput> nextMatchedInput();
+
+    /**
+     * Reads up to one block of input documents and joins it against the foreign collection into
+     * '_matched'.
+     */
+    void fetchBlock();
+
+    /**
+     * Returns the strategy to use for the foreign collection as it is now. Chooses kHash for a
+     * small collection, even though it may turn out too large to load.
+     */
+    JoinStrategy predictJoinStrategy() const;
+    void chooseJoinStrategy();
+
+    /**
+     * Loads the foreign collection into '_foreignDocs' and '_hashTable'. Returns false, leaving
+     * both empty, if it is too large.
+     */
+    bool loadHashTable();
+
+    /**
+     * Looks up the matches of a deferred input again, on their own.
+     */
+    void joinDeferred(MatchedInput* matched);
+
+    void joinNestedLoop(std::vector<MatchedInput>* block);
+    void joinBatchedIn(std::vector<MatchedInput>* block,
+                       std::vector<LocalKey>* keys,
+                       const LocalKeyIndex& keyIndex);
+    void joinHash(std::vector<MatchedInput>* block, std::vector<LocalKey>* keys);
+
+    /**
+     * Runs 'query' against the foreign collection and appends every result to the inputs of 'key'.
+     */
+    void joinQuery(const BSONObj& query, std::vector<MatchedInput>* block, const LocalKey& key);
+
+    /**
+     * Appends 'foreignDoc' to the inputs of every key it matches, trying only the keys found among
+     * the values of the foreign field in 'foreignDoc'.
+     */
+    void appendToMatchingKeys(const BSONObj& foreignDoc,
+                              long long docSeq,
+                              size_t inQuery,
+                              std::vector<MatchedInput>* block,
+                              std::vector<LocalKey>* keys,
+                              const LocalKeyIndex& keyIndex);
+
+    /**
+     * Buffers 'foreignDoc' as a match of 'matched', unless the matches buffered by the current
+     * join would then exceed kMaxBlockMatchesBytes, in which case 'matched' is deferred instead.
+     */
+    void appendMatch(const BSONObj& foreignDoc, MatchedInput* matched);
+
+    /**
+     * Returns every value the foreign field may be compared against when matching 'foreignDoc' for
+     * equality: each value along the path, arrays both whole and expanded, and null for missing.
+     */
+    std::vector<Value> candidateKeys(const BSONObj& foreignDoc) const;
+
+    static bool canUseIn(const Value& localFieldVal);
 
     NamespaceString _fromNs;
     FieldPath _as;
@@ -1299,8 +1547,22 @@ private:
 
     boost::intrusive_ptr<DocumentSourceUnwind> _unwindSrc;
     bool _handlingUnwind = false;
-    std::unique_ptr<DBClientCursor> _cursor;
     long long _cursorIndex = 0;
-    boost::optional<Document> _input;
+    boost::optional<MatchedInput> _input;
+    // Streams the matches of '_input' when it was deferred while unwinding.
+    std::unique_ptr<DBClientCursor> _unwindCursor;
+
+    JoinStrategy _strategy = JoinStrategy::kUndecided;
+    size_t _blockSize = 0;
+    bool _sourceExhausted = false;
+    std::deque<MatchedInput> _matched;
+    // Bytes of matches buffered by the join in progress.
+    long long _joinMatchesBytes = 0;
+
+    // The foreign collection and an index from each candidate key to the positions of the
+    // documents in '_foreignDocs' that have it, when using the hash join strategy. Reloaded for
+    // every block.
+    std::vector<BSONObj> _foreignDocs;
+    std::unordered_map<Value, std::vector<size_t>, Value::Hash> _hashTable;
 };
 }
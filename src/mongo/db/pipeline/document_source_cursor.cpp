@@ -32,12 +32,14 @@
 
 
 #include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/curop.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/query/explain.h"
 #include "mongo/db/query/find_common.h"
+#include "mongo/db/stats/query_shape_stats.h"
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/s/d_state.h"
 
@@ -116,8 +118,11 @@ void DocumentSourceCursor::loadBatch() {
         }
     }
 
-    // If we got here, there won't be any more documents, so destroy the executor. Can't use
-    // dispose since we want to keep the _currentBatch.
+    // If we got here, there won't be any more documents, so account for the query and destroy the
+    // executor. Can't use dispose since we want to keep the _currentBatch.
+    if (state == PlanExecutor::IS_EOF || state == PlanExecutor::ADVANCED) {
+        recordQueryShape();
+    }
     _exec.reset();
 
     uassert(16028,
@@ -135,6 +140,24 @@ void DocumentSourceCursor::loadBatch() {
             state == PlanExecutor::IS_EOF || state == PlanExecutor::ADVANCED);
 }
 
+void DocumentSourceCursor::recordQueryShape() {
+    const CanonicalQuery* cq = _exec->getCanonicalQuery();
+    if (!cq) {
+        return;
+    }
+
+    PlanSummaryStats stats;
+    Explain::getSummaryStats(*_exec, &stats);
+
+    OperationContext* opCtx = pExpCtx->opCtx;
+    QueryShapeStats::Execution execution;
+    execution.micros = CurOp::get(opCtx)->elapsedMicros();
+    execution.keysExamined = stats.totalKeysExamined;
+    execution.docsExamined = stats.totalDocsExamined;
+    execution.nreturned = stats.nReturned;
+    QueryShapeStats::get(opCtx->getServiceContext()).record("aggregate", *cq, execution);
+}
+
 long long DocumentSourceCursor::getLimit() const {
     return _limit ? _limit->getLimit() : -1;
 }
@@ -29,6 +29,8 @@
 #include "mongo/platform/basic.h"
 
 
+#include "mongo/base/counter.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/pipeline/accumulator.h"
 #include "mongo/db/pipeline/document.h"
@@ -46,6 +48,26 @@ using std::vector;
 
 REGISTER_DOCUMENT_SOURCE(group, DocumentSourceGroup::createFromBson);
 
+namespace {
+
+// Totals of the PartitionStats of every $group stage.
+Counter64 groupSpilledPartitions;
+Counter64 groupSpills;
+Counter64 groupSpilledGroups;
+Counter64 groupFoldedRuns;
+Counter64 groupSortedFallbacks;
+ServerStatusMetricField<Counter64> displayGroupSpilledPartitions(
+    "aggregate.group.spilledPartitions", &groupSpilledPartitions);
+ServerStatusMetricField<Counter64> displayGroupSpills("aggregate.group.spills", &groupSpills);
+ServerStatusMetricField<Counter64> displayGroupSpilledGroups("aggregate.group.spilledGroups",
+                                                             &groupSpilledGroups);
+ServerStatusMetricField<Counter64> displayGroupFoldedRuns("aggregate.group.foldedRuns",
+                                                          &groupFoldedRuns);
+ServerStatusMetricField<Counter64> displayGroupSortedFallbacks("aggregate.group.sortedFallbacks",
+                                                               &groupSortedFallbacks);
+
+}  // namespace
+
 const char* DocumentSourceGroup::getSourceName() const {
     return "$group";
 }
@@ -56,71 +78,57 @@ boost::optional<Document> DocumentSourceGroup::getNext() {
     if (!populated)
         populate();
 
-    if (_spilled) {
-        if (!_sorterIterator)
-            return boost::none;
+    while (_currentPartition < _outputOrder.size()) {
+        if (_sorterIterator)
+            return getNextSorted();
 
-        const size_t numAccumulators = vpAccumulatorFactory.size();
-        for (size_t i = 0; i < numAccumulators; i++) {
-            _currentAccumulators[i]->reset();  // prep accumulators for a new group
+        const Partition& partition = _partitions[_outputOrder[_currentPartition]];
+        if (groupsIterator != partition.groups.end()) {
+            Document out =
+                makeDocument(groupsIterator->first, groupsIterator->second, pExpCtx->inShard);
+            ++groupsIterator;
+            return out;
         }
 
-        _currentId = _firstPartOfNextGroup.first;
-        while (_currentId == _firstPartOfNextGroup.first) {
-            // Inside of this loop, _firstPartOfNextGroup is the current data being processed.
-            // At loop exit, it is the first value to be processed in the next group.
-
-            switch (numAccumulators) {  // mirrors switch in spill()
-                case 0:                 // no Accumulators so no Values
-                    break;
-
-                case 1:  // single accumulators serialize as a single Value
-                    _currentAccumulators[0]->process(_firstPartOfNextGroup.second,
-                                                     /*merging=*/true);
-                    break;
-
-                default: {  // multiple accumulators serialize as an array
-                    const vector<Value>& accumulatorStates =
-                        _firstPartOfNextGroup.second.getArray();
-                    for (size_t i = 0; i < numAccumulators; i++) {
-                        _currentAccumulators[i]->process(accumulatorStates[i],
-                                                         /*merging=*/true);
-                    }
-                    break;
-                }
-            }
-
-            if (!_sorterIterator->more()) {
-                dispose();
-                break;
-            }
-
-            _firstPartOfNextGroup = _sorterIterator->next();
-        }
+        if (!advancePartition())
+            dispose();
+    }
 
-        return makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
+    return boost::none;
+}
 
-    } else {
-        if (groups.empty())
-            return boost::none;
+Document DocumentSourceGroup::getNextSorted() {
+    const size_t numAccumulators = vpAccumulatorFactory.size();
+    for (size_t i = 0; i < numAccumulators; i++) {
+        _currentAccumulators[i]->reset();  // prep accumulators for a new group
+    }
 
-        Document out =
-            makeDocument(groupsIterator->first, groupsIterator->second, pExpCtx->inShard);
+    _currentId = _firstPartOfNextGroup.first;
+    while (_currentId == _firstPartOfNextGroup.first) {
+        // Inside of this loop, _firstPartOfNextGroup is the current data being processed.
+        // At loop exit, it is the first value to be processed in the next group.
+        mergeAccumulatorStates(_firstPartOfNextGroup.second, &_currentAccumulators);
 
-        if (++groupsIterator == groups.end())
-            dispose();
+        if (!_sorterIterator->more()) {
+            _sorterIterator.reset();
+            break;
+        }
 
-        return out;
+        _firstPartOfNextGroup = _sorterIterator->next();
     }
+
+    return makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
 }
 
 void DocumentSourceGroup::dispose() {
     // free our resources
-    GroupsMap().swap(groups);
+    std::vector<Partition>().swap(_partitions);
+    _memoryUsageBytes = 0;
     _sorterIterator.reset();
 
     // make us look done
-    groupsIterator = groups.end();
+    _outputOrder.clear();
+    _currentPartition = 0;
 
     // free our source's resources
     pSource->dispose();
@@ -200,10 +208,11 @@ intrusive_ptr<DocumentSourceGroup> DocumentSourceGroup::create(
 DocumentSourceGroup::DocumentSourceGroup(const intrusive_ptr<ExpressionContext>& pExpCtx)
     : DocumentSource(pExpCtx),
       populated(false),
+      _memoryUsageBytes(0),
       _doingMerge(false),
-      _spilled(false),
       _extSortAllowed(pExpCtx->extSortAllowed && !pExpCtx->inRouter),
-      _maxMemoryUsageBytes(100 * 1024 * 1024) {}
+      _maxMemoryUsageBytes(100 * 1024 * 1024),
+      _currentPartition(0) {}
 
 void DocumentSourceGroup::addAccumulator(const std::string& fieldName,
                                          Accumulator::Factory accumulatorFactory,
@@ -309,19 +318,17 @@ void DocumentSourceGroup::populate() {
     const size_t numAccumulators = vpAccumulatorFactory.size();
     dassert(numAccumulators == vpExpression.size());
 
-    // pushed to on spill()
-    vector<shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles;
-    int memoryUsageBytes = 0;
+    _partitions.resize(kNumPartitions);
+    const Value::Hash hasher;
 
     // This loop consumes all input from pSource and buckets it based on pIdExpression.
     while (boost::optional<Document> input = pSource->getNext()) {
-        if (memoryUsageBytes > _maxMemoryUsageBytes) {
+        if (_memoryUsageBytes > _maxMemoryUsageBytes) {
             uassert(16945,
                     "Exceeded memory limit for $group, but didn't allow external sort."
                     " Pass allowDiskUse:true to opt in.",
                     _extSortAllowed);
-            sortedFiles.push_back(spill());
-            memoryUsageBytes = 0;
+            spillLargestPartition();
         }
 
         _variables->setRoot(*input);
@@ -333,26 +340,32 @@ void DocumentSourceGroup::populate() {
         if (id.missing())
             id = Value(BSONNULL);
 
+        // Numbers are hashed as doubles, so the low bits of Value::Hash hardly vary for integral
+        // keys. Mix all of its bits into the ones that pick the partition.
+        uint64_t mixedHash = hasher(id);
+        mixedHash ^= mixedHash >> 29;
+        mixedHash *= 0xBF58476D1CE4E5B9ULL;
+        mixedHash ^= mixedHash >> 32;
+        Partition& partition = _partitions[mixedHash % kNumPartitions];
+
         /*
-          Look for the _id value in the map; if it's not there, add a
+          Look for the _id value in the partition's map; if it's not there, add a
           new entry with a blank accumulator.
         */
-        const size_t oldSize = groups.size();
-        vector<intrusive_ptr<Accumulator>>& group = groups[id];
-        const bool inserted = groups.size() != oldSize;
+        const size_t oldSize = partition.groups.size();
+        Accumulators& group = partition.groups[id];
+        const bool inserted = partition.groups.size() != oldSize;
 
+        long long memoryUsageDelta = 0;
         if (inserted) {
-            memoryUsageBytes += id.getApproximateSize();
+            memoryUsageDelta += id.getApproximateSize();
 
             // Add the accumulators
-            group.reserve(numAccumulators);
-            for (size_t i = 0; i < numAccumulators; i++) {
-                group.push_back(vpAccumulatorFactory[i]());
-            }
+            group = makeAccumulators();
         } else {
             for (size_t i = 0; i < numAccumulators; i++) {
                 // subtract old mem usage. New usage added back after processing.
-                memoryUsageBytes -= group[i]->memUsageForSorter();
+                memoryUsageDelta -= group[i]->memUsageForSorter();
             }
         }
 
@@ -360,9 +373,12 @@ void DocumentSourceGroup::populate() {
         dassert(numAccumulators == group.size());
         for (size_t i = 0; i < numAccumulators; i++) {
             group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
-            memoryUsageBytes += group[i]->memUsageForSorter();
+            memoryUsageDelta += group[i]->memUsageForSorter();
         }
 
+        partition.memoryUsageBytes += memoryUsageDelta;
+        _memoryUsageBytes += memoryUsageDelta;
+
         // We are done with the ROOT document so release it.
         _variables->clearRoot();
 
@@ -374,40 +390,203 @@ void DocumentSourceGroup::populate() {
                 &&
                 !_extSortAllowed  // don't change behavior when testing external sort
                 &&
-                sortedFiles.size() < 20  // don't open too many FDs
+                _partitionStats.spills < 20  // keep the stress cheap, runs get folded together
                 ) {
-                sortedFiles.push_back(spill());
+                spillPartition(&partition);
             }
         }
     }
 
-    // These blocks do any final steps necessary to prepare to output results.
-    if (!sortedFiles.empty()) {
-        _spilled = true;
-        if (!groups.empty()) {
-            sortedFiles.push_back(spill());
+    // Flush what is left of the spilled partitions, so that only the partitions that never
+    // overflowed stay in memory while results are being returned. Those are returned first.
+    for (auto&& partition : _partitions) {
+        if (!partition.spilledRuns.empty())
+            spillPartition(&partition);
+    }
+
+    for (size_t i = 0; i < _partitions.size(); i++) {
+        if (_partitions[i].spilledRuns.empty() && !_partitions[i].groups.empty())
+            _outputOrder.push_back(i);
+    }
+    for (size_t i = 0; i < _partitions.size(); i++) {
+        if (!_partitions[i].spilledRuns.empty())
+            _outputOrder.push_back(i);
+    }
+
+    // prepare current to accumulate data from a sorted partition
+    _currentAccumulators = makeAccumulators();
+
+    _currentPartition = 0;
+    if (!_outputOrder.empty())
+        startPartition();
+
+    populated = true;
+}
+
+void DocumentSourceGroup::startPartition() {
+    Partition& partition = _partitions[_outputOrder[_currentPartition]];
+    if (!partition.spilledRuns.empty())
+        loadSpilledPartition(&partition);
+
+    groupsIterator = partition.groups.begin();
+}
+
+bool DocumentSourceGroup::advancePartition() {
+    // We won't be using this partition again so free its memory.
+    Partition& done = _partitions[_outputOrder[_currentPartition]];
+    _memoryUsageBytes -= done.memoryUsageBytes;
+    done.memoryUsageBytes = 0;
+    GroupsMap().swap(done.groups);
+
+    if (++_currentPartition == _outputOrder.size())
+        return false;
+
+    startPartition();
+    return true;
+}
+
+void DocumentSourceGroup::spillLargestPartition() {
+    // Spilling a single partition only frees about 1/kNumPartitions of the budget, so keep
+    // going until half of it is free. Otherwise every new group past the limit would spill.
+    while (_memoryUsageBytes > _maxMemoryUsageBytes / 2) {
+        Partition* largest = &_partitions[0];
+        for (auto&& partition : _partitions) {
+            if (partition.memoryUsageBytes > largest->memoryUsageBytes)
+                largest = &partition;
         }
 
-        // We won't be using groups again so free its memory.
-        GroupsMap().swap(groups);
+        if (largest->groups.empty())
+            return;
+
+        spillPartition(largest);
+    }
+}
 
-        _sorterIterator.reset(
-            Sorter<Value, Value>::Iterator::merge(sortedFiles, SortOptions(), SorterComparator()));
+void DocumentSourceGroup::spillPartition(Partition* partition) {
+    if (partition->groups.empty())
+        return;
 
-        // prepare current to accumulate data
-        _currentAccumulators.reserve(numAccumulators);
-        for (size_t i = 0; i < numAccumulators; i++) {
-            _currentAccumulators.push_back(vpAccumulatorFactory[i]());
+    // Runs are only ever read back sequentially by loadSpilledPartition() and never merged, so
+    // unlike spill() there is no need to sort them.
+    SortedFileWriter<Value, Value> writer(SortOptions().TempDir(pExpCtx->tempDir));
+    const bool firstSpill = partition->spilledRuns.empty();
+
+    // Each run holds a file open until the partition is reloaded, so runs are merged by level. The
+    // new run starts at level 0. While the runs before it end with kMaxSpilledRunsPerPartition - 1
+    // runs of its level, those are copied into it and it moves up a level. A group is copied at
+    // most once per level, so the data written stays O(n log n) in the number of groups spilled,
+    // and a partition holds fewer than kMaxSpilledRunsPerPartition runs of each level.
+    auto& runs = partition->spilledRuns;
+    auto& levels = partition->spilledRunLevels;
+    size_t level = 0;
+    size_t firstFolded = runs.size();
+    while (firstFolded >= kMaxSpilledRunsPerPartition - 1 &&
+           levels[firstFolded - kMaxSpilledRunsPerPartition + 1] == level) {
+        firstFolded -= kMaxSpilledRunsPerPartition - 1;
+        level++;
+    }
+
+    for (size_t i = firstFolded; i < runs.size(); i++) {
+        pExpCtx->checkForInterrupt();
+        while (runs[i]->more()) {
+            const pair<Value, Value> data = runs[i]->next();
+            writer.addAlreadySorted(data.first, data.second);
         }
+    }
+    if (firstFolded < runs.size()) {
+        runs.erase(runs.begin() + firstFolded, runs.end());
+        levels.resize(firstFolded);
+        _partitionStats.foldedRuns++;
+        groupFoldedRuns.increment();
+    }
 
-        verify(_sorterIterator->more());  // we put data in, we should get something out.
-        _firstPartOfNextGroup = _sorterIterator->next();
-    } else {
-        // start the group iterator
-        groupsIterator = groups.begin();
+    for (auto&& group : partition->groups) {
+        writer.addAlreadySorted(group.first, serializeAccumulators(group.second));
     }
 
-    populated = true;
+    if (firstSpill) {
+        _partitionStats.spilledPartitions++;
+        groupSpilledPartitions.increment();
+    }
+    _partitionStats.spills++;
+    groupSpills.increment();
+    _partitionStats.spilledGroups += partition->groups.size();
+    groupSpilledGroups.increment(partition->groups.size());
+
+    partition->groups.clear();
+    _memoryUsageBytes -= partition->memoryUsageBytes;
+    partition->memoryUsageBytes = 0;
+
+    runs.push_back(shared_ptr<Sorter<Value, Value>::Iterator>(writer.done()));
+    levels.push_back(level);
+    _partitionStats.maxSpilledRuns =
+        std::max(_partitionStats.maxSpilledRuns, static_cast<long long>(runs.size()));
+}
+
+void DocumentSourceGroup::loadSpilledPartition(Partition* partition) {
+    invariant(partition->groups.empty());
+
+    // pushed to on spill(), only if this partition does not fit in memory on its own
+    vector<shared_ptr<Sorter<Value, Value>::Iterator>> sortedFiles;
+
+    for (auto&& run : partition->spilledRuns) {
+        pExpCtx->checkForInterrupt();
+
+        while (run->more()) {
+            if (partition->memoryUsageBytes > _maxMemoryUsageBytes) {
+                sortedFiles.push_back(spill(&partition->groups));
+                _memoryUsageBytes -= partition->memoryUsageBytes;
+                partition->memoryUsageBytes = 0;
+            }
+
+            const pair<Value, Value> data = run->next();
+
+            const size_t oldSize = partition->groups.size();
+            Accumulators& group = partition->groups[data.first];
+            const bool inserted = partition->groups.size() != oldSize;
+
+            long long memoryUsageDelta = 0;
+            if (inserted) {
+                memoryUsageDelta += data.first.getApproximateSize();
+                group = makeAccumulators();
+            } else {
+                for (auto&& accumulator : group) {
+                    memoryUsageDelta -= accumulator->memUsageForSorter();
+                }
+            }
+
+            mergeAccumulatorStates(data.second, &group);
+            for (auto&& accumulator : group) {
+                memoryUsageDelta += accumulator->memUsageForSorter();
+            }
+
+            partition->memoryUsageBytes += memoryUsageDelta;
+            _memoryUsageBytes += memoryUsageDelta;
+        }
+    }
+
+    // Close the runs now that they have been consumed.
+    partition->spilledRuns.clear();
+    partition->spilledRunLevels.clear();
+
+    if (sortedFiles.empty())
+        return;
+
+    // This partition alone did not fit in memory: fall back to merging sorted files for it.
+    _partitionStats.sortedFallbacks++;
+    groupSortedFallbacks.increment();
+    if (!partition->groups.empty())
+        sortedFiles.push_back(spill(&partition->groups));
+
+    _memoryUsageBytes -= partition->memoryUsageBytes;
+    partition->memoryUsageBytes = 0;
+    GroupsMap().swap(partition->groups);
+
+    _sorterIterator.reset(
+        Sorter<Value, Value>::Iterator::merge(sortedFiles, SortOptions(), SorterComparator()));
+
+    verify(_sorterIterator->more());  // we put data in, we should get something out.
+    _firstPartOfNextGroup = _sorterIterator->next();
 }
 
 class DocumentSourceGroup::SpillSTLComparator {
@@ -417,44 +596,71 @@ public:
     }
 };
 
-shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
+shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill(GroupsMap* groups) {
     vector<const GroupsMap::value_type*> ptrs;  // using pointers to speed sorting
-    ptrs.reserve(groups.size());
-    for (GroupsMap::const_iterator it = groups.begin(), end = groups.end(); it != end; ++it) {
+    ptrs.reserve(groups->size());
+    for (GroupsMap::const_iterator it = groups->begin(), end = groups->end(); it != end; ++it) {
         ptrs.push_back(&*it);
     }
 
     stable_sort(ptrs.begin(), ptrs.end(), SpillSTLComparator());
 
     SortedFileWriter<Value, Value> writer(SortOptions().TempDir(pExpCtx->tempDir));
-    switch (vpAccumulatorFactory.size()) {  // same as ptrs[i]->second.size() for all i.
-        case 0:                             // no values, essentially a distinct
-            for (size_t i = 0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first, Value());
-            }
-            break;
+    for (size_t i = 0; i < ptrs.size(); i++) {
+        writer.addAlreadySorted(ptrs[i]->first, serializeAccumulators(ptrs[i]->second));
+    }
+
+    groups->clear();
+
+    return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
+}
+
+Value DocumentSourceGroup::serializeAccumulators(const Accumulators& accumulators) const {
+    switch (accumulators.size()) {
+        case 0:  // no values, essentially a distinct
+            return Value();
 
         case 1:  // just one value, use optimized serialization as single Value
-            for (size_t i = 0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first,
-                                        ptrs[i]->second[0]->getValue(/*toBeMerged=*/true));
+            return accumulators[0]->getValue(/*toBeMerged=*/true);
+
+        default: {  // multiple values, serialize as array-typed Value
+            vector<Value> states;
+            states.reserve(accumulators.size());
+            for (auto&& accumulator : accumulators) {
+                states.push_back(accumulator->getValue(/*toBeMerged=*/true));
             }
+            return Value(std::move(states));
+        }
+    }
+}
+
+void DocumentSourceGroup::mergeAccumulatorStates(const Value& states,
+                                                 Accumulators* accumulators) const {
+    switch (accumulators->size()) {  // mirrors switch in serializeAccumulators()
+        case 0:                      // no Accumulators so no Values
             break;
 
-        default:  // multiple values, serialize as array-typed Value
-            for (size_t i = 0; i < ptrs.size(); i++) {
-                vector<Value> accums;
-                for (size_t j = 0; j < ptrs[i]->second.size(); j++) {
-                    accums.push_back(ptrs[i]->second[j]->getValue(/*toBeMerged=*/true));
-                }
-                writer.addAlreadySorted(ptrs[i]->first, Value(std::move(accums)));
+        case 1:  // single accumulators serialize as a single Value
+            (*accumulators)[0]->process(states, /*merging=*/true);
+            break;
+
+        default: {  // multiple accumulators serialize as an array
+            const vector<Value>& accumulatorStates = states.getArray();
+            for (size_t i = 0; i < accumulators->size(); i++) {
+                (*accumulators)[i]->process(accumulatorStates[i], /*merging=*/true);
             }
             break;
+        }
     }
+}
 
-    groups.clear();
-
-    return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
+DocumentSourceGroup::Accumulators DocumentSourceGroup::makeAccumulators() const {
+    Accumulators accumulators;
+    accumulators.reserve(vpAccumulatorFactory.size());
+    for (auto&& factory : vpAccumulatorFactory) {
+        accumulators.push_back(factory());
+    }
+    return accumulators;
 }
 
 void DocumentSourceGroup::parseIdExpression(BSONElement groupField,
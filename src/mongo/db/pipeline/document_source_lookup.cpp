@@ -30,18 +30,58 @@
 
 #include "document_source.h"
 
+#include <algorithm>
+#include <cctype>
+
+#include "mongo/base/counter.h"
 #include "mongo/base/init.h"
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/matcher/expression_leaf.h"
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/expression.h"
 #include "mongo/db/pipeline/expression_context.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/stdx/memory.h"
 
 namespace mongo {
 
 using boost::intrusive_ptr;
 
+// Number of input documents joined together with one query. 1 queries the foreign collection once
+// per input document.
+MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceLookupBatchSize, int, 100);
+
+// A foreign collection with at most this many documents is loaded into memory and joined against
+// by hashing, unless it is larger than kMaxHashJoinBytes. 0 disables the hash join.
+MONGO_EXPORT_SERVER_PARAMETER(internalDocumentSourceLookupHashJoinMaxDocuments, int, 1000);
+
+namespace {
+
+const long long kMaxHashJoinBytes = 32 * 1024 * 1024;
+
+// Caps the matches buffered for a block. The inputs whose matches do not fit are looked up again
+// on their own when they are returned, and smaller blocks are used from then on.
+const long long kMaxBlockMatchesBytes = 4 * BSONObjMaxInternalSize;
+
+// An $in query is split once its values reach this size, leaving room below the maximum size of
+// a query for the field names of the array.
+const int kMaxInQueryBytes = BSONObjMaxUserSize / 2;
+
+// Blocks of input documents joined with each strategy.
+Counter64 lookupNestedLoopBlocks;
+Counter64 lookupBatchedInBlocks;
+Counter64 lookupHashBlocks;
+ServerStatusMetricField<Counter64> displayLookupNestedLoopBlocks(
+    "aggregate.lookup.nestedLoopBlocks", &lookupNestedLoopBlocks);
+ServerStatusMetricField<Counter64> displayLookupBatchedInBlocks("aggregate.lookup.batchedInBlocks",
+                                                                &lookupBatchedInBlocks);
+ServerStatusMetricField<Counter64> displayLookupHashBlocks("aggregate.lookup.hashBlocks",
+                                                           &lookupHashBlocks);
+
+}  // namespace
+
 DocumentSourceLookUp::DocumentSourceLookUp(NamespaceString fromNs,
                                            std::string as,
                                            std::string localField,
@@ -69,26 +109,15 @@ boost::optional<Document> DocumentSourceLookUp::getNext() {
         return unwindResult();
     }
 
-    boost::optional<Document> input = pSource->getNext();
-    if (!input)
+    boost::optional<MatchedInput> next = nextMatchedInput();
+    if (!next)
         return {};
-    BSONObj query = queryForInput(*input);
-    std::unique_ptr<DBClientCursor> cursor = _mongod->directClient()->query(_fromNs.ns(), query);
-
-    std::vector<Value> results;
-    int objsize = 0;
-    while (cursor->more()) {
-        BSONObj result = cursor->nextSafe();
-        objsize += result.objsize();
-        uassert(4568,
-                str::stream() << "Total size of documents in " << _fromNs.coll() << " matching "
-                              << query << " exceeds maximum document size",
-                objsize <= BSONObjMaxInternalSize);
-        results.push_back(Value(result));
+    if (next->deferred) {
+        joinDeferred(&*next);
     }
 
-    MutableDocument output(std::move(*input));
-    output.setNestedField(_as, Value(std::move(results)));
+    MutableDocument output(std::move(next->input));
+    output.setNestedField(_as, Value(std::move(next->matches)));
     return output.freeze();
 }
 
@@ -107,7 +136,11 @@ bool DocumentSourceLookUp::coalesce(const intrusive_ptr<DocumentSource>& pNextSo
 }
 
 void DocumentSourceLookUp::dispose() {
-    _cursor.reset();
+    _input = boost::none;
+    _unwindCursor.reset();
+    _matched.clear();
+    _foreignDocs.clear();
+    _hashTable.clear();
     pSource->dispose();
 }
 
@@ -116,7 +149,10 @@ BSONObj DocumentSourceLookUp::queryForInput(const Document& input) const {
     if (localFieldVal.missing()) {
         localFieldVal = Value(BSONNULL);
     }
+    return queryForValue(localFieldVal);
+}
 
+BSONObj DocumentSourceLookUp::queryForValue(const Value& localFieldVal) const {
     // { _foreignFieldFiedlName : { "$eq" : localFieldValue } }
     BSONObjBuilder query;
     BSONObjBuilder subObj(query.subobjStart(_foreignFieldFieldName));
@@ -125,38 +161,404 @@ BSONObj DocumentSourceLookUp::queryForInput(const Document& input) const {
     return query.obj();
 }
 
+boost::optional<DocumentSourceLookUp::MatchedInput> DocumentSourceLookUp::nextMatchedInput() {
+    if (_matched.empty()) {
+        fetchBlock();
+    }
+    if (_matched.empty()) {
+        return boost::none;
+    }
+
+    MatchedInput next = std::move(_matched.front());
+    _matched.pop_front();
+    return std::move(next);
+}
+
+void DocumentSourceLookUp::fetchBlock() {
+    if (_sourceExhausted) {
+        return;
+    }
+    if (_strategy == JoinStrategy::kUndecided) {
+        chooseJoinStrategy();
+    }
+
+    std::vector<MatchedInput> block;
+    while (block.size() < _blockSize) {
+        boost::optional<Document> input = pSource->getNext();
+        if (!input) {
+            _sourceExhausted = true;
+            break;
+        }
+        block.emplace_back();
+        block.back().input = std::move(*input);
+    }
+    if (block.empty()) {
+        return;
+    }
+
+    // The foreign collection is reloaded for every block, so that like the queries of the other
+    // strategies, each block sees it as it is when the block is joined.
+    if (_strategy == JoinStrategy::kHash && !loadHashTable()) {
+        _strategy = JoinStrategy::kBatchedIn;
+    }
+
+    _joinMatchesBytes = 0;
+    if (_strategy == JoinStrategy::kNestedLoop) {
+        lookupNestedLoopBlocks.increment();
+        joinNestedLoop(&block);
+    } else {
+        // Each distinct local value is only looked up once per block.
+        std::vector<LocalKey> keys;
+        LocalKeyIndex keyIndex;
+        for (size_t i = 0; i < block.size(); ++i) {
+            Value localFieldVal = block[i].input.getNestedField(_localField);
+            if (localFieldVal.missing()) {
+                localFieldVal = Value(BSONNULL);
+            }
+
+            auto it = keyIndex.find(localFieldVal);
+            if (it == keyIndex.end()) {
+                it = keyIndex.emplace(localFieldVal, keys.size()).first;
+                keys.emplace_back();
+                LocalKey& key = keys.back();
+                key.value = localFieldVal;
+                BSONObjBuilder holder;
+                holder << "" << localFieldVal;
+                key.valueHolder = holder.obj();
+                if (canUseIn(localFieldVal)) {
+                    key.matcher = stdx::make_unique<EqualityMatchExpression>();
+                    uassertStatusOK(
+                        key.matcher->init(_foreignFieldFieldName, key.valueHolder.firstElement()));
+                }
+            }
+            keys[it->second].inputs.push_back(i);
+        }
+
+        if (_strategy == JoinStrategy::kHash) {
+            lookupHashBlocks.increment();
+            joinHash(&block, &keys);
+        } else {
+            lookupBatchedInBlocks.increment();
+            joinBatchedIn(&block, &keys, keyIndex);
+        }
+    }
+
+    bool anyDeferred = false;
+    for (auto&& matched : block) {
+        anyDeferred = anyDeferred || matched.deferred;
+        _matched.push_back(std::move(matched));
+    }
+
+    // Buffering a whole block of large results is not worth saving a few queries.
+    if (anyDeferred && _blockSize > 1) {
+        _blockSize /= 2;
+    }
+}
+
+DocumentSourceLookUp::JoinStrategy DocumentSourceLookUp::predictJoinStrategy() const {
+    if (internalDocumentSourceLookupBatchSize <= 1) {
+        return JoinStrategy::kNestedLoop;
+    }
+
+    // A numeric component may address an array element, which the candidate keys of a foreign
+    // document do not account for.
+    for (size_t i = 0; i < _foreignField.getPathLength(); ++i) {
+        const std::string& component = _foreignField.getFieldName(i);
+        if (std::all_of(component.begin(), component.end(), [](unsigned char c) {
+                return std::isdigit(c);
+            })) {
+            return JoinStrategy::kNestedLoop;
+        }
+    }
+
+    const int maxHashJoinDocuments = internalDocumentSourceLookupHashJoinMaxDocuments;
+    if (maxHashJoinDocuments > 0 &&
+        _mongod->directClient()->count(_fromNs.ns(), BSONObj(), 0, maxHashJoinDocuments + 1) <=
+            static_cast<unsigned long long>(maxHashJoinDocuments)) {
+        return JoinStrategy::kHash;
+    }
+    return JoinStrategy::kBatchedIn;
+}
+
+void DocumentSourceLookUp::chooseJoinStrategy() {
+    _strategy = predictJoinStrategy();
+    _blockSize =
+        _strategy == JoinStrategy::kNestedLoop ? 1 : internalDocumentSourceLookupBatchSize.load();
+}
+
+bool DocumentSourceLookUp::loadHashTable() {
+    _foreignDocs.clear();
+    _hashTable.clear();
+
+    std::unique_ptr<DBClientCursor> cursor = _mongod->directClient()->query(_fromNs.ns(), Query());
+
+    long long bytes = 0;
+    while (cursor->more()) {
+        BSONObj foreignDoc = cursor->nextSafe().getOwned();
+        bytes += foreignDoc.objsize();
+        if (bytes > kMaxHashJoinBytes) {
+            _foreignDocs.clear();
+            _hashTable.clear();
+            return false;
+        }
+
+        const size_t pos = _foreignDocs.size();
+        _foreignDocs.push_back(foreignDoc);
+        for (auto&& key : candidateKeys(foreignDoc)) {
+            std::vector<size_t>& bucket = _hashTable[key];
+            if (bucket.empty() || bucket.back() != pos) {
+                bucket.push_back(pos);
+            }
+        }
+    }
+    return true;
+}
+
+void DocumentSourceLookUp::joinNestedLoop(std::vector<MatchedInput>* block) {
+    for (auto&& matched : *block) {
+        std::unique_ptr<DBClientCursor> cursor =
+            _mongod->directClient()->query(_fromNs.ns(), queryForInput(matched.input));
+        while (cursor->more()) {
+            appendMatch(cursor->nextSafe(), &matched);
+        }
+    }
+}
+
+void DocumentSourceLookUp::joinDeferred(MatchedInput* matched) {
+    matched->deferred = false;
+    _joinMatchesBytes = 0;
+
+    std::unique_ptr<DBClientCursor> cursor =
+        _mongod->directClient()->query(_fromNs.ns(), queryForInput(matched->input));
+    while (cursor->more()) {
+        appendMatch(cursor->nextSafe(), matched);
+    }
+}
+
+void DocumentSourceLookUp::joinBatchedIn(std::vector<MatchedInput>* block,
+                                         std::vector<LocalKey>* keys,
+                                         const LocalKeyIndex& keyIndex) {
+    // The values are split across as many $in queries as it takes to keep each under
+    // kMaxInQueryBytes.
+    std::vector<std::vector<BSONElement>> inValues(1);
+    int inBytes = 0;
+    for (auto&& key : *keys) {
+        if (!key.matcher) {
+            continue;
+        }
+        const BSONElement value = key.valueHolder.firstElement();
+        if (!inValues.back().empty() && inBytes + value.size() > kMaxInQueryBytes) {
+            inValues.emplace_back();
+            inBytes = 0;
+        }
+        key.inQuery = inValues.size() - 1;
+        inValues.back().push_back(value);
+        inBytes += value.size();
+    }
+
+    long long docSeq = 0;
+    for (size_t inQuery = 0; inQuery < inValues.size(); ++inQuery) {
+        if (inValues[inQuery].empty()) {
+            continue;
+        }
+
+        // { _foreignFieldFieldName : { "$in" : [ localFieldValue, ... ] } }
+        BSONObjBuilder query;
+        BSONObjBuilder subObj(query.subobjStart(_foreignFieldFieldName));
+        BSONArrayBuilder in(subObj.subarrayStart("$in"));
+        for (auto&& value : inValues[inQuery]) {
+            in.append(value);
+        }
+        in.doneFast();
+        subObj.doneFast();
+
+        std::unique_ptr<DBClientCursor> cursor =
+            _mongod->directClient()->query(_fromNs.ns(), query.obj());
+        while (cursor->more()) {
+            appendToMatchingKeys(cursor->nextSafe(), docSeq++, inQuery, block, keys, keyIndex);
+        }
+    }
+
+    for (auto&& key : *keys) {
+        if (!key.matcher) {
+            joinQuery(queryForValue(key.value), block, key);
+        }
+    }
+}
+
+void DocumentSourceLookUp::joinHash(std::vector<MatchedInput>* block,
+                                    std::vector<LocalKey>* keys) {
+    for (auto&& key : *keys) {
+        if (!key.matcher) {
+            joinQuery(queryForValue(key.value), block, key);
+            continue;
+        }
+
+        auto bucket = _hashTable.find(key.value);
+        if (bucket == _hashTable.end()) {
+            continue;
+        }
+        for (size_t pos : bucket->second) {
+            const BSONObj& foreignDoc = _foreignDocs[pos];
+            if (!key.matcher->matchesBSON(foreignDoc)) {
+                continue;
+            }
+            for (size_t i : key.inputs) {
+                appendMatch(foreignDoc, &(*block)[i]);
+            }
+        }
+    }
+}
+
+void DocumentSourceLookUp::joinQuery(const BSONObj& query,
+                                     std::vector<MatchedInput>* block,
+                                     const LocalKey& key) {
+    std::unique_ptr<DBClientCursor> cursor = _mongod->directClient()->query(_fromNs.ns(), query);
+    while (cursor->more()) {
+        BSONObj foreignDoc = cursor->nextSafe();
+        for (size_t i : key.inputs) {
+            appendMatch(foreignDoc, &(*block)[i]);
+        }
+    }
+}
+
+void DocumentSourceLookUp::appendToMatchingKeys(const BSONObj& foreignDoc,
+                                                long long docSeq,
+                                                size_t inQuery,
+                                                std::vector<MatchedInput>* block,
+                                                std::vector<LocalKey>* keys,
+                                                const LocalKeyIndex& keyIndex) {
+    for (auto&& candidate : candidateKeys(foreignDoc)) {
+        auto it = keyIndex.find(candidate);
+        if (it == keyIndex.end()) {
+            continue;
+        }
+
+        // The keys of the other $in queries get this document from their own query.
+        LocalKey& key = (*keys)[it->second];
+        if (!key.matcher || key.inQuery != inQuery || key.lastMatchedDoc == docSeq ||
+            !key.matcher->matchesBSON(foreignDoc)) {
+            continue;
+        }
+        key.lastMatchedDoc = docSeq;
+        for (size_t i : key.inputs) {
+            appendMatch(foreignDoc, &(*block)[i]);
+        }
+    }
+}
+
+void DocumentSourceLookUp::appendMatch(const BSONObj& foreignDoc, MatchedInput* matched) {
+    if (matched->deferred) {
+        return;
+    }
+
+    const long long size = foreignDoc.objsize();
+    if (_joinMatchesBytes + size > kMaxBlockMatchesBytes) {
+        _joinMatchesBytes -= matched->matchesBytes;
+        std::vector<Value>().swap(matched->matches);
+        matched->matchesBytes = 0;
+        matched->deferred = true;
+        return;
+    }
+    _joinMatchesBytes += size;
+    matched->matchesBytes += size;
+
+    // When unwinding, each match goes into its own output document.
+    uassert(4568,
+            str::stream() << "Total size of documents in " << _fromNs.coll() << " matching "
+                          << queryForInput(matched->input) << " exceeds maximum document size",
+            _handlingUnwind || matched->matchesBytes <= BSONObjMaxInternalSize);
+    matched->matches.push_back(Value(foreignDoc));
+}
+
+std::vector<Value> DocumentSourceLookUp::candidateKeys(const BSONObj& foreignDoc) const {
+    BSONElementSet elements;
+    foreignDoc.getFieldsDotted(_foreignFieldFieldName, elements, true);
+    foreignDoc.getFieldsDotted(_foreignFieldFieldName, elements, false);
+
+    std::vector<Value> keys;
+    keys.reserve(elements.size() + 1);
+    for (auto&& elem : elements) {
+        keys.push_back(Value(elem));
+    }
+
+    // Null also matches a missing field.
+    keys.push_back(Value(BSONNULL));
+    return keys;
+}
+
+bool DocumentSourceLookUp::canUseIn(const Value& localFieldVal) {
+    switch (localFieldVal.getType()) {
+        case RegEx:
+            // $in treats a regular expression as a pattern, not as a value to compare with.
+        case Undefined:
+            // $eq rejects undefined; keep the error a query for the single value reports.
+            return false;
+        case Object: {
+            // $in does not accept objects whose first field is an operator.
+            FieldIterator fields = localFieldVal.getDocument().fieldIterator();
+            return !fields.more() || !fields.next().first.startsWith("$");
+        }
+        default:
+            return true;
+    }
+}
+
 boost::optional<Document> DocumentSourceLookUp::unwindResult() {
     const boost::optional<FieldPath> indexPath(_unwindSrc->indexPath());
 
     // Loop until we get a document that has at least one match.
     // Note we may return early from this loop if our source stage is exhausted or if the unwind
     // source was asked to return empty arrays and we get a document without a match.
-    while (!_cursor || !_cursor->more()) {
-        _input = pSource->getNext();
-        if (!_input)
-            return {};
+    Value nextVal;
+    bool isLast = false;
+    while (true) {
+        if (_unwindCursor) {
+            // The matches of a deferred input are streamed rather than buffered.
+            if (_unwindCursor->more()) {
+                nextVal = Value(_unwindCursor->nextSafe().getOwned());
+                break;
+            }
+            _unwindCursor.reset();
+            if (_cursorIndex > 0) {
+                _input = boost::none;
+                continue;
+            }
+        } else if (_input && _cursorIndex < static_cast<long long>(_input->matches.size())) {
+            nextVal = std::move(_input->matches[_cursorIndex]);
+            isLast = _cursorIndex + 1 == static_cast<long long>(_input->matches.size());
+            break;
+        } else {
+            _input = nextMatchedInput();
+            if (!_input)
+                return {};
+
+            _cursorIndex = 0;
 
-        _cursor = _mongod->directClient()->query(_fromNs.ns(), queryForInput(*_input));
-        _cursorIndex = 0;
+            if (_input->deferred) {
+                _unwindCursor =
+                    _mongod->directClient()->query(_fromNs.ns(), queryForInput(_input->input));
+                continue;
+            }
+        }
 
-        if (_unwindSrc->preserveNullAndEmptyArrays() && !_cursor->more()) {
-            // There were no results for this cursor, but the $unwind was asked to preserve empty
+        if (_unwindSrc->preserveNullAndEmptyArrays() && _input->matches.empty()) {
+            // There were no results for this input, but the $unwind was asked to preserve empty
             // arrays, so we should return a document without the array.
-            MutableDocument output(std::move(*_input));
+            MutableDocument output(std::move(_input->input));
             // Note this will correctly objects in the prefix of '_as', to act as if we had created
             // an empty array and then removed it.
             output.setNestedField(_as, Value());
             if (indexPath) {
                 output.setNestedField(*indexPath, Value(BSONNULL));
             }
+            _input = boost::none;
             return output.freeze();
         }
     }
-    invariant(_cursor->more() && bool(_input));
-    auto nextVal = Value(_cursor->nextSafe());
 
     // Move input document into output if this is the last or only result, otherwise perform a copy.
-    MutableDocument output(_cursor->more() ? *_input : std::move(*_input));
+    MutableDocument output(isLast ? std::move(_input->input) : _input->input);
     output.setNestedField(_as, nextVal);
 
     if (indexPath) {
@@ -0,0 +1,83 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/pipeline/document_source.h"
+
+#include "mongo/db/server_options.h"
+#include "mongo/util/net/sock.h"
+
+namespace mongo {
+
+using boost::intrusive_ptr;
+
+REGISTER_DOCUMENT_SOURCE(queryShapeStats, DocumentSourceQueryShapeStats::createFromBson);
+
+const char* DocumentSourceQueryShapeStats::getSourceName() const {
+    return "$queryShapeStats";
+}
+
+boost::optional<Document> DocumentSourceQueryShapeStats::getNext() {
+    pExpCtx->checkForInterrupt();
+
+    if (!_populated) {
+        _shapes = _mongod->getQueryShapeStats(pExpCtx->opCtx, pExpCtx->ns);
+        _shapesIter = _shapes.begin();
+        _populated = true;
+    }
+
+    if (_shapesIter != _shapes.end()) {
+        Document shape(*_shapesIter);
+        MutableDocument doc(shape);
+        doc["host"] = Value(_processName);
+        ++_shapesIter;
+        return doc.freeze();
+    }
+
+    return boost::none;
+}
+
+DocumentSourceQueryShapeStats::DocumentSourceQueryShapeStats(
+    const intrusive_ptr<ExpressionContext>& pExpCtx)
+    : DocumentSource(pExpCtx),
+      _processName(str::stream() << getHostNameCached() << ":" << serverGlobalParams.port) {}
+
+intrusive_ptr<DocumentSource> DocumentSourceQueryShapeStats::createFromBson(
+    BSONElement elem, const intrusive_ptr<ExpressionContext>& pExpCtx) {
+    uassert(34366,
+            "The $queryShapeStats stage specification must be an empty object",
+            elem.type() == Object && elem.Obj().isEmpty());
+    return new DocumentSourceQueryShapeStats(pExpCtx);
+}
+
+Value DocumentSourceQueryShapeStats::serialize(bool explain) const {
+    return Value(DOC(getSourceName() << Document()));
+}
+
+}  // namespace mongo
@@ -299,13 +299,14 @@ public:
     Base() : _tempDir("DocumentSourceGroupTest") {}
 
 protected:
-    void createGroup(const BSONObj& spec, bool inShard = false) {
+    void createGroup(const BSONObj& spec, bool inShard = false, bool extSortAllowed = false) {
         BSONObj namedSpec = BSON("$group" << spec);
         BSONElement specElement = namedSpec.firstElement();
 
         intrusive_ptr<ExpressionContext> expressionContext =
             new ExpressionContext(_opCtx.get(), NamespaceString(ns));
         expressionContext->inShard = inShard;
+        expressionContext->extSortAllowed = extSortAllowed;
         // Won't spill to disk properly if it needs to.
         expressionContext->tempDir = _tempDir.path();
 
@@ -885,6 +886,78 @@ public:
     }
 };
 
+/** Base class for tests that run the group with a small memory budget, so that it spills. */
+class SpillBase : public CheckResultsBase {
+public:
+    void run() {
+        createGroup(groupSpec(), /*inShard=*/false, /*extSortAllowed=*/true);
+        auto groupStage = static_cast<mongo::DocumentSourceGroup*>(group());
+        groupStage->setMaxMemoryUsageBytes(maxMemoryUsageBytes());
+        auto source = DocumentSourceMock::create(inputData());
+        group()->setSource(source.get());
+        checkResultSet(group());
+        checkStats(groupStage->getPartitionStats());
+    }
+
+protected:
+    static const int kNumGroups = 3000;
+    static const int kDocsPerGroup = 5;
+
+    virtual int maxMemoryUsageBytes() = 0;
+    virtual void checkStats(const mongo::DocumentSourceGroup::PartitionStats& stats) = 0;
+
+private:
+    std::deque<Document> inputData() {
+        std::deque<Document> data;
+        for (int i = 0; i < kNumGroups * kDocsPerGroup; ++i) {
+            data.push_back(DOC("x" << i % kNumGroups << "y" << i));
+        }
+        return data;
+    }
+    BSONObj groupSpec() {
+        return fromjson("{_id:'$x',count:{$sum:1},sum:{$sum:'$y'},max:{$max:'$y'}}");
+    }
+    BSONObj expectedResultSet() {
+        BSONArrayBuilder expected;
+        for (int x = 0; x < kNumGroups; ++x) {
+            // Group x gets y = x + kNumGroups * k for k in [0, kDocsPerGroup).
+            const int sum =
+                kDocsPerGroup * x + kNumGroups * kDocsPerGroup * (kDocsPerGroup - 1) / 2;
+            const int max = x + kNumGroups * (kDocsPerGroup - 1);
+            expected << BSON("_id" << x << "count" << kDocsPerGroup << "sum" << sum << "max"
+                                   << max);
+        }
+        return expected.arr();
+    }
+};
+
+/** Spilled partitions are re-aggregated from their runs, which are folded level by level. */
+class SpillAndReload : public SpillBase {
+    int maxMemoryUsageBytes() {
+        return 64 * 1024;
+    }
+    void checkStats(const mongo::DocumentSourceGroup::PartitionStats& stats) {
+        ASSERT_GREATER_THAN(stats.spilledPartitions, 0);
+        ASSERT_GREATER_THAN(stats.spills, stats.spilledPartitions);
+        ASSERT_GREATER_THAN(stats.foldedRuns, 0);
+        ASSERT_EQUALS(0, stats.sortedFallbacks);
+        // Each partition spills a few dozen times, which takes at most three levels of at most
+        // three runs each.
+        ASSERT_LESS_THAN_OR_EQUALS(stats.maxSpilledRuns, 9);
+    }
+};
+
+/** A partition that does not fit in memory on its own is merged through sorted files. */
+class SpillSortedFallback : public SpillBase {
+    int maxMemoryUsageBytes() {
+        return 8 * 1024;
+    }
+    void checkStats(const mongo::DocumentSourceGroup::PartitionStats& stats) {
+        ASSERT_GREATER_THAN(stats.spilledPartitions, 0);
+        ASSERT_GREATER_THAN(stats.sortedFallbacks, 0);
+    }
+};
+
 }  // namespace DocumentSourceGroup
 
 namespace DocumentSourceProject {
@@ -2706,6 +2779,8 @@ public:
         add<DocumentSourceGroup::Dependencies>();
         add<DocumentSourceGroup::StringConstantIdAndAccumulatorExpressions>();
         add<DocumentSourceGroup::ArrayConstantAccumulatorExpression>();
+        add<DocumentSourceGroup::SpillAndReload>();
+        add<DocumentSourceGroup::SpillSortedFallback>();
 
         add<DocumentSourceProject::Inclusion>();
         add<DocumentSourceProject::Optimize>();
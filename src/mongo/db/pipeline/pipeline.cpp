@@ -335,6 +335,10 @@ Status Pipeline::checkAuthForCommand(ClientBasic* client,
         Privilege::addPrivilegeToPrivilegeVector(
             &privileges,
             Privilege(ResourcePattern::forAnyNormalResource(), ActionType::indexStats));
+    } else if (cmdObj.getFieldDotted("pipeline.0.$queryShapeStats")) {
+        // Same privilege as the queryShapeStats command.
+        Privilege::addPrivilegeToPrivilegeVector(
+            &privileges, Privilege(ResourcePattern::forClusterResource(), ActionType::top));
     } else {
         // If no source requiring an alternative permission scheme is specified then default to
         // requiring find() privileges on the given namespace.
@@ -51,6 +51,7 @@
 #include "mongo/db/query/get_executor.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/service_context.h"
+#include "mongo/db/stats/query_shape_stats.h"
 #include "mongo/db/storage/record_store.h"
 #include "mongo/db/storage/sorted_data_interface.h"
 #include "mongo/db/s/sharded_connection_info.h"
@@ -114,6 +115,16 @@ public:
         return collection->infoCache()->getIndexUsageStats();
     }
 
+    std::vector<BSONObj> getQueryShapeStats(OperationContext* opCtx,
+                                            const NamespaceString& ns) final {
+        std::vector<BSONObj> shapes;
+        auto& queryShapeStats = QueryShapeStats::get(opCtx->getServiceContext());
+        for (const auto& shape : queryShapeStats.getStats(ns.ns())) {
+            shapes.push_back(shape.toBSON());
+        }
+        return shapes;
+    }
+
 private:
     intrusive_ptr<ExpressionContext> _ctx;
     DBDirectClient _client;
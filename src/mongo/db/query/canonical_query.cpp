@@ -339,6 +339,8 @@ Status CanonicalQuery::init(LiteParsedQuery* lpq,
         return Status(ErrorCodes::BadValue, "cannot use sortKey $meta projection without a sort");
     }
 
+    _planCacheKey = PlanCacheKey::encodeShape(_root.get(), _pq->getSort(), _pq->getProj());
+
     return Status::OK();
 }
 
@@ -35,6 +35,7 @@
 #include "mongo/db/matcher/expression.h"
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/query/parsed_projection.h"
+#include "mongo/db/query/plan_cache_key.h"
 
 namespace mongo {
 
@@ -164,6 +165,14 @@ public:
         return _proj.get();
     }
 
+    /**
+     * Returns the key for the shape of this query, which is encoded once the query has been
+     * normalized. Use PlanCache::computeKey() to obtain the key for a particular collection.
+     */
+    const PlanCacheKey& getPlanCacheKey() const {
+        return _planCacheKey;
+    }
+
     // Debugging
     std::string toString() const;
     std::string toStringShort() const;
@@ -214,6 +223,8 @@ private:
     std::unique_ptr<MatchExpression> _root;
 
     std::unique_ptr<ParsedProjection> _proj;
+
+    PlanCacheKey _planCacheKey;
 };
 
 }  // namespace mongo
@@ -52,6 +52,7 @@
 #include "mongo/db/query/query_planner_params.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/s/sharding_state.h"
+#include "mongo/db/stats/query_shape_stats.h"
 #include "mongo/db/server_options.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/storage_options.h"
@@ -162,6 +163,16 @@ void endQueryOp(OperationContext* txn,
         collection->infoCache()->notifyOfQuery(txn, summaryStats.indexesUsed);
     }
 
+    // Aggregate the execution statistics by query shape. Only the initial batch is accounted for.
+    if (const CanonicalQuery* cq = exec.getCanonicalQuery()) {
+        QueryShapeStats::Execution execution;
+        execution.micros = curop->elapsedMicros();
+        execution.keysExamined = summaryStats.totalKeysExamined;
+        execution.docsExamined = summaryStats.totalDocsExamined;
+        execution.nreturned = numResults;
+        QueryShapeStats::get(txn->getServiceContext()).record("find", *cq, execution);
+    }
+
     const logger::LogComponent queryLogComponent = logger::LogComponent::kQuery;
     const logger::LogSeverity logLevelOne = logger::LogSeverity::Debug(1);
 
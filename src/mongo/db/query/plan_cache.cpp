@@ -35,216 +35,38 @@
 #include <algorithm>
 #include <math.h>
 #include <memory>
+#include <unordered_map>
+
+#include "mongo/base/counter.h"
 #include "mongo/base/owned_pointer_vector.h"
 #include "mongo/client/dbclientinterface.h"  // For QueryOption_foobar
+#include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/matcher/expression_array.h"
-#include "mongo/db/matcher/expression_geo.h"
 #include "mongo/db/query/plan_ranker.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/query_knobs.h"
+#include "mongo/stdx/memory.h"
 #include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/rwlock.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 namespace {
 
-// Delimiters for cache key encoding.
-const char kEncodeDiscriminatorsBegin = '<';
-const char kEncodeDiscriminatorsEnd = '>';
-const char kEncodeChildrenBegin = '[';
-const char kEncodeChildrenEnd = ']';
-const char kEncodeChildrenSeparator = ',';
-const char kEncodeSortSection = '~';
-const char kEncodeProjectionSection = '|';
-
-/**
- * Encode user-provided string. Cache key delimiters seen in the
- * user string are escaped with a backslash.
- */
-void encodeUserString(StringData s, StringBuilder* keyBuilder) {
-    for (size_t i = 0; i < s.size(); ++i) {
-        char c = s[i];
-        switch (c) {
-            case kEncodeDiscriminatorsBegin:
-            case kEncodeDiscriminatorsEnd:
-            case kEncodeChildrenBegin:
-            case kEncodeChildrenEnd:
-            case kEncodeChildrenSeparator:
-            case kEncodeSortSection:
-            case kEncodeProjectionSection:
-            case '\\':
-                *keyBuilder << '\\';
-            // Fall through to default case.
-            default:
-                *keyBuilder << c;
-        }
-    }
-}
-
-/**
- * 2-character encoding of MatchExpression::MatchType.
- */
-const char* encodeMatchType(MatchExpression::MatchType mt) {
-    switch (mt) {
-        case MatchExpression::AND:
-            return "an";
-            break;
-        case MatchExpression::OR:
-            return "or";
-            break;
-        case MatchExpression::NOR:
-            return "nr";
-            break;
-        case MatchExpression::NOT:
-            return "nt";
-            break;
-        case MatchExpression::ELEM_MATCH_OBJECT:
-            return "eo";
-            break;
-        case MatchExpression::ELEM_MATCH_VALUE:
-            return "ev";
-            break;
-        case MatchExpression::SIZE:
-            return "sz";
-            break;
-        case MatchExpression::LTE:
-            return "le";
-            break;
-        case MatchExpression::LT:
-            return "lt";
-            break;
-        case MatchExpression::EQ:
-            return "eq";
-            break;
-        case MatchExpression::GT:
-            return "gt";
-            break;
-        case MatchExpression::GTE:
-            return "ge";
-            break;
-        case MatchExpression::REGEX:
-            return "re";
-            break;
-        case MatchExpression::MOD:
-            return "mo";
-            break;
-        case MatchExpression::EXISTS:
-            return "ex";
-            break;
-        case MatchExpression::MATCH_IN:
-            return "in";
-            break;
-        case MatchExpression::TYPE_OPERATOR:
-            return "ty";
-            break;
-        case MatchExpression::GEO:
-            return "go";
-            break;
-        case MatchExpression::WHERE:
-            return "wh";
-            break;
-        case MatchExpression::ATOMIC:
-            return "at";
-            break;
-        case MatchExpression::ALWAYS_FALSE:
-            return "af";
-            break;
-        case MatchExpression::GEO_NEAR:
-            return "gn";
-            break;
-        case MatchExpression::TEXT:
-            return "te";
-            break;
-        case MatchExpression::BITS_ALL_SET:
-            return "ls";
-            break;
-        case MatchExpression::BITS_ALL_CLEAR:
-            return "lc";
-            break;
-        case MatchExpression::BITS_ANY_SET:
-            return "ys";
-            break;
-        case MatchExpression::BITS_ANY_CLEAR:
-            return "yc";
-            break;
-        default:
-            verify(0);
-            return "";
-    }
-}
-
-/**
- * Encodes GEO match expression.
- * Encoding includes:
- * - type of geo query (within/intersect/near)
- * - geometry type
- * - CRS (flat or spherical)
- */
-void encodeGeoMatchExpression(const GeoMatchExpression* tree, StringBuilder* keyBuilder) {
-    const GeoExpression& geoQuery = tree->getGeoExpression();
-
-    // Type of geo query.
-    switch (geoQuery.getPred()) {
-        case GeoExpression::WITHIN:
-            *keyBuilder << "wi";
-            break;
-        case GeoExpression::INTERSECT:
-            *keyBuilder << "in";
-            break;
-        case GeoExpression::INVALID:
-            *keyBuilder << "id";
-            break;
-    }
-
-    // Geometry type.
-    // Only one of the shared_ptrs in GeoContainer may be non-NULL.
-    *keyBuilder << geoQuery.getGeometry().getDebugType();
-
-    // CRS (flat or spherical)
-    if (FLAT == geoQuery.getGeometry().getNativeCRS()) {
-        *keyBuilder << "fl";
-    } else if (SPHERE == geoQuery.getGeometry().getNativeCRS()) {
-        *keyBuilder << "sp";
-    } else if (STRICT_SPHERE == geoQuery.getGeometry().getNativeCRS()) {
-        *keyBuilder << "ss";
-    } else {
-        error() << "unknown CRS type " << (int)geoQuery.getGeometry().getNativeCRS()
-                << " in geometry of type " << geoQuery.getGeometry().getDebugType();
-        invariant(false);
-    }
-}
+// Upper bound on the number of partitions of each plan cache.
+const size_t kMaxPlanCachePartitions = 16;
 
-/**
- * Encodes GEO_NEAR match expression.
- * Encode:
- * - isNearSphere
- * - CRS (flat or spherical)
- */
-void encodeGeoNearMatchExpression(const GeoNearMatchExpression* tree, StringBuilder* keyBuilder) {
-    const GeoNearExpression& nearQuery = tree->getData();
-
-    // isNearSphere
-    *keyBuilder << (nearQuery.isNearSphere ? "ns" : "nr");
-
-    // CRS (flat or spherical or strict-winding spherical)
-    switch (nearQuery.centroid->crs) {
-        case FLAT:
-            *keyBuilder << "fl";
-            break;
-        case SPHERE:
-            *keyBuilder << "sp";
-            break;
-        case STRICT_SPHERE:
-            *keyBuilder << "ss";
-            break;
-        case UNSET:
-            error() << "unknown CRS type " << (int)nearQuery.centroid->crs
-                    << " in point geometry for near query";
-            invariant(false);
-            break;
-    }
-}
+// Plan cache lookups, and partition lock acquisitions which had to wait, across all collections.
+Counter64 planCacheHitsStats;
+ServerStatusMetricField<Counter64> displayPlanCacheHits("query.planCache.hits",
+                                                        &planCacheHitsStats);
+Counter64 planCacheMissesStats;
+ServerStatusMetricField<Counter64> displayPlanCacheMisses("query.planCache.misses",
+                                                          &planCacheMissesStats);
+Counter64 planCacheLockWaitsStats;
+ServerStatusMetricField<Counter64> displayPlanCacheLockWaits("query.planCache.lockWaits",
+                                                             &planCacheLockWaitsStats);
 
 }  // namespace
 
@@ -390,7 +212,7 @@ std::string PlanCacheEntry::toString() const {
 }
 
 std::string CachedSolution::toString() const {
-    return str::stream() << "key: " << key << '\n';
+    return str::stream() << "key: " << key.toString() << '\n';
 }
 
 //
@@ -473,144 +295,171 @@ std::string SolutionCacheData::toString() const {
 }
 
 //
-// PlanCache
+// PlanCache::Partition
 //
 
-PlanCache::PlanCache() : _cache(internalQueryCacheSize) {}
+/**
+ * A published cache entry. The entry itself is only modified under the exclusive partition lock,
+ * and readers which need it after releasing the lock keep the slot alive through a shared_ptr.
+ */
+struct PlanCache::Slot {
+    Slot(PlanCacheEntry* entry, unsigned long long tick) : entry(entry), lastUsed(tick) {}
+
+    const std::unique_ptr<PlanCacheEntry> entry;
 
-PlanCache::PlanCache(const std::string& ns) : _cache(internalQueryCacheSize), _ns(ns) {}
+    // Value of the cache's clock when the entry was last added or returned by a lookup.
+    AtomicUInt64 lastUsed;
+};
 
-PlanCache::~PlanCache() {}
+class PlanCache::Partition {
+    MONGO_DISALLOW_COPYING(Partition);
 
-/**
- * Traverses expression tree pre-order.
- * Appends an encoding of each node's match type and path name
- * to the output stream.
- */
-void PlanCache::encodeKeyForMatch(const MatchExpression* tree, StringBuilder* keyBuilder) const {
-    // Encode match type and path.
-    *keyBuilder << encodeMatchType(tree->matchType());
+public:
+    typedef std::unordered_map<PlanCacheKey, std::shared_ptr<Slot>, PlanCacheKey::Hasher> SlotMap;
 
-    encodeUserString(tree->path(), keyBuilder);
+    explicit Partition(size_t maxSize) : maxSize(maxSize), _lock("PlanCache::Partition") {}
 
-    // GEO and GEO_NEAR require additional encoding.
-    if (MatchExpression::GEO == tree->matchType()) {
-        encodeGeoMatchExpression(static_cast<const GeoMatchExpression*>(tree), keyBuilder);
-    } else if (MatchExpression::GEO_NEAR == tree->matchType()) {
-        encodeGeoNearMatchExpression(static_cast<const GeoNearMatchExpression*>(tree), keyBuilder);
-    }
+    /**
+     * Holds the partition lock in shared mode.
+     */
+    class SharedLock {
+        MONGO_DISALLOW_COPYING(SharedLock);
 
-    // Encode indexability.
-    const IndexabilityDiscriminators& discriminators =
-        _indexabilityState.getDiscriminators(tree->path());
-    if (!discriminators.empty()) {
-        *keyBuilder << kEncodeDiscriminatorsBegin;
-        // For each discriminator on this path, append the character '0' or '1'.
-        for (const IndexabilityDiscriminator& discriminator : discriminators) {
-            *keyBuilder << discriminator(tree);
+    public:
+        explicit SharedLock(Partition& partition) : _partition(partition) {
+            if (!_partition._lock.lock_shared_try(0)) {
+                _partition.recordLockWait();
+                _partition._lock.lock_shared();
+            }
         }
-        *keyBuilder << kEncodeDiscriminatorsEnd;
-    }
 
-    // Traverse child nodes.
-    // Enclose children in [].
-    if (tree->numChildren() > 0) {
-        *keyBuilder << kEncodeChildrenBegin;
-    }
-    // Use comma to separate children encoding.
-    for (size_t i = 0; i < tree->numChildren(); ++i) {
-        if (i > 0) {
-            *keyBuilder << kEncodeChildrenSeparator;
+        ~SharedLock() {
+            _partition._lock.unlock_shared();
         }
-        encodeKeyForMatch(tree->getChild(i), keyBuilder);
-    }
-    if (tree->numChildren() > 0) {
-        *keyBuilder << kEncodeChildrenEnd;
-    }
-}
 
-/**
- * Encodes sort order into cache key.
- * Sort order is normalized because it provided by
- * LiteParsedQuery.
- */
-void PlanCache::encodeKeyForSort(const BSONObj& sortObj, StringBuilder* keyBuilder) const {
-    if (sortObj.isEmpty()) {
-        return;
-    }
+    private:
+        Partition& _partition;
+    };
+
+    /**
+     * Holds the partition lock in exclusive mode.
+     */
+    class ExclusiveLock {
+        MONGO_DISALLOW_COPYING(ExclusiveLock);
+
+    public:
+        explicit ExclusiveLock(Partition& partition) : _partition(partition) {
+            if (!_partition._lock.lock_try(0)) {
+                _partition.recordLockWait();
+                _partition._lock.lock();
+            }
+        }
 
-    *keyBuilder << kEncodeSortSection;
+        ~ExclusiveLock() {
+            _partition._lock.unlock();
+        }
 
-    BSONObjIterator it(sortObj);
-    while (it.more()) {
-        BSONElement elt = it.next();
-        // $meta text score
-        if (LiteParsedQuery::isTextScoreMeta(elt)) {
-            *keyBuilder << "t";
+    private:
+        Partition& _partition;
+    };
+
+    /**
+     * Returns the slot for 'key', or nullptr, and marks it as used at tick 'now'.
+     * Requires the partition lock in at least shared mode.
+     */
+    std::shared_ptr<Slot> lookUp(const PlanCacheKey& key, unsigned long long now) {
+        SlotMap::const_iterator it = slots.find(key);
+        if (it == slots.end()) {
+            return nullptr;
         }
-        // Ascending
-        else if (elt.numberInt() == 1) {
-            *keyBuilder << "a";
+        // Avoid writing to the slot when concurrent lookups have already done so.
+        if (it->second->lastUsed.load() != now) {
+            it->second->lastUsed.store(now);
         }
-        // Descending
-        else {
-            *keyBuilder << "d";
+        return it->second;
+    }
+
+    /**
+     * Adds 'entry' at tick 'now', replacing any entry already cached for 'key'. If the partition
+     * grows beyond its maximum size, the least recently used other entry is removed and returned.
+     * Requires the partition lock in exclusive mode.
+     */
+    std::shared_ptr<Slot> add(const PlanCacheKey& key,
+                              PlanCacheEntry* entry,
+                              unsigned long long now) {
+        // Readers still holding the replaced slot keep it alive until they are done with it.
+        slots[key] = std::make_shared<Slot>(entry, now);
+        if (slots.size() <= maxSize) {
+            return nullptr;
         }
-        encodeUserString(elt.fieldName(), keyBuilder);
 
-        // Sort argument separator
-        if (it.more()) {
-            *keyBuilder << ",";
+        SlotMap::iterator victim = slots.end();
+        for (SlotMap::iterator it = slots.begin(); it != slots.end(); ++it) {
+            if (it->first != key &&
+                (victim == slots.end() ||
+                 it->second->lastUsed.load() < victim->second->lastUsed.load())) {
+                victim = it;
+            }
         }
+        invariant(victim != slots.end());
+
+        std::shared_ptr<Slot> evicted = std::move(victim->second);
+        slots.erase(victim);
+        return evicted;
     }
-}
 
-/**
- * Encodes parsed projection into cache key.
- * Does a simple toString() on each projected field
- * in the BSON object.
- * Orders the encoded elements in the projection by field name.
- * This handles all the special projection types ($meta, $elemMatch, etc.)
- */
-void PlanCache::encodeKeyForProj(const BSONObj& projObj, StringBuilder* keyBuilder) const {
-    // Sorts the BSON elements by field name using a map.
-    std::map<StringData, BSONElement> elements;
-
-    BSONObjIterator it(projObj);
-    while (it.more()) {
-        BSONElement elt = it.next();
-        StringData fieldName = elt.fieldNameStringData();
-
-        // Internal callers may add $-prefixed fields to the projection. These are not part of a
-        // user query, and therefore are not considered part of the cache key.
-        if (fieldName[0] == '$') {
-            continue;
-        }
+    const size_t maxSize;
+
+    SlotMap slots;
 
-        elements[fieldName] = elt;
+    AtomicUInt64 hits;
+    AtomicUInt64 misses;
+    AtomicUInt64 lockWaits;
+
+private:
+    void recordLockWait() {
+        lockWaits.fetchAndAdd(1);
+        planCacheLockWaitsStats.increment();
     }
 
-    if (!elements.empty()) {
-        *keyBuilder << kEncodeProjectionSection;
+    RWLock _lock;
+};
+
+//
+// PlanCache
+//
+
+PlanCache::PlanCache() : PlanCache("") {}
+
+PlanCache::PlanCache(const std::string& ns) : _ns(ns) {
+    const size_t maxSize = std::max(1, internalQueryCacheSize.load());
+    const size_t numPartitions = std::min(kMaxPlanCachePartitions, maxSize);
+    const size_t maxPartitionSize = (maxSize + numPartitions - 1) / numPartitions;
+    for (size_t i = 0; i < numPartitions; ++i) {
+        _partitions.push_back(stdx::make_unique<Partition>(maxPartitionSize));
     }
+}
 
-    // Read elements in order of field name
-    for (std::map<StringData, BSONElement>::const_iterator i = elements.begin();
-         i != elements.end();
-         ++i) {
-        const BSONElement& elt = (*i).second;
-
-        if (elt.isSimpleType()) {
-            // For inclusion/exclusion projections, we encode as "i" or "e".
-            *keyBuilder << (elt.trueValue() ? "i" : "e");
-        } else {
-            // For projection operators, we use the verbatim string encoding of the element.
-            encodeUserString(elt.toString(false,   // includeFieldName
-                                          false),  // full
-                             keyBuilder);
-        }
+PlanCache::~PlanCache() {}
+
+PlanCache::Partition& PlanCache::getPartition(const PlanCacheKey& key) const {
+    // Containers bucket by the low bits of the hash, so pick the partition from the high bits.
+    return *_partitions[(key.hash() >> 32) % _partitions.size()];
+}
+
+/**
+ * Traverses expression tree pre-order.
+ * For each discriminator on the path of each node, appends the character '0' or '1'.
+ */
+void PlanCache::encodeDiscriminators(const MatchExpression* tree, std::string* out) const {
+    const IndexabilityDiscriminators& discriminators =
+        _indexabilityState.getDiscriminators(tree->path());
+    for (const IndexabilityDiscriminator& discriminator : discriminators) {
+        out->push_back(discriminator(tree) ? '1' : '0');
+    }
 
-        encodeUserString(elt.fieldName(), keyBuilder);
+    for (size_t i = 0; i < tree->numChildren(); ++i) {
+        encodeDiscriminators(tree->getChild(i), out);
     }
 }
 
@@ -652,12 +501,18 @@ Status PlanCache::add(const CanonicalQuery& query,
     }
     entry->projection = projBuilder.obj();
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    std::unique_ptr<PlanCacheEntry> evictedEntry = _cache.add(computeKey(query), entry);
+    const PlanCacheKey key = computeKey(query);
+    Partition& partition = getPartition(key);
 
-    if (NULL != evictedEntry.get()) {
+    std::shared_ptr<Slot> evictedSlot;
+    {
+        Partition::ExclusiveLock lock(partition);
+        evictedSlot = partition.add(key, entry, _clock.addAndFetch(2));
+    }
+
+    if (evictedSlot) {
         LOG(1) << _ns << ": plan cache maximum size exceeded - "
-               << "removed least recently used entry " << evictedEntry->toString();
+               << "removed least recently used entry " << evictedSlot->entry->toString();
     }
 
     return Status::OK();
@@ -667,15 +522,24 @@ Status PlanCache::get(const CanonicalQuery& query, CachedSolution** crOut) const
     PlanCacheKey key = computeKey(query);
     verify(crOut);
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    PlanCacheEntry* entry;
-    Status cacheStatus = _cache.get(key, &entry);
-    if (!cacheStatus.isOK()) {
-        return cacheStatus;
+    Partition& partition = getPartition(key);
+    std::shared_ptr<Slot> slot;
+    {
+        Partition::SharedLock lock(partition);
+        slot = partition.lookUp(key, _clock.load() + 1);
+    }
+
+    if (!slot) {
+        partition.misses.fetchAndAdd(1);
+        planCacheMissesStats.increment();
+        return Status(ErrorCodes::NoSuchKey, "no such key in plan cache");
     }
-    invariant(entry);
+    partition.hits.fetchAndAdd(1);
+    planCacheHitsStats.increment();
 
-    *crOut = new CachedSolution(key, *entry);
+    // The planner data and query shape are never modified once the entry is published, so they
+    // can be copied without holding the partition lock.
+    *crOut = new CachedSolution(key, *slot->entry);
 
     return Status::OK();
 }
@@ -686,79 +550,134 @@ Status PlanCache::feedback(const CanonicalQuery& cq, PlanCacheEntryFeedback* fee
     }
     std::unique_ptr<PlanCacheEntryFeedback> autoFeedback(feedback);
     PlanCacheKey ck = computeKey(cq);
-
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    PlanCacheEntry* entry;
-    Status cacheStatus = _cache.get(ck, &entry);
-    if (!cacheStatus.isOK()) {
-        return cacheStatus;
+    Partition& partition = getPartition(ck);
+    const size_t maxFeedback = internalQueryCacheFeedbacksStored;
+
+    // We store up to a constant number of feedback entries. Once an entry has all of them, which
+    // is the common case, there is no need to take the partition lock exclusively.
+    {
+        Partition::SharedLock lock(partition);
+        std::shared_ptr<Slot> slot = partition.lookUp(ck, _clock.load() + 1);
+        if (!slot) {
+            return Status(ErrorCodes::NoSuchKey, "no such key in plan cache");
+        }
+        if (slot->entry->feedback.size() >= maxFeedback) {
+            return Status::OK();
+        }
     }
-    invariant(entry);
 
-    // We store up to a constant number of feedback entries.
-    if (entry->feedback.size() < size_t(internalQueryCacheFeedbacksStored)) {
-        entry->feedback.push_back(autoFeedback.release());
+    Partition::ExclusiveLock lock(partition);
+    std::shared_ptr<Slot> slot = partition.lookUp(ck, _clock.load() + 1);
+    if (!slot) {
+        return Status(ErrorCodes::NoSuchKey, "no such key in plan cache");
+    }
+    if (slot->entry->feedback.size() < maxFeedback) {
+        slot->entry->feedback.push_back(autoFeedback.release());
     }
 
     return Status::OK();
 }
 
 Status PlanCache::remove(const CanonicalQuery& canonicalQuery) {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    return _cache.remove(computeKey(canonicalQuery));
+    PlanCacheKey key = computeKey(canonicalQuery);
+    Partition& partition = getPartition(key);
+
+    Partition::ExclusiveLock lock(partition);
+    if (partition.slots.erase(key) == 0) {
+        return Status(ErrorCodes::NoSuchKey, "no such key in plan cache");
+    }
+    return Status::OK();
 }
 
 void PlanCache::clear() {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    _cache.clear();
+    for (auto& partition : _partitions) {
+        Partition::ExclusiveLock lock(*partition);
+        partition->slots.clear();
+    }
     _writeOperations.store(0);
 }
 
 PlanCacheKey PlanCache::computeKey(const CanonicalQuery& cq) const {
-    StringBuilder keyBuilder;
-    encodeKeyForMatch(cq.root(), &keyBuilder);
-    encodeKeyForSort(cq.getParsed().getSort(), &keyBuilder);
-    encodeKeyForProj(cq.getParsed().getProj(), &keyBuilder);
-    return keyBuilder.str();
+    // The shape of the query was encoded when it was canonicalized. Only the outcome of the
+    // discriminators, which depends on the indexes of this collection, remains to be computed.
+    const PlanCacheKey& shapeKey = cq.getPlanCacheKey();
+    if (!_indexabilityState.hasDiscriminators()) {
+        return shapeKey;
+    }
+
+    std::string discriminators;
+    encodeDiscriminators(cq.root(), &discriminators);
+    return shapeKey.withDiscriminators(std::move(discriminators));
 }
 
 Status PlanCache::getEntry(const CanonicalQuery& query, PlanCacheEntry** entryOut) const {
     PlanCacheKey key = computeKey(query);
     verify(entryOut);
 
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    PlanCacheEntry* entry;
-    Status cacheStatus = _cache.get(key, &entry);
-    if (!cacheStatus.isOK()) {
-        return cacheStatus;
+    Partition& partition = getPartition(key);
+
+    // The feedback of the entry may be appended to until we stop sharing the partition lock.
+    Partition::SharedLock lock(partition);
+    std::shared_ptr<Slot> slot = partition.lookUp(key, _clock.load() + 1);
+    if (!slot) {
+        return Status(ErrorCodes::NoSuchKey, "no such key in plan cache");
     }
-    invariant(entry);
 
-    *entryOut = entry->clone();
+    *entryOut = slot->entry->clone();
 
     return Status::OK();
 }
 
 std::vector<PlanCacheEntry*> PlanCache::getAllEntries() const {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
+    // Most recently used first.
+    std::vector<std::pair<unsigned long long, PlanCacheEntry*>> entriesByLastUse;
+    for (auto& partition : _partitions) {
+        Partition::SharedLock lock(*partition);
+        for (const auto& keyAndSlot : partition->slots) {
+            const Slot& slot = *keyAndSlot.second;
+            entriesByLastUse.emplace_back(slot.lastUsed.load(), slot.entry->clone());
+        }
+    }
+    std::stable_sort(entriesByLastUse.begin(),
+                     entriesByLastUse.end(),
+                     [](const std::pair<unsigned long long, PlanCacheEntry*>& lhs,
+                        const std::pair<unsigned long long, PlanCacheEntry*>& rhs) {
+                         return lhs.first > rhs.first;
+                     });
+
     std::vector<PlanCacheEntry*> entries;
-    typedef std::list<std::pair<PlanCacheKey, PlanCacheEntry*>>::const_iterator ConstIterator;
-    for (ConstIterator i = _cache.begin(); i != _cache.end(); i++) {
-        PlanCacheEntry* entry = i->second;
-        entries.push_back(entry->clone());
+    for (const auto& lastUseAndEntry : entriesByLastUse) {
+        entries.push_back(lastUseAndEntry.second);
     }
 
     return entries;
 }
 
 bool PlanCache::contains(const CanonicalQuery& cq) const {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    return _cache.hasKey(computeKey(cq));
+    PlanCacheKey key = computeKey(cq);
+    Partition& partition = getPartition(key);
+
+    Partition::SharedLock lock(partition);
+    return partition.slots.count(key) != 0;
 }
 
 size_t PlanCache::size() const {
-    stdx::lock_guard<stdx::mutex> cacheLock(_cacheMutex);
-    return _cache.size();
+    size_t size = 0;
+    for (auto& partition : _partitions) {
+        Partition::SharedLock lock(*partition);
+        size += partition->slots.size();
+    }
+    return size;
+}
+
+PlanCache::Stats PlanCache::getStats() const {
+    Stats stats;
+    for (auto& partition : _partitions) {
+        stats.hits += partition->hits.load();
+        stats.misses += partition->misses.load();
+        stats.lockWaits += partition->lockWaits.load();
+    }
+    return stats;
 }
 
 void PlanCache::notifyOfIndexEntries(const std::vector<IndexEntry>& indexEntries) {
@@ -28,23 +28,22 @@
 
 #pragma once
 
+#include <memory>
 #include <set>
 #include <boost/optional/optional.hpp>
+#include <vector>
 
 #include "mongo/db/exec/plan_stats.h"
 #include "mongo/db/query/canonical_query.h"
 #include "mongo/db/query/index_tag.h"
-#include "mongo/db/query/lru_key_value.h"
 #include "mongo/db/query/plan_cache_indexability.h"
+#include "mongo/db/query/plan_cache_key.h"
 #include "mongo/db/query/query_planner_params.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/mutex.h"
 
 namespace mongo {
 
-// A PlanCacheKey is a string-ified version of a query's predicate/projection/sort.
-typedef std::string PlanCacheKey;
-
 struct PlanRankingDecision;
 struct QuerySolution;
 struct QuerySolutionNode;
@@ -264,12 +263,28 @@ public:
  * mapping, the cache contains information on why that mapping was made and statistics on the
  * cache entry's actual performance on subsequent runs.
  *
+ * Entries are hashed by their key into partitions, each guarded by its own readers-writer lock.
+ * Lookups only share the partition lock, so they do not wait for each other, and the cached
+ * solution is copied out after the lock has been released. Eviction is least recently used per
+ * partition, based on a per-entry access tick rather than an ordered list.
  */
 class PlanCache {
 private:
     MONGO_DISALLOW_COPYING(PlanCache);
 
 public:
+    /**
+     * Usage counters of a plan cache, accumulated since it was created.
+     */
+    struct Stats {
+        // Lookups through get() which found, or did not find, an entry.
+        long long hits = 0;
+        long long misses = 0;
+
+        // Acquisitions of a partition lock which could not be granted immediately.
+        long long lockWaits = 0;
+    };
+
     /**
      * We don't want to cache every possible query. This function
      * encapsulates the criteria for what makes a canonical query
@@ -345,6 +360,9 @@ public:
      * This is provided in the public API simply as a convenience for consumers who need some
      * description of query shape (e.g. index filters).
      *
+     * Refines the key computed when the query was canonicalized, so this does not re-encode the
+     * query shape.
+     *
      * Callers must hold the collection lock when calling this method.
      */
     PlanCacheKey computeKey(const CanonicalQuery&) const;
@@ -380,6 +398,12 @@ public:
      */
     size_t size() const;
 
+    /**
+     * Returns the usage counters of this cache.
+     * Used by planCacheListQueryShapes.
+     */
+    Stats getStats() const;
+
     /**
      * Updates internal state kept about the collection's indexes.  Must be called when the set
      * of indexes on the associated collection have changed.
@@ -389,14 +413,20 @@ public:
     void notifyOfIndexEntries(const std::vector<IndexEntry>& indexEntries);
 
 private:
-    void encodeKeyForMatch(const MatchExpression* tree, StringBuilder* keyBuilder) const;
-    void encodeKeyForSort(const BSONObj& sortObj, StringBuilder* keyBuilder) const;
-    void encodeKeyForProj(const BSONObj& projObj, StringBuilder* keyBuilder) const;
+    void encodeDiscriminators(const MatchExpression* tree, std::string* out) const;
+
+    struct Slot;
+    class Partition;
+
+    Partition& getPartition(const PlanCacheKey& key) const;
 
-    LRUKeyValue<PlanCacheKey, PlanCacheEntry> _cache;
+    // Fixed at construction. Each partition holds at most its share of internalQueryCacheSize.
+    std::vector<std::unique_ptr<Partition>> _partitions;
 
-    // Protects _cache.
-    mutable stdx::mutex _cacheMutex;
+    // Advances by two on every add, which stamps the new entry with the new value. Lookups stamp
+    // the entry they find with the current value plus one, so that eviction can tell which
+    // entries have been used since the most recent adds.
+    AtomicUInt64 _clock;
 
     // Counter for write notifications since initialization or last clear() invocation.  Starts
     // at 0.
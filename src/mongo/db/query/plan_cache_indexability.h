@@ -63,6 +63,13 @@ public:
      */
     const IndexabilityDiscriminators& getDiscriminators(StringData path) const;
 
+    /**
+     * Returns true if discriminators are registered for any path.
+     */
+    bool hasDiscriminators() const {
+        return !_pathDiscriminatorsMap.empty();
+    }
+
     /**
      * Clears discriminators for all paths, and regenerate them from 'indexEntries'.
      */
@@ -0,0 +1,433 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kQuery
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/query/plan_cache_key.h"
+
+#include <map>
+#include <ostream>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/matcher/expression_geo.h"
+#include "mongo/db/query/lite_parsed_query.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/log.h"
+#include "third_party/murmurhash3/MurmurHash3.h"
+
+namespace mongo {
+namespace {
+
+// Delimiters for cache key encoding.
+const char kEncodeDiscriminatorsBegin = '<';
+const char kEncodeDiscriminatorsEnd = '>';
+const char kEncodeChildrenBegin = '[';
+const char kEncodeChildrenEnd = ']';
+const char kEncodeChildrenSeparator = ',';
+const char kEncodeSortSection = '~';
+const char kEncodeProjectionSection = '|';
+
+/**
+ * Encode user-provided string. Cache key delimiters seen in the
+ * user string are escaped with a backslash.
+ */
+void encodeUserString(StringData s, StringBuilder* keyBuilder) {
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        switch (c) {
+            case kEncodeDiscriminatorsBegin:
+            case kEncodeDiscriminatorsEnd:
+            case kEncodeChildrenBegin:
+            case kEncodeChildrenEnd:
+            case kEncodeChildrenSeparator:
+            case kEncodeSortSection:
+            case kEncodeProjectionSection:
+            case '\\':
+                *keyBuilder << '\\';
+            // Fall through to default case.
+            default:
+                *keyBuilder << c;
+        }
+    }
+}
+
+/**
+ * 2-character encoding of MatchExpression::MatchType.
+ */
+const char* encodeMatchType(MatchExpression::MatchType mt) {
+    switch (mt) {
+        case MatchExpression::AND:
+            return "an";
+            break;
+        case MatchExpression::OR:
+            return "or";
+            break;
+        case MatchExpression::NOR:
+            return "nr";
+            break;
+        case MatchExpression::NOT:
+            return "nt";
+            break;
+        case MatchExpression::ELEM_MATCH_OBJECT:
+            return "eo";
+            break;
+        case MatchExpression::ELEM_MATCH_VALUE:
+            return "ev";
+            break;
+        case MatchExpression::SIZE:
+            return "sz";
+            break;
+        case MatchExpression::LTE:
+            return "le";
+            break;
+        case MatchExpression::LT:
+            return "lt";
+            break;
+        case MatchExpression::EQ:
+            return "eq";
+            break;
+        case MatchExpression::GT:
+            return "gt";
+            break;
+        case MatchExpression::GTE:
+            return "ge";
+            break;
+        case MatchExpression::REGEX:
+            return "re";
+            break;
+        case MatchExpression::MOD:
+            return "mo";
+            break;
+        case MatchExpression::EXISTS:
+            return "ex";
+            break;
+        case MatchExpression::MATCH_IN:
+            return "in";
+            break;
+        case MatchExpression::TYPE_OPERATOR:
+            return "ty";
+            break;
+        case MatchExpression::GEO:
+            return "go";
+            break;
+        case MatchExpression::WHERE:
+            return "wh";
+            break;
+        case MatchExpression::ATOMIC:
+            return "at";
+            break;
+        case MatchExpression::ALWAYS_FALSE:
+            return "af";
+            break;
+        case MatchExpression::GEO_NEAR:
+            return "gn";
+            break;
+        case MatchExpression::TEXT:
+            return "te";
+            break;
+        case MatchExpression::BITS_ALL_SET:
+            return "ls";
+            break;
+        case MatchExpression::BITS_ALL_CLEAR:
+            return "lc";
+            break;
+        case MatchExpression::BITS_ANY_SET:
+            return "ys";
+            break;
+        case MatchExpression::BITS_ANY_CLEAR:
+            return "yc";
+            break;
+        default:
+            verify(0);
+            return "";
+    }
+}
+
+/**
+ * Encodes GEO match expression.
+ * Encoding includes:
+ * - type of geo query (within/intersect/near)
+ * - geometry type
+ * - CRS (flat or spherical)
+ */
+void encodeGeoMatchExpression(const GeoMatchExpression* tree, StringBuilder* keyBuilder) {
+    const GeoExpression& geoQuery = tree->getGeoExpression();
+
+    // Type of geo query.
+    switch (geoQuery.getPred()) {
+        case GeoExpression::WITHIN:
+            *keyBuilder << "wi";
+            break;
+        case GeoExpression::INTERSECT:
+            *keyBuilder << "in";
+            break;
+        case GeoExpression::INVALID:
+            *keyBuilder << "id";
+            break;
+    }
+
+    // Geometry type.
+    // Only one of the shared_ptrs in GeoContainer may be non-NULL.
+    *keyBuilder << geoQuery.getGeometry().getDebugType();
+
+    // CRS (flat or spherical)
+    if (FLAT == geoQuery.getGeometry().getNativeCRS()) {
+        *keyBuilder << "fl";
+    } else if (SPHERE == geoQuery.getGeometry().getNativeCRS()) {
+        *keyBuilder << "sp";
+    } else if (STRICT_SPHERE == geoQuery.getGeometry().getNativeCRS()) {
+        *keyBuilder << "ss";
+    } else {
+        error() << "unknown CRS type " << (int)geoQuery.getGeometry().getNativeCRS()
+                << " in geometry of type " << geoQuery.getGeometry().getDebugType();
+        invariant(false);
+    }
+}
+
+/**
+ * Encodes GEO_NEAR match expression.
+ * Encode:
+ * - isNearSphere
+ * - CRS (flat or spherical)
+ */
+void encodeGeoNearMatchExpression(const GeoNearMatchExpression* tree, StringBuilder* keyBuilder) {
+    const GeoNearExpression& nearQuery = tree->getData();
+
+    // isNearSphere
+    *keyBuilder << (nearQuery.isNearSphere ? "ns" : "nr");
+
+    // CRS (flat or spherical or strict-winding spherical)
+    switch (nearQuery.centroid->crs) {
+        case FLAT:
+            *keyBuilder << "fl";
+            break;
+        case SPHERE:
+            *keyBuilder << "sp";
+            break;
+        case STRICT_SPHERE:
+            *keyBuilder << "ss";
+            break;
+        case UNSET:
+            error() << "unknown CRS type " << (int)nearQuery.centroid->crs
+                    << " in point geometry for near query";
+            invariant(false);
+            break;
+    }
+}
+
+/**
+ * Traverses expression tree pre-order.
+ * Appends an encoding of each node's match type and path name
+ * to the output stream.
+ */
+void encodeKeyForMatch(const MatchExpression* tree, StringBuilder* keyBuilder) {
+    // Encode match type and path.
+    *keyBuilder << encodeMatchType(tree->matchType());
+
+    encodeUserString(tree->path(), keyBuilder);
+
+    // GEO and GEO_NEAR require additional encoding.
+    if (MatchExpression::GEO == tree->matchType()) {
+        encodeGeoMatchExpression(static_cast<const GeoMatchExpression*>(tree), keyBuilder);
+    } else if (MatchExpression::GEO_NEAR == tree->matchType()) {
+        encodeGeoNearMatchExpression(static_cast<const GeoNearMatchExpression*>(tree), keyBuilder);
+    }
+
+    // Traverse child nodes.
+    // Enclose children in [].
+    if (tree->numChildren() > 0) {
+        *keyBuilder << kEncodeChildrenBegin;
+    }
+    // Use comma to separate children encoding.
+    for (size_t i = 0; i < tree->numChildren(); ++i) {
+        if (i > 0) {
+            *keyBuilder << kEncodeChildrenSeparator;
+        }
+        encodeKeyForMatch(tree->getChild(i), keyBuilder);
+    }
+    if (tree->numChildren() > 0) {
+        *keyBuilder << kEncodeChildrenEnd;
+    }
+}
+
+/**
+ * Encodes sort order into cache key.
+ * Sort order is normalized because it provided by
+ * LiteParsedQuery.
+ */
+void encodeKeyForSort(const BSONObj& sortObj, StringBuilder* keyBuilder) {
+    if (sortObj.isEmpty()) {
+        return;
+    }
+
+    *keyBuilder << kEncodeSortSection;
+
+    BSONObjIterator it(sortObj);
+    while (it.more()) {
+        BSONElement elt = it.next();
+        // $meta text score
+        if (LiteParsedQuery::isTextScoreMeta(elt)) {
+            *keyBuilder << "t";
+        }
+        // Ascending
+        else if (elt.numberInt() == 1) {
+            *keyBuilder << "a";
+        }
+        // Descending
+        else {
+            *keyBuilder << "d";
+        }
+        encodeUserString(elt.fieldName(), keyBuilder);
+
+        // Sort argument separator
+        if (it.more()) {
+            *keyBuilder << ",";
+        }
+    }
+}
+
+/**
+ * Encodes parsed projection into cache key.
+ * Does a simple toString() on each projected field
+ * in the BSON object.
+ * Orders the encoded elements in the projection by field name.
+ * This handles all the special projection types ($meta, $elemMatch, etc.)
+ */
+void encodeKeyForProj(const BSONObj& projObj, StringBuilder* keyBuilder) {
+    // Sorts the BSON elements by field name using a map.
+    std::map<StringData, BSONElement> elements;
+
+    BSONObjIterator it(projObj);
+    while (it.more()) {
+        BSONElement elt = it.next();
+        StringData fieldName = elt.fieldNameStringData();
+
+        // Internal callers may add $-prefixed fields to the projection. These are not part of a
+        // user query, and therefore are not considered part of the cache key.
+        if (fieldName[0] == '$') {
+            continue;
+        }
+
+        elements[fieldName] = elt;
+    }
+
+    if (!elements.empty()) {
+        *keyBuilder << kEncodeProjectionSection;
+    }
+
+    // Read elements in order of field name
+    for (std::map<StringData, BSONElement>::const_iterator i = elements.begin();
+         i != elements.end();
+         ++i) {
+        const BSONElement& elt = (*i).second;
+
+        if (elt.isSimpleType()) {
+            // For inclusion/exclusion projections, we encode as "i" or "e".
+            *keyBuilder << (elt.trueValue() ? "i" : "e");
+        } else {
+            // For projection operators, we use the verbatim string encoding of the element.
+            encodeUserString(elt.toString(false,   // includeFieldName
+                                          false),  // full
+                             keyBuilder);
+        }
+
+        encodeUserString(elt.fieldName(), keyBuilder);
+    }
+}
+
+uint64_t hashBytes(const std::string& bytes, uint32_t seed) {
+    uint64_t hash[2];
+    MurmurHash3_x64_128(bytes.data(), bytes.size(), seed, hash);
+    return hash[0];
+}
+
+}  // namespace
+
+PlanCacheKey PlanCacheKey::encodeShape(const MatchExpression* root,
+                                       const BSONObj& sortObj,
+                                       const BSONObj& projObj) {
+    StringBuilder keyBuilder;
+    encodeKeyForMatch(root, &keyBuilder);
+    encodeKeyForSort(sortObj, &keyBuilder);
+    encodeKeyForProj(projObj, &keyBuilder);
+    return PlanCacheKey(keyBuilder.str());
+}
+
+PlanCacheKey::PlanCacheKey(std::string encoding)
+    : PlanCacheKey(std::make_shared<const std::string>(std::move(encoding)), std::string(), 0) {
+    _hash = hashBytes(*_shape, 0);
+}
+
+PlanCacheKey::PlanCacheKey(std::shared_ptr<const std::string> shape,
+                           std::string discriminators,
+                           uint64_t hash)
+    : _shape(std::move(shape)), _discriminators(std::move(discriminators)), _hash(hash) {}
+
+PlanCacheKey PlanCacheKey::withDiscriminators(std::string discriminators) const {
+    if (discriminators.empty()) {
+        return *this;
+    }
+    // Seeding with the shape hash keeps keys of different shapes with the same discriminator
+    // outcome from colliding.
+    const uint64_t hash = _hash ^ hashBytes(discriminators, static_cast<uint32_t>(_hash >> 32));
+    return PlanCacheKey(_shape, std::move(discriminators), hash);
+}
+
+bool PlanCacheKey::empty() const {
+    return (!_shape || _shape->empty()) && _discriminators.empty();
+}
+
+std::string PlanCacheKey::toString() const {
+    std::string encoding = _shape ? *_shape : std::string();
+    if (!_discriminators.empty()) {
+        encoding += kEncodeDiscriminatorsBegin;
+        encoding += _discriminators;
+        encoding += kEncodeDiscriminatorsEnd;
+    }
+    return encoding;
+}
+
+bool PlanCacheKey::operator==(const PlanCacheKey& other) const {
+    if (_hash != other._hash || _discriminators != other._discriminators) {
+        return false;
+    }
+    if (_shape == other._shape) {
+        return true;
+    }
+    const std::string empty;
+    return (_shape ? *_shape : empty) == (other._shape ? *other._shape : empty);
+}
+
+std::ostream& operator<<(std::ostream& stream, const PlanCacheKey& key) {
+    return stream << key.toString();
+}
+
+}  // namespace mongo
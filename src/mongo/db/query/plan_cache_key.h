@@ -0,0 +1,123 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+namespace mongo {
+
+class BSONObj;
+class MatchExpression;
+
+/**
+ * A PlanCacheKey identifies the shape of a query: the structure of its predicate, sort and
+ * projection, without the values they compare against. Two queries with equal keys can share a
+ * cached plan and the same index filters.
+ *
+ * The encoding of the shape is built once, when the query is canonicalized, and is shared by the
+ * keys copied from it. Keys also carry a 64-bit hash of their contents which is computed along
+ * with the encoding, so that hashing and comparing keys during cache lookups is cheap.
+ *
+ * The encoding is meaningful only within the lifetime of the process and should be treated as
+ * opaque by users.
+ */
+class PlanCacheKey {
+public:
+    /**
+     * Hash functor for unordered containers.
+     */
+    struct Hasher {
+        size_t operator()(const PlanCacheKey& key) const {
+            return static_cast<size_t>(key.hash());
+        }
+    };
+
+    /**
+     * Returns the key for the shape of a query with the given normalized expression tree, sort
+     * and projection.
+     */
+    static PlanCacheKey encodeShape(const MatchExpression* root,
+                                    const BSONObj& sortObj,
+                                    const BSONObj& projObj);
+
+    /**
+     * Constructs an empty key.
+     */
+    PlanCacheKey() = default;
+
+    /**
+     * Constructs a key with the given encoding.
+     */
+    explicit PlanCacheKey(std::string encoding);
+
+    /**
+     * Returns a key for the same shape, further distinguished by the outcome of the indexability
+     * discriminators of a collection. 'discriminators' holds one '0' or '1' for every
+     * discriminator applied, in pre-order of the expression tree. Returns a copy of this key if
+     * 'discriminators' is empty.
+     */
+    PlanCacheKey withDiscriminators(std::string discriminators) const;
+
+    uint64_t hash() const {
+        return _hash;
+    }
+
+    bool empty() const;
+
+    /**
+     * Returns the encoding of the key, for display and debugging.
+     */
+    std::string toString() const;
+
+    bool operator==(const PlanCacheKey& other) const;
+
+    bool operator!=(const PlanCacheKey& other) const {
+        return !(*this == other);
+    }
+
+private:
+    PlanCacheKey(std::shared_ptr<const std::string> shape,
+                 std::string discriminators,
+                 uint64_t hash);
+
+    // Encoding of the query shape. Null for an empty key.
+    std::shared_ptr<const std::string> _shape;
+
+    // Outcome of the indexability discriminators, usually empty.
+    std::string _discriminators;
+
+    uint64_t _hash = 0;
+};
+
+std::ostream& operator<<(std::ostream& stream, const PlanCacheKey& key);
+
+}  // namespace mongo
@@ -43,6 +43,7 @@
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/query/query_planner_test_lib.h"
 #include "mongo/db/query/query_solution.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/assert_util.h"
 
@@ -388,6 +389,144 @@ TEST(PlanCacheTest, AddValidSolution) {
     ASSERT_EQUALS(planCache.size(), 1U);
 }
 
+/**
+ * Adds a cache entry with a single solution for 'cq'.
+ */
+void addSingleSolution(PlanCache* planCache, const CanonicalQuery& cq) {
+    QuerySolution qs;
+    qs.cacheData.reset(new SolutionCacheData());
+    qs.cacheData->tree.reset(new PlanCacheIndexTree());
+    std::vector<QuerySolution*> solns;
+    solns.push_back(&qs);
+    ASSERT_OK(planCache->add(cq, solns, createDecision(1U)));
+}
+
+/**
+ * Sets internalQueryCacheSize for the lifetime of the object.
+ */
+class ScopedCacheSize {
+public:
+    explicit ScopedCacheSize(int size) : _oldSize(internalQueryCacheSize.load()) {
+        internalQueryCacheSize.store(size);
+    }
+
+    ~ScopedCacheSize() {
+        internalQueryCacheSize.store(_oldSize);
+    }
+
+private:
+    const int _oldSize;
+};
+
+TEST(PlanCacheTest, GetCountsHitsAndMisses) {
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> cachedQuery(canonicalize("{a: 1}"));
+    unique_ptr<CanonicalQuery> otherQuery(canonicalize("{b: 1}"));
+    addSingleSolution(&planCache, *cachedQuery);
+
+    CachedSolution* rawSolution;
+    ASSERT_OK(planCache.get(*cachedQuery, &rawSolution));
+    unique_ptr<CachedSolution> solution(rawSolution);
+    ASSERT_EQUALS(solution->plannerData.size(), 1U);
+    ASSERT_NOT_OK(planCache.get(*otherQuery, &rawSolution));
+
+    PlanCache::Stats stats = planCache.getStats();
+    ASSERT_EQUALS(stats.hits, 1);
+    ASSERT_EQUALS(stats.misses, 1);
+    ASSERT_EQUALS(stats.lockWaits, 0);
+}
+
+TEST(PlanCacheTest, SizeOneEvictsPreviousEntry) {
+    ScopedCacheSize cacheSize(1);
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> first(canonicalize("{a: 1}"));
+    unique_ptr<CanonicalQuery> second(canonicalize("{b: 1}"));
+
+    addSingleSolution(&planCache, *first);
+    addSingleSolution(&planCache, *second);
+    ASSERT_EQUALS(planCache.size(), 1U);
+    ASSERT_FALSE(planCache.contains(*first));
+    ASSERT_TRUE(planCache.contains(*second));
+}
+
+TEST(PlanCacheTest, EvictionKeepsEntriesInUse) {
+    const int kCacheSize = 32;
+    ScopedCacheSize cacheSize(kCacheSize);
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> hotQuery(canonicalize("{hot: 1}"));
+    addSingleSolution(&planCache, *hotQuery);
+
+    for (int i = 0; i < 10 * kCacheSize; ++i) {
+        const std::string field = str::stream() << "f" << i;
+        unique_ptr<CanonicalQuery> cq(canonicalize(BSON(field << 1)));
+        addSingleSolution(&planCache, *cq);
+        ASSERT_TRUE(planCache.contains(*cq));
+
+        CachedSolution* rawSolution;
+        ASSERT_OK(planCache.get(*hotQuery, &rawSolution));
+        delete rawSolution;
+    }
+
+    // Each partition holds its share of the cache size, rounded up.
+    ASSERT_LESS_THAN_OR_EQUALS(planCache.size(), size_t(kCacheSize));
+    ASSERT_GREATER_THAN_OR_EQUALS(planCache.size(), size_t(kCacheSize) / 2);
+}
+
+TEST(PlanCacheTest, GetAllEntriesMostRecentlyUsedFirst) {
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> first(canonicalize("{a: 1}"));
+    unique_ptr<CanonicalQuery> second(canonicalize("{b: 1}"));
+    addSingleSolution(&planCache, *first);
+    addSingleSolution(&planCache, *second);
+
+    CachedSolution* rawSolution;
+    ASSERT_OK(planCache.get(*first, &rawSolution));
+    delete rawSolution;
+
+    std::vector<PlanCacheEntry*> entries = planCache.getAllEntries();
+    ASSERT_EQUALS(entries.size(), 2U);
+    ASSERT_EQUALS(entries[0]->query, fromjson("{a: 1}"));
+    ASSERT_EQUALS(entries[1]->query, fromjson("{b: 1}"));
+    for (auto entry : entries) {
+        delete entry;
+    }
+}
+
+TEST(PlanCacheTest, ConcurrentLookupsAndUpdates) {
+    const int kReaders = 4;
+    const int kLookupsPerReader = 2000;
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> hotQuery(canonicalize("{hot: 1}"));
+    addSingleSolution(&planCache, *hotQuery);
+
+    std::vector<stdx::thread> readers;
+    for (int i = 0; i < kReaders; ++i) {
+        readers.emplace_back([&] {
+            for (int j = 0; j < kLookupsPerReader; ++j) {
+                CachedSolution* rawSolution;
+                ASSERT_OK(planCache.get(*hotQuery, &rawSolution));
+                delete rawSolution;
+            }
+        });
+    }
+
+    // Replace the hot entry and churn through other entries while the readers run.
+    for (int i = 0; i < 200; ++i) {
+        addSingleSolution(&planCache, *hotQuery);
+        const std::string field = str::stream() << "f" << i;
+        unique_ptr<CanonicalQuery> cq(canonicalize(BSON(field << 1)));
+        addSingleSolution(&planCache, *cq);
+        ASSERT_OK(planCache.remove(*cq));
+    }
+
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    ASSERT_EQUALS(planCache.getStats().hits, kReaders * kLookupsPerReader);
+    ASSERT_EQUALS(planCache.size(), 1U);
+}
+
 /**
  * Each test in the CachePlanSelectionTest suite goes through
  * the following flow:
@@ -695,7 +834,7 @@ protected:
     vector<QuerySolution*> solns;
 };
 
-const PlanCacheKey CachePlanSelectionTest::ck = "mock_cache_key";
+const PlanCacheKey CachePlanSelectionTest::ck("mock_cache_key");
 
 //
 // Equality
@@ -1053,8 +1192,8 @@ void testComputeKey(const char* queryStr,
         return;
     }
     str::stream ss;
-    ss << "Unexpected plan cache key. Expected: " << expectedKey << ". Actual: " << key
-       << ". Query: " << cq->toString();
+    ss << "Unexpected plan cache key. Expected: " << expectedKey.toString()
+       << ". Actual: " << key.toString() << ". Query: " << cq->toString();
     FAIL(ss);
 }
 
@@ -1150,6 +1289,40 @@ TEST(PlanCacheTest, ComputeKeyGeoNear) {
         "gnanrsp");
 }
 
+// Without indexability discriminators, computeKey() returns the key encoded when the query was
+// canonicalized, and queries of the same shape hash alike.
+TEST(PlanCacheTest, ComputeKeyUsesCanonicalQueryShape) {
+    PlanCache planCache;
+    unique_ptr<CanonicalQuery> cq(canonicalize("{a: 1, b: {$gt: 2}}", "{c: 1}", "{a: 1}"));
+    unique_ptr<CanonicalQuery> sameShape(canonicalize("{b: {$gt: 7}, a: 'x'}", "{c: 1}", "{a: 1}"));
+    unique_ptr<CanonicalQuery> otherShape(canonicalize("{a: 1, b: {$lt: 2}}", "{c: 1}", "{a: 1}"));
+
+    PlanCacheKey key = planCache.computeKey(*cq);
+    ASSERT_EQUALS(key, cq->getPlanCacheKey());
+    ASSERT_EQUALS(key.toString(), cq->getPlanCacheKey().toString());
+
+    ASSERT_EQUALS(key, planCache.computeKey(*sameShape));
+    ASSERT_EQUALS(key.hash(), planCache.computeKey(*sameShape).hash());
+    ASSERT_EQUALS(PlanCacheKey::Hasher()(key),
+                  PlanCacheKey::Hasher()(sameShape->getPlanCacheKey()));
+
+    ASSERT_NOT_EQUALS(key, planCache.computeKey(*otherShape));
+    ASSERT_NOT_EQUALS(key.hash(), planCache.computeKey(*otherShape).hash());
+}
+
+TEST(PlanCacheTest, PlanCacheKeyFromEncoding) {
+    PlanCacheKey empty;
+    ASSERT_TRUE(empty.empty());
+    ASSERT_EQUALS(empty, PlanCacheKey(""));
+
+    unique_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+    PlanCacheKey key(cq->getPlanCacheKey().toString());
+    ASSERT_FALSE(key.empty());
+    ASSERT_EQUALS(key, cq->getPlanCacheKey());
+    ASSERT_EQUALS(key.hash(), cq->getPlanCacheKey().hash());
+    ASSERT_NOT_EQUALS(key, empty);
+}
+
 // When a sparse index is present, computeKey() should generate different keys depending on
 // whether or not the predicates in the given query can use the index.
 TEST(PlanCacheTest, ComputeKeySparseIndex) {
@@ -1172,6 +1345,11 @@ TEST(PlanCacheTest, ComputeKeySparseIndex) {
 
     // 'cqEqNull' gets a different key, since it is not compatible with this index.
     ASSERT_NOT_EQUALS(planCache.computeKey(*cqEqNull), planCache.computeKey(*cqEqNumber));
+
+    // All three have the same shape, which the discriminators refine.
+    ASSERT_EQ(cqEqNull->getPlanCacheKey(), cqEqNumber->getPlanCacheKey());
+    ASSERT_NOT_EQUALS(planCache.computeKey(*cqEqNumber), cqEqNumber->getPlanCacheKey());
+    ASSERT_NOT_EQUALS(planCache.computeKey(*cqEqNull), cqEqNull->getPlanCacheKey());
 }
 
 // When a partial index is present, computeKey() should generate different keys depending on
@@ -1201,4 +1379,42 @@ TEST(PlanCacheTest, ComputeKeyPartialIndex) {
     ASSERT_NOT_EQUALS(planCache.computeKey(*cqGtNegativeFive), planCache.computeKey(*cqGtZero));
 }
 
+/**
+ * Builds a predicate which nests $or and $and 'depth' levels deep, with comparisons on distinct
+ * fields at every level.
+ */
+BSONObj deepOrAndPredicate(int depth) {
+    const std::string suffix = str::stream() << depth;
+    BSONObjBuilder conjunct;
+    conjunct.append("a" + suffix, 1);
+    conjunct.append("b" + suffix, BSON("$gt" << depth));
+    if (depth > 0) {
+        conjunct.append("$and",
+                        BSON_ARRAY(deepOrAndPredicate(depth - 1)
+                                   << BSON("c" + suffix << BSON("$in" << BSON_ARRAY(1 << 2)))));
+    }
+    BSONObj exists = BSON("e" + suffix << BSON("$exists" << true));
+    return BSON("$or" << BSON_ARRAY(conjunct.obj() << BSON("d" + suffix << BSON("$lt" << 5))
+                                                   << exists));
+}
+
+// The key computed from the shape encoded at canonicalization must match encoding the shape again,
+// also for deeply nested queries.
+TEST(PlanCacheTest, ComputeKeyMatchesEncodedShapeOfDeepQuery) {
+    unique_ptr<CanonicalQuery> cq(canonicalize(deepOrAndPredicate(6)));
+    PlanCache planCache;
+
+    PlanCacheKey encodedKey = PlanCacheKey::encodeShape(
+        cq->root(), cq->getParsed().getSort(), cq->getParsed().getProj());
+    PlanCacheKey computedKey = planCache.computeKey(*cq);
+
+    ASSERT_EQ(encodedKey, computedKey);
+    ASSERT_EQUALS(encodedKey.hash(), computedKey.hash());
+    ASSERT_EQUALS(encodedKey.toString(), computedKey.toString());
+
+    // A shallower query has a different shape
+    unique_ptr<CanonicalQuery> cqShallow(canonicalize(deepOrAndPredicate(5)));
+    ASSERT_NOT_EQUALS(computedKey, planCache.computeKey(*cqShallow));
+}
+
 }  // namespace
@@ -66,4 +66,8 @@ MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecMaxBlockingSortBytes, int, 32 * 1
 MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecYieldIterations, int, 128);
 MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecYieldPeriodMS, int, 10);
 
+MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecCollectionScanBatchSize, int, 64);
+
+MONGO_EXPORT_SERVER_PARAMETER(internalQueryShapeStatsMaxShapes, int, 1000);
+
 }  // namespace mongo
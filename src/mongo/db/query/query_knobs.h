@@ -105,6 +105,19 @@ extern std::atomic<int> internalQueryExecYieldIterations;  // NOLINT
 // Yield if it's been at least this many milliseconds since we last yielded.
 extern std::atomic<int> internalQueryExecYieldPeriodMS;  // NOLINT
 
+// How many documents a filtered collection scan reads ahead so it can apply its filter to all of
+// them at once. The scan cannot yield while it reads a batch. A value of 1 or less disables
+// batching.
+extern std::atomic<int> internalQueryExecCollectionScanBatchSize;  // NOLINT
+
+//
+// Query shape statistics.
+//
+
+// How many query shapes are tracked by the query shape statistics. Each of its stripes holds its
+// share of the shapes, so fewer may be tracked when shapes are unevenly spread. 0 disables them.
+extern std::atomic<int> internalQueryShapeStatsMaxShapes;  // NOLINT
+
 // Limit the size that we write without yielding to 16MB / 64 (max expected number of indexes)
 const int64_t insertVectorMaxBytes = 256 * 1024;
 
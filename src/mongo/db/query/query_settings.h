@@ -139,7 +139,8 @@ private:
      */
     void _clear();
 
-    typedef unordered_map<PlanCacheKey, AllowedIndexEntry*> AllowedIndexEntryMap;
+    typedef unordered_map<PlanCacheKey, AllowedIndexEntry*, PlanCacheKey::Hasher>
+        AllowedIndexEntryMap;
     AllowedIndexEntryMap _allowedIndexEntryMap;
 
     /**
@@ -39,6 +39,36 @@
 namespace mongo {
 namespace repl {
 
+std::string CollectionCloner::Stats::toString() const {
+    return toBSON().toString();
+}
+
+BSONObj CollectionCloner::Stats::toBSON() const {
+    BSONObjBuilder bob;
+    append(&bob);
+    return bob.obj();
+}
+
+void CollectionCloner::Stats::append(BSONObjBuilder* builder) const {
+    builder->append("ns", ns);
+    builder->appendNumber("indexes", static_cast<long long>(indexes));
+    builder->appendNumber("documentsCopied", static_cast<long long>(documentsCopied));
+    builder->appendNumber("bytesCopied", bytesCopied);
+    builder->appendNumber("fetchedBatches", static_cast<long long>(fetchedBatches));
+    if (start != Date_t()) {
+        builder->appendDate("start", start);
+        if (end != Date_t()) {
+            builder->appendDate("end", end);
+            const long long elapsedMillis = durationCount<Milliseconds>(end - start);
+            builder->appendNumber("elapsedMillis", elapsedMillis);
+            if (elapsedMillis > 0) {
+                builder->append("documentsPerSecond",
+                                documentsCopied * 1000.0 / static_cast<double>(elapsedMillis));
+            }
+        }
+    }
+}
+
 CollectionCloner::CollectionCloner(ReplicationExecutor* executor,
                                    const HostAndPort& source,
                                    const NamespaceString& sourceNss,
@@ -74,6 +104,7 @@ CollectionCloner::CollectionCloner(ReplicationExecutor* executor,
       _indexSpecs(),
       _documents(),
       _dbWorkCallbackHandle(),
+      _stats(),
       _scheduleDbWorkFn([this](const ReplicationExecutor::CallbackFn& work) {
           return _executor->scheduleDBWork(work);
       }) {
@@ -84,6 +115,7 @@ CollectionCloner::CollectionCloner(ReplicationExecutor* executor,
     uassertStatusOK(options.validate());
     uassert(ErrorCodes::BadValue, "callback function cannot be null", onCompletion);
     uassert(ErrorCodes::BadValue, "null storage interface", storageInterface);
+    _stats.ns = _sourceNss.ns();
 }
 
 CollectionCloner::~CollectionCloner() {
@@ -94,6 +126,11 @@ const NamespaceString& CollectionCloner::getSourceNamespace() const {
     return _sourceNss;
 }
 
+CollectionCloner::Stats CollectionCloner::getStats() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _stats;
+}
+
 std::string CollectionCloner::getDiagnosticString() const {
     stdx::lock_guard<stdx::mutex> lk(_mutex);
     str::stream output;
@@ -108,6 +145,7 @@ std::string CollectionCloner::getDiagnosticString() const {
     output << " find fetcher: " << _findFetcher.getDiagnosticString();
     output << " database worked callback handle: " << (_dbWorkCallbackHandle.isValid() ? "valid"
                                                                                        : "invalid");
+    output << " stats: " << _stats.toString();
     return output;
 }
 
@@ -129,6 +167,7 @@ Status CollectionCloner::start() {
     }
 
     _active = true;
+    _stats.start = _executor->now();
 
     return Status::OK();
 }
@@ -209,6 +248,11 @@ void CollectionCloner::_listIndexesCallback(const Fetcher::QueryResponseStatus&
         return;
     }
 
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _stats.indexes = _indexSpecs.size();
+    }
+
     // We have all of the indexes now, so we can start cloning the collection data.
     auto&& scheduleResult = _scheduleDbWorkFn(
         stdx::bind(&CollectionCloner::_beginCollectionCallback, this, stdx::placeholders::_1));
@@ -282,6 +326,15 @@ void CollectionCloner::_insertDocumentsCallback(const ReplicationExecutor::Callb
         return;
     }
 
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _stats.fetchedBatches++;
+        _stats.documentsCopied += _documents.size();
+        for (auto&& doc : _documents) {
+            _stats.bytesCopied += doc.objsize();
+        }
+    }
+
     if (!lastBatch) {
         return;
     }
@@ -297,6 +350,10 @@ void CollectionCloner::_finishCallback(OperationContext* txn, const Status& stat
                       << commitStatus;
         }
     }
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _stats.end = _executor->now();
+    }
     _onCompletion(status);
     stdx::lock_guard<stdx::mutex> lk(_mutex);
     _active = false;
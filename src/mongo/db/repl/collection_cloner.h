@@ -44,6 +44,7 @@
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/util/net/hostandport.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 namespace repl {
@@ -69,6 +70,24 @@ public:
     using ScheduleDbWorkFn = stdx::function<StatusWith<ReplicationExecutor::CallbackHandle>(
         const ReplicationExecutor::CallbackFn&)>;
 
+    /**
+     * Progress of the collection cloner, as reported by getStats().
+     */
+    struct Stats {
+        std::string toString() const;
+        BSONObj toBSON() const;
+        void append(BSONObjBuilder* builder) const;
+
+        std::string ns;
+        // Set when the cloner is started and when it completes, respectively.
+        Date_t start;
+        Date_t end;
+        size_t indexes{0};
+        size_t documentsCopied{0};
+        long long bytesCopied{0};
+        size_t fetchedBatches{0};
+    };
+
     /**
      * Creates CollectionCloner task in inactive state. Use start() to activate cloner.
      *
@@ -89,6 +108,11 @@ public:
 
     const NamespaceString& getSourceNamespace() const;
 
+    /**
+     * Returns a snapshot of the cloning progress. May be called at any time.
+     */
+    Stats getStats() const;
+
     std::string getDiagnosticString() const override;
 
     bool isActive() const override;
@@ -195,6 +219,9 @@ private:
     // Callback handle for database worker.
     ReplicationExecutor::CallbackHandle _dbWorkCallbackHandle;
 
+    // Cloning progress. Protected by _mutex.
+    Stats _stats;
+
     // Function for scheduling database work using the executor.
     ScheduleDbWorkFn _scheduleDbWorkFn;
 };
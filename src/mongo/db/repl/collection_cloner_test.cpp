@@ -489,4 +489,46 @@ TEST_F(CollectionClonerTest, InsertDocumentsMultipleBatches) {
     ASSERT_FALSE(collectionCloner->isActive());
 }
 
+TEST_F(CollectionClonerTest, StatsTrackProgressAcrossBatches) {
+    ASSERT_OK(collectionCloner->start());
+
+    auto stats = collectionCloner->getStats();
+    ASSERT_EQUALS(nss.ns(), stats.ns);
+    ASSERT_NOT_EQUALS(Date_t(), stats.start);
+    ASSERT_EQUALS(Date_t(), stats.end);
+
+    processNetworkResponse(createListIndexesResponse(0, BSON_ARRAY(idIndexSpec)));
+
+    collectionCloner->waitForDbWorker();
+
+    const BSONObj doc = BSON("_id" << 1);
+    const BSONObj doc2 = BSON("_id" << 2);
+    processNetworkResponse(createCursorResponse(1, BSON_ARRAY(doc << doc2)));
+
+    collectionCloner->waitForDbWorker();
+    stats = collectionCloner->getStats();
+    ASSERT_EQUALS(1U, stats.indexes);
+    ASSERT_EQUALS(2U, stats.documentsCopied);
+    ASSERT_EQUALS(doc.objsize() + doc2.objsize(), stats.bytesCopied);
+    ASSERT_EQUALS(1U, stats.fetchedBatches);
+    ASSERT_EQUALS(Date_t(), stats.end);
+
+    const BSONObj doc3 = BSON("_id" << 3);
+    processNetworkResponse(createCursorResponse(0, BSON_ARRAY(doc3), "nextBatch"));
+
+    collectionCloner->waitForDbWorker();
+    ASSERT_OK(getStatus());
+    ASSERT_FALSE(collectionCloner->isActive());
+
+    stats = collectionCloner->getStats();
+    ASSERT_EQUALS(3U, stats.documentsCopied);
+    ASSERT_EQUALS(2U, stats.fetchedBatches);
+    ASSERT_NOT_EQUALS(Date_t(), stats.end);
+
+    const BSONObj statsObj = stats.toBSON();
+    ASSERT_EQUALS(nss.ns(), statsObj["ns"].str());
+    ASSERT_EQUALS(3, statsObj["documentsCopied"].numberLong());
+    ASSERT_TRUE(statsObj.hasField("elapsedMillis"));
+}
+
 }  // namespace
@@ -69,6 +69,9 @@ namespace {
 // Limit buffer to 256MB
 const size_t kOplogBufferSize = 256 * 1024 * 1024;
 
+// Number of collections of a database which initial sync clones at the same time.
+const size_t kMaxConcurrentCollectionCloners = 4;
+
 size_t getSize(const BSONObj& o) {
     // SERVER-9808 Avoid Fortify complaint about implicit signed->unsigned conversion
     return static_cast<size_t>(o.objsize());
@@ -443,6 +446,7 @@ void DatabasesCloner::_onListDatabaseFinish(const CommandCallbackArgs& cbd) {
                         }
                     },
                     [=](const Status& status) { _onEachDBCloneFinish(status, name); }));
+                dbCloner->setMaxConcurrentCollectionCloners(kMaxConcurrentCollectionCloners);
             } catch (...) {
                 // error creating, fails below.
             }
@@ -117,6 +117,16 @@ const std::vector<BSONObj>& DatabaseCloner::getCollectionInfos() const {
     return _collectionInfos;
 }
 
+std::vector<CollectionCloner::Stats> DatabaseCloner::getStats() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    std::vector<CollectionCloner::Stats> stats;
+    stats.reserve(_collectionCloners.size());
+    for (auto&& collectionCloner : _collectionCloners) {
+        stats.push_back(collectionCloner.getStats());
+    }
+    return stats;
+}
+
 std::string DatabaseCloner::getDiagnosticString() const {
     stdx::lock_guard<stdx::mutex> lk(_mutex);
     str::stream output;
@@ -128,6 +138,8 @@ std::string DatabaseCloner::getDiagnosticString() const {
     output << " active: " << _active;
     output << " collection info objects (empty if listCollections is in progress): "
            << _collectionInfos.size();
+    output << " max concurrent collection cloners: " << _maxConcurrentCollectionCloners;
+    output << " active collection cloners: " << _activeCollectionCloners;
     return output;
 }
 
@@ -181,6 +193,13 @@ void DatabaseCloner::setStartCollectionClonerFn(
     _startCollectionCloner = startCollectionCloner;
 }
 
+void DatabaseCloner::setMaxConcurrentCollectionCloners(size_t maxConcurrentCollectionCloners) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    invariant(!_active);
+    invariant(maxConcurrentCollectionCloners > 0);
+    _maxConcurrentCollectionCloners = maxConcurrentCollectionCloners;
+}
+
 void DatabaseCloner::_listCollectionsCallback(const StatusWith<Fetcher::QueryResponse>& result,
                                               Fetcher::NextAction* nextAction,
                                               BSONObjBuilder* getMoreBob) {
@@ -266,6 +285,7 @@ void DatabaseCloner::_listCollectionsCallback(const StatusWith<Fetcher::QueryRes
         auto&& nss = *_collectionNamespaces.crbegin();
 
         try {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
             _collectionCloners.emplace_back(
                 _executor,
                 _source,
@@ -284,18 +304,12 @@ void DatabaseCloner::_listCollectionsCallback(const StatusWith<Fetcher::QueryRes
         collectionCloner.setScheduleDbWorkFn(_scheduleDbWorkFn);
     }
 
-    // Start first collection cloner.
-    _currentCollectionClonerIter = _collectionCloners.begin();
-
-    LOG(1) << "    cloning collection " << _currentCollectionClonerIter->getSourceNamespace();
-
-    Status startStatus = _startCollectionCloner(*_currentCollectionClonerIter);
-    if (!startStatus.isOK()) {
-        LOG(1) << "    failed to start collection cloning on "
-               << _currentCollectionClonerIter->getSourceNamespace() << ": " << startStatus;
-        _finishCallback(startStatus);
-        return;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _nextCollectionClonerIter = _collectionCloners.begin();
     }
+
+    _startCollectionCloners();
 }
 
 void DatabaseCloner::_collectionClonerCallback(const Status& status, const NamespaceString& nss) {
@@ -304,22 +318,63 @@ void DatabaseCloner::_collectionClonerCallback(const Status& status, const Names
     // from cloning the rest of the collections in the listCollections result.
     _collectionWork(status, nss);
 
-    _currentCollectionClonerIter++;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        invariant(_activeCollectionCloners > 0);
+        _activeCollectionCloners--;
+    }
+
+    _startCollectionCloners();
+}
+
+void DatabaseCloner::_startCollectionCloners() {
+    while (true) {
+        CollectionCloner* collectionCloner = nullptr;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+            const bool canStartMore = _startCollectionClonerStatus.isOK() &&
+                _nextCollectionClonerIter != _collectionCloners.end();
+            if (!canStartMore) {
+                // The last collection cloner to finish reports completion, exactly once.
+                if (_activeCollectionCloners > 0 || _collectionClonersDone) {
+                    return;
+                }
+                _collectionClonersDone = true;
+                break;
+            }
+
+            if (_activeCollectionCloners >= _maxConcurrentCollectionCloners) {
+                return;
+            }
+
+            // Count the cloner as active before starting it, so that a concurrently finishing
+            // cloner does not report completion.
+            collectionCloner = &*_nextCollectionClonerIter++;
+            _activeCollectionCloners++;
+        }
 
-    LOG(1) << "    cloning collection " << _currentCollectionClonerIter->getSourceNamespace();
+        LOG(1) << "    cloning collection " << collectionCloner->getSourceNamespace();
 
-    if (_currentCollectionClonerIter != _collectionCloners.end()) {
-        Status startStatus = _startCollectionCloner(*_currentCollectionClonerIter);
+        Status startStatus = _startCollectionCloner(*collectionCloner);
         if (!startStatus.isOK()) {
             LOG(1) << "    failed to start collection cloning on "
-                   << _currentCollectionClonerIter->getSourceNamespace() << ": " << startStatus;
-            _finishCallback(startStatus);
-            return;
+                   << collectionCloner->getSourceNamespace() << ": " << startStatus;
+
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _activeCollectionCloners--;
+            if (_startCollectionClonerStatus.isOK()) {
+                _startCollectionClonerStatus = startStatus;
+            }
         }
-        return;
     }
 
-    _finishCallback(Status::OK());
+    Status status = Status::OK();
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        status = _startCollectionClonerStatus;
+    }
+    _finishCallback(status);
 }
 
 void DatabaseCloner::_finishCallback(const Status& status) {
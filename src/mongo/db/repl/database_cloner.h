@@ -105,6 +105,11 @@ public:
      */
     const std::vector<BSONObj>& getCollectionInfos() const;
 
+    /**
+     * Returns the progress of every collection cloner created so far.
+     */
+    std::vector<CollectionCloner::Stats> getStats() const;
+
     std::string getDiagnosticString() const override;
 
     bool isActive() const override;
@@ -133,6 +138,12 @@ public:
      */
     void setStartCollectionClonerFn(const StartCollectionClonerFn& startCollectionCloner);
 
+    /**
+     * Limits the number of collections cloned at the same time. Defaults to 1, which clones the
+     * collections one after another in listCollections order. Must be called before start().
+     */
+    void setMaxConcurrentCollectionCloners(size_t maxConcurrentCollectionCloners);
+
 private:
     /**
      * Read collection names and options from listCollections result.
@@ -147,6 +158,12 @@ private:
      */
     void _collectionClonerCallback(const Status& status, const NamespaceString& nss);
 
+    /**
+     * Starts collection cloners until the concurrency limit is reached or there are no more
+     * collections to clone. Reports completion once the last collection cloner has finished.
+     */
+    void _startCollectionCloners();
+
     /**
      * Reports completion status.
      * Sets cloner to inactive.
@@ -191,7 +208,21 @@ private:
     std::vector<NamespaceString> _collectionNamespaces;
 
     std::list<CollectionCloner> _collectionCloners;
-    std::list<CollectionCloner>::iterator _currentCollectionClonerIter;
+
+    // Next collection cloner to start. Protected by _mutex once the cloners have been created.
+    std::list<CollectionCloner>::iterator _nextCollectionClonerIter;
+
+    // Number of collection cloners started but not yet finished. Protected by _mutex.
+    size_t _activeCollectionCloners{0};
+
+    // Failure to start a collection cloner. Once set, no further cloners are started and it
+    // becomes the completion status when the running ones have finished. Protected by _mutex.
+    Status _startCollectionClonerStatus = Status::OK();
+
+    // Set once the completion of the collection cloners has been reported. Protected by _mutex.
+    bool _collectionClonersDone{false};
+
+    size_t _maxConcurrentCollectionCloners{1};
 
     // Function for scheduling database work using the executor.
     CollectionCloner::ScheduleDbWorkFn _scheduleDbWorkFn;
@@ -529,4 +529,124 @@ TEST_F(DatabaseClonerTest, CreateCollections) {
     }
 }
 
+TEST_F(DatabaseClonerTest, CreateCollectionsConcurrently) {
+    databaseCloner->setMaxConcurrentCollectionCloners(2U);
+    ASSERT_OK(databaseCloner->start());
+
+    // Replace scheduleDbWork function so that all callbacks (including exclusive tasks)
+    // will run through network interface.
+    auto&& executor = getReplExecutor();
+    databaseCloner->setScheduleDbWorkFn([&](const ReplicationExecutor::CallbackFn& workFn) {
+        return executor.scheduleWork(workFn);
+    });
+
+    processNetworkResponse(createListCollectionsResponse(0,
+                                                         BSON_ARRAY(BSON("name"
+                                                                         << "a"
+                                                                         << "options" << BSONObj())
+                                                                    << BSON("name"
+                                                                            << "b"
+                                                                            << "options"
+                                                                            << BSONObj())
+                                                                    << BSON("name"
+                                                                            << "c"
+                                                                            << "options"
+                                                                            << BSONObj()))));
+
+    // Responds to the next request after checking that it is 'command' on collection 'coll'.
+    auto net = getNet();
+    auto processRequest = [&](const std::string& command,
+                              const std::string& coll,
+                              const BSONObj& response) {
+        ASSERT_TRUE(net->hasReadyRequests());
+        NetworkOperationIterator noi = net->getNextReadyRequest();
+        auto&& noiRequest = noi->getRequest();
+        ASSERT_EQUALS(command, std::string(noiRequest.cmdObj.firstElementFieldName()));
+        ASSERT_EQUALS(coll, noiRequest.cmdObj.firstElement().str());
+        scheduleNetworkResponse(noi, response);
+        finishProcessingNetworkResponse();
+    };
+
+    // Collections 'a' and 'b' are cloned at the same time. Collection 'c' is not started until
+    // one of them has finished.
+    processRequest("listIndexes", "a", createListIndexesResponse(0, BSON_ARRAY(idIndexSpec)));
+    processRequest("listIndexes", "b", createListIndexesResponse(0, BSON_ARRAY(idIndexSpec)));
+    processRequest("find", "a", createCursorResponse(0, BSONArray()));
+    ASSERT_TRUE(databaseCloner->isActive());
+
+    processRequest("find", "b", createCursorResponse(0, BSONArray()));
+    processRequest("listIndexes", "c", createListIndexesResponse(0, BSON_ARRAY(idIndexSpec)));
+    processRequest("find", "c", createCursorResponse(0, BSONArray()));
+
+    ASSERT_OK(getStatus());
+    ASSERT_FALSE(databaseCloner->isActive());
+
+    ASSERT_EQUALS(3U, collectionWorkResults.size());
+    {
+        auto i = collectionWorkResults.cbegin();
+        ASSERT_OK(i->first);
+        ASSERT_EQUALS(i->second.ns(), NamespaceString(dbname, "a").ns());
+        i++;
+        ASSERT_OK(i->first);
+        ASSERT_EQUALS(i->second.ns(), NamespaceString(dbname, "b").ns());
+        i++;
+        ASSERT_OK(i->first);
+        ASSERT_EQUALS(i->second.ns(), NamespaceString(dbname, "c").ns());
+    }
+
+    const auto stats = databaseCloner->getStats();
+    ASSERT_EQUALS(3U, stats.size());
+    ASSERT_EQUALS(NamespaceString(dbname, "c").ns(), stats[2].ns);
+    ASSERT_EQUALS(1U, stats[2].indexes);
+    ASSERT_NOT_EQUALS(Date_t(), stats[2].end);
+}
+
+TEST_F(DatabaseClonerTest, StartCollectionClonerFailedWhileOtherClonerActive) {
+    databaseCloner->setMaxConcurrentCollectionCloners(2U);
+    ASSERT_OK(databaseCloner->start());
+
+    // Replace scheduleDbWork function so that all callbacks (including exclusive tasks)
+    // will run through network interface.
+    auto&& executor = getReplExecutor();
+    databaseCloner->setScheduleDbWorkFn([&](const ReplicationExecutor::CallbackFn& workFn) {
+        return executor.scheduleWork(workFn);
+    });
+
+    databaseCloner->setStartCollectionClonerFn([](CollectionCloner& cloner) {
+        if (cloner.getSourceNamespace().coll() == "b") {
+            return Status(ErrorCodes::OperationFailed, "");
+        }
+        return cloner.start();
+    });
+
+    processNetworkResponse(createListCollectionsResponse(0,
+                                                         BSON_ARRAY(BSON("name"
+                                                                         << "a"
+                                                                         << "options" << BSONObj())
+                                                                    << BSON("name"
+                                                                            << "b"
+                                                                            << "options"
+                                                                            << BSONObj())
+                                                                    << BSON("name"
+                                                                            << "c"
+                                                                            << "options"
+                                                                            << BSONObj()))));
+
+    // The database cloner waits for the cloner of collection 'a' before reporting the failure and
+    // does not start the cloner of collection 'c'.
+    ASSERT_EQUALS(getDetectableErrorStatus(), getStatus());
+    ASSERT_TRUE(databaseCloner->isActive());
+
+    processNetworkResponse(createListIndexesResponse(0, BSON_ARRAY(idIndexSpec)));
+    processNetworkResponse(createCursorResponse(0, BSONArray()));
+
+    ASSERT_EQUALS(ErrorCodes::OperationFailed, getStatus().code());
+    ASSERT_FALSE(databaseCloner->isActive());
+    ASSERT_FALSE(getNet()->hasReadyRequests());
+
+    ASSERT_EQUALS(1U, collectionWorkResults.size());
+    ASSERT_OK(collectionWorkResults.front().first);
+    ASSERT_EQUALS(NamespaceString(dbname, "a").ns(), collectionWorkResults.front().second.ns());
+}
+
 }  // namespace
@@ -0,0 +1,115 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/repl/oplog_dependency_graph.h"
+
+#include <algorithm>
+
+#include "mongo/platform/unordered_map.h"
+
+namespace mongo {
+namespace repl {
+
+OplogDependencyGraph::OplogDependencyGraph(const std::vector<uint32_t>& conflictKeys) {
+    const size_t numOps = conflictKeys.size();
+
+    // Assign every operation to the chain of its conflict key, in order of first appearance.
+    std::vector<size_t> chainOfOp(numOps);
+    std::vector<size_t> chainLength;
+    unordered_map<uint32_t, size_t> chainOfKey;
+    chainOfKey.reserve(numOps);
+    for (size_t i = 0; i < numOps; ++i) {
+        auto inserted = chainOfKey.emplace(conflictKeys[i], chainLength.size());
+        if (inserted.second) {
+            chainLength.push_back(0);
+        }
+        chainOfOp[i] = inserted.first->second;
+        ++chainLength[chainOfOp[i]];
+    }
+
+    // Lay the chains out longest-first. The sort is stable so that equally long chains keep
+    // their oplog order, which keeps the layout deterministic.
+    const size_t numChains = chainLength.size();
+    std::vector<size_t> chainsByLength(numChains);
+    for (size_t chain = 0; chain < numChains; ++chain) {
+        chainsByLength[chain] = chain;
+    }
+    std::stable_sort(chainsByLength.begin(),
+                     chainsByLength.end(),
+                     [&](size_t lhs, size_t rhs) { return chainLength[lhs] > chainLength[rhs]; });
+
+    std::vector<size_t> chainOffset(numChains);
+    _chainBegin.reserve(numChains + 1);
+    size_t offset = 0;
+    for (auto chain : chainsByLength) {
+        _chainBegin.push_back(offset);
+        chainOffset[chain] = offset;
+        offset += chainLength[chain];
+    }
+    _chainBegin.push_back(offset);
+
+    // Scatter the operations into their chains. Iterating in oplog order preserves the
+    // application order within each chain.
+    _opOrder.resize(numOps);
+    for (size_t i = 0; i < numOps; ++i) {
+        _opOrder[chainOffset[chainOfOp[i]]++] = i;
+    }
+}
+
+size_t OplogDependencyGraph::longestChainLength() const {
+    // Chains are sorted longest-first.
+    return numChains() == 0 ? 0 : _chainBegin[1] - _chainBegin[0];
+}
+
+std::vector<size_t> OplogDependencyGraph::getChain(size_t chain) const {
+    return std::vector<size_t>(_opOrder.begin() + _chainBegin[chain],
+                               _opOrder.begin() + _chainBegin[chain + 1]);
+}
+
+bool OplogDependencyGraph::claimChains(size_t minOps, std::vector<size_t>* opIndexes) {
+    bool claimedAny = false;
+    size_t claimedOps = 0;
+    while (claimedOps < minOps || !claimedAny) {
+        const unsigned long long chain = _nextChain.fetchAndAdd(1);
+        if (chain >= numChains()) {
+            break;
+        }
+
+        opIndexes->insert(opIndexes->end(),
+                          _opOrder.begin() + _chainBegin[chain],
+                          _opOrder.begin() + _chainBegin[chain + 1]);
+        claimedOps += _chainBegin[chain + 1] - _chainBegin[chain];
+        claimedAny = true;
+    }
+    return claimedAny;
+}
+
+}  // namespace repl
+}  // namespace mongo
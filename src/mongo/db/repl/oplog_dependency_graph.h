@@ -0,0 +1,103 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+namespace repl {
+
+/**
+ * Dependency graph over the operations of a single oplog application batch.
+ *
+ * Each operation is described by a conflict key. Two operations conflict, and must be applied in
+ * oplog order, if and only if they have the same key. Since every CRUD operation touches exactly
+ * one document, the graph degenerates into a set of independent chains, one per key, which can
+ * be applied concurrently with each other.
+ *
+ * Chains are laid out longest-first, so that the workers claiming them through claimChains()
+ * start on the critical path as early as possible and finish the batch with short chains.
+ */
+class OplogDependencyGraph {
+    MONGO_DISALLOW_COPYING(OplogDependencyGraph);
+
+public:
+    /**
+     * Builds the graph. 'conflictKeys[i]' is the conflict key of the i-th operation of the batch.
+     */
+    explicit OplogDependencyGraph(const std::vector<uint32_t>& conflictKeys);
+
+    size_t numOps() const {
+        return _opOrder.size();
+    }
+
+    size_t numChains() const {
+        return _chainBegin.size() - 1;
+    }
+
+    /**
+     * Number of operations in the longest chain. No schedule can apply the batch in fewer
+     * sequential steps.
+     */
+    size_t longestChainLength() const;
+
+    /**
+     * Returns the indexes, in application order, of the operations making up the chain at
+     * position 'chain'.
+     */
+    std::vector<size_t> getChain(size_t chain) const;
+
+    /**
+     * Claims whole chains that no other caller has claimed yet, until at least 'minOps'
+     * operations have been claimed or no chains remain, and appends the indexes of their
+     * operations to 'opIndexes'. Operations of each claimed chain are appended in application
+     * order. Returns false once every chain has been claimed.
+     *
+     * Safe to call concurrently from multiple threads.
+     */
+    bool claimChains(size_t minOps, std::vector<size_t>* opIndexes);
+
+private:
+    // Operation indexes grouped by chain, chains ordered longest-first.
+    std::vector<size_t> _opOrder;
+
+    // _chainBegin[i] is the offset in _opOrder of chain i; the last element is _opOrder.size().
+    std::vector<size_t> _chainBegin;
+
+    // Next chain to be handed out by claimChains().
+    AtomicWord<unsigned long long> _nextChain{0};
+};
+
+}  // namespace repl
+}  // namespace mongo
@@ -0,0 +1,135 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mongo/db/repl/oplog_dependency_graph.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+
+namespace {
+
+using namespace mongo;
+using namespace mongo::repl;
+
+TEST(OplogDependencyGraphTest, EmptyBatch) {
+    OplogDependencyGraph graph({});
+    ASSERT_EQUALS(0U, graph.numOps());
+    ASSERT_EQUALS(0U, graph.numChains());
+    ASSERT_EQUALS(0U, graph.longestChainLength());
+
+    std::vector<size_t> claimed;
+    ASSERT_FALSE(graph.claimChains(1, &claimed));
+    ASSERT_TRUE(claimed.empty());
+}
+
+TEST(OplogDependencyGraphTest, IndependentOpsFormSingletonChains) {
+    OplogDependencyGraph graph({1, 2, 3, 4});
+    ASSERT_EQUALS(4U, graph.numOps());
+    ASSERT_EQUALS(4U, graph.numChains());
+    ASSERT_EQUALS(1U, graph.longestChainLength());
+    for (size_t chain = 0; chain < graph.numChains(); ++chain) {
+        ASSERT_TRUE((std::vector<size_t>{chain} == graph.getChain(chain)));
+    }
+}
+
+TEST(OplogDependencyGraphTest, ConflictingOpsKeepOplogOrder) {
+    OplogDependencyGraph graph({7, 8, 7, 9, 7, 8});
+    ASSERT_EQUALS(6U, graph.numOps());
+    ASSERT_EQUALS(3U, graph.numChains());
+    ASSERT_EQUALS(3U, graph.longestChainLength());
+
+    // Chains are laid out longest-first.
+    ASSERT_TRUE((std::vector<size_t>{0, 2, 4} == graph.getChain(0)));
+    ASSERT_TRUE((std::vector<size_t>{1, 5} == graph.getChain(1)));
+    ASSERT_TRUE((std::vector<size_t>{3} == graph.getChain(2)));
+}
+
+TEST(OplogDependencyGraphTest, ClaimChainsHandsOutWholeChains) {
+    OplogDependencyGraph graph({7, 8, 7, 9, 7, 8});
+
+    std::vector<size_t> claimed;
+    ASSERT_TRUE(graph.claimChains(1, &claimed));
+    ASSERT_TRUE((std::vector<size_t>{0, 2, 4} == claimed));
+
+    claimed.clear();
+    ASSERT_TRUE(graph.claimChains(3, &claimed));
+    ASSERT_TRUE((std::vector<size_t>{1, 5, 3} == claimed));
+
+    claimed.clear();
+    ASSERT_FALSE(graph.claimChains(1, &claimed));
+    ASSERT_TRUE(claimed.empty());
+}
+
+TEST(OplogDependencyGraphTest, ConcurrentClaimsCoverEveryOpExactlyOnce) {
+    const size_t numOps = 10000;
+    const size_t numThreads = 8;
+
+    std::vector<uint32_t> keys;
+    for (size_t i = 0; i < numOps; ++i) {
+        keys.push_back(i % 97);
+    }
+    OplogDependencyGraph graph(keys);
+
+    std::vector<std::vector<size_t>> claimedByThread(numThreads);
+    std::vector<stdx::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&graph, &claimedByThread, t] {
+            while (graph.claimChains(16, &claimedByThread[t])) {
+            }
+        });
+    }
+    for (auto&& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<size_t> all;
+    for (auto&& claimed : claimedByThread) {
+        // Within every thread, the ops of each key must still be in oplog order.
+        std::vector<size_t> lastSeen(97, 0);
+        std::vector<bool> seen(97, false);
+        for (auto op : claimed) {
+            const uint32_t key = keys[op];
+            ASSERT_TRUE(!seen[key] || lastSeen[key] < op);
+            seen[key] = true;
+            lastSeen[key] = op;
+        }
+        all.insert(all.end(), claimed.begin(), claimed.end());
+    }
+
+    std::sort(all.begin(), all.end());
+    ASSERT_EQUALS(numOps, all.size());
+    for (size_t i = 0; i < numOps; ++i) {
+        ASSERT_EQUALS(i, all[i]);
+    }
+}
+
+}  // namespace
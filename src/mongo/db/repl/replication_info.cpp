@@ -47,6 +47,7 @@
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/db/wire_version.h"
 #include "mongo/s/write_ops/batched_command_request.h"
+#include "mongo/util/net/message_compressor.h"
 
 namespace mongo {
 
@@ -239,6 +240,7 @@ public:
         result.appendDate("localTime", jsTime());
         result.append("maxWireVersion", WireSpec::instance().maxWireVersionIncoming);
         result.append("minWireVersion", WireSpec::instance().minWireVersionIncoming);
+        MessageCompressorRegistry::get().serverNegotiate(cmdObj, &result);
         return true;
     }
 } cmdismaster;
@@ -53,6 +53,7 @@
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
 #include "mongo/db/repl/replication_executor.h"
+#include "mongo/db/repl/rs_initialsync.h"
 #include "mongo/db/repl/update_position_args.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/storage_engine.h"
@@ -211,6 +212,9 @@ public:
             return appendCommandStatus(result, status);
 
         status = getGlobalReplicationCoordinator()->processReplSetGetStatus(&result);
+        if (status.isOK()) {
+            appendInitialSyncProgress(&result);
+        }
         return appendCommandStatus(result, status);
     }
 } cmdReplSetGetStatus;
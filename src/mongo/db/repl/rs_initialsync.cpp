@@ -54,6 +54,7 @@
 #include "mongo/db/repl/oplogreader.h"
 #include "mongo/db/repl/repl_client_info.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
@@ -69,6 +70,15 @@ using std::string;
 // Failpoint which fails initial sync and leaves on oplog entry in the buffer.
 MONGO_FP_DECLARE(failInitSyncWithBufferedEntriesLeft);
 
+// Failpoint which pauses initial sync once the documents of all databases have been cloned.
+MONGO_FP_DECLARE(initialSyncHangAfterDataCloning);
+
+// Number of collections of a database whose documents initial sync clones at the same time.
+MONGO_EXPORT_SERVER_PARAMETER(initialSyncMaxConcurrentCollectionCloners, int, 4);
+
+// Progress of the collections cloned by the current or last initial sync attempt
+CloneProgress initialSyncCloneProgress;
+
 /**
  * Truncates the oplog (removes any documents) and resets internal variables that were
  * originally initialized or affected by using values from the oplog at startup time.  These
@@ -188,6 +198,9 @@ bool _initialSyncClone(OperationContext* txn,
         options.mayBeInterrupted = true;
         options.syncData = dataPass;
         options.syncIndexes = !dataPass;
+        options.maxConcurrentCollections =
+            std::max(1, initialSyncMaxConcurrentCollectionCloners.load());
+        options.progress = &initialSyncCloneProgress;
 
         // Make database stable
         ScopedTransaction transaction(txn, MODE_IX);
@@ -362,11 +375,17 @@ Status _initialSync() {
         }
     }
 
+    initialSyncCloneProgress.clear();
+
     Cloner cloner;
     if (!_initialSyncClone(&txn, cloner, r.conn()->getServerAddress(), dbs, true)) {
         return Status(ErrorCodes::InitialSyncFailure, "initial sync failed data cloning");
     }
 
+    while (MONGO_FAIL_POINT(initialSyncHangAfterDataCloning) && !inShutdown()) {
+        sleepmillis(100);
+    }
+
     log() << "initial sync data copy, starting syncup";
 
     // prime oplog, but don't need to actually apply the op as the cloned data already reflects it.
@@ -444,11 +463,22 @@ Status _initialSync() {
         replCoord->setMaintenanceMode(false);
     }
 
+    initialSyncCloneProgress.clear();
+
     log() << "initial sync done";
     return Status::OK();
 }
 }  // namespace
 
+void appendInitialSyncProgress(BSONObjBuilder* builder) {
+    if (initialSyncCloneProgress.empty()) {
+        return;
+    }
+
+    BSONObjBuilder initialSyncBuilder(builder->subobjStart("initialSyncStatus"));
+    initialSyncCloneProgress.append(&initialSyncBuilder);
+}
+
 void syncDoInitialSync() {
     static const int maxFailedAttempts = 10;
 
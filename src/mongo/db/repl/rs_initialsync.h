@@ -29,11 +29,20 @@
 #pragma once
 
 namespace mongo {
+
+class BSONObjBuilder;
+
 namespace repl {
 /**
  * Begins an initial sync of a node.  This drops all data, chooses a sync source,
  * and runs the cloner from that sync source.  The node's state is not changed.
  */
 void syncDoInitialSync();
+
+/**
+ * Appends an 'initialSyncStatus' section with the progress of each collection cloned by the
+ * running or last failed initial sync attempt, if any.
+ */
+void appendInitialSyncProgress(BSONObjBuilder* builder);
 }
 }
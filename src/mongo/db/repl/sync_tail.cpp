@@ -56,6 +56,7 @@
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/minvalid.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/repl/oplog_dependency_graph.h"
 #include "mongo/db/repl/oplogreader.h"
 #include "mongo/db/repl/repl_client_info.h"
 #include "mongo/db/repl/replica_set_config.h"
@@ -63,6 +64,7 @@
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/stats/timer_stats.h"
+#include "mongo/stdx/memory.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/util/log.h"
@@ -103,6 +105,10 @@ public:
 
 } exportedWriterThreadCountParam;
 
+// When set, each batch is applied by building a per-document dependency graph and letting every
+// writer thread claim independent chains of operations, instead of statically hashing operations
+// onto writer threads.
+MONGO_EXPORT_STARTUP_SERVER_PARAMETER(replApplyUsingDependencyGraph, bool, false);
 
 static Counter64 opsAppliedStats;
 
@@ -111,10 +117,29 @@ static ServerStatusMetricField<Counter64> displayOpsApplied("repl.apply.ops", &o
 
 MONGO_FP_DECLARE(rsSyncApplyStop);
 
+// Pauses a batch while it holds the ParallelBatchWriterMode lock, which readers conflict with
+MONGO_FP_DECLARE(rsSyncApplyHangDuringBatch);
+
 // Number and time of each ApplyOps worker pool round
 static TimerStats applyBatchStats;
 static ServerStatusMetricField<TimerStats> displayOpBatchesApplied("repl.apply.batches",
                                                                    &applyBatchStats);
+
+// Number and time, from scheduling to completion, of batches applied using the dependency graph
+static TimerStats dependencyGraphBatchStats;
+static ServerStatusMetricField<TimerStats> displayDependencyGraphBatches(
+    "repl.apply.dependencyGraph.batches", &dependencyGraphBatchStats);
+
+// Independent chains of operations found in those batches
+static Counter64 dependencyGraphChainsStats;
+static ServerStatusMetricField<Counter64> displayDependencyGraphChains(
+    "repl.apply.dependencyGraph.chains", &dependencyGraphChainsStats);
+
+// Operations on the longest chain of each of those batches. Dividing "repl.apply.ops" deltas by
+// deltas of this counter gives the parallelism available to the writer threads.
+static Counter64 dependencyGraphCriticalPathStats;
+static ServerStatusMetricField<Counter64> displayDependencyGraphCriticalPath(
+    "repl.apply.dependencyGraph.criticalPathOps", &dependencyGraphCriticalPathStats);
 void initializePrefetchThread() {
     if (!ClientBasic::getCurrent()) {
         Client::initThreadIfNotAlready();
@@ -474,6 +499,42 @@ private:
     StringMap<bool> _cache;
 };
 
+/**
+ * Returns the hash deciding which operations of a batch must be applied in oplog order. Operations
+ * that touch the same document always get the same hash.
+ */
+uint32_t computeConflictHash(OperationContext* txn,
+                             const SyncTail::OplogEntry& op,
+                             bool supportsDocLocking,
+                             CachingCappedChecker* isCapped) {
+    StringMapTraits::HashedKey hashedNs(op.ns);
+    uint32_t hash = hashedNs.hash();
+
+    const char* opType = op.opType.rawData();
+
+    // For doc locking engines, include the _id of the document in the hash so we get
+    // parallelism even if all writes are to a single collection. We can't do this for capped
+    // collections because the order of inserts is a guaranteed property, unlike for normal
+    // collections.
+    if (supportsDocLocking && isCrudOpType(opType) && !(*isCapped)(txn, hashedNs)) {
+        BSONElement id;
+        switch (opType[0]) {
+            case 'u':
+                id = op.o2.Obj()["_id"];
+                break;
+            case 'd':
+            case 'i':
+                id = op.o.Obj()["_id"];
+                break;
+        }
+
+        const size_t idHash = BSONElement::Hasher()(id);
+        MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
+    }
+
+    return hash;
+}
+
 void fillWriterVectors(OperationContext* txn,
                        const std::deque<SyncTail::OplogEntry>& ops,
                        std::vector<std::vector<BSONObj>>* writerVectors) {
@@ -486,32 +547,67 @@ void fillWriterVectors(OperationContext* txn,
     CachingCappedChecker isCapped;
 
     for (auto&& op : ops) {
-        StringMapTraits::HashedKey hashedNs(op.ns);
-        uint32_t hash = hashedNs.hash();
-
-        const char* opType = op.opType.rawData();
-
-        // For doc locking engines, include the _id of the document in the hash so we get
-        // parallelism even if all writes are to a single collection. We can't do this for capped
-        // collections because the order of inserts is a guaranteed property, unlike for normal
-        // collections.
-        if (supportsDocLocking && isCrudOpType(opType) && !isCapped(txn, hashedNs)) {
-            BSONElement id;
-            switch (opType[0]) {
-                case 'u':
-                    id = op.o2.Obj()["_id"];
-                    break;
-                case 'd':
-                case 'i':
-                    id = op.o.Obj()["_id"];
-                    break;
-            }
+        const uint32_t hash = computeConflictHash(txn, op, supportsDocLocking, &isCapped);
+        (*writerVectors)[hash % numWriters].push_back(op.raw);
+    }
+}
+
+std::unique_ptr<OplogDependencyGraph> buildDependencyGraph(
+    OperationContext* txn, const std::deque<SyncTail::OplogEntry>& ops) {
+    const bool supportsDocLocking =
+        getGlobalServiceContext()->getGlobalStorageEngine()->supportsDocLocking();
+
+    Lock::GlobalRead globalReadLock(txn->lockState());
+
+    CachingCappedChecker isCapped;
+
+    std::vector<uint32_t> conflictHashes;
+    conflictHashes.reserve(ops.size());
+    for (auto&& op : ops) {
+        conflictHashes.push_back(computeConflictHash(txn, op, supportsDocLocking, &isCapped));
+    }
+
+    return stdx::make_unique<OplogDependencyGraph>(conflictHashes);
+}
 
-            const size_t idHash = BSONElement::Hasher()(id);
-            MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
+// Run by each writer thread: claims chains of the dependency graph until none are left, applying
+// at least 'minOpsPerClaim' operations at a time to amortize the cost of each apply call.
+void applyDependencyChains(OplogDependencyGraph* graph,
+                           const std::deque<SyncTail::OplogEntry>* ops,
+                           size_t minOpsPerClaim,
+                           SyncTail::MultiSyncApplyFunc func,
+                           SyncTail* sync) {
+    std::vector<size_t> opIndexes;
+    std::vector<BSONObj> claimedOps;
+    while (graph->claimChains(minOpsPerClaim, &opIndexes)) {
+        for (auto i : opIndexes) {
+            claimedOps.push_back((*ops)[i].raw);
         }
+        func(claimedOps, sync);
 
-        (*writerVectors)[hash % numWriters].push_back(op.raw);
+        opIndexes.clear();
+        claimedOps.clear();
+    }
+}
+
+// Schedules one chain-claiming task per writer thread. Chains are handed out longest-first, so
+// a writer that runs out of work takes over the remaining chains of the batch.
+void applyOpsUsingDependencyGraph(OplogDependencyGraph* graph,
+                                  const std::deque<SyncTail::OplogEntry>& ops,
+                                  OldThreadPool* writerPool,
+                                  SyncTail::MultiSyncApplyFunc func,
+                                  SyncTail* sync) {
+    TimerHolder timer(&applyBatchStats);
+    dependencyGraphChainsStats.increment(graph->numChains());
+    dependencyGraphCriticalPathStats.increment(graph->longestChainLength());
+
+    const size_t numWriters = SyncTail::replWriterThreadCount;
+    const size_t minOpsPerClaim = std::max<size_t>(1, graph->numOps() / (numWriters * 8));
+    const size_t numTasks = std::min(numWriters, graph->numChains());
+    for (size_t i = 0; i < numTasks; ++i) {
+        writerPool->schedule([=, &ops] {
+            applyDependencyChains(graph, &ops, minOpsPerClaim, func, sync);
+        });
     }
 }
 
@@ -527,9 +623,15 @@ OpTime SyncTail::multiApply(OperationContext* txn, const OpQueue& ops) {
         prefetchOps(ops.getDeque(), &_prefetcherPool);
     }
 
-    std::vector<std::vector<BSONObj>> writerVectors(replWriterThreadCount);
+    std::vector<std::vector<BSONObj>> writerVectors;
+    std::unique_ptr<OplogDependencyGraph> dependencyGraph;
 
-    fillWriterVectors(txn, ops.getDeque(), &writerVectors);
+    if (replApplyUsingDependencyGraph) {
+        dependencyGraph = buildDependencyGraph(txn, ops.getDeque());
+    } else {
+        writerVectors.resize(replWriterThreadCount);
+        fillWriterVectors(txn, ops.getDeque(), &writerVectors);
+    }
     LOG(2) << "replication batch size is " << ops.getDeque().size() << endl;
     // We must grab this because we're going to grab write locks later.
     // We hold this mutex the entire time we're writing; it doesn't matter
@@ -539,13 +641,26 @@ OpTime SyncTail::multiApply(OperationContext* txn, const OpQueue& ops) {
     // stop all readers until we're done
     Lock::ParallelBatchWriterMode pbwm(txn->lockState());
 
+    if (MONGO_FAIL_POINT(rsSyncApplyHangDuringBatch)) {
+        log() << "rsSyncApplyHangDuringBatch fail point enabled, blocking until disabled";
+        while (MONGO_FAIL_POINT(rsSyncApplyHangDuringBatch) && !inShutdown()) {
+            sleepmillis(10);
+        }
+    }
+
     ReplicationCoordinator* replCoord = getGlobalReplicationCoordinator();
     if (replCoord->getMemberState().primary() && !replCoord->isWaitingForApplierToDrain()) {
         severe() << "attempting to replicate ops while primary";
         fassertFailed(28527);
     }
 
-    applyOps(writerVectors, &_writerPool, _applyFunc, this);
+    Timer applyTimer;
+    if (dependencyGraph) {
+        applyOpsUsingDependencyGraph(
+            dependencyGraph.get(), ops.getDeque(), &_writerPool, _applyFunc, this);
+    } else {
+        applyOps(writerVectors, &_writerPool, _applyFunc, this);
+    }
 
     OpTime lastOpTime;
     {
@@ -558,6 +673,10 @@ OpTime SyncTail::multiApply(OperationContext* txn, const OpQueue& ops) {
         lastOpTime = writeOpsToOplog(txn, raws);
     }
 
+    if (dependencyGraph) {
+        dependencyGraphBatchStats.record(applyTimer);
+    }
+
     if (inShutdownStrict()) {
         log() << "Cannot apply operations due to shutdown in progress";
         return OpTime();
@@ -32,6 +32,7 @@
 
 #include "mongo/db/s/migration_destination_manager.h"
 
+#include <deque>
 #include <list>
 #include <vector>
 
@@ -53,6 +54,7 @@
 #include "mongo/db/range_deleter_service.h"
 #include "mongo/db/repl/repl_client_info.h"
 #include "mongo/db/repl/replication_coordinator_global.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/service_context.h"
 #include "mongo/db/storage/mmap_v1/dur.h"
 #include "mongo/db/s/sharded_connection_info.h"
@@ -161,6 +163,109 @@ bool opReplicatedEnough(OperationContext* txn,
     return majorityStatus.isOK() && userStatus.isOK();
 }
 
+// Number of _migrateClone batches which the recipient may have fetched from the donor, but not yet
+// applied locally. Each batch is at most 16MB, so this bounds the memory used by the clone phase.
+MONGO_EXPORT_SERVER_PARAMETER(migrateCloneMaxBufferedBatches, int, 2);
+
+/**
+ * Pulls the documents of the chunk being migrated from the donor shard through repeated
+ * _migrateClone calls on a dedicated thread and connection, so that fetching the next batch from
+ * the donor overlaps with inserting the current one instead of alternating with it.
+ */
+class CloneBatchFetcher {
+    MONGO_DISALLOW_COPYING(CloneBatchFetcher);
+
+public:
+    CloneBatchFetcher(std::string fromShard, size_t maxBufferedBatches)
+        : _fromShard(std::move(fromShard)), _maxBufferedBatches(maxBufferedBatches) {
+        _thread = stdx::thread([this] { _run(); });
+    }
+
+    ~CloneBatchFetcher() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _shutdown = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+    }
+
+    /**
+     * Blocks until the next batch is available and returns the _migrateClone response which
+     * carries it. A response with an empty 'objects' array marks the end of the initial clone.
+     */
+    StatusWith<BSONObj> next() {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _cv.wait(lk, [this] { return !_batches.empty(); });
+
+        StatusWith<BSONObj> batch = std::move(_batches.front());
+        _batches.pop_front();
+        _cv.notify_all();
+        return batch;
+    }
+
+private:
+    void _run() {
+        Client::initThread("migrateCloneFetcher");
+
+        try {
+            ScopedDbConnection conn(_fromShard);
+
+            while (true) {
+                {
+                    stdx::unique_lock<stdx::mutex> lk(_mutex);
+                    _cv.wait(lk, [this] {
+                        return _shutdown || _batches.size() < _maxBufferedBatches;
+                    });
+                    if (_shutdown) {
+                        // The connection may still have a response in flight, so don't return it
+                        // to the pool.
+                        return;
+                    }
+                }
+
+                // Gets array of objects to copy, in disk order
+                BSONObj res;
+                if (!conn->runCommand("admin", BSON("_migrateClone" << 1), res)) {
+                    conn.done();
+                    _push(Status(ErrorCodes::OperationFailed,
+                                 str::stream() << "_migrateClone failed: " << res));
+                    return;
+                }
+
+                const bool isLastBatch = res["objects"].Obj().isEmpty();
+                _push(res.getOwned());
+
+                if (isLastBatch) {
+                    conn.done();
+                    return;
+                }
+            }
+        } catch (const DBException& ex) {
+            _push(ex.toStatus());
+        }
+    }
+
+    void _push(StatusWith<BSONObj> batch) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _batches.push_back(std::move(batch));
+        _cv.notify_all();
+    }
+
+    const std::string _fromShard;
+    const size_t _maxBufferedBatches;
+
+    stdx::mutex _mutex;
+    stdx::condition_variable _cv;
+
+    // Fetched batches in the order in which the donor returned them
+    std::deque<StatusWith<BSONObj>> _batches;
+
+    bool _shutdown{false};
+
+    stdx::thread _thread;
+};
+
 }  // namespace
 
 // Enabling / disabling these fail points pauses / resumes MigrateStatus::_go(), the thread which
@@ -561,20 +666,19 @@ void MigrationDestinationManager::_migrateDriver(OperationContext* txn,
         // 3. Initial bulk clone
         setState(CLONE);
 
+        CloneBatchFetcher fetcher(fromShard, std::max(1, migrateCloneMaxBufferedBatches.load()));
+
         while (true) {
-            BSONObj res;
-            if (!conn->runCommand("admin",
-                                  BSON("_migrateClone" << 1),
-                                  res)) {  // gets array of objects to copy, in disk order
+            StatusWith<BSONObj> swRes = fetcher.next();
+            if (!swRes.isOK()) {
                 setState(FAIL);
-                errmsg = "_migrateClone failed: ";
-                errmsg += res.toString();
+                errmsg = swRes.getStatus().reason();
                 error() << errmsg << migrateLog;
                 conn.done();
                 return;
             }
 
-            BSONObj arr = res["objects"].Obj();
+            BSONObj arr = swRes.getValue()["objects"].Obj();
             int thisTime = 0;
 
             BSONObjIterator i(arr);
@@ -32,6 +32,7 @@
 
 #include "mongo/db/s/migration_source_manager.h"
 
+#include <algorithm>
 #include <set>
 #include <vector>
 
@@ -192,7 +193,10 @@ bool MigrationSourceManager::start(OperationContext* txn,
     _active = true;
 
     stdx::lock_guard<stdx::mutex> tLock(_cloneLocsMutex);
-    invariant(_cloneLocs.size() == 0);
+    invariant(_cloneLocs.empty());
+    invariant(_cloneLocsNext == 0);
+    invariant(!_cloneLocsStored);
+    invariant(_cloneLocsDeleted.empty());
 
     return true;
 }
@@ -216,7 +220,10 @@ void MigrationSourceManager::done(OperationContext* txn) {
     _memoryUsed = 0;
 
     stdx::lock_guard<stdx::mutex> cloneLock(_cloneLocsMutex);
-    _cloneLocs.clear();
+    std::vector<RecordId>().swap(_cloneLocs);
+    _cloneLocsNext = 0;
+    _cloneLocsStored = false;
+    _cloneLocsDeleted.clear();
 }
 
 void MigrationSourceManager::logOp(OperationContext* txn,
@@ -398,11 +405,16 @@ bool MigrationSourceManager::storeCurrentLocs(OperationContext* txn,
     bool isLargeChunk = false;
     unsigned long long recCount = 0;
 
+    // The record ids come out of the index in shard key order and are collected locally, so that
+    // they can be sorted before becoming visible to clone. Deletions which happen in the meantime
+    // are remembered by aboutToDelete.
+    std::vector<RecordId> cloneLocs;
+    cloneLocs.reserve(std::min(maxRecsWhenFull, 1024ULL * 1024));
+
     RecordId recordId;
     while (PlanExecutor::ADVANCED == exec->getNext(NULL, &recordId)) {
         if (!isLargeChunk) {
-            stdx::lock_guard<stdx::mutex> lk(_cloneLocsMutex);
-            _cloneLocs.insert(recordId);
+            cloneLocs.push_back(recordId);
         }
 
         if (++recCount > maxRecsWhenFull) {
@@ -428,6 +440,23 @@ bool MigrationSourceManager::storeCurrentLocs(OperationContext* txn,
         return false;
     }
 
+    std::sort(cloneLocs.begin(), cloneLocs.end());
+
+    {
+        stdx::lock_guard<stdx::mutex> lk(_cloneLocsMutex);
+        invariant(!_cloneLocsStored);
+        _cloneLocs = std::move(cloneLocs);
+        _cloneLocsStored = true;
+
+        for (auto it = _cloneLocsDeleted.begin(); it != _cloneLocsDeleted.end();) {
+            if (std::binary_search(_cloneLocs.begin(), _cloneLocs.end(), *it)) {
+                ++it;
+            } else {
+                it = _cloneLocsDeleted.erase(it);
+            }
+        }
+    }
+
     log() << "moveChunk number of documents: " << cloneLocsRemaining() << migrateLog;
 
     txn->recoveryUnit()->abandonSnapshot();
@@ -479,12 +508,16 @@ bool MigrationSourceManager::clone(OperationContext* txn, string& errmsg, BSONOb
 
         stdx::lock_guard<stdx::mutex> lk(_cloneLocsMutex);
 
-        std::set<RecordId>::iterator cloneLocsIter = _cloneLocs.begin();
-        for (; cloneLocsIter != _cloneLocs.end(); ++cloneLocsIter) {
+        for (; _cloneLocsNext < _cloneLocs.size(); ++_cloneLocsNext) {
             if (tracker.intervalHasElapsed())  // should I yield?
                 break;
 
-            RecordId recordId = *cloneLocsIter;
+            const RecordId& recordId = _cloneLocs[_cloneLocsNext];
+            if (!_cloneLocsDeleted.empty() && _cloneLocsDeleted.erase(recordId)) {
+                // doc was deleted and its record id may since have been reused
+                continue;
+            }
+
             Snapshotted<BSONObj> doc;
             if (!collection->findDoc(txn, recordId, &doc)) {
                 // doc was deleted
@@ -504,10 +537,8 @@ bool MigrationSourceManager::clone(OperationContext* txn, string& errmsg, BSONOb
             clonedDocsArrayBuilder.append(doc.value());
         }
 
-        _cloneLocs.erase(_cloneLocs.begin(), cloneLocsIter);
-
         // Note: must be holding _cloneLocsMutex, don't move this inside while condition!
-        if (_cloneLocs.empty()) {
+        if (_cloneLocsNext == _cloneLocs.size()) {
             break;
         }
     }
@@ -520,12 +551,19 @@ void MigrationSourceManager::aboutToDelete(const RecordId& dl) {
     // Even though above we call findDoc to check for existance that check only works for non-mmapv1
     // engines, and this is needed for mmapv1.
     stdx::lock_guard<stdx::mutex> lk(_cloneLocsMutex);
-    _cloneLocs.erase(dl);
+    if (!_cloneLocsStored ||
+        std::binary_search(_cloneLocs.begin() + _cloneLocsNext, _cloneLocs.end(), dl)) {
+        _cloneLocsDeleted.insert(dl);
+    }
 }
 
 std::size_t MigrationSourceManager::cloneLocsRemaining() const {
     stdx::lock_guard<stdx::mutex> lk(_cloneLocsMutex);
-    return _cloneLocs.size();
+    if (!_cloneLocsStored) {
+        return 0;
+    }
+
+    return _cloneLocs.size() - _cloneLocsNext - _cloneLocsDeleted.size();
 }
 
 long long MigrationSourceManager::mbUsed() const {
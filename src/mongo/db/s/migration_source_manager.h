@@ -31,10 +31,12 @@
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/bson/bsonobj.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/record_id.h"
 #include "mongo/stdx/condition_variable.h"
 
 namespace mongo {
@@ -43,7 +45,6 @@ class BSONObj;
 class Database;
 class OperationContext;
 class PlanExecutor;
-class RecordId;
 
 class MigrationSourceManager {
     MONGO_DISALLOW_COPYING(MigrationSourceManager);
@@ -79,7 +80,8 @@ public:
 
     /**
      * Get the disklocs that belong to the chunk migrated and sort them in _cloneLocs (to avoid
-     * seeking disk later).
+     * seeking disk later). Only the record ids are kept, in a flat array, so the memory used is
+     * bounded by the number of documents a chunk may hold.
      *
      * @param maxChunkSize number of bytes beyond which a chunk's base data (no indices) is
      *      considered too large to move
@@ -174,8 +176,17 @@ private:
 
     mutable stdx::mutex _cloneLocsMutex;
 
-    // List of record id that needs to be transferred from here to the other side.
-    std::set<RecordId> _cloneLocs;  // (C)
+    // Record ids of the chunk's documents in ascending order. The ones before _cloneLocsNext have
+    // already been transferred to the other side.
+    std::vector<RecordId> _cloneLocs;  // (C)
+    std::size_t _cloneLocsNext{0};     // (C)
+
+    // Whether storeCurrentLocs has finished filling _cloneLocs.
+    bool _cloneLocsStored{false};  // (C)
+
+    // Record ids at or after _cloneLocsNext which were deleted before they could be transferred.
+    // Until _cloneLocsStored is set, holds every record id deleted from the collection.
+    std::set<RecordId> _cloneLocsDeleted;  // (C)
 };
 
 }  // namespace mongo
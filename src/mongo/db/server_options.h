@@ -55,6 +55,7 @@ struct ServerGlobalParams {
           doFork(0),
           socket("/tmp"),
           maxConns(DEFAULT_MAX_CONN),
+          ingressWorkerThreads(0),
           unixSocketPermissions(DEFAULT_UNIX_PERMS),
           logAppend(false),
           logRenameOnRotate(true),
@@ -98,6 +99,10 @@ struct ServerGlobalParams {
 
     int maxConns;  // Maximum number of simultaneous open connections.
 
+    // Number of worker threads serving all connections from an event-driven reactor, or 0 to
+    // serve each connection from its own thread.
+    int ingressWorkerThreads;
+
     int unixSocketPermissions;  // permissions for the UNIX domain socket
 
     std::string keyFile;  // Path to keyfile, or empty if none.
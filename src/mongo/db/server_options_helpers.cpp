@@ -206,6 +206,13 @@ Status addGeneralServerOptions(moe::OptionSection* options) {
     options->addOptionChaining(
         "net.maxIncomingConnections", "maxConns", moe::Int, maxConnInfoBuilder.str().c_str());
 
+    options->addOptionChaining("net.ingressWorkerThreads",
+                               "ingressWorkerThreads",
+                               moe::Int,
+                               "serve all connections from this many worker threads, more while "
+                               "they are all busy, instead of one thread per connection (Linux "
+                               "only, 0 to disable)");
+
     options->addOptionChaining(
                  "logpath",
                  "logpath",
@@ -803,6 +810,14 @@ Status storeServerOptions(const moe::Environment& params, const std::vector<std:
         }
     }
 
+    if (params.count("net.ingressWorkerThreads")) {
+        serverGlobalParams.ingressWorkerThreads = params["net.ingressWorkerThreads"].as<int>();
+
+        if (serverGlobalParams.ingressWorkerThreads < 0) {
+            return Status(ErrorCodes::BadValue, "ingressWorkerThreads cannot be negative");
+        }
+    }
+
     if (params.count("net.wireObjectCheck")) {
         serverGlobalParams.objcheck = params["net.wireObjectCheck"].as<bool>();
     }
@@ -504,6 +504,27 @@ private:
         _iters.push_back(std::shared_ptr<Iterator>(writer.done()));
 
         _memUsed = 0;
+
+        if (_opts.maxSpillFiles && _iters.size() >= _opts.maxSpillFiles) {
+            mergeSpills();
+        }
+    }
+
+    /**
+     * Merges the spilled files into a single one, so that no more than maxSpillFiles files are
+     * kept open at once.
+     */
+    void mergeSpills() {
+        SortedFileWriter<Key, Value> writer(_opts, _settings);
+        {
+            std::unique_ptr<Iterator> merged(Iterator::merge(_iters, _opts, _comp));
+            _iters.clear();
+            while (merged->more()) {
+                Data data = merged->next();
+                writer.addAlreadySorted(data.first, data.second);
+            }
+        }
+        _iters.push_back(std::shared_ptr<Iterator>(writer.done()));
     }
 
     const Comparator _comp;
@@ -97,8 +97,14 @@ struct SortOptions {
     bool extSortAllowed;         /// If false, uassert if more mem needed than allowed.
     std::string tempDir;         /// Directory to directly place files in.
                                  /// Must be explicitly set if extSortAllowed is true.
+    size_t maxSpillFiles;        /// Spilled files are merged into one when there are this many.
+                                 /// 0 for no limit. Only used without a limit.
 
-    SortOptions() : limit(0), maxMemoryUsageBytes(64 * 1024 * 1024), extSortAllowed(false) {}
+    SortOptions()
+        : limit(0),
+          maxMemoryUsageBytes(64 * 1024 * 1024),
+          extSortAllowed(false),
+          maxSpillFiles(0) {}
 
     /// Fluent API to support expressions like SortOptions().Limit(1000).ExtSortAllowed(true)
 
@@ -121,6 +127,11 @@ struct SortOptions {
         tempDir = newTempDir;
         return *this;
     }
+
+    SortOptions& MaxSpillFiles(size_t newMaxSpillFiles) {
+        maxSpillFiles = newMaxSpillFiles;
+        return *this;
+    }
 };
 
 /// This is the output from the sorting framework
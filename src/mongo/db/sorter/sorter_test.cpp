@@ -520,6 +520,20 @@ public:
     std::unique_ptr<int[]> _array;
 };
 
+template <bool Random = true>
+class LotsOfDataFewFiles : public LotsOfDataLittleMemory<Random> {
+    typedef LotsOfDataLittleMemory<Random> Parent;
+    SortOptions adjustSortOptions(SortOptions opts) {
+        return Parent::adjustSortOptions(opts).MaxSpillFiles(MAX_SPILL_FILES);
+    }
+    void addData(unowned_ptr<IWSorter> sorter) {
+        for (int i = 0; i < Parent::NUM_ITEMS; i++) {
+            sorter->add(Parent::_array[i], -Parent::_array[i]);
+            ASSERT_LESS_THAN(sorter->numFiles(), MAX_SPILL_FILES);
+        }
+    }
+    enum { MAX_SPILL_FILES = 8 };
+};
 
 template <long long Limit, bool Random = true>
 class LotsOfDataWithLimit : public LotsOfDataLittleMemory<Random> {
@@ -563,6 +577,8 @@ public:
         add<SorterTests::Dupes>();
         add<SorterTests::LotsOfDataLittleMemory</*random=*/false>>();
         add<SorterTests::LotsOfDataLittleMemory</*random=*/true>>();
+        add<SorterTests::LotsOfDataFewFiles</*random=*/false>>();
+        add<SorterTests::LotsOfDataFewFiles</*random=*/true>>();
         add<SorterTests::LotsOfDataWithLimit<1, /*random=*/false>>();     // limit=1 is special case
         add<SorterTests::LotsOfDataWithLimit<1, /*random=*/true>>();      // limit=1 is special case
         add<SorterTests::LotsOfDataWithLimit<100, /*random=*/false>>();   // fits in mem
@@ -34,7 +34,6 @@
 #include "mongo/db/stats/counters.h"
 
 #include "mongo/db/jsobj.h"
-#include "mongo/util/debug_util.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
@@ -44,38 +43,31 @@ using std::endl;
 OpCounters::OpCounters() {}
 
 void OpCounters::incInsertInWriteLock(int n) {
-    RARELY _checkWrap();
-    _insert.fetchAndAdd(n);
+    _insert.increment(n);
 }
 
 void OpCounters::gotInsert() {
-    RARELY _checkWrap();
-    _insert.fetchAndAdd(1);
+    _insert.increment();
 }
 
 void OpCounters::gotQuery() {
-    RARELY _checkWrap();
-    _query.fetchAndAdd(1);
+    _query.increment();
 }
 
 void OpCounters::gotUpdate() {
-    RARELY _checkWrap();
-    _update.fetchAndAdd(1);
+    _update.increment();
 }
 
 void OpCounters::gotDelete() {
-    RARELY _checkWrap();
-    _delete.fetchAndAdd(1);
+    _delete.increment();
 }
 
 void OpCounters::gotGetMore() {
-    RARELY _checkWrap();
-    _getmore.fetchAndAdd(1);
+    _getmore.increment();
 }
 
 void OpCounters::gotCommand() {
-    RARELY _checkWrap();
-    _command.fetchAndAdd(1);
+    _command.increment();
 }
 
 void OpCounters::gotOp(int op, bool isCommand) {
@@ -107,58 +99,29 @@ void OpCounters::gotOp(int op, bool isCommand) {
     }
 }
 
-void OpCounters::_checkWrap() {
-    const unsigned MAX = 1 << 30;
-
-    bool wrap = _insert.loadRelaxed() > MAX || _query.loadRelaxed() > MAX ||
-        _update.loadRelaxed() > MAX || _delete.loadRelaxed() > MAX ||
-        _getmore.loadRelaxed() > MAX || _command.loadRelaxed() > MAX;
-
-    if (wrap) {
-        _insert.store(0);
-        _query.store(0);
-        _update.store(0);
-        _delete.store(0);
-        _getmore.store(0);
-        _command.store(0);
-    }
-}
-
 BSONObj OpCounters::getObj() const {
     BSONObjBuilder b;
-    b.append("insert", _insert.loadRelaxed());
-    b.append("query", _query.loadRelaxed());
-    b.append("update", _update.loadRelaxed());
-    b.append("delete", _delete.loadRelaxed());
-    b.append("getmore", _getmore.loadRelaxed());
-    b.append("command", _command.loadRelaxed());
+    b.append("insert", _insert.get());
+    b.append("query", _query.get());
+    b.append("update", _update.get());
+    b.append("delete", _delete.get());
+    b.append("getmore", _getmore.get());
+    b.append("command", _command.get());
     return b.obj();
 }
 
 void NetworkCounter::hit(long long bytesIn, long long bytesOut) {
-    const int64_t MAX = 1ULL << 60;
-
-    // don't care about the race as its just a counter
-    bool overflow = _bytesIn.loadRelaxed() > MAX || _bytesOut.loadRelaxed() > MAX;
-
-    if (overflow) {
-        _bytesIn.store(bytesIn);
-        _bytesOut.store(bytesOut);
-        _requests.store(1);
-    } else {
-        _bytesIn.fetchAndAdd(bytesIn);
-        _bytesOut.fetchAndAdd(bytesOut);
-        _requests.fetchAndAdd(1);
-    }
+    _bytesIn.increment(bytesIn);
+    _bytesOut.increment(bytesOut);
+    _requests.increment();
 }
 
 void NetworkCounter::append(BSONObjBuilder& b) {
-    b.append("bytesIn", static_cast<long long>(_bytesIn.loadRelaxed()));
-    b.append("bytesOut", static_cast<long long>(_bytesOut.loadRelaxed()));
-    b.append("numRequests", static_cast<long long>(_requests.loadRelaxed()));
+    b.append("bytesIn", _bytesIn.get());
+    b.append("bytesOut", _bytesOut.get());
+    b.append("numRequests", _requests.get());
 }
 
-
 OpCounters globalOpCounters;
 OpCounters replOpCounters;
 NetworkCounter networkCounter;
@@ -31,16 +31,18 @@
 
 #include "mongo/platform/basic.h"
 #include "mongo/db/jsobj.h"
-#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/spin_lock.h"
+#include "mongo/util/concurrency/striped_counter.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/processinfo.h"
-#include "mongo/util/concurrency/spin_lock.h"
 
 namespace mongo {
 
 /**
  * for storing operation counters
- * note: not thread safe.  ok with that for speed
+ *
+ * The counters are striped, so incrementing them from many threads at once is cheap but reading
+ * them has to sum every stripe.
  */
 class OpCounters {
 public:
@@ -58,36 +60,32 @@ public:
     BSONObj getObj() const;
 
     // thse are used by snmp, and other things, do not remove
-    const AtomicUInt32* getInsert() const {
+    const StripedCounter64* getInsert() const {
         return &_insert;
     }
-    const AtomicUInt32* getQuery() const {
+    const StripedCounter64* getQuery() const {
         return &_query;
     }
-    const AtomicUInt32* getUpdate() const {
+    const StripedCounter64* getUpdate() const {
         return &_update;
     }
-    const AtomicUInt32* getDelete() const {
+    const StripedCounter64* getDelete() const {
         return &_delete;
     }
-    const AtomicUInt32* getGetMore() const {
+    const StripedCounter64* getGetMore() const {
         return &_getmore;
     }
-    const AtomicUInt32* getCommand() const {
+    const StripedCounter64* getCommand() const {
         return &_command;
     }
 
 private:
-    void _checkWrap();
-
-    // todo: there will be a lot of cache line contention on these.  need to do something
-    //       else eventually.
-    AtomicUInt32 _insert;
-    AtomicUInt32 _query;
-    AtomicUInt32 _update;
-    AtomicUInt32 _delete;
-    AtomicUInt32 _getmore;
-    AtomicUInt32 _command;
+    StripedCounter64 _insert;
+    StripedCounter64 _query;
+    StripedCounter64 _update;
+    StripedCounter64 _delete;
+    StripedCounter64 _getmore;
+    StripedCounter64 _command;
 };
 
 extern OpCounters globalOpCounters;
@@ -95,14 +93,13 @@ extern OpCounters replOpCounters;
 
 class NetworkCounter {
 public:
-    NetworkCounter() : _bytesIn(0), _bytesOut(0), _requests(0) {}
     void hit(long long bytesIn, long long bytesOut);
     void append(BSONObjBuilder& b);
 
 private:
-    AtomicInt64 _bytesIn;
-    AtomicInt64 _bytesOut;
-    AtomicInt64 _requests;
+    StripedCounter64 _bytesIn;
+    StripedCounter64 _bytesOut;
+    StripedCounter64 _requests;
 };
 
 extern NetworkCounter networkCounter;
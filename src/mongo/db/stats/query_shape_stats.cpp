@@ -0,0 +1,231 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/stats/query_shape_stats.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/service_context.h"
+#include "mongo/util/hex.h"
+
+namespace mongo {
+namespace {
+
+const auto getQueryShapeStats = ServiceContext::declareDecoration<QueryShapeStats>();
+
+long long latencyBucketLowerBound(size_t bucket) {
+    return bucket == 0 ? 0 : QueryShapeStats::kFirstLatencyBucketMicros << (bucket - 1);
+}
+
+/**
+ * Returns an owned copy of 'obj', or {$truncated: <summary>} if 'obj' is larger than
+ * kMaxExemplarBytes, where the summary is the abbreviated string form of 'obj' cut to that size.
+ */
+BSONObj makeExemplar(const BSONObj& obj) {
+    const int maxBytes = QueryShapeStats::kMaxExemplarBytes;
+    if (obj.objsize() <= maxBytes) {
+        return obj.getOwned();
+    }
+
+    const bool isArray = false;
+    const bool full = false;
+    std::string summary = obj.toString(isArray, full);
+    if (summary.size() > static_cast<size_t>(maxBytes)) {
+        summary.resize(maxBytes - 3);
+        summary += "...";
+    }
+    return BSON("$truncated" << summary);
+}
+
+}  // namespace
+
+const size_t QueryShapeStats::kNumLatencyBuckets;
+const long long QueryShapeStats::kFirstLatencyBucketMicros;
+const size_t QueryShapeStats::kNumStripes;
+const int QueryShapeStats::kMaxExemplarBytes;
+
+//
+// QueryShapeStats::ShapeStats
+//
+
+QueryShapeStats::ShapeStats::ShapeStats(StringData command, const CanonicalQuery& query)
+    : command(command.toString()),
+      ns(query.ns()),
+      key(query.getPlanCacheKey()),
+      query(makeExemplar(query.getParsed().getFilter())),
+      sort(makeExemplar(query.getParsed().getSort())),
+      projection(makeExemplar(query.getParsed().getProj())) {}
+
+void QueryShapeStats::ShapeStats::add(const Execution& execution) {
+    count++;
+    totalMicros += execution.micros;
+    maxMicros = std::max(maxMicros, execution.micros);
+    latencyHistogram[latencyBucket(execution.micros)]++;
+    keysExamined += execution.keysExamined;
+    docsExamined += execution.docsExamined;
+    nreturned += execution.nreturned;
+}
+
+BSONObj QueryShapeStats::ShapeStats::toBSON() const {
+    BSONObjBuilder bob;
+    bob.append("command", command);
+    bob.append("ns", ns);
+    bob.append("shapeHash", integerToHex(key.hash()));
+    bob.append("query", query);
+    bob.append("sort", sort);
+    bob.append("projection", projection);
+    bob.append("count", count);
+
+    {
+        BSONObjBuilder latencyBob(bob.subobjStart("latencyMicros"));
+        latencyBob.append("total", totalMicros);
+        latencyBob.append("max", maxMicros);
+
+        // Only the buckets which counted executions are reported.
+        BSONArrayBuilder histogramBob(latencyBob.subarrayStart("histogram"));
+        for (size_t i = 0; i < kNumLatencyBuckets; i++) {
+            if (latencyHistogram[i]) {
+                histogramBob.append(BSON("lowerBound" << latencyBucketLowerBound(i) << "count"
+                                                      << latencyHistogram[i]));
+            }
+        }
+    }
+
+    bob.append("keysExamined", keysExamined);
+    bob.append("docsExamined", docsExamined);
+    bob.append("nreturned", nreturned);
+    return bob.obj();
+}
+
+//
+// QueryShapeStats
+//
+
+// static
+QueryShapeStats& QueryShapeStats::get(ServiceContext* service) {
+    return getQueryShapeStats(service);
+}
+
+// static
+size_t QueryShapeStats::latencyBucket(long long micros) {
+    size_t bucket = 0;
+    for (long long bound = kFirstLatencyBucketMicros;
+         micros >= bound && bucket < kNumLatencyBuckets - 1;
+         bound *= 2) {
+        bucket++;
+    }
+    return bucket;
+}
+
+QueryShapeStats::QueryShapeStats(size_t numStripes) : _stripes(numStripes) {}
+
+QueryShapeStats::~QueryShapeStats() = default;
+
+void QueryShapeStats::record(StringData command,
+                             const CanonicalQuery& query,
+                             const Execution& execution) {
+    const int maxShapes = internalQueryShapeStatsMaxShapes.load();
+    if (maxShapes <= 0) {
+        return;
+    }
+    const size_t maxStripeShapes = (maxShapes + _stripes.size() - 1) / _stripes.size();
+
+    const PlanCacheKey& key = query.getPlanCacheKey();
+    Stripe& stripe = _stripes[key.hash() % _stripes.size()];
+    stdx::lock_guard<stdx::mutex> lock(stripe.mutex);
+
+    auto range = stripe.shapesByKey.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        ShapeList::iterator shape = it->second;
+        if (shape->command == command && shape->ns == query.ns()) {
+            // Mark the shape as the most recently executed.
+            stripe.shapes.splice(stripe.shapes.begin(), stripe.shapes, shape);
+            shape->add(execution);
+            return;
+        }
+    }
+
+    stripe.shapes.emplace_front(command, query);
+    stripe.shapes.front().add(execution);
+    stripe.shapesByKey.emplace(key, stripe.shapes.begin());
+
+    // Evict the least recently executed shapes.
+    while (stripe.shapes.size() > maxStripeShapes) {
+        ShapeList::iterator victim = std::prev(stripe.shapes.end());
+        auto victimRange = stripe.shapesByKey.equal_range(victim->key);
+        for (auto it = victimRange.first; it != victimRange.second; ++it) {
+            if (it->second == victim) {
+                stripe.shapesByKey.erase(it);
+                break;
+            }
+        }
+        stripe.shapes.erase(victim);
+    }
+}
+
+std::vector<QueryShapeStats::ShapeStats> QueryShapeStats::getStats() const {
+    return _getStats(nullptr);
+}
+
+std::vector<QueryShapeStats::ShapeStats> QueryShapeStats::getStats(StringData ns) const {
+    return _getStats(&ns);
+}
+
+std::vector<QueryShapeStats::ShapeStats> QueryShapeStats::_getStats(const StringData* ns) const {
+    std::vector<ShapeStats> stats;
+    for (const Stripe& stripe : _stripes) {
+        stdx::lock_guard<stdx::mutex> lock(stripe.mutex);
+        for (const ShapeStats& shape : stripe.shapes) {
+            if (!ns || shape.ns == *ns) {
+                stats.push_back(shape);
+            }
+        }
+    }
+
+    std::stable_sort(stats.begin(),
+                     stats.end(),
+                     [](const ShapeStats& lhs, const ShapeStats& rhs) {
+                         return lhs.totalMicros > rhs.totalMicros;
+                     });
+    return stats;
+}
+
+void QueryShapeStats::clear() {
+    for (Stripe& stripe : _stripes) {
+        stdx::lock_guard<stdx::mutex> lock(stripe.mutex);
+        stripe.shapes.clear();
+        stripe.shapesByKey.clear();
+    }
+}
+
+}  // namespace mongo
@@ -0,0 +1,170 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <array>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/query/plan_cache_key.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+class CanonicalQuery;
+class ServiceContext;
+
+/**
+ * Aggregates execution statistics of queries by command, collection and query shape, where the
+ * shape is identified by the plan cache key of the query. The statistics are always collected and
+ * are held in a bounded number of entries, evicting the least recently executed shapes first.
+ *
+ * Shapes are spread over a fixed number of stripes by the hash of their key, each stripe with its
+ * own lock and entries, so that recording different shapes does not contend on a single lock.
+ * Every shape lives in exactly one stripe, and each stripe holds at most its share of
+ * internalQueryShapeStatsMaxShapes.
+ */
+class QueryShapeStats {
+    MONGO_DISALLOW_COPYING(QueryShapeStats);
+
+public:
+    // Latency histograms have kNumLatencyBuckets buckets. The first counts executions which took
+    // less than kFirstLatencyBucketMicros, and each following bucket starts at twice the lower
+    // bound of the previous one. The last bucket is unbounded.
+    static const size_t kNumLatencyBuckets = 20;
+    static const long long kFirstLatencyBucketMicros = 128;
+
+    static const size_t kNumStripes = 16;
+
+    // The filter, sort and projection kept as an example of a shape are replaced by a truncated
+    // string summary when larger than this.
+    static const int kMaxExemplarBytes = 1024;
+
+    /**
+     * What is recorded about a single execution of a query.
+     */
+    struct Execution {
+        long long micros;
+        long long keysExamined;
+        long long docsExamined;
+        long long nreturned;
+    };
+
+    /**
+     * Statistics of a query shape.
+     */
+    struct ShapeStats {
+        ShapeStats() = default;
+        ShapeStats(StringData command, const CanonicalQuery& query);
+
+        void add(const Execution& execution);
+
+        /**
+         * Returns the statistics as reported by the queryShapeStats command and the
+         * $queryShapeStats aggregation stage.
+         */
+        BSONObj toBSON() const;
+
+        // Name of the command which executed the query, such as "find" or "count".
+        std::string command;
+        std::string ns;
+        PlanCacheKey key;
+
+        // Filter, sort and projection of the first execution recorded for the shape, each
+        // truncated to kMaxExemplarBytes.
+        BSONObj query;
+        BSONObj sort;
+        BSONObj projection;
+
+        long long count = 0;
+        long long totalMicros = 0;
+        long long maxMicros = 0;
+        std::array<long long, kNumLatencyBuckets> latencyHistogram{};
+        long long keysExamined = 0;
+        long long docsExamined = 0;
+        long long nreturned = 0;
+    };
+
+    static QueryShapeStats& get(ServiceContext* service);
+
+    /**
+     * Returns the latency histogram bucket that an execution taking 'micros' falls into.
+     */
+    static size_t latencyBucket(long long micros);
+
+    explicit QueryShapeStats(size_t numStripes = kNumStripes);
+    ~QueryShapeStats();
+
+    /**
+     * Adds 'execution' to the statistics of the shape of 'query' as executed by 'command'. Has no
+     * effect if internalQueryShapeStatsMaxShapes is not positive.
+     */
+    void record(StringData command, const CanonicalQuery& query, const Execution& execution);
+
+    /**
+     * Returns the statistics of all shapes, or of the shapes of collection 'ns', in descending
+     * order of total latency.
+     */
+    std::vector<ShapeStats> getStats() const;
+    std::vector<ShapeStats> getStats(StringData ns) const;
+
+    void clear();
+
+private:
+    typedef std::list<ShapeStats> ShapeList;
+
+    // Shapes of the same key executed by different commands or on different collections share
+    // the key, and are told apart by scanning the entries of the key.
+    typedef std::unordered_multimap<PlanCacheKey, ShapeList::iterator, PlanCacheKey::Hasher>
+        ShapeMap;
+
+    /**
+     * Statistics of the shapes whose key hashes to the stripe.
+     */
+    struct Stripe {
+        mutable stdx::mutex mutex;
+
+        // Most recently executed shape first.
+        ShapeList shapes;
+
+        // Indexes 'shapes' by key.
+        ShapeMap shapesByKey;
+    };
+
+    std::vector<ShapeStats> _getStats(const StringData* ns) const;
+
+    std::vector<Stripe> _stripes;
+};
+
+}  // namespace mongo
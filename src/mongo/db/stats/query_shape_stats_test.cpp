@@ -0,0 +1,267 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/stats/query_shape_stats.h"
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "mongo/db/json.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+const NamespaceString nss("test.collection");
+const NamespaceString otherNss("test.other");
+
+std::unique_ptr<CanonicalQuery> canonicalize(const NamespaceString& ns, const char* queryStr) {
+    auto statusWithCQ = CanonicalQuery::canonicalize(ns, fromjson(queryStr));
+    ASSERT_OK(statusWithCQ.getStatus());
+    return std::move(statusWithCQ.getValue());
+}
+
+QueryShapeStats::Execution execution(long long micros, long long nreturned) {
+    return {micros, 2 * nreturned, 3 * nreturned, nreturned};
+}
+
+/**
+ * Sets internalQueryShapeStatsMaxShapes for the lifetime of the object.
+ */
+class ScopedMaxShapes {
+public:
+    explicit ScopedMaxShapes(int maxShapes)
+        : _oldMaxShapes(internalQueryShapeStatsMaxShapes.load()) {
+        internalQueryShapeStatsMaxShapes.store(maxShapes);
+    }
+
+    ~ScopedMaxShapes() {
+        internalQueryShapeStatsMaxShapes.store(_oldMaxShapes);
+    }
+
+private:
+    const int _oldMaxShapes;
+};
+
+TEST(QueryShapeStatsTest, LatencyBucket) {
+    const long long first = QueryShapeStats::kFirstLatencyBucketMicros;
+    ASSERT_EQUALS(0U, QueryShapeStats::latencyBucket(0));
+    ASSERT_EQUALS(0U, QueryShapeStats::latencyBucket(first - 1));
+    ASSERT_EQUALS(1U, QueryShapeStats::latencyBucket(first));
+    ASSERT_EQUALS(1U, QueryShapeStats::latencyBucket(2 * first - 1));
+    ASSERT_EQUALS(2U, QueryShapeStats::latencyBucket(2 * first));
+    ASSERT_EQUALS(QueryShapeStats::kNumLatencyBuckets - 1,
+                  QueryShapeStats::latencyBucket(std::numeric_limits<long long>::max()));
+}
+
+TEST(QueryShapeStatsTest, RecordAggregatesExecutionsOfSameShape) {
+    QueryShapeStats stats;
+    stats.record("find", *canonicalize(nss, "{a: 1}"), execution(10, 1));
+    stats.record("find", *canonicalize(nss, "{a: 5}"), execution(1000, 2));
+    stats.record("find", *canonicalize(nss, "{b: 1}"), execution(20, 3));
+
+    std::vector<QueryShapeStats::ShapeStats> shapes = stats.getStats();
+    ASSERT_EQUALS(2U, shapes.size());
+
+    // Most expensive shape first.
+    const QueryShapeStats::ShapeStats& shape = shapes[0];
+    ASSERT_EQUALS(nss.ns(), shape.ns);
+    std::unique_ptr<CanonicalQuery> sameShape = canonicalize(nss, "{a: 3}");
+    ASSERT_EQUALS(sameShape->getPlanCacheKey(), shape.key);
+    ASSERT_EQUALS(fromjson("{a: 1}"), shape.query);
+    ASSERT_EQUALS(2, shape.count);
+    ASSERT_EQUALS(1010, shape.totalMicros);
+    ASSERT_EQUALS(1000, shape.maxMicros);
+    ASSERT_EQUALS(1, shape.latencyHistogram[QueryShapeStats::latencyBucket(10)]);
+    ASSERT_EQUALS(1, shape.latencyHistogram[QueryShapeStats::latencyBucket(1000)]);
+    ASSERT_EQUALS(6, shape.keysExamined);
+    ASSERT_EQUALS(9, shape.docsExamined);
+    ASSERT_EQUALS(3, shape.nreturned);
+
+    ASSERT_EQUALS(fromjson("{b: 1}"), shapes[1].query);
+    ASSERT_EQUALS(1, shapes[1].count);
+}
+
+TEST(QueryShapeStatsTest, ShapesAreTrackedPerNamespace) {
+    QueryShapeStats stats;
+    stats.record("find", *canonicalize(nss, "{a: 1}"), execution(10, 1));
+    stats.record("find", *canonicalize(otherNss, "{a: 1}"), execution(20, 1));
+
+    ASSERT_EQUALS(2U, stats.getStats().size());
+
+    std::vector<QueryShapeStats::ShapeStats> shapes = stats.getStats(otherNss.ns());
+    ASSERT_EQUALS(1U, shapes.size());
+    ASSERT_EQUALS(otherNss.ns(), shapes[0].ns);
+    ASSERT_EQUALS(20, shapes[0].totalMicros);
+
+    stats.clear();
+    ASSERT_TRUE(stats.getStats().empty());
+}
+
+TEST(QueryShapeStatsTest, EvictsLeastRecentlyExecutedShape) {
+    ScopedMaxShapes maxShapes(2);
+
+    // A single stripe holds all the shapes.
+    QueryShapeStats stats(1);
+    stats.record("find", *canonicalize(nss, "{a: 1}"), execution(10, 1));
+    stats.record("find", *canonicalize(nss, "{b: 1}"), execution(20, 1));
+    stats.record("find", *canonicalize(nss, "{a: 1}"), execution(10, 1));
+    stats.record("find", *canonicalize(nss, "{c: 1}"), execution(30, 1));
+
+    std::vector<QueryShapeStats::ShapeStats> shapes = stats.getStats();
+    ASSERT_EQUALS(2U, shapes.size());
+    ASSERT_EQUALS(fromjson("{c: 1}"), shapes[0].query);
+    ASSERT_EQUALS(fromjson("{a: 1}"), shapes[1].query);
+    ASSERT_EQUALS(2, shapes[1].count);
+}
+
+TEST(QueryShapeStatsTest, EvictsOnlyTheShapeOfTheSameKey) {
+    ScopedMaxShapes maxShapes(2);
+
+    // Both shapes have the same key, and the least recently executed one is evicted.
+    QueryShapeStats stats(1);
+    std::unique_ptr<CanonicalQuery> cq = canonicalize(nss, "{a: 1}");
+    stats.record("find", *cq, execution(10, 1));
+    stats.record("count", *cq, execution(20, 1));
+    stats.record("find", *cq, execution(10, 1));
+    stats.record("distinct", *cq, execution(30, 1));
+
+    std::vector<QueryShapeStats::ShapeStats> shapes = stats.getStats();
+    ASSERT_EQUALS(2U, shapes.size());
+    ASSERT_EQUALS("distinct", shapes[0].command);
+    ASSERT_EQUALS("find", shapes[1].command);
+    ASSERT_EQUALS(2, shapes[1].count);
+
+    stats.record("count", *cq, execution(40, 1));
+    shapes = stats.getStats();
+    ASSERT_EQUALS(2U, shapes.size());
+    ASSERT_EQUALS("count", shapes[0].command);
+    ASSERT_EQUALS(1, shapes[0].count);
+    ASSERT_EQUALS("distinct", shapes[1].command);
+}
+
+TEST(QueryShapeStatsTest, ShapesAreTrackedPerCommand) {
+    QueryShapeStats stats;
+    std::unique_ptr<CanonicalQuery> cq = canonicalize(nss, "{a: 1}");
+    stats.record("find", *cq, execution(10, 1));
+    stats.record("count", *cq, execution(20, 1));
+    stats.record("count", *cq, execution(20, 1));
+
+    std::vector<QueryShapeStats::ShapeStats> shapes = stats.getStats();
+    ASSERT_EQUALS(2U, shapes.size());
+    ASSERT_EQUALS("count", shapes[0].command);
+    ASSERT_EQUALS(2, shapes[0].count);
+    ASSERT_EQUALS("find", shapes[1].command);
+    ASSERT_EQUALS(1, shapes[1].count);
+}
+
+TEST(QueryShapeStatsTest, TruncatesLargeExemplars) {
+    BSONArrayBuilder values;
+    for (int i = 0; i < QueryShapeStats::kMaxExemplarBytes; i++) {
+        values.append(i);
+    }
+    BSONObj filter = BSON("a" << BSON("$in" << values.arr()));
+    auto statusWithCQ = CanonicalQuery::canonicalize(nss, filter);
+    ASSERT_OK(statusWithCQ.getStatus());
+
+    QueryShapeStats stats;
+    stats.record("find", *statusWithCQ.getValue(), execution(10, 1));
+
+    std::vector<QueryShapeStats::ShapeStats> shapes = stats.getStats();
+    ASSERT_EQUALS(1U, shapes.size());
+    BSONObj query = shapes[0].query;
+    ASSERT_EQUALS(1, query.nFields());
+    ASSERT_EQUALS(String, query["$truncated"].type());
+    ASSERT_LESS_THAN_OR_EQUALS(query["$truncated"].valueStringData().size(),
+                               static_cast<size_t>(QueryShapeStats::kMaxExemplarBytes));
+    ASSERT_LESS_THAN_OR_EQUALS(query.objsize(), 2 * QueryShapeStats::kMaxExemplarBytes);
+}
+
+TEST(QueryShapeStatsTest, DisabledWithoutMaxShapes) {
+    ScopedMaxShapes maxShapes(0);
+
+    QueryShapeStats stats;
+    stats.record("find", *canonicalize(nss, "{a: 1}"), execution(10, 1));
+    ASSERT_TRUE(stats.getStats().empty());
+}
+
+TEST(QueryShapeStatsTest, RecordsFromManyThreads) {
+    const size_t kThreads = 8;
+    const int kExecutionsPerThread = 100;
+
+    QueryShapeStats stats;
+    std::unique_ptr<CanonicalQuery> cq = canonicalize(nss, "{a: {$gt: 1}}");
+
+    std::vector<stdx::thread> threads;
+    for (size_t i = 0; i < kThreads; i++) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < kExecutionsPerThread; j++) {
+                stats.record("find", *cq, execution(1, 1));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<QueryShapeStats::ShapeStats> shapes = stats.getStats();
+    ASSERT_EQUALS(1U, shapes.size());
+    const long long expected = kThreads * kExecutionsPerThread;
+    ASSERT_EQUALS(expected, shapes[0].count);
+    ASSERT_EQUALS(expected, shapes[0].totalMicros);
+    ASSERT_EQUALS(expected, shapes[0].latencyHistogram[0]);
+    ASSERT_EQUALS(expected, shapes[0].nreturned);
+}
+
+TEST(QueryShapeStatsTest, ToBSON) {
+    QueryShapeStats stats;
+    std::unique_ptr<CanonicalQuery> cq = canonicalize(nss, "{a: 1}");
+    stats.record("find", *cq, execution(10, 1));
+    stats.record("find", *cq, execution(200, 1));
+
+    BSONObj obj = stats.getStats()[0].toBSON();
+    ASSERT_EQUALS("find", obj["command"].String());
+    ASSERT_EQUALS(nss.ns(), obj["ns"].String());
+    ASSERT_EQUALS(fromjson("{a: 1}"), obj["query"].Obj());
+    ASSERT_EQUALS(2, obj["count"].numberLong());
+    ASSERT_EQUALS(fromjson("{total: 210, max: 200, histogram: [{lowerBound: 0, count: 1},"
+                           "{lowerBound: 128, count: 1}]}"),
+                  obj["latencyMicros"].Obj());
+    ASSERT_EQUALS(4, obj["keysExamined"].numberLong());
+    ASSERT_EQUALS(6, obj["docsExamined"].numberLong());
+    ASSERT_EQUALS(2, obj["nreturned"].numberLong());
+}
+
+}  // namespace
+}  // namespace mongo
@@ -67,6 +67,18 @@ Top::CollectionData::CollectionData(const CollectionData& older, const Collectio
       remove(older.remove, newer.remove),
       commands(older.commands, newer.commands) {}
 
+void Top::CollectionData::add(const CollectionData& other) {
+    total.add(other.total);
+    readLock.add(other.readLock);
+    writeLock.add(other.writeLock);
+    queries.add(other.queries);
+    getmore.add(other.getmore);
+    insert.add(other.insert);
+    update.add(other.update);
+    remove.add(other.remove);
+    commands.add(other.commands);
+}
+
 // static
 Top& Top::get(ServiceContext* service) {
     return getTop(service);
@@ -79,17 +91,22 @@ void Top::record(StringData ns, LogicalOp logicalOp, int lockType, long long mic
     auto hashedNs = UsageMap::HashedKey(ns);
 
     // cout << "record: " << ns << "\t" << op << "\t" << command << endl;
-    stdx::lock_guard<SimpleMutex> lk(_lock);
+    Partition& partition = _partitionForCurrentThread();
+    stdx::lock_guard<SimpleMutex> lk(partition.lock);
 
-    if ((command || logicalOp == LogicalOp::opQuery) && ns == _lastDropped) {
-        _lastDropped = "";
+    if ((command || logicalOp == LogicalOp::opQuery) && ns == partition.lastDropped) {
+        partition.lastDropped = "";
         return;
     }
 
-    CollectionData& coll = _usage[hashedNs];
+    CollectionData& coll = partition.usage[hashedNs];
     _record(coll, logicalOp, lockType, micros);
 }
 
+Top::Partition& Top::_partitionForCurrentThread() {
+    return _partitions[currentThreadStripeIndex() % kNumPartitions];
+}
+
 void Top::_record(CollectionData& c, LogicalOp logicalOp, int lockType, long long micros) {
     c.total.inc(micros);
 
@@ -128,19 +145,32 @@ void Top::_record(CollectionData& c, LogicalOp logicalOp, int lockType, long lon
 }
 
 void Top::collectionDropped(StringData ns) {
-    stdx::lock_guard<SimpleMutex> lk(_lock);
-    _usage.erase(ns);
-    _lastDropped = ns.toString();
+    for (auto& partition : _partitions) {
+        stdx::lock_guard<SimpleMutex> lk(partition.lock);
+        partition.usage.erase(ns);
+    }
+
+    // The operation that dropped the collection is recorded afterwards by this same thread, so
+    // only this thread's partition needs to know to skip it.
+    Partition& partition = _partitionForCurrentThread();
+    stdx::lock_guard<SimpleMutex> lk(partition.lock);
+    partition.lastDropped = ns.toString();
 }
 
 void Top::cloneMap(Top::UsageMap& out) const {
-    stdx::lock_guard<SimpleMutex> lk(_lock);
-    out = _usage;
+    out = UsageMap();
+    for (const auto& partition : _partitions) {
+        stdx::lock_guard<SimpleMutex> lk(partition.lock);
+        for (const auto& entry : partition.usage) {
+            out[entry.first].add(entry.second);
+        }
+    }
 }
 
 void Top::append(BSONObjBuilder& b) {
-    stdx::lock_guard<SimpleMutex> lk(_lock);
-    _appendToUsageMap(b, _usage);
+    UsageMap usage;
+    cloneMap(usage);
+    _appendToUsageMap(b, usage);
 }
 
 void Top::_appendToUsageMap(BSONObjBuilder& b, const UsageMap& map) const {
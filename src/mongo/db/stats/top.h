@@ -32,6 +32,7 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/striped_counter.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/string_map.h"
 
@@ -41,6 +42,10 @@ class ServiceContext;
 
 /**
  * tracks usage by collection
+ *
+ * The usage map is partitioned, and each thread records into the partition picked by
+ * currentThreadStripeIndex(), so that threads recording at the same time rarely contend on a
+ * lock. Readers merge all of the partitions.
  */
 class Top {
 public:
@@ -58,6 +63,11 @@ public:
             count++;
             time += micros;
         }
+
+        void add(const UsageData& other) {
+            count += other.count;
+            time += other.time;
+        }
     };
 
     struct CollectionData {
@@ -67,6 +77,11 @@ public:
         CollectionData() {}
         CollectionData(const CollectionData& older, const CollectionData& newer);
 
+        /**
+         * adds the usage recorded in 'other' to this
+         */
+        void add(const CollectionData& other);
+
         UsageData total;
 
         UsageData readLock;
@@ -93,9 +108,19 @@ private:
     void _appendStatsEntry(BSONObjBuilder& b, const char* statsName, const UsageData& map) const;
     void _record(CollectionData& c, LogicalOp logicalOp, int lockType, long long micros);
 
-    mutable SimpleMutex _lock;
-    UsageMap _usage;
-    std::string _lastDropped;
+    static const size_t kNumPartitions = 16;
+
+    struct Partition {
+        mutable SimpleMutex lock;
+        UsageMap usage;
+
+        // The namespace last dropped by a thread that records into this partition.
+        std::string lastDropped;
+    };
+
+    Partition& _partitionForCurrentThread();
+
+    Partition _partitions[kNumPartitions];
 };
 
 }  // namespace mongo
@@ -28,7 +28,10 @@
 
 #include "mongo/platform/basic.h"
 
+#include <vector>
+
 #include "mongo/db/stats/top.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/unittest/unittest.h"
 
 namespace {
@@ -39,4 +42,54 @@ TEST(TopTest, CollectionDropped) {
     Top().collectionDropped("coll");
 }
 
+void recordFromThreads(Top* top, int numThreads, StringData ns, LogicalOp op, int lockType) {
+    std::vector<stdx::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back([=] { top->record(ns, op, lockType, 10, false); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+TEST(TopTest, MergesUsageRecordedByManyThreads) {
+    Top top;
+    recordFromThreads(&top, 40, "test.coll", LogicalOp::opInsert, 1);
+    recordFromThreads(&top, 20, "test.coll", LogicalOp::opQuery, -1);
+    recordFromThreads(&top, 5, "test.other", LogicalOp::opUpdate, 1);
+
+    Top::UsageMap usage;
+    top.cloneMap(usage);
+    ASSERT_EQUALS(2U, usage.size());
+
+    const Top::CollectionData& coll = usage["test.coll"];
+    ASSERT_EQUALS(60, coll.total.count);
+    ASSERT_EQUALS(600, coll.total.time);
+    ASSERT_EQUALS(40, coll.insert.count);
+    ASSERT_EQUALS(40, coll.writeLock.count);
+    ASSERT_EQUALS(20, coll.queries.count);
+    ASSERT_EQUALS(20, coll.readLock.count);
+    ASSERT_EQUALS(5, usage["test.other"].update.count);
+}
+
+TEST(TopTest, CollectionDroppedRemovesUsageFromAllThreads) {
+    Top top;
+    recordFromThreads(&top, 40, "test.coll", LogicalOp::opInsert, 1);
+    recordFromThreads(&top, 5, "test.other", LogicalOp::opInsert, 1);
+
+    top.collectionDropped("test.coll");
+
+    // The command that dropped the collection is not recorded against it.
+    top.record("test.coll", LogicalOp::opCommand, 1, 10, true);
+
+    Top::UsageMap usage;
+    top.cloneMap(usage);
+    ASSERT_EQUALS(1U, usage.size());
+    ASSERT_EQUALS(5, usage["test.other"].insert.count);
+
+    top.record("test.coll", LogicalOp::opInsert, 1, 10, false);
+    top.cloneMap(usage);
+    ASSERT_EQUALS(1, usage["test.coll"].insert.count);
+}
+
 }  // namespace
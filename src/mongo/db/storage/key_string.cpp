@@ -550,6 +550,45 @@ void KeyString::_appendNumberInt(const int num, bool invert) {
     _appendInteger(num, invert);
 }
 
+// static
+bool KeyString::canEncode(const BSONObj& obj) {
+    for (BSONElement elem : obj) {
+        switch (elem.type()) {
+            case MinKey:
+            case MaxKey:
+            case EOO:
+            case Undefined:
+            case jstNULL:
+            case NumberDouble:
+            case String:
+            case BinData:
+            case jstOID:
+            case Bool:
+            case Date:
+            case RegEx:
+            case DBRef:
+            case Symbol:
+            case Code:
+            case CodeWScope:
+            case NumberInt:
+            case bsonTimestamp:
+            case NumberLong:
+                break;
+
+            case Object:
+            case Array:
+                if (!canEncode(elem.Obj())) {
+                    return false;
+                }
+                break;
+
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
 void KeyString::_appendBsonValue(const BSONElement& elem, bool invert, const StringData* name) {
     if (name) {
         _appendBytes(name->rawData(), name->size() + 1, invert);  // + 1 for NUL
@@ -228,6 +228,12 @@ public:
     static BSONObj toBson(StringData data, Ordering ord, const TypeBits& types);
     static BSONObj toBson(const char* buffer, size_t len, Ordering ord, const TypeBits& types);
 
+    /**
+     * Returns whether every value of 'obj', including those nested in objects and arrays, is of a
+     * type that can be encoded. resetToKey() must only be called on objects for which it is.
+     */
+    static bool canEncode(const BSONObj& obj);
+
     /**
      * Decodes a RecordId from the end of a buffer.
      */
@@ -156,6 +156,19 @@ TEST(KeyStringTest, AllTypesSimple) {
     ROUNDTRIP(BSON("" << 1235123123123LL));
 }
 
+TEST(KeyStringTest, CanEncode) {
+    ASSERT_TRUE(KeyString::canEncode(BSONObj()));
+    ASSERT_TRUE(KeyString::canEncode(BSON("" << 5 << "" << BSON("a" << 5.5))));
+    ASSERT_TRUE(KeyString::canEncode(BSON("" << BSON_ARRAY(1 << BSON("b" << MINKEY)))));
+
+    if (Decimal128::enabled) {
+        const Decimal128 decimal("1.5");
+        ASSERT_FALSE(KeyString::canEncode(BSON("" << decimal)));
+        ASSERT_FALSE(KeyString::canEncode(BSON("" << 1 << "" << BSON("a" << decimal))));
+        ASSERT_FALSE(KeyString::canEncode(BSON("" << BSON_ARRAY(1 << BSON_ARRAY(decimal)))));
+    }
+}
+
 TEST(KeyStringTest, Array1) {
     BSONObj emptyArray = BSON("" << BSONArray());
 
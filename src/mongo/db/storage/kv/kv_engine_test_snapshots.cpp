@@ -31,6 +31,7 @@
 #include <memory>
 #include <string>
 
+#include "mongo/bson/mutable/damage_vector.h"
 #include "mongo/db/operation_context_noop.h"
 #include "mongo/db/service_context_noop.h"
 #include "mongo/db/storage/kv/kv_engine.h"
@@ -129,6 +130,19 @@ public:
         wuow.commit();
     }
 
+    /**
+     * Overwrites the second character of the record with 'replacement' through a single damage.
+     */
+    void updateRecordWithDamagesAndCommit(RecordId id, char replacement) {
+        auto op = makeOperation();
+        WriteUnitOfWork wuow(op);
+        mutablebson::DamageVector damages;
+        damages.push_back(mutablebson::DamageEvent{0, 1, 1});
+        ASSERT_OK(rs->updateWithDamages(op, id, rs->dataFor(op, id), &replacement, damages)
+                      .getStatus());
+        wuow.commit();
+    }
+
     void deleteRecordAndCommit(RecordId id) {
         auto op = makeOperation();
         WriteUnitOfWork wuow(op);
@@ -339,8 +353,12 @@ TEST_F(SnapshotManagerTests, UpdateAndDelete) {
     updateRecordAndCommit(id, "Cat");
     auto snapCat = prepareAndCreateSnapshot();
 
-    // Untested since no engine currently supports both updateWithDamanges and snapshots.
-    ASSERT(!rs->updateWithDamagesSupported());
+    if (rs->updateWithDamagesSupported()) {
+        updateRecordWithDamagesAndCommit(id, 'o');
+    } else {
+        updateRecordAndCommit(id, "Cow");
+    }
+    auto snapCow = prepareAndCreateSnapshot();
 
     deleteRecordAndCommit(id);
     auto snapAfterDelete = prepareAndCreateSnapshot();
@@ -357,6 +375,10 @@ TEST_F(SnapshotManagerTests, UpdateAndDelete) {
     ASSERT_EQ(itCountCommitted(), 1);
     ASSERT_EQ(readStringCommitted(id), "Cat");
 
+    snapshotManager->setCommittedSnapshot(snapCow);
+    ASSERT_EQ(itCountCommitted(), 1);
+    ASSERT_EQ(readStringCommitted(id), "Cow");
+
     snapshotManager->setCommittedSnapshot(snapAfterDelete);
     ASSERT_EQ(itCountCommitted(), 0);
     ASSERT(!readRecordCommitted(id));
@@ -107,6 +107,13 @@ public:
                 "Current storage engine does not support majority readConcerns"};
     }
 
+    /**
+     * Undoes setReadFromMajorityCommittedSnapshot(), so that the next snapshot sees the latest
+     * data again. Must not be called while a snapshot is open, for example call
+     * abandonSnapshot() first.
+     */
+    virtual void clearReadFromMajorityCommittedSnapshot() {}
+
     /**
      * Returns true if setReadFromMajorityCommittedSnapshot() has been called.
      */
@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <boost/optional.hpp>
 #include <limits>
 #include <string>
 
@@ -96,6 +97,15 @@ public:
      */
     virtual void dropAllSnapshots() = 0;
 
+    /**
+     * Returns lowest SnapshotName that could possibly be used by a future committed read, or
+     * boost::none if there is currently no committed snapshot.
+     *
+     * This should not be used for starting a transaction on this SnapshotName since the named
+     * snapshot may be deleted by the time you start the transaction.
+     */
+    virtual boost::optional<SnapshotName> getMinSnapshotForNextCommittedRead() const = 0;
+
 protected:
     /**
      * SnapshotManagers are not intended to be deleted through pointers to base type.
@@ -265,6 +265,59 @@ private:
     std::atomic<bool> _shuttingDown{false};  // NOLINT
 };
 
+class WiredTigerKVEngine::WiredTigerConcurrencyAdjuster : public BackgroundJob {
+public:
+    explicit WiredTigerConcurrencyAdjuster(WT_CONNECTION* conn)
+        : BackgroundJob(false /* deleteSelf */), _conn(conn) {}
+
+    virtual string name() const {
+        return "WTConcurrencyAdjuster";
+    }
+
+    virtual void run() {
+        Client::initThread(name().c_str());
+
+        LOG(1) << "starting " << name() << " thread";
+
+        // Whether tickets may have been taken out of circulation since adaptive concurrency was
+        // last disabled.
+        bool adjusted = false;
+        while (!_shuttingDown.load()) {
+            if (WiredTigerRecoveryUnit::isAdaptiveConcurrencyEnabled()) {
+                WiredTigerRecoveryUnit::adjustConcurrency(_getCacheFillRatio());
+                adjusted = true;
+            } else if (adjusted) {
+                WiredTigerRecoveryUnit::restoreConcurrency();
+                adjusted = false;
+            }
+            sleepmillis(1000);
+        }
+        LOG(1) << "stopping " << name() << " thread";
+    }
+
+    void shutdown() {
+        _shuttingDown.store(true);
+        wait();
+    }
+
+private:
+    double _getCacheFillRatio() {
+        WiredTigerSession session(_conn);
+        WT_SESSION* s = session.getSession();
+        StatusWith<uint64_t> inUse = WiredTigerUtil::getStatisticsValueAs<uint64_t>(
+            s, "statistics:", "statistics=(fast)", WT_STAT_CONN_CACHE_BYTES_INUSE);
+        StatusWith<uint64_t> max = WiredTigerUtil::getStatisticsValueAs<uint64_t>(
+            s, "statistics:", "statistics=(fast)", WT_STAT_CONN_CACHE_BYTES_MAX);
+        if (!inUse.isOK() || !max.isOK() || max.getValue() == 0) {
+            return 0;
+        }
+        return static_cast<double>(inUse.getValue()) / max.getValue();
+    }
+
+    WT_CONNECTION* _conn;
+    std::atomic<bool> _shuttingDown{false};  // NOLINT
+};
+
 WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
                                        const std::string& path,
                                        const std::string& extraOpenOptions,
@@ -565,6 +618,9 @@ WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
         _journalFlusher->go();
     }
 
+    _concurrencyAdjuster = stdx::make_unique<WiredTigerConcurrencyAdjuster>(_conn);
+    _concurrencyAdjuster->go();
+
     _sizeStorerUri = "table:sizeStorer";
     {
         WiredTigerSession session(_conn);
@@ -752,6 +808,8 @@ void WiredTigerKVEngine::cleanShutdown() {
         _sizeStorer.reset(NULL);
         if (_journalFlusher)
             _journalFlusher->shutdown();
+        if (_concurrencyAdjuster)
+            _concurrencyAdjuster->shutdown();
         _sessionCache->shuttingDown();
 
 // We want WiredTiger to leak memory for faster shutdown except when we are running tools to
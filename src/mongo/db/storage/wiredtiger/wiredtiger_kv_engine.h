@@ -144,6 +144,7 @@ public:
 
 private:
     class WiredTigerJournalFlusher;
+    class WiredTigerConcurrencyAdjuster;
 
     Status _salvageIfNeeded(const char* uri);
     void _checkIdentPath(StringData ident);
@@ -162,6 +163,7 @@ private:
     bool _durable;
     bool _ephemeral;
     std::unique_ptr<WiredTigerJournalFlusher> _journalFlusher;
+    std::unique_ptr<WiredTigerConcurrencyAdjuster> _concurrencyAdjuster;
 
     std::string _rsOptions;
     std::string _indexOptions;
@@ -1402,7 +1402,7 @@ StatusWith<RecordId> WiredTigerRecordStore::updateRecord(OperationContext* txn,
 }
 
 bool WiredTigerRecordStore::updateWithDamagesSupported() const {
-    return false;
+    return true;
 }
 
 StatusWith<RecordData> WiredTigerRecordStore::updateWithDamages(
@@ -1411,7 +1411,30 @@ StatusWith<RecordData> WiredTigerRecordStore::updateWithDamages(
     const RecordData& oldRec,
     const char* damageSource,
     const mutablebson::DamageVector& damages) {
-    MONGO_UNREACHABLE;
+    // WiredTiger cannot modify part of a value, so the damages are applied to a copy of the old
+    // record which then replaces it. Damages never change the size of the record, so unlike
+    // updateRecord() there is no need to look up the existing value, adjust the data size or
+    // delete from a capped collection.
+    const int len = oldRec.size();
+    SharedBuffer data = SharedBuffer::allocate(len);
+    memcpy(data.get(), oldRec.data(), len);
+
+    for (const auto& damage : damages) {
+        invariant(damage.targetOffset + damage.size <= static_cast<size_t>(len));
+        memcpy(data.get() + damage.targetOffset, damageSource + damage.sourceOffset, damage.size);
+    }
+
+    WiredTigerCursor curwrap(_uri, _tableId, true, txn);
+    curwrap.assertInActiveTxn();
+    WT_CURSOR* c = curwrap.get();
+    invariant(c);
+    c->set_key(c, _makeKey(id));
+    WiredTigerItem value(data.get(), len);
+    c->set_value(c, value.Get());
+    int ret = WT_OP_CHECK(c->insert(c));
+    invariantWTOK(ret);
+
+    return RecordData(std::move(data), len);
 }
 
 void WiredTigerRecordStore::_oplogSetStartHack(WiredTigerRecoveryUnit* wru) const {
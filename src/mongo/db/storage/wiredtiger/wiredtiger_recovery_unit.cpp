@@ -33,6 +33,7 @@
 #include "mongo/base/checked_cast.h"
 #include "mongo/base/init.h"
 #include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/client.h"
 #include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_recovery_unit.h"
@@ -40,6 +41,7 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/mutex.h"
+#include "mongo/util/concurrency/admission_controller.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
@@ -209,11 +211,13 @@ class TicketServerParameter : public ServerParameter {
     MONGO_DISALLOW_COPYING(TicketServerParameter);
 
 public:
-    TicketServerParameter(TicketHolder* holder, const std::string& name)
-        : ServerParameter(ServerParameterSet::getGlobal(), name, true, true), _holder(holder) {}
+    TicketServerParameter(AdmissionController* admission, const std::string& name)
+        : ServerParameter(ServerParameterSet::getGlobal(), name, true, true),
+          _admission(admission),
+          _maxTickets(admission->getTicketHolder()->outof()) {}
 
     virtual void append(OperationContext* txn, BSONObjBuilder& b, const std::string& name) {
-        b.append(name, _holder->outof());
+        b.append(name, getMaxTickets());
     }
 
     virtual Status set(const BSONElement& newValueElement) {
@@ -235,36 +239,75 @@ public:
             return Status(ErrorCodes::BadValue, str::stream() << name() << " has to be > 0");
         }
 
-        return _holder->resize(newNum);
+        Status status = _admission->resize(newNum);
+        if (status.isOK()) {
+            _maxTickets.store(newNum);
+        }
+        return status;
+    }
+
+    /**
+     * Returns the configured number of tickets. With adaptive concurrency, this is the most
+     * tickets the TicketHolder is resized to.
+     */
+    int getMaxTickets() const {
+        return _maxTickets.load();
     }
 
 private:
-    TicketHolder* _holder;
+    AdmissionController* _admission;
+    AtomicInt32 _maxTickets;
 };
 
+// When enabled, the number of tickets is adapted to the load, with the values of
+// wiredTigerConcurrentWriteTransactions and wiredTigerConcurrentReadTransactions as upper bounds.
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerAdaptiveConcurrency, bool, false);
+
 TicketHolder openWriteTransaction(128);
-TicketServerParameter openWriteTransactionParam(&openWriteTransaction,
+AdmissionController writeAdmission(&openWriteTransaction);
+TicketServerParameter openWriteTransactionParam(&writeAdmission,
                                                 "wiredTigerConcurrentWriteTransactions");
 
 TicketHolder openReadTransaction(128);
-TicketServerParameter openReadTransactionParam(&openReadTransaction,
+AdmissionController readAdmission(&openReadTransaction);
+TicketServerParameter openReadTransactionParam(&readAdmission,
                                                "wiredTigerConcurrentReadTransactions");
+
+void appendTicketStats(const AdmissionController& admission, BSONObjBuilder* builder) {
+    // Tickets withheld by adaptive concurrency are neither out nor part of the total.
+    const TicketHolder* holder = admission.getTicketHolder();
+    const int withheld = admission.getWithheldTickets();
+    builder->append("out", holder->used() - withheld);
+    builder->append("available", holder->available());
+    builder->append("totalTickets", holder->outof() - withheld);
+    admission.appendStats(builder);
+}
+}
+
+bool WiredTigerRecoveryUnit::isAdaptiveConcurrencyEnabled() {
+    return wiredTigerAdaptiveConcurrency;
+}
+
+void WiredTigerRecoveryUnit::adjustConcurrency(double cacheFillRatio) {
+    writeAdmission.adjust(cacheFillRatio, openWriteTransactionParam.getMaxTickets());
+    readAdmission.adjust(cacheFillRatio, openReadTransactionParam.getMaxTickets());
+}
+
+void WiredTigerRecoveryUnit::restoreConcurrency() {
+    writeAdmission.restore();
+    readAdmission.restore();
 }
 
 void WiredTigerRecoveryUnit::appendGlobalStats(BSONObjBuilder& b) {
     BSONObjBuilder bb(b.subobjStart("concurrentTransactions"));
     {
         BSONObjBuilder bbb(bb.subobjStart("write"));
-        bbb.append("out", openWriteTransaction.used());
-        bbb.append("available", openWriteTransaction.available());
-        bbb.append("totalTickets", openWriteTransaction.outof());
+        appendTicketStats(writeAdmission, &bbb);
         bbb.done();
     }
     {
         BSONObjBuilder bbb(bb.subobjStart("read"));
-        bbb.append("out", openReadTransaction.used());
-        bbb.append("available", openReadTransaction.available());
-        bbb.append("totalTickets", openReadTransaction.outof());
+        appendTicketStats(readAdmission, &bbb);
         bbb.done();
     }
     bb.done();
@@ -302,6 +345,11 @@ Status WiredTigerRecoveryUnit::setReadFromMajorityCommittedSnapshot() {
     return Status::OK();
 }
 
+void WiredTigerRecoveryUnit::clearReadFromMajorityCommittedSnapshot() {
+    invariant(!_active);
+    _readFromMajorityCommittedSnapshot = false;
+}
+
 boost::optional<SnapshotName> WiredTigerRecoveryUnit::getMajorityCommittedSnapshot() const {
     if (!_readFromMajorityCommittedSnapshot)
         return {};
@@ -332,10 +380,16 @@ void WiredTigerRecoveryUnit::_getTicket(OperationContext* opCtx) {
         writeLocked = _everStartedWrite;
     }
 
-    TicketHolder* holder = writeLocked ? &openWriteTransaction : &openReadTransaction;
+    AdmissionController* admission = writeLocked ? &writeAdmission : &readAdmission;
+
+    // With adaptive concurrency, internal operations such as replication do not queue behind user
+    // operations, and use the reserved tickets instead.
+    const bool internal = wiredTigerAdaptiveConcurrency && opCtx != NULL &&
+        opCtx->getClient() != NULL && !opCtx->getClient()->isFromUserConnection();
+    const auto priority =
+        internal ? AdmissionController::Priority::kHigh : AdmissionController::Priority::kNormal;
 
-    holder->waitForTicket();
-    _ticket.reset(holder);
+    _ticket.reset(admission->admit(priority));
 }
 
 void WiredTigerRecoveryUnit::_txnOpen(OperationContext* opCtx) {
@@ -77,6 +77,7 @@ public:
     virtual SnapshotId getSnapshotId() const;
 
     Status setReadFromMajorityCommittedSnapshot() final;
+    void clearReadFromMajorityCommittedSnapshot() final;
     bool isReadingFromMajorityCommittedSnapshot() const final {
         return _readFromMajorityCommittedSnapshot;
     }
@@ -117,6 +118,20 @@ public:
 
     static void appendGlobalStats(BSONObjBuilder& b);
 
+    static bool isAdaptiveConcurrencyEnabled();
+
+    /**
+     * Adapts the number of transaction tickets to the load, given the fraction of the WiredTiger
+     * cache in use. Called periodically while wiredTigerAdaptiveConcurrency is enabled.
+     */
+    static void adjustConcurrency(double cacheFillRatio);
+
+    /**
+     * Puts back the transaction tickets taken out of circulation by adjustConcurrency(). Called
+     * once wiredTigerAdaptiveConcurrency is disabled.
+     */
+    static void restoreConcurrency();
+
     /**
      * Prepares this RU to be the basis for a named snapshot.
      *
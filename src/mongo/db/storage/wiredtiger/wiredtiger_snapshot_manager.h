@@ -56,6 +56,7 @@ public:
     void setCommittedSnapshot(const SnapshotName& name) final;
     void cleanupUnneededSnapshots() final;
     void dropAllSnapshots() final;
+    boost::optional<SnapshotName> getMinSnapshotForNextCommittedRead() const final;
 
     //
     // WT-specific methods
@@ -73,16 +74,6 @@ public:
      */
     SnapshotName beginTransactionOnCommittedSnapshot(WT_SESSION* session) const;
 
-    /**
-     * Returns lowest SnapshotName that could possibly be used by a future call to
-     * beginTransactionOnCommittedSnapshot, or boost::none if there is currently no committed
-     * snapshot.
-     *
-     * This should not be used for starting a transaction on this SnapshotName since the named
-     * snapshot may be deleted by the time you start the transaction.
-     */
-    boost::optional<SnapshotName> getMinSnapshotForNextCommittedRead() const;
-
 private:
     mutable stdx::mutex _mutex;  // Guards all members.
     boost::optional<SnapshotName> _committedSnapshot;
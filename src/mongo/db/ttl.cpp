@@ -34,6 +34,9 @@
 
 #include "mongo/db/ttl.h"
 
+#include <algorithm>
+#include <boost/optional.hpp>
+
 #include "mongo/base/counter.h"
 #include "mongo/db/auth/authorization_session.h"
 #include "mongo/db/auth/user_name.h"
@@ -45,8 +48,8 @@
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/commands/server_status_metric.h"
 #include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/curop.h"
 #include "mongo/db/db_raii.h"
-#include "mongo/db/exec/delete.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/db/ops/insert.h"
@@ -57,6 +60,7 @@
 #include "mongo/util/background.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/log.h"
+#include "mongo/util/scopeguard.h"
 
 namespace mongo {
 
@@ -69,14 +73,25 @@ using std::unique_ptr;
 
 Counter64 ttlPasses;
 Counter64 ttlDeletedDocuments;
+Counter64 ttlDeleteBatches;
+
+// Expired documents which were left after the first batch of the current pass over a TTL index and
+// have not been deleted yet.
+Counter64 ttlBacklog;
 
 ServerStatusMetricField<Counter64> ttlPassesDisplay("ttl.passes", &ttlPasses);
 ServerStatusMetricField<Counter64> ttlDeletedDocumentsDisplay("ttl.deletedDocuments",
                                                               &ttlDeletedDocuments);
+ServerStatusMetricField<Counter64> ttlDeleteBatchesDisplay("ttl.deleteBatches",
+                                                           &ttlDeleteBatches);
+ServerStatusMetricField<Counter64> ttlBacklogDisplay("ttl.backlog", &ttlBacklog);
 
 MONGO_EXPORT_SERVER_PARAMETER(ttlMonitorEnabled, bool, true);
 MONGO_EXPORT_SERVER_PARAMETER(ttlMonitorSleepSecs, int, 60);  // used for testing
 
+// Number of expired documents deleted together in one storage transaction.
+MONGO_EXPORT_SERVER_PARAMETER(ttlDeleteBatchSize, int, 256);
+
 class TTLMonitor : public BackgroundJob {
 public:
     TTLMonitor() {}
@@ -224,11 +239,154 @@ private:
 
         LOG(1) << "TTL -- ns: " << ns << " key: " << key;
 
+        // The expiration time is fixed for the whole pass over the index, so that documents which
+        // expire while the batches below run are left for the next pass.
+        boost::optional<Date_t> expirationTime;
+        long long numDeleted = 0;
+
+        // Index key from which the next batch starts, empty until the first batch has run.
+        BSONObj resumeKey;
+
+        // Expired documents counted after the first batch which are still accounted in
+        // ttlBacklog.
+        long long backlog = 0;
+        ON_BLOCK_EXIT([&] { ttlBacklog.decrement(backlog); });
+
+        // Delete the expired documents in index order, ttlDeleteBatchSize documents per
+        // WriteUnitOfWork. All the deletes of a batch, and their oplog entries, are committed
+        // together, and the locks are released between batches so that other operations on the
+        // collection are not held up by a large backlog.
+        for (bool firstBatch = true;; firstBatch = false) {
+            if (inShutdown() || !txn->checkForInterruptNoAssert().isOK()) {
+                LOG(1) << "\tTTL interrupted after deleting " << numDeleted << " documents";
+                return false;
+            }
+
+            const TTLBatchResult batchResult =
+                deleteExpiredBatch(txn, dbName, key, &idx, &expirationTime, &resumeKey);
+
+            if (batchResult.numDeleted > 0) {
+                numDeleted += batchResult.numDeleted;
+                ttlDeletedDocuments.increment(batchResult.numDeleted);
+                ttlDeleteBatches.increment();
+
+                const long long backlogDeleted = std::min(backlog, batchResult.numDeleted);
+                ttlBacklog.decrement(backlogDeleted);
+                backlog -= backlogDeleted;
+            }
+
+            if (batchResult.action != TTLBatchResult::kMoreBatches) {
+                LOG(1) << "\tTTL deleted: " << numDeleted << endl;
+                return batchResult.action != TTLBatchResult::kStopDatabase;
+            }
+
+            // Most passes are done in a single batch. Only when one is not, count what is left
+            // of the expired range, without holding up writers to the collection.
+            if (firstBatch) {
+                backlog = countExpiredKeys(txn, dbName, idx, resumeKey, *expirationTime);
+                ttlBacklog.increment(backlog);
+            }
+        }
+    }
+
+    /**
+     * Returns the number of keys of the TTL index 'idx' from 'startKey' up to 'expirationTime'.
+     * Yields while it scans. A document of a multikey index may have several expired keys, so this
+     * is an estimate of the expired documents.
+     */
+    long long countExpiredKeys(OperationContext* txn,
+                               const string& dbName,
+                               const BSONObj& idx,
+                               const BSONObj& startKey,
+                               Date_t expirationTime) {
+        const string ns = idx["ns"].String();
+        const BSONObj key = idx["key"].Obj();
+
+        ScopedTransaction scopedXact(txn, MODE_IS);
+        AutoGetDb autoDb(txn, dbName, MODE_IS);
+        Database* db = autoDb.getDb();
+        if (!db) {
+            return 0;
+        }
+
+        Lock::CollectionLock collLock(txn->lockState(), ns, MODE_IS);
+        Collection* collection = db->getCollection(ns);
+        if (!collection) {
+            return 0;
+        }
+
+        IndexDescriptor* desc = collection->getIndexCatalog()->findIndexByKeyPattern(txn, key);
+        if (!desc) {
+            return 0;
+        }
+
+        unique_ptr<PlanExecutor> exec = InternalPlanner::indexScan(txn,
+                                                                   collection,
+                                                                   desc,
+                                                                   startKey,
+                                                                   BSON("" << expirationTime),
+                                                                   true,  // endKeyInclusive
+                                                                   PlanExecutor::YIELD_AUTO,
+                                                                   scanDirection(key));
+
+        // The count only feeds the backlog metric, so a scan killed during a yield, for instance
+        // because the collection was dropped, just returns what it counted so far.
+        long long count = 0;
+        while (PlanExecutor::ADVANCED == exec->getNext(NULL, NULL)) {
+            ++count;
+        }
+        return count;
+    }
+
+    /**
+     * Returns the direction in which to scan the TTL index with key pattern 'key' so that the
+     * oldest keys come first.
+     */
+    static InternalPlanner::Direction scanDirection(const BSONObj& key) {
+        // The canonical check as to whether a key pattern element is "ascending" or
+        // "descending" is (elt.number() >= 0).  This is defined by the Ordering class.
+        return (key.firstElement().number() >= 0) ? InternalPlanner::Direction::FORWARD
+                                                  : InternalPlanner::Direction::BACKWARD;
+    }
+
+    struct TTLBatchResult {
+        enum Action {
+            // The expired range may still contain documents.
+            kMoreBatches,
+            // Processing of this index is done, either because the expired range is empty or
+            // because the index can't be used.
+            kIndexDone,
+            // Processing of all the TTL indexes of the database should stop.
+            kStopDatabase,
+        };
+
+        Action action;
+        long long numDeleted;
+    };
+
+    /**
+     * Deletes up to ttlDeleteBatchSize of the expired documents indexed by the TTL index 'idx',
+     * starting from the oldest, in a single WriteUnitOfWork.
+     *
+     * On the first call for an index, computes the '*expirationTime' for the pass. Each batch
+     * starts from '*resumeKey', or from the oldest key if it is empty, and sets it to the last
+     * key the batch read. Keys before it which are still in the index belong to documents that
+     * did not match the expiration filter when fetched, so the next batch skips them.
+     */
+    TTLBatchResult deleteExpiredBatch(OperationContext* txn,
+                                      const string& dbName,
+                                      const BSONObj& key,
+                                      BSONObj* idx,
+                                      boost::optional<Date_t>* expirationTime,
+                                      BSONObj* resumeKey) {
+        const string ns = (*idx)["ns"].String();
+        NamespaceString nss(ns);
+
         ScopedTransaction scopedXact(txn, MODE_IX);
         AutoGetDb autoDb(txn, dbName, MODE_IX);
         Database* db = autoDb.getDb();
         if (!db) {
-            return false;
+            return {TTLBatchResult::kStopDatabase, 0};
         }
 
         Lock::CollectionLock collLock(txn->lockState(), ns, MODE_IX);
@@ -236,86 +394,120 @@ private:
         Collection* collection = db->getCollection(ns);
         if (!collection) {
             // Collection was dropped.
-            return true;
+            return {TTLBatchResult::kIndexDone, 0};
         }
 
         if (!repl::getGlobalReplicationCoordinator()->canAcceptWritesFor(nss)) {
             // We've stepped down since we started this function, so we should stop working
             // as we only do deletes on the primary.
-            return false;
+            return {TTLBatchResult::kStopDatabase, 0};
         }
 
         IndexDescriptor* desc = collection->getIndexCatalog()->findIndexByKeyPattern(txn, key);
         if (!desc) {
             LOG(1) << "index not found (index build in progress? index dropped?), skipping "
-                   << "ttl job for: " << idx;
-            return true;
+                   << "ttl job for: " << *idx;
+            return {TTLBatchResult::kIndexDone, 0};
         }
 
         // Re-read 'idx' from the descriptor, in case the collection or index definition
         // changed before we re-acquired the collection lock.
-        idx = desc->infoObj();
+        *idx = desc->infoObj();
 
         if (IndexType::INDEX_BTREE != IndexNames::nameToType(desc->getAccessMethodName())) {
-            error() << "special index can't be used as a ttl index, skipping ttl job for: " << idx;
-            return true;
+            error() << "special index can't be used as a ttl index, skipping ttl job for: "
+                    << *idx;
+            return {TTLBatchResult::kIndexDone, 0};
         }
 
-        BSONElement secondsExpireElt = idx[secondsExpireField];
+        BSONElement secondsExpireElt = (*idx)[secondsExpireField];
         if (!secondsExpireElt.isNumber()) {
             error() << "ttl indexes require the " << secondsExpireField << " field to be "
                     << "numeric but received a type of " << typeName(secondsExpireElt.type())
-                    << ", skipping ttl job for: " << idx;
-            return true;
+                    << ", skipping ttl job for: " << *idx;
+            return {TTLBatchResult::kIndexDone, 0};
+        }
+
+        if (!*expirationTime) {
+            *expirationTime = Date_t::now() - Seconds(secondsExpireElt.numberLong());
         }
 
         const Date_t kDawnOfTime =
             Date_t::fromMillisSinceEpoch(std::numeric_limits<long long>::min());
-        const Date_t expirationTime = Date_t::now() - Seconds(secondsExpireElt.numberLong());
-        const BSONObj startKey = BSON("" << kDawnOfTime);
-        const BSONObj endKey = BSON("" << expirationTime);
+        const BSONObj startKey = resumeKey->isEmpty() ? BSON("" << kDawnOfTime) : *resumeKey;
+        const BSONObj endKey = BSON("" << **expirationTime);
         const bool endKeyInclusive = true;
-        // The canonical check as to whether a key pattern element is "ascending" or
-        // "descending" is (elt.number() >= 0).  This is defined by the Ordering class.
-        const InternalPlanner::Direction direction = (key.firstElement().number() >= 0)
-            ? InternalPlanner::Direction::FORWARD
-            : InternalPlanner::Direction::BACKWARD;
 
-        // We need to pass into the DeleteStageParams (below) a CanonicalQuery with a BSONObj that
-        // queries for the expired documents correctly so that we do not delete documents that are
-        // not actually expired when our snapshot changes during deletion.
+        // The documents are fetched again before they are deleted, so make sure that we do not
+        // delete documents which are not actually expired, for instance because the indexed field
+        // is an array.
         const char* keyFieldName = key.firstElement().fieldName();
         BSONObj query =
-            BSON(keyFieldName << BSON("$gte" << kDawnOfTime << "$lte" << expirationTime));
+            BSON(keyFieldName << BSON("$gte" << kDawnOfTime << "$lte" << **expirationTime));
         auto canonicalQuery = CanonicalQuery::canonicalize(nss, query);
         invariantOK(canonicalQuery.getStatus());
-
-        DeleteStageParams params;
-        params.isMulti = true;
-        params.canonicalQuery = canonicalQuery.getValue().get();
-
-        unique_ptr<PlanExecutor> exec =
-            InternalPlanner::deleteWithIndexScan(txn,
-                                                 collection,
-                                                 params,
-                                                 desc,
-                                                 startKey,
-                                                 endKey,
-                                                 endKeyInclusive,
-                                                 PlanExecutor::YIELD_AUTO,
-                                                 direction);
-
-        Status result = exec->executePlan();
-        if (!result.isOK()) {
-            error() << "ttl query execution for index " << idx << " failed with status: " << result;
-            return true;
+        const MatchExpression* filter = canonicalQuery.getValue()->root();
+
+        // Only the index keys are read here, the documents are not fetched.
+        unique_ptr<PlanExecutor> exec = InternalPlanner::indexScan(txn,
+                                                                   collection,
+                                                                   desc,
+                                                                   startKey,
+                                                                   endKey,
+                                                                   endKeyInclusive,
+                                                                   PlanExecutor::YIELD_MANUAL,
+                                                                   scanDirection(key));
+
+        const size_t batchSize = std::max(1, ttlDeleteBatchSize.load());
+        vector<RecordId> batch;
+        batch.reserve(batchSize);
+
+        bool batchFull = false;
+        BSONObj indexKey;
+        RecordId recordId;
+        PlanExecutor::ExecState state;
+        while (PlanExecutor::ADVANCED == (state = exec->getNext(&indexKey, &recordId))) {
+            if (batch.size() == batchSize) {
+                batchFull = true;
+                break;
+            }
+            batch.push_back(recordId);
+            *resumeKey = indexKey.getOwned();
         }
+        exec.reset();
 
-        const long long numDeleted = DeleteStage::getNumDeleted(*exec);
-        ttlDeletedDocuments.increment(numDeleted);
-        LOG(1) << "\tTTL deleted: " << numDeleted << endl;
+        if (PlanExecutor::FAILURE == state || PlanExecutor::DEAD == state) {
+            error() << "ttl query execution for index " << *idx
+                    << " failed with state: " << PlanExecutor::statestr(state);
+            return {TTLBatchResult::kIndexDone, 0};
+        }
 
-        return true;
+        // An index key can appear more than once for a multikey index.
+        std::sort(batch.begin(), batch.end());
+        batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+
+        long long numDeleted = 0;
+        MONGO_WRITE_CONFLICT_RETRY_LOOP_BEGIN {
+            numDeleted = 0;
+            WriteUnitOfWork wunit(txn);
+            for (const RecordId& loc : batch) {
+                Snapshotted<BSONObj> doc;
+                if (!collection->findDoc(txn, loc, &doc) || !filter->matchesBSON(doc.value())) {
+                    continue;
+                }
+                collection->deleteDocument(txn, loc);
+                ++numDeleted;
+            }
+            wunit.commit();
+        }
+        MONGO_WRITE_CONFLICT_RETRY_LOOP_END(txn, "ttl", ns);
+
+        // Stop once the expired range has been drained, or when nothing in the batch could be
+        // deleted and every key it read equals the one it started from, as the next batch would
+        // read the same keys again.
+        const bool moreBatches = batchFull && (numDeleted > 0 || resumeKey->woCompare(startKey) != 0);
+        return {moreBatches ? TTLBatchResult::kMoreBatches : TTLBatchResult::kIndexDone,
+                numDeleted};
     }
 };
 
@@ -570,6 +570,127 @@ public:
     }
 };
 
+/** Sets indexBuildThreads for the lifetime of a test. */
+class ParallelIndexBuildBase : public IndexBuildBase {
+public:
+    ParallelIndexBuildBase() : _oldIndexBuildThreads(indexBuildThreads.load()) {
+        indexBuildThreads.store(4);
+    }
+    ~ParallelIndexBuildBase() {
+        indexBuildThreads.store(_oldIndexBuildThreads);
+    }
+
+protected:
+    Collection* createCollection(int nDocs) {
+        Database* db = _ctx.db();
+        WriteUnitOfWork wunit(&_txn);
+        db->dropCollection(&_txn, _ns);
+        Collection* coll = db->createCollection(&_txn, _ns);
+        for (int i = 0; i < nDocs; ++i) {
+            coll->insertDocument(
+                &_txn, BSON("_id" << i << "a" << i % 1000 << "b" << BSON_ARRAY(i << -i)), true);
+        }
+        wunit.commit();
+        return coll;
+    }
+
+    int64_t numKeys(Collection* coll, const std::string& indexName) {
+        IndexCatalog* catalog = coll->getIndexCatalog();
+        IndexDescriptor* descriptor = catalog->findIndexByName(&_txn, indexName);
+        ASSERT(descriptor);
+        int64_t keys = 0;
+        ASSERT_OK(catalog->getIndex(descriptor)->validate(&_txn, true, &keys, NULL));
+        return keys;
+    }
+
+private:
+    const int _oldIndexBuildThreads;
+};
+
+/** Indexes built on several threads at once get the keys of every document. */
+class ParallelBuildMultipleIndexes : public ParallelIndexBuildBase {
+public:
+    void run() {
+        // More documents than fit in one batch.
+        const int nDocs = 25 * 1000;
+        Collection* coll = createCollection(nDocs);
+
+        std::vector<BSONObj> specs;
+        specs.push_back(BSON("name"
+                             << "a_1"
+                             << "ns" << _ns << "key" << BSON("a" << 1)));
+        specs.push_back(BSON("name"
+                             << "b_-1"
+                             << "ns" << _ns << "key" << BSON("b" << -1)));
+        specs.push_back(BSON("name"
+                             << "a_1_partial"
+                             << "ns" << _ns << "key" << BSON("a" << 1 << "_id" << 1)
+                             << "partialFilterExpression" << BSON("a" << BSON("$lt" << 500))));
+
+        MultiIndexBlock indexer(&_txn, coll);
+        ASSERT_OK(indexer.init(specs));
+        ASSERT_OK(indexer.insertAllDocumentsInCollection());
+        WriteUnitOfWork wunit(&_txn);
+        indexer.commit();
+        wunit.commit();
+
+        ASSERT_EQUALS(nDocs, numKeys(coll, "a_1"));
+        // Both array elements of every document but the first, for which they are equal.
+        ASSERT_EQUALS(2 * nDocs - 1, numKeys(coll, "b_-1"));
+        ASSERT_EQUALS(nDocs / 2, numKeys(coll, "a_1_partial"));
+
+        // The keys of different threads are loaded in order.
+        std::unique_ptr<DBClientCursor> cursor =
+            _client.query(_ns, Query().hint(BSON("a" << 1)).sort(BSON("a" << 1)));
+        int last = -1;
+        int count = 0;
+        while (cursor->more()) {
+            int a = cursor->next()["a"].numberInt();
+            ASSERT_LESS_THAN_OR_EQUALS(last, a);
+            last = a;
+            count++;
+        }
+        ASSERT_EQUALS(nDocs, count);
+    }
+};
+
+/** Duplicates generated on different threads are found when the index is loaded. */
+class ParallelBuildFillDups : public ParallelIndexBuildBase {
+public:
+    void run() {
+        const int nDocs = 25 * 1000;
+        Collection* coll = createCollection(nDocs);
+
+        MultiIndexBlock indexer(&_txn, coll);
+        const BSONObj spec = BSON("name"
+                                  << "a"
+                                  << "ns" << _ns << "key" << BSON("a" << 1) << "unique" << true);
+        ASSERT_OK(indexer.init(spec));
+
+        std::set<RecordId> dups;
+        ASSERT_OK(indexer.insertAllDocumentsInCollection(&dups));
+        ASSERT_EQUALS(static_cast<size_t>(nDocs - 1000), dups.size());
+    }
+};
+
+/** Index creation on several threads is killed if mayInterrupt is true. */
+class ParallelBuildIndexInterrupt : public ParallelIndexBuildBase {
+public:
+    void run() {
+        Collection* coll = createCollection(1000);
+        // Request an interrupt.
+        getGlobalServiceContext()->setKillAllOperations();
+        BSONObj indexInfo = BSON("key" << BSON("a" << 1) << "ns" << _ns << "name"
+                                       << "a_1");
+        // The call is interrupted because mayInterrupt == true.
+        ASSERT_TRUE(buildIndexInterrupted(indexInfo, true));
+        // only want to interrupt the index build
+        getGlobalServiceContext()->unsetKillAllOperations();
+        // The new index is not listed in the index catalog because the index build failed.
+        ASSERT(!coll->getIndexCatalog()->findIndexByName(&_txn, "a_1"));
+    }
+};
+
 /** Index creation is not killed when building the _id index if mayInterrupt is false. */
 class InsertBuildIdIndexInterruptDisallowed : public IndexBuildBase {
 public:
@@ -906,6 +1027,9 @@ public:
         add<InsertBuildIdIndexInterrupt>();
         add<InsertBuildIdIndexInterruptDisallowed>();
         add<HelpersEnsureIndexInterruptDisallowed>();
+        add<ParallelBuildMultipleIndexes>();
+        add<ParallelBuildFillDups>();
+        add<ParallelBuildIndexInterrupt>();
         // add<IndexBuildInProgressTest>();
         add<SameSpecDifferentOption>();
         add<SameSpecSameOptions>();
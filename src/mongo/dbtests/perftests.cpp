@@ -45,13 +45,23 @@
 #include <iomanip>
 #include <iostream>
 #include <mutex>
+#include <unordered_set>
 
 #include "mongo/config.h"
 #include "mongo/db/client.h"
+#include "mongo/db/concurrency/lock_manager.h"
+#include "mongo/db/concurrency/lock_state.h"
 #include "mongo/db/db.h"
 #include "mongo/db/dbdirectclient.h"
+#include "mongo/db/ftdc/columns.h"
+#include "mongo/db/ftdc/compressor.h"
+#include "mongo/db/ftdc/config.h"
+#include "mongo/db/ftdc/decompressor.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/operation_context_impl.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/storage/mmap_v1/dur_stats.h"
 #include "mongo/db/storage/mmap_v1/mmap.h"
 #include "mongo/db/storage/storage_options.h"
@@ -59,6 +69,7 @@
 #include "mongo/dbtests/framework_options.h"
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/thread.h"
+#include "mongo/util/concurrency/striped_counter.h"
 #include "mongo/util/log.h"
 #include "mongo/util/timer.h"
 #include "mongo/util/version.h"
@@ -248,12 +259,16 @@ public:
         }
     }
 
-    /** if true runs timed2() again with several threads (8 at time of this writing).
+    /** if true runs timed2() again with several threads (threadCount() of them).
     */
     virtual bool testThreaded() {
         return false;
     }
 
+    virtual int threadCount() {
+        return 8;
+    }
+
     int howLong() {
         int hlm = howLongMillis();
         DEV {
@@ -311,7 +326,7 @@ public:
         }
 
         if (testThreaded()) {
-            const int nThreads = 8;
+            const int nThreads = threadCount();
             // cout << "testThreaded nThreads:" << nThreads << endl;
             mongo::Timer t;
             const unsigned long long result = launchThreads(nThreads);
@@ -444,6 +459,295 @@ public:
     }
 };
 
+AtomicInt64 atomicCounter;
+StripedCounter64 stripedCounter;
+
+/**
+ * Increments a counter from one thread and then from 64 at once, to compare how counter types
+ * behave when many threads update them.
+ */
+class CounterSpeedBase : public B {
+public:
+    virtual int howLongMillis() {
+        return 500;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual bool testThreaded() {
+        return true;
+    }
+    virtual int threadCount() {
+        return 64;
+    }
+    virtual void timed2(DBClientBase*) {
+        timed();
+    }
+};
+
+class atomiccounterspeed : public CounterSpeedBase {
+public:
+    string name() {
+        return "AtomicInt64::fetchAndAdd";
+    }
+    void timed() {
+        atomicCounter.fetchAndAdd(1);
+    }
+};
+
+class stripedcounterspeed : public CounterSpeedBase {
+public:
+    string name() {
+        return "StripedCounter64::increment";
+    }
+    void timed() {
+        stripedCounter.increment();
+    }
+};
+
+// Lock managers of their own, so that the benchmarks do not interfere with the server's locks
+LockManager partitionedLockManager(false);
+LockManager fastIntentLockManager(true);
+
+/**
+ * Acquires the global and a database lock in intent mode and releases them, from one thread and
+ * then from 64 at once. Intent locks on these resources are taken by practically every operation.
+ * Compares granting them through the partitioned lock heads with the fast intent lock counters.
+ */
+template <bool FastIntentLocks>
+class intentLockSpeed : public CounterSpeedBase {
+public:
+    string name() {
+        return FastIntentLocks ? "intent-locks-fast" : "intent-locks-partitioned";
+    }
+    void timed() {
+        LockManager& lockMgr = FastIntentLocks ? fastIntentLockManager : partitionedLockManager;
+        const ResourceId resIdGlobal(RESOURCE_GLOBAL, ResourceId::SINGLETON_GLOBAL);
+        const ResourceId resIdDb(RESOURCE_DATABASE, StringData("perf"));
+
+        DefaultLockerImpl locker;
+        CondVarLockGrantNotification notify;
+        LockRequest globalRequest;
+        globalRequest.initNew(&locker, &notify);
+        LockRequest dbRequest;
+        dbRequest.initNew(&locker, &notify);
+
+        invariant(LOCK_OK == lockMgr.lock(resIdGlobal, &globalRequest, MODE_IX));
+        invariant(LOCK_OK == lockMgr.lock(resIdDb, &dbRequest, MODE_IX));
+        invariant(lockMgr.unlock(&dbRequest));
+        invariant(lockMgr.unlock(&globalRequest));
+    }
+};
+
+/**
+ * Increments a counter in documents of DocSizeKB kilobytes. The update can be applied in place, so
+ * storage engines that support updateWithDamages() are handed only the changed bytes.
+ */
+template <int DocSizeKB>
+class incCounterInDocSpeed : public B {
+public:
+    incCounterInDocSpeed() : _next(0) {}
+    string name() {
+        return "inc-counter-" + std::to_string(DocSizeKB) + "KB";
+    }
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    void prep() {
+        const string padding(DocSizeKB * 1024, 'x');
+        for (int i = 0; i < kNumDocs; i++) {
+            client()->insert(ns(), BSON("_id" << i << "count" << 0 << "padding" << padding));
+        }
+    }
+    void timed() {
+        client()->update(ns(),
+                         QUERY("_id" << (_next++ % kNumDocs)),
+                         BSON("$inc" << BSON("count" << 1)));
+    }
+
+private:
+    static const int kNumDocs = 100;
+    long long _next;
+};
+
+/**
+ * Counts the documents matching a selective filter with a collection scan, which applies the filter
+ * to BatchSize documents at a time. A BatchSize of 1 applies it to each document as it is read.
+ */
+template <int BatchSize>
+class collscanFilteredSpeed : public B {
+public:
+    collscanFilteredSpeed() : _savedBatchSize(0) {}
+    string name() {
+        return "collscan-filtered-batch-" + std::to_string(BatchSize);
+    }
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual unsigned batchSize() {
+        return 1;
+    }
+    void prep() {
+        _savedBatchSize = internalQueryExecCollectionScanBatchSize.load();
+        internalQueryExecCollectionScanBatchSize.store(BatchSize);
+
+        for (int i = 0; i < kNumDocs; i++) {
+            client()->insert(ns(),
+                             BSON("_id" << i << "qty" << (i % 1000) << "price" << (i % 37) * 1.5
+                                        << "status" << (i % 3)));
+        }
+    }
+    void timed() {
+        const BSONObj query = BSON("qty" << BSON("$gte" << 990) << "status" << 2);
+        invariant(client()->count(ns(), query) == kNumDocs / 300);
+    }
+    void post() {
+        internalQueryExecCollectionScanBatchSize.store(_savedBatchSize);
+    }
+
+private:
+    static const int kNumDocs = 30 * 1000;
+    int _savedBatchSize;
+};
+
+/**
+ * Builds a predicate which nests $or and $and 'depth' levels deep, with comparisons on distinct
+ * fields at every level.
+ */
+BSONObj nestedOrAndPredicate(int depth) {
+    const string suffix = std::to_string(depth);
+    BSONObjBuilder conjunct;
+    conjunct.append("a" + suffix, 1);
+    conjunct.append("b" + suffix, BSON("$gt" << depth));
+    if (depth > 0) {
+        conjunct.append("$and",
+                        BSON_ARRAY(nestedOrAndPredicate(depth - 1)
+                                   << BSON("c" + suffix << BSON("$in" << BSON_ARRAY(1 << 2)))));
+    }
+    return BSON("$or" << BSON_ARRAY(conjunct.obj() << BSON("d" + suffix << BSON("$lt" << 5))));
+}
+
+/**
+ * Looks up the plan cache key of a query with a deeply nested predicate in a hash table, as every
+ * plan cache lookup does. With EncodeShape, the shape of the query is encoded into a string which
+ * is then hashed, on every lookup, as when plan cache keys were strings. Otherwise the key is
+ * computed from the shape encoded at canonicalization, which comes with its hash.
+ */
+template <bool EncodeShape>
+class planCacheKeySpeed : public B {
+public:
+    string name() {
+        return EncodeShape ? "plancache-key-encode-string" : "plancache-key-computed";
+    }
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    void prep() {
+        auto statusWithCQ =
+            CanonicalQuery::canonicalize(NamespaceString(ns()), nestedOrAndPredicate(6));
+        invariant(statusWithCQ.isOK());
+        _cq = std::move(statusWithCQ.getValue());
+
+        const PlanCacheKey key = _planCache.computeKey(*_cq);
+        _keys.insert(key);
+        _stringKeys.insert(key.toString());
+    }
+    void timed() {
+        if (EncodeShape) {
+            const string key = PlanCacheKey::encodeShape(_cq->root(),
+                                                         _cq->getParsed().getSort(),
+                                                         _cq->getParsed().getProj()).toString();
+            invariant(_stringKeys.count(key) == 1);
+        } else {
+            invariant(_keys.count(_planCache.computeKey(*_cq)) == 1);
+        }
+    }
+
+private:
+    std::unique_ptr<CanonicalQuery> _cq;
+    PlanCache _planCache;
+    std::unordered_set<string> _stringKeys;
+    std::unordered_set<PlanCacheKey, PlanCacheKey::Hasher> _keys;
+};
+
+/**
+ * Returns an FTDC sample shaped like serverStatus, with 500 counters in 20 sections. Some counters
+ * never change, the others grow by a different amount for every counter.
+ */
+BSONObj ftdcSample(int i) {
+    BSONObjBuilder builder;
+    builder.append("start", Date_t::fromMillisSinceEpoch(1000LL * i));
+    for (int section = 0; section < 20; section++) {
+        BSONObjBuilder sectionBuilder(builder.subobjStart("section" + std::to_string(section)));
+        for (int metric = 0; metric < 25; metric++) {
+            const long long value = metric % 4 == 0 ? metric : 1LL * i * metric * (section + 1);
+            sectionBuilder.append("metric" + std::to_string(metric), value);
+        }
+    }
+    builder.append("end", Date_t::fromMillisSinceEpoch(1000LL * i + 3));
+    return builder.obj();
+}
+
+/**
+ * Decodes a chunk of FTDC samples. With Columns, the chunk is decoded into one column per metric,
+ * otherwise into one document per sample, as the row decoder did before columns existed.
+ */
+template <bool Columns>
+class ftdcDecodeSpeed : public B {
+public:
+    string name() {
+        return Columns ? "ftdc-decode-columns" : "ftdc-decode-documents";
+    }
+    virtual int howLongMillis() {
+        return 2000;
+    }
+    virtual bool showDurStats() {
+        return false;
+    }
+    virtual unsigned batchSize() {
+        return 1;
+    }
+    void prep() {
+        FTDCConfig config;
+        FTDCCompressor compressor(&config);
+        for (int i = 0; i < kSamples; i++) {
+            auto swChunk = compressor.addSample(ftdcSample(i), Date_t());
+            invariant(swChunk.isOK() && !swChunk.getValue());
+        }
+
+        auto swBuf = compressor.getCompressedSamples();
+        invariant(swBuf.isOK());
+        ConstDataRange buf = std::get<0>(swBuf.getValue());
+        _chunk.assign(buf.data(), buf.data() + buf.length());
+    }
+    void timed() {
+        ConstDataRange buf(_chunk.data(), _chunk.size());
+        if (Columns) {
+            invariant(_decompressor.uncompressColumns(buf, Date_t(), &_columns).isOK());
+            invariant(_columns.getSamplesCount() == static_cast<std::uint32_t>(kSamples));
+        } else {
+            auto swDocs = _decompressor.uncompress(buf);
+            invariant(swDocs.isOK());
+            invariant(swDocs.getValue().size() == static_cast<size_t>(kSamples));
+        }
+    }
+
+private:
+    static const int kSamples = 250;
+
+    vector<char> _chunk;
+    FTDCDecompressor _decompressor;
+    FTDCMetricColumns _columns;
+};
 
 class All : public Suite {
 public:
@@ -457,6 +761,19 @@ public:
         add<boosttimed_mutexspeed>();
         add<stdmutexspeed>();
         add<stdtimed_mutexspeed>();
+        add<atomiccounterspeed>();
+        add<stripedcounterspeed>();
+        add<intentLockSpeed<false>>();
+        add<intentLockSpeed<true>>();
+        add<incCounterInDocSpeed<4>>();
+        add<incCounterInDocSpeed<16>>();
+        add<incCounterInDocSpeed<64>>();
+        add<collscanFilteredSpeed<1>>();
+        add<collscanFilteredSpeed<64>>();
+        add<planCacheKeySpeed<true>>();
+        add<planCacheKeySpeed<false>>();
+        add<ftdcDecodeSpeed<false>>();
+        add<ftdcDecodeSpeed<true>>();
     }
 } myall;
 }
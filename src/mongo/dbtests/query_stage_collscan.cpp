@@ -391,6 +391,76 @@ public:
     }
 };
 
+//
+// Scan through some of the objects with a filter, which reads the records ahead in a batch. Delete
+// an object of the batch which has not been returned yet, then expect it to be skipped.
+//
+
+class QueryStageCollscanInvalidateBatchedObject : public QueryStageCollectionScanBase {
+public:
+    void run() {
+        OldClientWriteContext ctx(&_txn, ns());
+        Collection* coll = ctx.getCollection();
+
+        // Get the RecordIds that would be returned by an in-order scan.
+        vector<RecordId> locs;
+        getLocs(coll, CollectionScanParams::FORWARD, &locs);
+
+        // Configure the scan.
+        CollectionScanParams params;
+        params.collection = coll;
+        params.direction = CollectionScanParams::FORWARD;
+        params.tailable = false;
+
+        BSONObj filterObj = BSON("foo" << BSON("$gte" << 0));
+        StatusWithMatchExpression statusWithMatcher = MatchExpressionParser::parse(filterObj);
+        ASSERT_OK(statusWithMatcher.getStatus());
+        unique_ptr<MatchExpression> filterExpr = std::move(statusWithMatcher.getValue());
+
+        WorkingSet ws;
+        unique_ptr<CollectionScan> scan(new CollectionScan(&_txn, params, &ws, filterExpr.get()));
+
+        int count = 0;
+        while (count < 10) {
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            PlanStage::StageState state = scan->work(&id);
+            if (PlanStage::ADVANCED == state) {
+                WorkingSetMember* member = ws.get(id);
+                ASSERT_EQUALS(locs[count], member->loc);
+                ++count;
+            }
+        }
+
+        // Remove locs[count], which was read into the batch along with the returned objects.
+        scan->saveState();
+        {
+            WriteUnitOfWork wunit(&_txn);
+            scan->invalidate(&_txn, locs[count], INVALIDATION_DELETION);
+            wunit.commit();  // to avoid rollback of the invalidate
+        }
+        remove(coll->docFor(&_txn, locs[count]).value());
+        scan->restoreState();
+
+        // Skip over locs[count].
+        ++count;
+
+        // Expect the rest.
+        while (!scan->isEOF()) {
+            WorkingSetID id = WorkingSet::INVALID_ID;
+            PlanStage::StageState state = scan->work(&id);
+            if (PlanStage::ADVANCED == state) {
+                WorkingSetMember* member = ws.get(id);
+                ASSERT_EQUALS(locs[count], member->loc);
+                ASSERT_EQUALS(coll->docFor(&_txn, locs[count]).value()["foo"].numberInt(),
+                              member->obj.value()["foo"].numberInt());
+                ++count;
+            }
+        }
+
+        ASSERT_EQUALS(numObj(), count);
+    }
+};
+
 class All : public Suite {
 public:
     All() : Suite("QueryStageCollectionScan") {}
@@ -405,6 +475,7 @@ public:
         add<QueryStageCollscanObjectsInOrderBackward>();
         add<QueryStageCollscanInvalidateUpcomingObject>();
         add<QueryStageCollscanInvalidateUpcomingObjectBackward>();
+        add<QueryStageCollscanInvalidateBatchedObject>();
     }
 };
 
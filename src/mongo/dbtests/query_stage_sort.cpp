@@ -26,6 +26,8 @@
  *    then also delete it in the license file.
  */
 
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
@@ -40,6 +42,8 @@
 #include "mongo/db/query/plan_executor.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/stdx/memory.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
 
 /**
  * This file tests db/exec/sort.cpp
@@ -573,6 +577,62 @@ public:
     }
 };
 
+// Benchmark of the memory allocations of a sort, which the working set serves from its arena.
+class QueryStageSortArenaAllocations : public QueryStageSortTestBase {
+public:
+    virtual int numObj() {
+        return 50 * 1000;
+    }
+
+    void run() {
+        OldClientWriteContext ctx(&_txn, ns());
+        Database* db = ctx.db();
+        Collection* coll = db->getCollection(ns());
+        if (!coll) {
+            WriteUnitOfWork wuow(&_txn);
+            coll = db->createCollection(&_txn, ns());
+            wuow.commit();
+        }
+
+        fillData();
+
+        auto ws = make_unique<WorkingSet>();
+        const WorkingSet* workingSet = ws.get();
+        auto queuedDataStage = make_unique<QueuedDataStage>(&_txn, ws.get());
+        insertVarietyOfObjects(ws.get(), queuedDataStage.get(), coll);
+
+        SortStageParams params;
+        params.collection = coll;
+        params.pattern = BSON("foo" << -1);
+
+        auto keyGenStage = make_unique<SortKeyGeneratorStage>(
+            &_txn, queuedDataStage.release(), ws.get(), params.pattern, BSONObj());
+        auto sortStage = make_unique<SortStage>(&_txn, params, ws.get(), keyGenStage.release());
+        auto statusWithPlanExecutor = PlanExecutor::make(
+            &_txn, std::move(ws), std::move(sortStage), coll, PlanExecutor::YIELD_MANUAL);
+        ASSERT_OK(statusWithPlanExecutor.getStatus());
+        unique_ptr<PlanExecutor> exec = std::move(statusWithPlanExecutor.getValue());
+
+        Timer timer;
+        int count = 0;
+        RecordId loc;
+        while (PlanExecutor::ADVANCED == exec->getNext(NULL, &loc)) {
+            ++count;
+        }
+        ASSERT_EQUALS(numObj(), count);
+
+        // Without the arena, every member and every sort key would be a heap allocation.
+        const WorkingSetArena::Stats& stats = workingSet->getArenaStats();
+        mongo::log() << "sorted " << count << " results in " << timer.millis() << "ms with "
+                     << stats.allocations << " working set allocations served by "
+                     << stats.blocks << " heap allocations of " << stats.bytes << " bytes";
+
+        // A member and a sort key per result.
+        ASSERT_GREATER_THAN_OR_EQUALS(stats.allocations, 2U * numObj());
+        ASSERT_LESS_THAN(stats.blocks * 100, stats.allocations);
+    }
+};
+
 class All : public Suite {
 public:
     All() : Suite("query_stage_sort") {}
@@ -590,6 +650,7 @@ public:
         add<QueryStageSortDeletionInvalidationWithLimit<10>>();
         add<QueryStageSortDeletionInvalidationWithLimit<1>>();
         add<QueryStageSortParallelArrays>();
+        add<QueryStageSortArenaAllocations>();
     }
 };
 
@@ -56,6 +56,7 @@
 #include "mongo/stdx/mutex.h"
 #include "mongo/stdx/thread.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compressor_manager.h"
 
 namespace mongo {
 
@@ -145,6 +146,8 @@ private:
         rpc::ProtocolSet clientProtocols() const;
         void setServerProtocols(rpc::ProtocolSet protocols);
 
+        MessageCompressorManager& compressorManager();
+
 // Explicit move construction and assignment to support MSVC
 #if defined(_MSC_VER) && _MSC_VER < 1900
         AsyncConnection(AsyncConnection&&);
@@ -162,6 +165,9 @@ private:
         // Dynamically initialized from [min max]WireVersionOutgoing.
         // Its expected that isMaster response is checked only on the caller.
         rpc::ProtocolSet _clientProtocols{rpc::supports::kNone};
+
+        // Held by pointer so that the connection stays movable.
+        std::unique_ptr<MessageCompressorManager> _compressorManager;
     };
 
     /**
@@ -199,6 +205,12 @@ private:
 
         Message& toSend();
         Message& toRecv();
+
+        /**
+         * Returns the OP_COMPRESSED form of toSend() which is actually written to the network, or
+         * an empty Message if toSend() goes out as is.
+         */
+        Message& toSendCompressed();
         MSGHEADER::Value& header();
 
         ResponseStatus response(rpc::Protocol protocol,
@@ -211,6 +223,7 @@ private:
         const CommandType _type;
 
         Message _toSend;
+        Message _toSendCompressed;
         Message _toRecv;
 
         // TODO: Investigate efficiency of storing header separately.
@@ -76,8 +76,6 @@ template <typename Handler>
 void asyncSendMessage(AsyncStreamInterface& stream, Message* m, Handler&& handler) {
     static_assert(IsNetworkHandler<Handler>::value,
                   "Handler passed to asyncSendMessage does not conform to NetworkHandler concept");
-    m->header().setResponseTo(0);
-    m->header().setId(nextMessageId());
     // TODO: Some day we may need to support vector messages.
     fassert(28708, m->buf() != 0);
     stream.write(asio::buffer(m->buf(), m->size()), std::forward<Handler>(handler));
@@ -186,6 +184,10 @@ Message& NetworkInterfaceASIO::AsyncCommand::toSend() {
     return _toSend;
 }
 
+Message& NetworkInterfaceASIO::AsyncCommand::toSendCompressed() {
+    return _toSendCompressed;
+}
+
 Message& NetworkInterfaceASIO::AsyncCommand::toRecv() {
     return _toRecv;
 }
@@ -351,6 +353,14 @@ void NetworkInterfaceASIO::_asyncRunCommand(AsyncOp* op, NetworkOpHandler handle
 
     // Step 4
     auto recvMessageCallback = [this, cmd, handler, op](std::error_code ec, size_t bytes) {
+        if (!ec && cmd->toRecv().operation() == dbCompressed) {
+            auto decompressed = cmd->conn().compressorManager().decompressMessage(cmd->toRecv());
+            if (!decompressed.isOK()) {
+                return handler(make_error_code(decompressed.getStatus().code()), bytes);
+            }
+            cmd->toRecv() = std::move(decompressed.getValue());
+        }
+
         // We don't call _validateAndRun here as we assume the caller will.
         handler(ec, bytes);
     };
@@ -395,7 +405,25 @@ void NetworkInterfaceASIO::_asyncRunCommand(AsyncOp* op, NetworkOpHandler handle
         };
 
     // Step 1
-    asyncSendMessage(cmd->conn().stream(), &cmd->toSend(), std::move(sendMessageCallback));
+    Message& toSend = cmd->toSend();
+    toSend.header().setResponseTo(0);
+    toSend.header().setId(nextMessageId());
+
+    // Once compression has been negotiated, the command goes out wrapped in an OP_COMPRESSED
+    // envelope. toSend() itself is kept as is, since replies to down converted commands are
+    // parsed against it.
+    auto& compressorManager = cmd->conn().compressorManager();
+    if (MessageCompressorBase* compressor = compressorManager.compressorFor(false)) {
+        auto compressed = compressorManager.compressMessage(toSend, compressor);
+        if (!compressed.isOK()) {
+            return _completeOperation(op, compressed.getStatus());
+        }
+        cmd->toSendCompressed() = std::move(compressed.getValue());
+    }
+    Message* wireMessage =
+        cmd->toSendCompressed().empty() ? &toSend : &cmd->toSendCompressed();
+
+    asyncSendMessage(cmd->conn().stream(), wireMessage, std::move(sendMessageCallback));
 }
 
 void NetworkInterfaceASIO::_runConnectionHook(AsyncOp* op) {
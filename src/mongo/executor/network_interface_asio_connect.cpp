@@ -54,19 +54,22 @@ NetworkInterfaceASIO::AsyncConnection::AsyncConnection(std::unique_ptr<AsyncStre
     : _stream(std::move(stream)),
       _serverProtocols(protocols),
       _clientProtocols(rpc::computeProtocolSet(WireSpec::instance().minWireVersionOutgoing,
-                                               WireSpec::instance().maxWireVersionOutgoing)) {}
+                                               WireSpec::instance().maxWireVersionOutgoing)),
+      _compressorManager(stdx::make_unique<MessageCompressorManager>()) {}
 
 #if defined(_MSC_VER) && _MSC_VER < 1900
 NetworkInterfaceASIO::AsyncConnection::AsyncConnection(AsyncConnection&& other)
     : _stream(std::move(other._stream)),
       _serverProtocols(other._serverProtocols),
-      _clientProtocols(other._clientProtocols) {}
+      _clientProtocols(other._clientProtocols),
+      _compressorManager(std::move(other._compressorManager)) {}
 
 NetworkInterfaceASIO::AsyncConnection& NetworkInterfaceASIO::AsyncConnection::operator=(
     AsyncConnection&& other) {
     _stream = std::move(other._stream);
     _serverProtocols = other._serverProtocols;
     _clientProtocols = other._clientProtocols;
+    _compressorManager = std::move(other._compressorManager);
     return *this;
 }
 #endif
@@ -91,6 +94,10 @@ void NetworkInterfaceASIO::AsyncConnection::setServerProtocols(rpc::ProtocolSet
     _serverProtocols = protocols;
 }
 
+MessageCompressorManager& NetworkInterfaceASIO::AsyncConnection::compressorManager() {
+    return *_compressorManager;
+}
+
 void NetworkInterfaceASIO::_connect(AsyncOp* op) {
     LOG(1) << "Connecting to " << op->request().target.toString();
 
@@ -198,6 +198,8 @@ void ChunkManager::loadExistingRanges(OperationContext* txn, const ChunkManager*
                 _shardIds.swap(shardIds);
                 _shardVersions.swap(shardVersions);
                 _chunkRanges.reloadAll(_chunkMap);
+                _routingTable = ChunkRoutingTable(
+                    _chunkMap, oldManager ? &oldManager->_routingTable : nullptr);
 
                 return;
             }
@@ -449,10 +451,10 @@ ChunkPtr ChunkManager::findIntersectingChunk(OperationContext* txn, const BSONOb
         BSONObj chunkMin;
         ChunkPtr chunk;
         {
-            ChunkMap::const_iterator it = _chunkMap.upper_bound(shardKey);
-            if (it != _chunkMap.end()) {
-                chunkMin = it->first;
-                chunk = it->second;
+            const size_t pos = _routingTable.upperBound(shardKey);
+            if (pos < _routingTable.size()) {
+                chunkMin = _routingTable.maxAt(pos);
+                chunk = _routingTable.chunkAt(pos);
             }
         }
 
@@ -34,6 +34,7 @@
 
 #include "mongo/db/repl/optime.h"
 #include "mongo/s/chunk.h"
+#include "mongo/s/chunk_routing_table.h"
 #include "mongo/s/shard_key_pattern.h"
 #include "mongo/util/concurrency/ticketholder.h"
 
@@ -47,9 +48,6 @@ class OperationContext;
 
 typedef std::shared_ptr<ChunkManager> ChunkManagerPtr;
 
-// The key for the map is max for each Chunk or ChunkRange
-typedef std::map<BSONObj, std::shared_ptr<Chunk>, BSONObjCmp> ChunkMap;
-
 class ChunkRange {
 public:
     ChunkRange(ChunkMap::const_iterator begin, const ChunkMap::const_iterator end);
@@ -276,6 +274,9 @@ private:
     ChunkMap _chunkMap;
     ChunkRangeManager _chunkRanges;
 
+    // Flat copy of _chunkMap used to target single shard keys.
+    ChunkRoutingTable _routingTable;
+
     std::set<ShardId> _shardIds;
 
     // Max known version per shard
@@ -0,0 +1,195 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/s/chunk_routing_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "mongo/db/storage/key_string.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+namespace {
+
+// Shard key bounds compare like BSONObjCmp, with every field ascending.
+const Ordering kAllAscending = Ordering::make(BSONObj());
+
+const std::shared_ptr<Chunk> kNoChunk;
+
+/**
+ * Encodes a shard key or chunk bound. KeyString encodes index keys, which have no field names.
+ * The key must pass KeyString::canEncode().
+ */
+void encodeKey(const BSONObj& key, KeyString* out) {
+    BSONObjBuilder stripped;
+    for (const auto& elem : key) {
+        stripped.appendAs(elem, "");
+    }
+    out->resetToKey(stripped.done(), kAllAscending);
+}
+
+}  // namespace
+
+ChunkRoutingTable::ChunkRoutingTable(const ChunkMap& chunks, const ChunkRoutingTable* previous) {
+    _prefixes.reserve(chunks.size());
+    _maxes.reserve(chunks.size());
+    _chunks.reserve(chunks.size());
+
+    // KeyString cannot encode some types, such as NumberDecimal. If a bound has one of them, only
+    // the bounds themselves are kept and upperBound() compares BSON.
+    _encoded = std::all_of(chunks.begin(), chunks.end(), [](const ChunkMap::value_type& entry) {
+        return KeyString::canEncode(entry.first);
+    });
+    if (!_encoded) {
+        for (const auto& entry : chunks) {
+            _maxes.push_back(entry.first);
+            _chunks.push_back(entry.second);
+        }
+        return;
+    }
+
+    _keyOffsets.reserve(chunks.size() + 1);
+
+    KeyString encoded;
+    size_t prevPos = 0;
+    for (const auto& entry : chunks) {
+        const BSONObj& max = entry.first;
+
+        if (previous && previous->_encoded) {
+            // Both tables are in bound order, so one merge pass finds the bounds they share.
+            int cmp = -1;
+            while (prevPos < previous->size() &&
+                   (cmp = previous->_maxes[prevPos].woCompare(max)) < 0) {
+                ++prevPos;
+            }
+            if (prevPos < previous->size() && cmp == 0) {
+                const uint32_t begin = previous->_keyOffsets[prevPos];
+                const uint32_t end = previous->_keyOffsets[prevPos + 1];
+                append(max, entry.second, previous->_keyData.data() + begin, end - begin);
+                continue;
+            }
+        }
+
+        encodeKey(max, &encoded);
+        append(max, entry.second, encoded.getBuffer(), encoded.getSize());
+    }
+}
+
+size_t ChunkRoutingTable::upperBound(const BSONObj& shardKey) const {
+    if (!_encoded || !KeyString::canEncode(shardKey)) {
+        return std::upper_bound(_maxes.begin(), _maxes.end(), shardKey, BSONObjCmp()) -
+            _maxes.begin();
+    }
+
+    const size_t n = _prefixes.size();
+    if (n == 0) {
+        return 0;
+    }
+
+    KeyString encoded;
+    encodeKey(shardKey, &encoded);
+    const uint64_t prefix = prefixOf(encoded.getBuffer(), encoded.getSize());
+    const uint64_t* const prefixes = _prefixes.data();
+
+    // Branch-free binary searches for the positions of the first prefix not less than, and of the
+    // first prefix greater than, the prefix of the key.
+    const uint64_t* lo = prefixes;
+    const uint64_t* hi = prefixes;
+    for (size_t len = n; len > 1;) {
+        const size_t half = len / 2;
+        lo += (lo[half] < prefix) ? half : 0;
+        hi += (hi[half] <= prefix) ? half : 0;
+        len -= half;
+    }
+    size_t begin = (lo - prefixes) + (*lo < prefix);
+    size_t end = (hi - prefixes) + (*hi <= prefix);
+
+    // Bounds before 'begin' are less than the key and bounds from 'end' on are greater. Those in
+    // between share its prefix and need a full comparison.
+    while (begin < end) {
+        const size_t mid = begin + (end - begin) / 2;
+        if (compareAt(mid, encoded.getBuffer(), encoded.getSize()) <= 0) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    return begin;
+}
+
+const std::shared_ptr<Chunk>& ChunkRoutingTable::findChunk(const BSONObj& shardKey) const {
+    const size_t pos = upperBound(shardKey);
+    return pos < _chunks.size() ? _chunks[pos] : kNoChunk;
+}
+
+uint64_t ChunkRoutingTable::prefixOf(const char* key, size_t size) {
+    // Big-endian, so that prefixes compare like the bytes they came from, and padded with zeros,
+    // which sort before any byte.
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < sizeof(prefix); ++i) {
+        prefix <<= 8;
+        if (i < size) {
+            prefix |= static_cast<unsigned char>(key[i]);
+        }
+    }
+    return prefix;
+}
+
+int ChunkRoutingTable::compareAt(size_t pos, const char* key, size_t size) const {
+    const uint32_t begin = _keyOffsets[pos];
+    const size_t boundSize = _keyOffsets[pos + 1] - begin;
+
+    const int cmp = memcmp(_keyData.data() + begin, key, std::min(boundSize, size));
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (boundSize == size) {
+        return 0;
+    }
+    return boundSize < size ? -1 : 1;
+}
+
+void ChunkRoutingTable::append(const BSONObj& max,
+                               const std::shared_ptr<Chunk>& chunk,
+                               const char* key,
+                               size_t size) {
+    invariant(_keyData.size() + size <= std::numeric_limits<uint32_t>::max());
+
+    _prefixes.push_back(prefixOf(key, size));
+    _maxes.push_back(max);
+    _chunks.push_back(chunk);
+    _keyData.insert(_keyData.end(), key, key + size);
+    _keyOffsets.push_back(_keyData.size());
+}
+
+}  // namespace mongo
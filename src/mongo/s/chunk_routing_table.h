@@ -0,0 +1,115 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+class Chunk;
+
+// The key for the map is max for each Chunk or ChunkRange
+typedef std::map<BSONObj, std::shared_ptr<Chunk>, BSONObjCmp> ChunkMap;
+
+/**
+ * Immutable index over the chunks of a collection, used to find the chunk owning a shard key.
+ *
+ * The max bound of each chunk is encoded as a KeyString, so that bounds compare with memcmp, and
+ * all encodings are stored back to back in one buffer in chunk order. The first eight bytes of
+ * each encoding are also kept in a separate array, which a branch-free binary search narrows down
+ * to the few chunks that share the prefix of the key being looked up.
+ *
+ * Keys and bounds which KeyString cannot encode, such as those holding a NumberDecimal, are looked
+ * up by comparing BSON instead.
+ */
+class ChunkRoutingTable {
+public:
+    ChunkRoutingTable() = default;
+
+    /**
+     * Builds the table for 'chunks'. If 'previous' is not null, the encodings of the bounds it
+     * shares with 'chunks' are copied from it rather than computed again, which makes reloading a
+     * chunk manager after a few chunks changed cheap.
+     */
+    ChunkRoutingTable(const ChunkMap& chunks, const ChunkRoutingTable* previous);
+
+    size_t size() const {
+        return _chunks.size();
+    }
+
+    /**
+     * Returns the position of the first chunk whose max bound is greater than 'shardKey', that is
+     * the chunk which would own 'shardKey', or size() if there is none.
+     */
+    size_t upperBound(const BSONObj& shardKey) const;
+
+    /**
+     * Returns the chunk which would own 'shardKey', or null if 'shardKey' is not below the max
+     * bound of any chunk.
+     */
+    const std::shared_ptr<Chunk>& findChunk(const BSONObj& shardKey) const;
+
+    const std::shared_ptr<Chunk>& chunkAt(size_t pos) const {
+        return _chunks[pos];
+    }
+
+    const BSONObj& maxAt(size_t pos) const {
+        return _maxes[pos];
+    }
+
+private:
+    static uint64_t prefixOf(const char* key, size_t size);
+
+    void append(const BSONObj& max,
+                const std::shared_ptr<Chunk>& chunk,
+                const char* key,
+                size_t size);
+
+    int compareAt(size_t pos, const char* key, size_t size) const;
+
+    // Whether the max bounds are KeyString encoded. If not, _prefixes and _keyData stay empty.
+    bool _encoded = true;
+
+    // Parallel arrays, in increasing order of max bound.
+    std::vector<uint64_t> _prefixes;
+    std::vector<BSONObj> _maxes;
+    std::vector<std::shared_ptr<Chunk>> _chunks;
+
+    // KeyString encodings of the max bounds. The encoding of the bound at position i spans
+    // [_keyOffsets[i], _keyOffsets[i + 1]), so there is one more offset than there are chunks.
+    std::vector<char> _keyData;
+    std::vector<uint32_t> _keyOffsets{0};
+};
+
+}  // namespace mongo
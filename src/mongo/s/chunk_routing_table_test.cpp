@@ -0,0 +1,195 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/decimal128.h"
+#include "mongo/platform/random.h"
+#include "mongo/s/chunk_routing_table.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+using std::string;
+using std::vector;
+
+/**
+ * Builds a ChunkMap whose chunks end at each of 'maxes' and at MaxKey. The chunks themselves are
+ * not needed to route, so they are left null.
+ */
+ChunkMap makeChunkMap(const vector<BSONObj>& maxes) {
+    ChunkMap chunks;
+    for (const auto& max : maxes) {
+        chunks.insert(std::make_pair(max, std::shared_ptr<Chunk>()));
+    }
+    chunks.insert(std::make_pair(BSON("a" << MAXKEY), std::shared_ptr<Chunk>()));
+    return chunks;
+}
+
+/**
+ * Checks that the table routes every key in 'keys' to the same position as ChunkMap::upper_bound.
+ */
+void assertRoutesLikeMap(const ChunkRoutingTable& table,
+                         const ChunkMap& chunks,
+                         const vector<BSONObj>& keys) {
+    ASSERT_EQUALS(chunks.size(), table.size());
+    for (const auto& key : keys) {
+        const size_t expected = std::distance(chunks.begin(), chunks.upper_bound(key));
+        ASSERT_EQUALS(expected, table.upperBound(key)) << key;
+        if (expected < chunks.size()) {
+            ASSERT_EQUALS(chunks.upper_bound(key)->first, table.maxAt(expected));
+        }
+    }
+}
+
+TEST(ChunkRoutingTable, Empty) {
+    ChunkRoutingTable table(ChunkMap(), nullptr);
+    ASSERT_EQUALS(0U, table.size());
+    ASSERT_EQUALS(0U, table.upperBound(BSON("a" << 1)));
+    ASSERT_FALSE(table.findChunk(BSON("a" << 1)));
+}
+
+TEST(ChunkRoutingTable, KeyOnBoundaryBelongsToNextChunk) {
+    ChunkMap chunks = makeChunkMap({BSON("a" << 0), BSON("a" << 10), BSON("a" << 20)});
+    ChunkRoutingTable table(chunks, nullptr);
+
+    ASSERT_EQUALS(0U, table.upperBound(BSON("a" << MINKEY)));
+    ASSERT_EQUALS(0U, table.upperBound(BSON("a" << -5)));
+    ASSERT_EQUALS(1U, table.upperBound(BSON("a" << 0)));
+    ASSERT_EQUALS(1U, table.upperBound(BSON("a" << 9.5)));
+    ASSERT_EQUALS(2U, table.upperBound(BSON("a" << 10LL)));
+    ASSERT_EQUALS(3U, table.upperBound(BSON("a" << 20.0)));
+    ASSERT_EQUALS(3U, table.upperBound(BSON("a" << "string")));
+    ASSERT_EQUALS(4U, table.upperBound(BSON("a" << MAXKEY)));
+}
+
+TEST(ChunkRoutingTable, KeysSharingLongPrefixes) {
+    vector<BSONObj> maxes;
+    vector<BSONObj> keys;
+    for (int i = 0; i < 200; i += 2) {
+        const string common = "a common prefix longer than eight bytes ";
+        maxes.push_back(BSON("a" << (common + std::to_string(i))));
+        keys.push_back(BSON("a" << (common + std::to_string(i))));
+        keys.push_back(BSON("a" << (common + std::to_string(i + 1))));
+        keys.push_back(BSON("a" << common));
+    }
+    ChunkMap chunks = makeChunkMap(maxes);
+    assertRoutesLikeMap(ChunkRoutingTable(chunks, nullptr), chunks, keys);
+}
+
+TEST(ChunkRoutingTable, MixedTypesAndCompoundKeys) {
+    vector<BSONObj> maxes{BSON("a" << -100 << "b" << MINKEY),
+                          BSON("a" << 1 << "b" << "x"),
+                          BSON("a" << 1 << "b" << "xy"),
+                          BSON("a" << 2.5 << "b" << MAXKEY),
+                          BSON("a" << "abc" << "b" << 1),
+                          BSON("a" << OID("010203040506070809101112") << "b" << 1),
+                          BSON("a" << true << "b" << 1)};
+    vector<BSONObj> keys = maxes;
+    keys.push_back(BSON("a" << 1 << "b" << MINKEY));
+    keys.push_back(BSON("a" << 1.0 << "b" << "x"));
+    keys.push_back(BSON("a" << 1 << "b" << "xx"));
+    keys.push_back(BSON("a" << 2 << "b" << 2));
+    keys.push_back(BSON("a" << "abd" << "b" << 0));
+    keys.push_back(BSON("a" << false << "b" << 0));
+    keys.push_back(BSON("a" << MAXKEY << "b" << MAXKEY));
+
+    ChunkMap chunks;
+    for (const auto& max : maxes) {
+        chunks.insert(std::make_pair(max, std::shared_ptr<Chunk>()));
+    }
+    chunks.insert(std::make_pair(BSON("a" << MAXKEY << "b" << MAXKEY), std::shared_ptr<Chunk>()));
+    assertRoutesLikeMap(ChunkRoutingTable(chunks, nullptr), chunks, keys);
+}
+
+TEST(ChunkRoutingTable, RebuildFromPreviousTable) {
+    PseudoRandom random(1);
+
+    vector<BSONObj> maxes;
+    for (int i = 0; i < 1000; ++i) {
+        maxes.push_back(BSON("a" << i * 10));
+    }
+    ChunkMap chunks = makeChunkMap(maxes);
+    ChunkRoutingTable previous(chunks, nullptr);
+
+    // Split some chunks and merge others, as a chunk diff would.
+    for (int i = 0; i < 100; ++i) {
+        const int bound = random.nextInt32(10000);
+        if (bound % 2) {
+            chunks.insert(std::make_pair(BSON("a" << bound), std::shared_ptr<Chunk>()));
+        } else {
+            chunks.erase(BSON("a" << bound));
+        }
+    }
+    ChunkRoutingTable rebuilt(chunks, &previous);
+
+    vector<BSONObj> keys;
+    for (int i = -5; i < 10005; ++i) {
+        keys.push_back(BSON("a" << i));
+    }
+    assertRoutesLikeMap(rebuilt, chunks, keys);
+}
+
+TEST(ChunkRoutingTable, DecimalKeysAndBounds) {
+    if (!Decimal128::enabled) {
+        return;
+    }
+
+    // KeyString cannot encode NumberDecimal, so these keys are looked up by comparing BSON.
+    vector<BSONObj> maxes{BSON("a" << 0), BSON("a" << 10), BSON("a" << 20)};
+    vector<BSONObj> keys{BSON("a" << Decimal128("-5")),
+                         BSON("a" << Decimal128("0")),
+                         BSON("a" << Decimal128("9.5")),
+                         BSON("a" << Decimal128("10.0")),
+                         BSON("a" << Decimal128("15.5")),
+                         BSON("a" << Decimal128("1E+10")),
+                         BSON("a" << 15.5),
+                         BSON("a" << 15)};
+    ChunkMap chunks = makeChunkMap(maxes);
+    ChunkRoutingTable table(chunks, nullptr);
+    assertRoutesLikeMap(table, chunks, keys);
+
+    // A chunk bound which KeyString cannot encode, with a previous table whose bounds are encoded.
+    maxes.push_back(BSON("a" << Decimal128("15.5")));
+    ChunkMap decimalChunks = makeChunkMap(maxes);
+    ChunkRoutingTable decimalTable(decimalChunks, &table);
+    assertRoutesLikeMap(decimalTable, decimalChunks, keys);
+    ASSERT_EQUALS(3U, decimalTable.upperBound(BSON("a" << 15.5)));
+
+    // Back to encoded bounds, with a previous table whose bounds are not.
+    assertRoutesLikeMap(ChunkRoutingTable(chunks, &decimalTable), chunks, keys);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -36,6 +36,7 @@
 #include "mongo/db/query/cursor_response.h"
 #include "mongo/db/query/getmore_request.h"
 #include "mongo/db/query/killcursors_request.h"
+#include "mongo/db/storage/key_string.h"
 #include "mongo/executor/remote_command_request.h"
 #include "mongo/executor/remote_command_response.h"
 #include "mongo/rpc/metadata/server_selection_metadata.h"
@@ -51,6 +52,9 @@ namespace {
 // Maximum number of retries for network and replication notMaster errors (per host).
 const int kMaxNumFailedHostRetryAttempts = 3;
 
+// Ordering::make() can describe at most this many sort pattern fields.
+const int kMaxOrderingFields = 32;
+
 /**
  * Returns whether a particular error code returned from the initial cursor establishment should
  * be retried.
@@ -64,9 +68,11 @@ bool isPerShardRetriableError(ErrorCodes::Error err) {
 
 AsyncResultsMerger::AsyncResultsMerger(executor::TaskExecutor* executor,
                                        ClusterClientCursorParams&& params)
-    : _executor(executor),
-      _params(std::move(params)),
-      _mergeQueue(MergingComparator(_remotes, _params.sort)) {
+    : _executor(executor), _params(std::move(params)) {
+    if (!_params.sort.isEmpty() && _params.sort.nFields() <= kMaxOrderingFields) {
+        _sortKeyOrdering = Ordering::make(_params.sort);
+    }
+
     for (const auto& remote : _params.remotes) {
         if (remote.shardId) {
             invariant(remote.cmdObj);
@@ -210,28 +216,122 @@ boost::optional<BSONObj> AsyncResultsMerger::nextReadySorted() {
     // Tailable cursors cannot have a sort.
     invariant(!_params.isTailable);
 
-    if (_mergeQueue.empty()) {
+    if (_remotes.empty()) {
         return boost::none;
     }
 
-    size_t smallestRemote = _mergeQueue.top();
-    _mergeQueue.pop();
+    if (_mergeTree.empty()) {
+        buildMergeTree_inlock();
+    } else if (_mergeTreeReplayRemote) {
+        replayMergeTree_inlock(*_mergeTreeReplayRemote);
+    }
+    _mergeTreeReplayRemote = boost::none;
 
-    invariant(!_remotes[smallestRemote].docBuffer.empty());
-    invariant(_remotes[smallestRemote].status.isOK());
+    // If even the winner of the tournament has nothing buffered, then every remote is exhausted.
+    size_t smallestRemote = _mergeTree[0];
+    auto& remote = _remotes[smallestRemote];
+    if (!remote.hasNext()) {
+        return boost::none;
+    }
 
-    BSONObj front = _remotes[smallestRemote].docBuffer.front();
-    _remotes[smallestRemote].docBuffer.pop();
+    invariant(remote.status.isOK());
 
-    // Re-populate the merging queue with the next result from 'smallestRemote', if it has a
-    // next result.
-    if (!_remotes[smallestRemote].docBuffer.empty()) {
-        _mergeQueue.push(smallestRemote);
+    BSONObj front = remote.docBuffer.front();
+    remote.docBuffer.pop();
+    if (_sortKeyOrdering) {
+        remote.sortKeyBuffer.pop();
     }
 
+    // The leaf of 'smallestRemote' can only be replayed once we know its next result, which may
+    // require waiting for another batch.
+    _mergeTreeReplayRemote = smallestRemote;
+    prefetchNextBatchIfNeeded_inlock(smallestRemote);
+
     return front;
 }
 
+bool AsyncResultsMerger::sortsBefore_inlock(size_t lhs, size_t rhs) const {
+    const auto& leftRemote = _remotes[lhs];
+    const auto& rightRemote = _remotes[rhs];
+    if (!leftRemote.hasNext() || !rightRemote.hasNext()) {
+        if (leftRemote.hasNext() != rightRemote.hasNext()) {
+            return leftRemote.hasNext();
+        }
+        return lhs < rhs;
+    }
+
+    int cmp;
+    if (_sortKeyOrdering) {
+        const std::string& leftKey = leftRemote.sortKeyBuffer.front();
+        const std::string& rightKey = rightRemote.sortKeyBuffer.front();
+        cmp = leftKey.compare(rightKey);
+    } else {
+        BSONObj leftDocKey =
+            leftRemote.docBuffer.front()[ClusterClientCursorParams::kSortKeyField].Obj();
+        BSONObj rightDocKey =
+            rightRemote.docBuffer.front()[ClusterClientCursorParams::kSortKeyField].Obj();
+        cmp = leftDocKey.woCompare(rightDocKey, _params.sort, false /*considerFieldName*/);
+    }
+
+    return cmp < 0 || (cmp == 0 && lhs < rhs);
+}
+
+void AsyncResultsMerger::buildMergeTree_inlock() {
+    const size_t numRemotes = _remotes.size();
+    _mergeTree.assign(numRemotes, 0);
+
+    // 'winners[node]' is the winner of the match played at 'node'. The leaves occupy positions
+    // numRemotes through 2 * numRemotes - 1, and each is won by its own remote.
+    std::vector<size_t> winners(2 * numRemotes);
+    for (size_t i = 0; i < numRemotes; ++i) {
+        winners[numRemotes + i] = i;
+    }
+
+    for (size_t node = numRemotes - 1; node > 0; --node) {
+        size_t left = winners[2 * node];
+        size_t right = winners[2 * node + 1];
+        if (sortsBefore_inlock(left, right)) {
+            winners[node] = left;
+            _mergeTree[node] = right;
+        } else {
+            winners[node] = right;
+            _mergeTree[node] = left;
+        }
+    }
+
+    _mergeTree[0] = winners[1];
+}
+
+void AsyncResultsMerger::replayMergeTree_inlock(size_t remoteIndex) {
+    size_t winner = remoteIndex;
+    for (size_t node = (_remotes.size() + remoteIndex) / 2; node > 0; node /= 2) {
+        if (sortsBefore_inlock(_mergeTree[node], winner)) {
+            std::swap(_mergeTree[node], winner);
+        }
+    }
+    _mergeTree[0] = winner;
+}
+
+void AsyncResultsMerger::prefetchNextBatchIfNeeded_inlock(size_t remoteIndex) {
+    if (!_params.prefetchThreshold || _params.isTailable) {
+        return;
+    }
+
+    auto& remote = _remotes[remoteIndex];
+    if (remote.exhausted() || !remote.cursorId || remote.cbHandle.isValid() ||
+        !remote.status.isOK()) {
+        return;
+    }
+
+    if (static_cast<long long>(remote.docBuffer.size()) > *_params.prefetchThreshold) {
+        return;
+    }
+
+    // A failure to schedule the getMore leaves the remote without an outstanding request, so the
+    // next call to nextEvent() will retry it and surface the error to the caller.
+    askForNextBatch_inlock(remoteIndex);
+}
+
 boost::optional<BSONObj> AsyncResultsMerger::nextReadyUnsorted() {
     size_t remotesAttempted = 0;
     while (remotesAttempted < _remotes.size()) {
@@ -241,6 +341,7 @@ boost::optional<BSONObj> AsyncResultsMerger::nextReadyUnsorted() {
         if (_remotes[_gettingFromRemote].hasNext()) {
             BSONObj front = _remotes[_gettingFromRemote].docBuffer.front();
             _remotes[_gettingFromRemote].docBuffer.pop();
+            prefetchNextBatchIfNeeded_inlock(_gettingFromRemote);
 
             if (_params.isTailable && !_remotes[_gettingFromRemote].hasNext()) {
                 // The cursor is tailable and we're about to return the last buffered result. This
@@ -478,7 +579,13 @@ void AsyncResultsMerger::handleBatchResponse(
             // Clear the results buffer and cursor id.
             std::queue<BSONObj> emptyBuffer;
             std::swap(remote.docBuffer, emptyBuffer);
+            std::queue<std::string> emptySortKeyBuffer;
+            std::swap(remote.sortKeyBuffer, emptySortKeyBuffer);
             remote.cursorId = 0;
+
+            // The front result of this remote may have changed underneath the merge tree, so the
+            // tournament has to be replayed from scratch.
+            _mergeTree.clear();
         }
 
         return;
@@ -489,6 +596,14 @@ void AsyncResultsMerger::handleBatchResponse(
     remote.cursorId = cursorResponse.getCursorId();
     remote.initialCmdObj = boost::none;
 
+    // A remote whose buffer was empty can only be given a new front result without rebuilding the
+    // merge tree if it is the pending winner of the tournament.
+    if (!remote.hasNext() && !cursorResponse.getBatch().empty() &&
+        _mergeTreeReplayRemote != remoteIndex) {
+        _mergeTree.clear();
+    }
+
+    KeyString sortKeyString;
     for (const auto& obj : cursorResponse.getBatch()) {
         // If there's a sort, we're expecting the remote node to give us back a sort key.
         if (!_params.sort.isEmpty() &&
@@ -500,16 +615,26 @@ void AsyncResultsMerger::handleBatchResponse(
             return;
         }
 
+        // Encode the sort key once here, so that each comparison made by the merge is a memcmp.
+        // KeyString orders keys the same way as woCompare(), so the merge tree stays valid if we
+        // have to fall back to comparing BSON for a key with a type KeyString cannot encode.
+        if (_sortKeyOrdering) {
+            BSONObj sortKey = obj[ClusterClientCursorParams::kSortKeyField].Obj();
+            if (KeyString::canEncode(sortKey)) {
+                sortKeyString.resetToKey(sortKey, *_sortKeyOrdering);
+                remote.sortKeyBuffer.emplace(sortKeyString.getBuffer(), sortKeyString.getSize());
+            } else {
+                for (auto& otherRemote : _remotes) {
+                    otherRemote.sortKeyBuffer = std::queue<std::string>();
+                }
+                _sortKeyOrdering = boost::none;
+            }
+        }
+
         remote.docBuffer.push(obj);
         ++remote.fetchedCount;
     }
 
-    // If we're doing a sorted merge, then we have to make sure to put this remote onto the
-    // merge queue.
-    if (!_params.sort.isEmpty() && !cursorResponse.getBatch().empty()) {
-        _mergeQueue.push(remoteIndex);
-    }
-
     // If the cursor is tailable and we just received an empty batch, the next return value should
     // be boost::none in order to indicate the end of the batch.
     if (_params.isTailable && !remote.hasNext()) {
@@ -528,6 +653,9 @@ void AsyncResultsMerger::handleBatchResponse(
         }
     }
 
+    // A batch smaller than the prefetch threshold warrants asking for the following one right away.
+    prefetchNextBatchIfNeeded_inlock(remoteIndex);
+
     // ScopeGuard requires dismiss on success, but we want waiter to be signalled on success as
     // well as failure.
     signaller.Dismiss();
@@ -659,18 +787,4 @@ Status AsyncResultsMerger::RemoteCursorData::resolveShardIdToHostAndPort(
     return Status::OK();
 }
 
-//
-// AsyncResultsMerger::MergingComparator
-//
-
-bool AsyncResultsMerger::MergingComparator::operator()(const size_t& lhs, const size_t& rhs) {
-    const BSONObj& leftDoc = _remotes[lhs].docBuffer.front();
-    const BSONObj& rightDoc = _remotes[rhs].docBuffer.front();
-
-    BSONObj leftDocKey = leftDoc[ClusterClientCursorParams::kSortKeyField].Obj();
-    BSONObj rightDocKey = rightDoc[ClusterClientCursorParams::kSortKeyField].Obj();
-
-    return leftDocKey.woCompare(rightDocKey, _sort, false /*considerFieldName*/) > 0;
-}
-
 }  // namespace mongo
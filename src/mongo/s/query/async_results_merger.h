@@ -30,11 +30,13 @@
 
 #include <boost/optional.hpp>
 #include <queue>
+#include <string>
 #include <vector>
 
 #include "mongo/base/disallow_copying.h"
 #include "mongo/base/status_with.h"
 #include "mongo/bson/bsonobj.h"
+#include "mongo/bson/ordering.h"
 #include "mongo/db/cursor_id.h"
 #include "mongo/executor/task_executor.h"
 #include "mongo/s/query/cluster_client_cursor_params.h"
@@ -62,7 +64,10 @@ class CursorResponse;
  * Task-scheduling behavior differs depending on whether there is a sort. If the result documents
  * must be sorted, we pass the sort through to the remote nodes and then merge the sorted streams.
  * This requires waiting until we have a response from every remote before returning results.
- * Without a sort, we are ready to return results as soon as we have *any* response from a remote.
+ * The sorted streams are merged with a tournament (loser) tree whose leaves are the remotes, so
+ * producing each result costs O(log n) comparisons of pre-encoded KeyString sort keys for n
+ * remotes. Without a sort, we are ready to return results as soon as we have *any* response from a
+ * remote.
  *
  * On any error, the caller is responsible for shutting down the ARM using the kill() method.
  *
@@ -222,6 +227,11 @@ private:
         boost::optional<CursorId> cursorId;
 
         std::queue<BSONObj> docBuffer;
+
+        // The KeyString-encoded '$sortKey' of each document in 'docBuffer', in the same order. Only
+        // populated while '_sortKeyOrdering' is set.
+        std::queue<std::string> sortKeyBuffer;
+
         executor::TaskExecutor::CallbackHandle cbHandle;
         Status status = Status::OK();
 
@@ -240,19 +250,6 @@ private:
         boost::optional<HostAndPort> _shardHostAndPort;
     };
 
-    class MergingComparator {
-    public:
-        MergingComparator(const std::vector<RemoteCursorData>& remotes, const BSONObj& sort)
-            : _remotes(remotes), _sort(sort) {}
-
-        bool operator()(const size_t& lhs, const size_t& rhs);
-
-    private:
-        const std::vector<RemoteCursorData>& _remotes;
-
-        const BSONObj& _sort;
-    };
-
     enum LifecycleState { kAlive, kKillStarted, kKillComplete };
 
     /**
@@ -299,6 +296,35 @@ private:
     boost::optional<BSONObj> nextReadySorted();
     boost::optional<BSONObj> nextReadyUnsorted();
 
+    //
+    // Helpers for the sorted merge.
+    //
+
+    /**
+     * Returns true if the next buffered result of the remote at 'lhs' sorts strictly before the
+     * next buffered result of the remote at 'rhs'. A remote without buffered results sorts after
+     * every other remote. Ties are broken by remote index so that the merge is deterministic.
+     */
+    bool sortsBefore_inlock(size_t lhs, size_t rhs) const;
+
+    /**
+     * Plays a full tournament between all remotes, filling '_mergeTree' from scratch.
+     */
+    void buildMergeTree_inlock();
+
+    /**
+     * Replays the matches on the path from the leaf of the remote at 'remoteIndex' to the root of
+     * '_mergeTree'. Only valid if that remote was the previous winner of the tournament.
+     */
+    void replayMergeTree_inlock(size_t remoteIndex);
+
+    /**
+     * Schedules a getMore against the remote at 'remoteIndex' if prefetching is enabled and the
+     * number of results buffered from it has dropped to the prefetch threshold. Scheduling errors
+     * are ignored here; they are reported by the next call to nextEvent() instead.
+     */
+    void prefetchNextBatchIfNeeded_inlock(size_t remoteIndex);
+
     /**
      * When nextEvent() schedules remote work, it passes this method as a callback. The TaskExecutor
      * will call this function, passing the response from the remote.
@@ -345,9 +371,20 @@ private:
     // Data tracking the state of our communication with each of the remote nodes.
     std::vector<RemoteCursorData> _remotes;
 
-    // The top of this priority queue is the index into '_remotes' for the remote host that has the
-    // next document to return, according to the sort order. Used only if there is a sort.
-    std::priority_queue<size_t, std::vector<size_t>, MergingComparator> _mergeQueue;
+    // Describes the sort pattern for encoding '$sortKey' values as KeyStrings. Unset if there is no
+    // sort, if the sort pattern has too many fields to be described by an Ordering, or once a remote
+    // returns a sort key that KeyString cannot encode. The sort keys are then compared as BSON.
+    boost::optional<Ordering> _sortKeyOrdering;
+
+    // Loser tree over the indices into '_remotes'. Element 0 holds the index of the remote with the
+    // next document to return according to the sort order, and each internal node 1..n-1 holds the
+    // loser of the match played there. Leaf i sits at the implicit position n + i. Empty if the
+    // tournament has yet to be played. Used only if there is a sort.
+    std::vector<size_t> _mergeTree;
+
+    // The winner whose front document was last returned by nextReadySorted(). Its leaf is replayed
+    // lazily on the next call, once the remote has either buffered more results or is exhausted.
+    boost::optional<size_t> _mergeTreeReplayRemote;
 
     // The index into '_remotes' for the remote from which we are currently retrieving results.
     // Used only if there is *not* a sort.
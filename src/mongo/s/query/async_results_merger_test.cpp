@@ -100,12 +100,16 @@ protected:
      *
      * If 'batchSize' is set (i.e. not equal to boost::none), this batchSize is used for each
      * getMore. If 'findCmd' has a batchSize, this is used just for the initial find operation.
+     *
+     * If 'prefetchThreshold' is set, the ARM asks a remote for its next batch as soon as it has
+     * that many results or fewer buffered.
      */
     void makeCursorFromFindCmd(
         const BSONObj& findCmd,
         const std::vector<ShardId>& shardIds,
         boost::optional<long long> getMoreBatchSize = boost::none,
-        ReadPreferenceSetting readPref = ReadPreferenceSetting(ReadPreference::PrimaryOnly)) {
+        ReadPreferenceSetting readPref = ReadPreferenceSetting(ReadPreference::PrimaryOnly),
+        boost::optional<long long> prefetchThreshold = boost::none) {
         const bool isExplain = true;
         const auto lpq =
             unittest::assertGet(LiteParsedQuery::makeFromFindCommand(_nss, findCmd, isExplain));
@@ -118,6 +122,7 @@ protected:
         params.isTailable = lpq->isTailable();
         params.isAwaitData = lpq->isAwaitData();
         params.isAllowPartialResults = lpq->isAllowPartialResults();
+        params.prefetchThreshold = prefetchThreshold;
 
         for (const auto& shardId : shardIds) {
             params.remotes.emplace_back(shardId, findCmd);
@@ -180,6 +185,14 @@ protected:
         return retRequest;
     }
 
+    bool networkHasReadyRequests() {
+        executor::NetworkInterfaceMock* net = network();
+        net->enterNetwork();
+        bool hasReadyRequests = net->hasReadyRequests();
+        net->exitNetwork();
+        return hasReadyRequests;
+    }
+
     void scheduleErrorResponse(Status status) {
         invariant(!status.isOK());
         executor::NetworkInterfaceMock* net = network();
@@ -475,6 +488,157 @@ TEST_F(AsyncResultsMergerTest, ClusterFindCompoundSortKey) {
     ASSERT(!unittest::assertGet(arm->nextReady()));
 }
 
+TEST_F(AsyncResultsMergerTest, ClusterFindSortedMixedTypes) {
+    BSONObj findCmd = fromjson("{find: 'testcoll', sort: {a: 1}, batchSize: 2}");
+    makeCursorFromFindCmd(findCmd, kTestShardIds);
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+    ASSERT_FALSE(arm->ready());
+
+    // Sort keys of different BSON types must merge in BSON order, with numbers of different types
+    // compared by value.
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{$sortKey: {'': 1}}"),
+                                   fromjson("{$sortKey: {'': 'b'}}")};
+    responses.emplace_back(_nss, CursorId(0), batch1);
+    std::vector<BSONObj> batch2 = {fromjson("{$sortKey: {'': 1.5}}"),
+                                   fromjson("{$sortKey: {'': NumberLong(2)}}")};
+    responses.emplace_back(_nss, CursorId(0), batch2);
+    std::vector<BSONObj> batch3 = {fromjson("{$sortKey: {'': null}}"),
+                                   fromjson("{$sortKey: {'': 'a'}}")};
+    responses.emplace_back(_nss, CursorId(0), batch3);
+    scheduleNetworkResponses(std::move(responses), CursorResponse::ResponseType::InitialResponse);
+    executor->waitForEvent(readyEvent);
+
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': null}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': 1}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': 1.5}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': NumberLong(2)}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': 'a'}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': 'b'}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT(!unittest::assertGet(arm->nextReady()));
+}
+
+TEST_F(AsyncResultsMergerTest, ClusterFindSortedTiesReturnedInRemoteOrder) {
+    BSONObj findCmd = fromjson("{find: 'testcoll', sort: {a: -1}, batchSize: 2}");
+    makeCursorFromFindCmd(findCmd, kTestShardIds);
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+    ASSERT_FALSE(arm->ready());
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{_id: 1, $sortKey: {'': 5}}"),
+                                   fromjson("{_id: 4, $sortKey: {'': 4}}")};
+    responses.emplace_back(_nss, CursorId(0), batch1);
+    std::vector<BSONObj> batch2 = {fromjson("{_id: 2, $sortKey: {'': 5}}"),
+                                   fromjson("{_id: 5, $sortKey: {'': 4}}")};
+    responses.emplace_back(_nss, CursorId(0), batch2);
+    std::vector<BSONObj> batch3 = {fromjson("{_id: 0, $sortKey: {'': 6}}"),
+                                   fromjson("{_id: 3, $sortKey: {'': 5}}")};
+    responses.emplace_back(_nss, CursorId(0), batch3);
+    scheduleNetworkResponses(std::move(responses), CursorResponse::ResponseType::InitialResponse);
+    executor->waitForEvent(readyEvent);
+
+    for (int id = 0; id < 6; ++id) {
+        ASSERT_TRUE(arm->ready());
+        ASSERT_EQ(id, (*unittest::assertGet(arm->nextReady()))["_id"].numberInt());
+    }
+    ASSERT_TRUE(arm->ready());
+    ASSERT(!unittest::assertGet(arm->nextReady()));
+}
+
+TEST_F(AsyncResultsMergerTest, ClusterFindSortPatternTooLongForOrdering) {
+    // A sort pattern with more fields than an Ordering can describe is merged by comparing the sort
+    // keys as BSON.
+    BSONObjBuilder sortBuilder;
+    BSONObjBuilder lowKeyBuilder;
+    BSONObjBuilder highKeyBuilder;
+    for (int i = 0; i < 33; ++i) {
+        sortBuilder.append("f" + std::to_string(i), i == 32 ? -1 : 1);
+        lowKeyBuilder.append("", i == 32 ? 2 : 0);
+        highKeyBuilder.append("", i == 32 ? 1 : 0);
+    }
+    BSONObj findCmd = BSON("find"
+                           << "testcoll"
+                           << "sort" << sortBuilder.obj() << "batchSize" << 2);
+    makeCursorFromFindCmd(findCmd, {kTestShardIds[0], kTestShardIds[1]});
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+    ASSERT_FALSE(arm->ready());
+
+    // The last sort field is descending, so the key ending in 2 comes first.
+    BSONObj first = BSON("_id" << 1 << "$sortKey" << lowKeyBuilder.obj());
+    BSONObj second = BSON("_id" << 2 << "$sortKey" << highKeyBuilder.obj());
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {second};
+    responses.emplace_back(_nss, CursorId(0), batch1);
+    std::vector<BSONObj> batch2 = {first};
+    responses.emplace_back(_nss, CursorId(0), batch2);
+    scheduleNetworkResponses(std::move(responses), CursorResponse::ResponseType::InitialResponse);
+    executor->waitForEvent(readyEvent);
+
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(first, *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(second, *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT(!unittest::assertGet(arm->nextReady()));
+}
+
+TEST_F(AsyncResultsMergerTest, ClusterFindSortKeyKeyStringCannotEncode) {
+    // KeyString has no encoding for decimals, so a batch holding one switches the merge over to
+    // comparing the sort keys as BSON, including the keys already buffered.
+    if (!Decimal128::enabled) {
+        return;
+    }
+
+    BSONObj findCmd = fromjson("{find: 'testcoll', sort: {a: 1}, batchSize: 2}");
+    makeCursorFromFindCmd(findCmd, kTestShardIds);
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+    ASSERT_FALSE(arm->ready());
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{$sortKey: {'': 1}}"),
+                                   fromjson("{$sortKey: {'': 4}}")};
+    responses.emplace_back(_nss, CursorId(0), batch1);
+    std::vector<BSONObj> batch2 = {fromjson("{$sortKey: {'': NumberDecimal('2.5')}}"),
+                                   fromjson("{$sortKey: {'': 5}}")};
+    responses.emplace_back(_nss, CursorId(0), batch2);
+    std::vector<BSONObj> batch3 = {fromjson("{$sortKey: {'': 2}}"),
+                                   fromjson("{$sortKey: {'': 3}}")};
+    responses.emplace_back(_nss, CursorId(0), batch3);
+    scheduleNetworkResponses(std::move(responses), CursorResponse::ResponseType::InitialResponse);
+    executor->waitForEvent(readyEvent);
+
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': 1}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': 2}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': NumberDecimal('2.5')}}"),
+              *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': 3}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': 4}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{$sortKey: {'': 5}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT(!unittest::assertGet(arm->nextReady()));
+}
+
 TEST_F(AsyncResultsMergerTest, ClusterFindSortedButNoSortKey) {
     BSONObj findCmd = fromjson("{find: 'testcoll', sort: {a: -1, b: 1}, batchSize: 2}");
     makeCursorFromFindCmd(findCmd, {kTestShardIds[0]});
@@ -1099,6 +1263,109 @@ TEST_F(AsyncResultsMergerTest, GetMoreBatchSizes) {
     ASSERT(!unittest::assertGet(arm->nextReady()));
 }
 
+TEST_F(AsyncResultsMergerTest, PrefetchGetMoreBeforeBufferRunsDry) {
+    BSONObj findCmd = fromjson("{find: 'testcoll', batchSize: 3}");
+    makeCursorFromFindCmd(findCmd,
+                          {kTestShardIds[0]},
+                          boost::none,
+                          ReadPreferenceSetting(ReadPreference::PrimaryOnly),
+                          1LL);
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+    ASSERT_FALSE(arm->ready());
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {
+        fromjson("{_id: 1}"), fromjson("{_id: 2}"), fromjson("{_id: 3}")};
+    responses.emplace_back(_nss, CursorId(1), batch1);
+    scheduleNetworkResponses(std::move(responses), CursorResponse::ResponseType::InitialResponse);
+    executor->waitForEvent(readyEvent);
+
+    // Two results are still buffered, which is above the prefetch threshold.
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 1}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_FALSE(networkHasReadyRequests());
+
+    // Dropping to the threshold schedules the getMore while a result is still buffered.
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 2}"), *unittest::assertGet(arm->nextReady()));
+    auto request = GetMoreRequest::parseFromBSON("anydbname", getFirstPendingRequest().cmdObj);
+    ASSERT_OK(request.getStatus());
+    ASSERT_EQ(request.getValue().cursorid, 1LL);
+
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 3}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_FALSE(arm->ready());
+
+    // The outstanding getMore is not issued a second time.
+    readyEvent = unittest::assertGet(arm->nextEvent());
+    responses.clear();
+    std::vector<BSONObj> batch2 = {fromjson("{_id: 4}")};
+    responses.emplace_back(_nss, CursorId(0), batch2);
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    executor->waitForEvent(readyEvent);
+    ASSERT_FALSE(networkHasReadyRequests());
+
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 4}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT(!unittest::assertGet(arm->nextReady()));
+}
+
+TEST_F(AsyncResultsMergerTest, PrefetchGetMoreSorted) {
+    BSONObj findCmd = fromjson("{find: 'testcoll', sort: {_id: 1}, batchSize: 2}");
+    makeCursorFromFindCmd(findCmd,
+                          {kTestShardIds[0], kTestShardIds[1]},
+                          boost::none,
+                          ReadPreferenceSetting(ReadPreference::PrimaryOnly),
+                          1LL);
+
+    ASSERT_FALSE(arm->ready());
+    auto readyEvent = unittest::assertGet(arm->nextEvent());
+    ASSERT_FALSE(arm->ready());
+
+    std::vector<CursorResponse> responses;
+    std::vector<BSONObj> batch1 = {fromjson("{_id: 1, $sortKey: {'': 1}}"),
+                                   fromjson("{_id: 5, $sortKey: {'': 5}}")};
+    responses.emplace_back(_nss, CursorId(1), batch1);
+    std::vector<BSONObj> batch2 = {fromjson("{_id: 2, $sortKey: {'': 2}}"),
+                                   fromjson("{_id: 3, $sortKey: {'': 3}}")};
+    responses.emplace_back(_nss, CursorId(2), batch2);
+    scheduleNetworkResponses(std::move(responses), CursorResponse::ResponseType::InitialResponse);
+    executor->waitForEvent(readyEvent);
+
+    // Each remote is asked for its next batch as soon as it has a single result left.
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 1, $sortKey: {'': 1}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 2, $sortKey: {'': 2}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_TRUE(arm->ready());
+    ASSERT_EQ(fromjson("{_id: 3, $sortKey: {'': 3}}"), *unittest::assertGet(arm->nextReady()));
+    ASSERT_FALSE(arm->ready());
+
+    // The first remote's batch lands behind the result it still has buffered.
+    readyEvent = unittest::assertGet(arm->nextEvent());
+    responses.clear();
+    std::vector<BSONObj> batch3 = {fromjson("{_id: 6, $sortKey: {'': 6}}"),
+                                   fromjson("{_id: 8, $sortKey: {'': 8}}")};
+    responses.emplace_back(_nss, CursorId(0), batch3);
+    std::vector<BSONObj> batch4 = {fromjson("{_id: 4, $sortKey: {'': 4}}"),
+                                   fromjson("{_id: 7, $sortKey: {'': 7}}")};
+    responses.emplace_back(_nss, CursorId(0), batch4);
+    scheduleNetworkResponses(std::move(responses),
+                             CursorResponse::ResponseType::SubsequentResponse);
+    executor->waitForEvent(readyEvent);
+
+    for (int id = 4; id <= 8; ++id) {
+        ASSERT_TRUE(arm->ready());
+        ASSERT_EQ(id, (*unittest::assertGet(arm->nextReady()))["_id"].numberInt());
+    }
+    ASSERT_TRUE(arm->ready());
+    ASSERT(!unittest::assertGet(arm->nextReady()));
+}
+
 TEST_F(AsyncResultsMergerTest, SendsSecondaryOkAsMetadata) {
     BSONObj findCmd = fromjson("{find: 'testcoll', batchSize: 2}");
     makeCursorFromFindCmd(
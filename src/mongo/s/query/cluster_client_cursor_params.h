@@ -137,6 +137,11 @@ struct ClusterClientCursorParams {
     // Whether the client indicated that it is willing to receive partial results in the case of an
     // unreachable host.
     bool isAllowPartialResults = false;
+
+    // If set, a getMore is scheduled against a remote as soon as the number of results buffered
+    // from it drops to this many, rather than only once its buffer has run dry. Ignored for
+    // tailable cursors, whose batches are passed through to the client as they arrive.
+    boost::optional<long long> prefetchThreshold;
 };
 
 }  // mongo
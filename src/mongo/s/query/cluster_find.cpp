@@ -43,6 +43,7 @@
 #include "mongo/db/query/canonical_query.h"
 #include "mongo/db/query/find_common.h"
 #include "mongo/db/query/getmore_request.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/rpc/metadata/server_selection_metadata.h"
 #include "mongo/s/catalog/catalog_cache.h"
 #include "mongo/s/chunk_manager.h"
@@ -61,6 +62,10 @@
 
 namespace mongo {
 
+// When a remote has this many results or fewer buffered on mongos, ask it for the next batch
+// without waiting for the buffer to run dry. A negative value disables prefetching.
+MONGO_EXPORT_SERVER_PARAMETER(internalQueryRouterPrefetchThreshold, int, 32);
+
 namespace {
 
 static const BSONObj kSortKeyMetaProjection = BSON("$meta"
@@ -224,6 +229,11 @@ StatusWith<CursorId> runQueryWithoutRetrying(OperationContext* txn,
     params.isAwaitData = query.getParsed().isAwaitData();
     params.isAllowPartialResults = query.getParsed().isAllowPartialResults();
 
+    const int prefetchThreshold = internalQueryRouterPrefetchThreshold;
+    if (prefetchThreshold >= 0) {
+        params.prefetchThreshold = prefetchThreshold;
+    }
+
     // This is the batchSize passed to each subsequent getMore command issued by the cursor. We
     // usually use the batchSize associated with the initial find, but as it is illegal to send a
     // getMore with a batchSize of 0, we set it to use the default batchSize logic.
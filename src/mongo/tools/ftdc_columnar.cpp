@@ -0,0 +1,114 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/filesystem.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "mongo/base/initializer.h"
+#include "mongo/db/ftdc/column_reader.h"
+#include "mongo/util/exit_code.h"
+#include "mongo/util/quick_exit.h"
+#include "mongo/util/text.h"
+
+namespace mongo {
+namespace {
+
+void printUsage() {
+    std::cerr << "usage: ftdc_columnar <diagnostic.data directory or metrics file> <output file>"
+              << std::endl
+              << std::endl
+              << "Converts FTDC metric files into a single file of metric columns which can be "
+                 "read with FTDCColumnReader."
+              << std::endl;
+}
+
+int ftdcColumnarMain(int argc, char** argv, char** envp) {
+    runGlobalInitializersOrDie(argc, argv, envp);
+
+    if (argc != 3) {
+        printUsage();
+        return EXIT_BADOPTIONS;
+    }
+
+    boost::filesystem::path input(argv[1]);
+    boost::filesystem::path output(argv[2]);
+
+    std::vector<boost::filesystem::path> files;
+    if (boost::filesystem::is_directory(input)) {
+        files = FTDCColumnarConverter::listFiles(input);
+    } else if (boost::filesystem::is_regular_file(input)) {
+        files.push_back(input);
+    }
+
+    if (files.empty()) {
+        std::cerr << "No FTDC metric files found in '" << input.generic_string() << "'"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    FTDCColumnarConverter converter;
+    Status s = converter.convert(files, output);
+    if (!s.isOK()) {
+        std::cerr << "Failed to convert '" << input.generic_string() << "': " << s << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto& stats = converter.getStats();
+    std::cout << "Converted " << stats.files << " files, " << stats.chunks << " chunks, "
+              << stats.samples << " samples: " << stats.inputBytes << " bytes in, "
+              << stats.outputBytes << " bytes out to '" << output.generic_string() << "'"
+              << std::endl;
+
+    return EXIT_CLEAN;
+}
+
+}  // namespace
+}  // namespace mongo
+
+#if defined(_WIN32)
+// In Windows, wmain() is an alternate entry point for main(), and receives the same parameters
+// as main() but encoded in Windows Unicode (UTF-16); "wide" 16-bit wchar_t characters.  The
+// WindowsCommandLine object converts these wide character strings to a UTF-8 coded equivalent
+// and makes them available through the argv() and envp() members.  This enables
+// ftdcColumnarMain() to process UTF-8 encoded arguments and environment variables without regard
+// to platform.
+int wmain(int argc, wchar_t* argvW[], wchar_t* envpW[]) {
+    mongo::WindowsCommandLine wcl(argc, argvW, envpW);
+    int exitCode = mongo::ftdcColumnarMain(argc, wcl.argv(), wcl.envp());
+    mongo::quickExit(exitCode);
+}
+#else
+int main(int argc, char* argv[], char** envp) {
+    int exitCode = mongo::ftdcColumnarMain(argc, argv, envp);
+    mongo::quickExit(exitCode);
+}
+#endif
@@ -0,0 +1,220 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kStorage
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/admission_controller.h"
+
+#include <algorithm>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/util/log.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+namespace {
+
+long long queueWaitBucketLowerBound(size_t bucket) {
+    return bucket == 0 ? 0 : AdmissionController::kFirstQueueWaitBucketMicros << (bucket - 1);
+}
+
+}  // namespace
+
+const int AdmissionController::kReservedTickets;
+const int AdmissionController::kMinTickets;
+const double AdmissionController::kCachePressureThreshold = 0.95;
+const double AdmissionController::kMinThroughputGain = 1.05;
+const size_t AdmissionController::kNumQueueWaitBuckets;
+const long long AdmissionController::kFirstQueueWaitBucketMicros;
+
+AdmissionController::AdmissionController(TicketHolder* holder)
+    : _holder(holder),
+      _reserved(kReservedTickets),
+      _tickets(holder->outof()),
+      _lastAdjustment(Date_t::now()) {}
+
+TicketHolder* AdmissionController::admit(Priority priority) {
+    if (_holder->tryAcquire()) {
+        _admitted.fetchAndAdd(1);
+        return _holder;
+    }
+
+    if (priority == Priority::kHigh) {
+        _reserved.waitForTicket();
+        _admitted.fetchAndAdd(1);
+        _admittedFromReserve.fetchAndAdd(1);
+        return &_reserved;
+    }
+
+    Timer timer;
+    _holder->waitForTicket();
+    const long long micros = timer.micros();
+
+    _admitted.fetchAndAdd(1);
+    _queued.fetchAndAdd(1);
+    _queueWaitMicros.fetchAndAdd(micros);
+    _queueWaitHistogram[queueWaitBucket(micros)].fetchAndAdd(1);
+    return _holder;
+}
+
+void AdmissionController::adjust(double cacheFillRatio, int maxTickets) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    const Date_t now = Date_t::now();
+    const long long admitted = _admitted.load();
+    const long long queued = _queued.load();
+    const long long queueWaitMicros = _queueWaitMicros.load();
+
+    Interval interval;
+    interval.millis = durationCount<Milliseconds>(now - _lastAdjustment);
+    interval.admitted = admitted - _lastAdmitted;
+    interval.queued = queued - _lastQueued;
+    interval.queueWaitMicros = queueWaitMicros - _lastQueueWaitMicros;
+    interval.cacheFillRatio = cacheFillRatio;
+
+    _lastAdjustment = now;
+    _lastAdmitted = admitted;
+    _lastQueued = queued;
+    _lastQueueWaitMicros = queueWaitMicros;
+
+    const int currentTickets = _tickets;
+    _tickets = nextTicketCount(interval, currentTickets, maxTickets);
+    if (_tickets != currentTickets) {
+        LOG(2) << "adjusting the number of tickets from " << currentTickets << " to " << _tickets;
+    }
+    _withholdTickets();
+}
+
+void AdmissionController::restore() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    _tickets = _holder->outof();
+    _withholdTickets();
+}
+
+Status AdmissionController::resize(int newSize) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+
+    // Shrinking the TicketHolder waits for the tickets it removes, so the withheld tickets must be
+    // back in circulation first.
+    const int tickets = _tickets;
+    _tickets = _holder->outof();
+    _withholdTickets();
+
+    Status status = _holder->resize(newSize);
+    _tickets = std::min(tickets, _holder->outof());
+    _withholdTickets();
+    return status;
+}
+
+void AdmissionController::_withholdTickets() {
+    int withheld = _withheld.load();
+    const int target = std::max(0, _holder->outof() - _tickets);
+    while (withheld < target && _holder->tryAcquire()) {
+        withheld++;
+    }
+    while (withheld > target) {
+        _holder->release();
+        withheld--;
+    }
+    _withheld.store(withheld);
+}
+
+int AdmissionController::nextTicketCount(const Interval& interval,
+                                         int currentTickets,
+                                         int maxTickets) {
+    const double throughput =
+        interval.millis > 0 ? interval.admitted * 1000.0 / interval.millis : _lastThroughput;
+    const int step = std::max(1, currentTickets / 8);
+
+    int direction = 0;
+    int tickets = currentTickets;
+    if (interval.cacheFillRatio >= kCachePressureThreshold) {
+        // More concurrent transactions only add to the eviction work, so back off quickly.
+        direction = -1;
+        tickets -= std::max(step, currentTickets / 4);
+    } else if (interval.queued > 0 && interval.queueWaitMicros > 0) {
+        if (_lastDirection > 0 && throughput < _lastThroughput * kMinThroughputGain) {
+            // The last increase did not pay off, so admission is not what limits throughput.
+            direction = -1;
+            tickets -= step;
+        } else if (_lastDirection < 0 && throughput * kMinThroughputGain >= _lastThroughput) {
+            // The last decrease did not cost throughput. Keep the smaller number of tickets.
+            direction = 0;
+        } else {
+            direction = 1;
+            tickets += step;
+        }
+    }
+
+    tickets = std::max(kMinTickets, std::min(tickets, std::max(kMinTickets, maxTickets)));
+    _lastDirection = tickets == currentTickets ? 0 : direction;
+    _lastThroughput = throughput;
+    return tickets;
+}
+
+void AdmissionController::appendStats(BSONObjBuilder* builder) const {
+    builder->append("admitted", _admitted.load());
+    builder->append("queued", _queued.load());
+    builder->append("admittedFromReserve", _admittedFromReserve.load());
+
+    {
+        BSONObjBuilder reservedBuilder(builder->subobjStart("reserved"));
+        reservedBuilder.append("out", _reserved.used());
+        reservedBuilder.append("available", _reserved.available());
+        reservedBuilder.append("totalTickets", _reserved.outof());
+    }
+
+    BSONObjBuilder queueWaitBuilder(builder->subobjStart("queueWaitMicros"));
+    queueWaitBuilder.append("total", _queueWaitMicros.load());
+
+    // Only the buckets which counted waits are reported.
+    BSONArrayBuilder histogramBuilder(queueWaitBuilder.subarrayStart("histogram"));
+    for (size_t i = 0; i < kNumQueueWaitBuckets; i++) {
+        const long long count = _queueWaitHistogram[i].load();
+        if (count) {
+            histogramBuilder.append(BSON("lowerBound" << queueWaitBucketLowerBound(i) << "count"
+                                                      << count));
+        }
+    }
+}
+
+// static
+size_t AdmissionController::queueWaitBucket(long long micros) {
+    size_t bucket = 0;
+    for (long long bound = kFirstQueueWaitBucketMicros;
+         micros >= bound && bucket < kNumQueueWaitBuckets - 1;
+         bound *= 2) {
+        bucket++;
+    }
+    return bucket;
+}
+
+}  // namespace mongo
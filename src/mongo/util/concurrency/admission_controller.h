@@ -0,0 +1,183 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <array>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+class BSONObjBuilder;
+
+/**
+ * Admits operations through a TicketHolder and adapts its number of tickets to the observed load.
+ *
+ * Operations of normal priority wait in line for a ticket. Operations of high priority, such as
+ * replication and other internal work, take a ticket of the TicketHolder if one is available and
+ * otherwise wait for one of a small pool of kReservedTickets tickets, so they never queue behind
+ * normal operations while still being bounded in number.
+ *
+ * Adaptation is driven by calling adjust() periodically. While normal operations queue for
+ * tickets, the number of tickets grows for as long as admission throughput keeps improving, and
+ * shrinks back once it stops doing so. The number of tickets also shrinks whenever the storage
+ * engine reports cache pressure. Tickets are taken out of circulation by holding on to them as
+ * they become free, so adjust() never waits for operations to release their tickets.
+ */
+class AdmissionController {
+    MONGO_DISALLOW_COPYING(AdmissionController);
+
+public:
+    enum class Priority { kNormal, kHigh };
+
+    // Number of tickets reserved for operations of high priority.
+    static const int kReservedTickets = 8;
+
+    // The smallest number of tickets adjust() leaves, which is also the smallest size a
+    // TicketHolder can be resized to.
+    static const int kMinTickets = 5;
+
+    // Cache fill ratio from which the storage engine is considered under pressure. This is where
+    // WiredTiger makes application threads help with eviction by default.
+    static const double kCachePressureThreshold;
+
+    // Throughput must improve by this ratio for an increase in tickets to be worth keeping.
+    static const double kMinThroughputGain;
+
+    // Queue waits are counted in a histogram of kNumQueueWaitBuckets buckets. The first counts
+    // waits shorter than kFirstQueueWaitBucketMicros, and each following bucket starts at twice
+    // the lower bound of the previous one. The last bucket is unbounded.
+    static const size_t kNumQueueWaitBuckets = 16;
+    static const long long kFirstQueueWaitBucketMicros = 16;
+
+    /**
+     * What happened during an adjustment interval, as passed to nextTicketCount().
+     */
+    struct Interval {
+        long long millis = 0;
+        long long admitted = 0;
+        long long queued = 0;
+        long long queueWaitMicros = 0;
+        double cacheFillRatio = 0;
+    };
+
+    explicit AdmissionController(TicketHolder* holder);
+
+    TicketHolder* getTicketHolder() const {
+        return _holder;
+    }
+
+    /**
+     * Returns how many of the tickets of the TicketHolder adjust() took out of circulation.
+     */
+    int getWithheldTickets() const {
+        return _withheld.load();
+    }
+
+    /**
+     * Admits an operation, waiting for a ticket. Returns the TicketHolder the ticket was taken
+     * from, which the caller must eventually release it to.
+     */
+    TicketHolder* admit(Priority priority);
+
+    /**
+     * Moves the number of tickets in circulation towards nextTicketCount() for the admissions
+     * since the previous call, without exceeding 'maxTickets'. Tickets which are in use when the
+     * number shrinks are taken out of circulation by later calls, as they are released.
+     */
+    void adjust(double cacheFillRatio, int maxTickets);
+
+    /**
+     * Puts all the tickets of the TicketHolder back into circulation.
+     */
+    void restore();
+
+    /**
+     * Resizes the TicketHolder to 'newSize' tickets. Shrinking it waits for the tickets in use
+     * above the new size to be released. No more than 'newSize' tickets stay in circulation.
+     */
+    Status resize(int newSize);
+
+    /**
+     * Returns the number of tickets the TicketHolder should have after 'interval', given that it
+     * has 'currentTickets' now. Updates the state kept across intervals.
+     */
+    int nextTicketCount(const Interval& interval, int currentTickets, int maxTickets);
+
+    /**
+     * Appends the admission counters and the queue wait histogram.
+     */
+    void appendStats(BSONObjBuilder* builder) const;
+
+    /**
+     * Returns the queue wait histogram bucket that a wait of 'micros' falls into.
+     */
+    static size_t queueWaitBucket(long long micros);
+
+private:
+    /**
+     * Takes or releases tickets of the TicketHolder, without waiting, so that as few as possible
+     * but no fewer than _tickets of them are in circulation.
+     */
+    void _withholdTickets();
+
+    TicketHolder* const _holder;
+    TicketHolder _reserved;
+
+    // Cumulative counters, updated by admit().
+    AtomicInt64 _admitted;
+    AtomicInt64 _queued;
+    AtomicInt64 _queueWaitMicros;
+    AtomicInt64 _admittedFromReserve;
+    std::array<AtomicInt64, kNumQueueWaitBuckets> _queueWaitHistogram;
+
+    // Serializes adjust(), restore() and resize(), which all change the tickets in circulation.
+    stdx::mutex _mutex;
+
+    // Tickets of the TicketHolder held by the controller to take them out of circulation. Only
+    // changed with _mutex held.
+    AtomicInt32 _withheld;
+
+    // State of adjust() and nextTicketCount(). _tickets is only accessed with _mutex held.
+    int _tickets;
+    Date_t _lastAdjustment;
+    long long _lastAdmitted = 0;
+    long long _lastQueued = 0;
+    long long _lastQueueWaitMicros = 0;
+    double _lastThroughput = 0;
+
+    // Direction of the last change of the number of tickets, or zero if it was kept.
+    int _lastDirection = 0;
+};
+
+}  // namespace mongo
@@ -0,0 +1,297 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/admission_controller.h"
+
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+namespace {
+
+using Priority = AdmissionController::Priority;
+
+AdmissionController::Interval interval(long long admitted, long long queued) {
+    AdmissionController::Interval interval;
+    interval.millis = 1000;
+    interval.admitted = admitted;
+    interval.queued = queued;
+    interval.queueWaitMicros = queued * 100;
+    return interval;
+}
+
+TEST(AdmissionControllerTest, QueueWaitBucket) {
+    const long long first = AdmissionController::kFirstQueueWaitBucketMicros;
+    ASSERT_EQUALS(0U, AdmissionController::queueWaitBucket(0));
+    ASSERT_EQUALS(0U, AdmissionController::queueWaitBucket(first - 1));
+    ASSERT_EQUALS(1U, AdmissionController::queueWaitBucket(first));
+    ASSERT_EQUALS(2U, AdmissionController::queueWaitBucket(2 * first));
+    ASSERT_EQUALS(AdmissionController::kNumQueueWaitBuckets - 1,
+                  AdmissionController::queueWaitBucket(first << 30));
+}
+
+TEST(AdmissionControllerTest, HighPriorityUsesReservedTickets) {
+    TicketHolder holder(5);
+    AdmissionController controller(&holder);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQUALS(&holder, controller.admit(Priority::kNormal));
+    }
+    ASSERT_EQUALS(0, holder.available());
+
+    // The ticket comes from the reserve, and must be released to it.
+    TicketHolder* reserved = controller.admit(Priority::kHigh);
+    ASSERT_NOT_EQUALS(&holder, reserved);
+    ASSERT_EQUALS(AdmissionController::kReservedTickets, reserved->outof());
+    ASSERT_EQUALS(1, reserved->used());
+
+    holder.release();
+    ASSERT_EQUALS(&holder, controller.admit(Priority::kHigh));
+
+    BSONObjBuilder builder;
+    controller.appendStats(&builder);
+    BSONObj stats = builder.obj();
+    ASSERT_EQUALS(7, stats["admitted"].numberLong());
+    ASSERT_EQUALS(0, stats["queued"].numberLong());
+    ASSERT_EQUALS(1, stats["admittedFromReserve"].numberLong());
+    ASSERT_EQUALS(1, stats["reserved"]["out"].numberInt());
+
+    reserved->release();
+    for (int i = 0; i < 5; i++) {
+        holder.release();
+    }
+}
+
+TEST(AdmissionControllerTest, HighPriorityIsBoundedByReservedTickets) {
+    const int kTickets = 5;
+    const int kThreads = 4 * (kTickets + AdmissionController::kReservedTickets);
+
+    TicketHolder holder(kTickets);
+    AdmissionController controller(&holder);
+
+    AtomicInt32 admitted;
+    AtomicInt32 maxAdmitted;
+    std::vector<stdx::thread> threads;
+    for (int i = 0; i < kThreads; i++) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 50; j++) {
+                TicketHolder* ticket = controller.admit(Priority::kHigh);
+                const int current = admitted.addAndFetch(1);
+                int max = maxAdmitted.load();
+                while (current > max && maxAdmitted.compareAndSwap(max, current) != max) {
+                    max = maxAdmitted.load();
+                }
+                stdx::this_thread::yield();
+                admitted.subtractAndFetch(1);
+                ticket->release();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_LESS_THAN_OR_EQUALS(maxAdmitted.load(),
+                               kTickets + AdmissionController::kReservedTickets);
+    ASSERT_EQUALS(kTickets, holder.available());
+}
+
+TEST(AdmissionControllerTest, NormalPriorityWaitsForTicket) {
+    TicketHolder holder(5);
+    AdmissionController controller(&holder);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQUALS(&holder, controller.admit(Priority::kNormal));
+    }
+
+    stdx::thread waiter([&] { ASSERT_EQUALS(&holder, controller.admit(Priority::kNormal)); });
+    sleepmillis(10);
+    holder.release();
+    waiter.join();
+
+    BSONObjBuilder builder;
+    controller.appendStats(&builder);
+    BSONObj stats = builder.obj();
+    ASSERT_EQUALS(6, stats["admitted"].numberLong());
+    ASSERT_EQUALS(1, stats["queued"].numberLong());
+
+    BSONObj queueWait = stats["queueWaitMicros"].Obj();
+    ASSERT_GREATER_THAN(queueWait["total"].numberLong(), 0);
+    std::vector<BSONElement> histogram = queueWait["histogram"].Array();
+    ASSERT_EQUALS(1U, histogram.size());
+    ASSERT_EQUALS(1, histogram[0]["count"].numberLong());
+
+    for (int i = 0; i < 5; i++) {
+        holder.release();
+    }
+}
+
+TEST(AdmissionControllerTest, KeepsTicketsWithoutQueueing) {
+    TicketHolder holder(64);
+    AdmissionController controller(&holder);
+    ASSERT_EQUALS(64, controller.nextTicketCount(interval(1000, 0), 64, 128));
+}
+
+TEST(AdmissionControllerTest, GrowsWhileThroughputImproves) {
+    TicketHolder holder(64);
+    AdmissionController controller(&holder);
+    ASSERT_EQUALS(72, controller.nextTicketCount(interval(1000, 10), 64, 128));
+    ASSERT_EQUALS(81, controller.nextTicketCount(interval(1100, 10), 72, 128));
+}
+
+TEST(AdmissionControllerTest, ShrinksWhenGrowingDoesNotImproveThroughput) {
+    TicketHolder holder(64);
+    AdmissionController controller(&holder);
+    ASSERT_EQUALS(72, controller.nextTicketCount(interval(1000, 10), 64, 128));
+    ASSERT_EQUALS(63, controller.nextTicketCount(interval(1000, 10), 72, 128));
+
+    // Throughput held up with fewer tickets, so keep them.
+    ASSERT_EQUALS(63, controller.nextTicketCount(interval(1000, 10), 63, 128));
+
+    // Then probe again.
+    ASSERT_EQUALS(70, controller.nextTicketCount(interval(1000, 10), 63, 128));
+}
+
+TEST(AdmissionControllerTest, GrowsBackWhenShrinkingCostsThroughput) {
+    TicketHolder holder(64);
+    AdmissionController controller(&holder);
+    ASSERT_EQUALS(72, controller.nextTicketCount(interval(1000, 10), 64, 128));
+    ASSERT_EQUALS(63, controller.nextTicketCount(interval(1000, 10), 72, 128));
+    ASSERT_EQUALS(70, controller.nextTicketCount(interval(800, 10), 63, 128));
+}
+
+TEST(AdmissionControllerTest, ShrinksUnderCachePressure) {
+    TicketHolder holder(64);
+    AdmissionController controller(&holder);
+    AdmissionController::Interval pressure = interval(1000, 10);
+    pressure.cacheFillRatio = AdmissionController::kCachePressureThreshold;
+    ASSERT_EQUALS(48, controller.nextTicketCount(pressure, 64, 128));
+}
+
+TEST(AdmissionControllerTest, StaysWithinBounds) {
+    TicketHolder holder(64);
+    AdmissionController controller(&holder);
+    ASSERT_EQUALS(64, controller.nextTicketCount(interval(1000, 10), 64, 64));
+    ASSERT_EQUALS(32, controller.nextTicketCount(interval(1000, 0), 64, 32));
+
+    AdmissionController::Interval pressure = interval(1000, 10);
+    pressure.cacheFillRatio = 1;
+    ASSERT_EQUALS(AdmissionController::kMinTickets,
+                  controller.nextTicketCount(pressure, AdmissionController::kMinTickets, 64));
+}
+
+TEST(AdmissionControllerTest, AdjustWithholdsTickets) {
+    TicketHolder holder(10);
+    AdmissionController controller(&holder);
+    controller.adjust(1, 128);
+    ASSERT_EQUALS(10, holder.outof());
+    ASSERT_EQUALS(8, holder.available());
+    ASSERT_EQUALS(2, controller.getWithheldTickets());
+
+    controller.adjust(0, 128);
+    ASSERT_EQUALS(8, holder.available());
+
+    controller.restore();
+    ASSERT_EQUALS(10, holder.available());
+    ASSERT_EQUALS(0, controller.getWithheldTickets());
+}
+
+TEST(AdmissionControllerTest, ShrinkingDoesNotWaitForTicketsInUse) {
+    TicketHolder holder(10);
+    AdmissionController controller(&holder);
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQUALS(&holder, controller.admit(Priority::kNormal));
+    }
+
+    // No ticket is free, so none can be withheld yet.
+    controller.adjust(1, 128);
+    ASSERT_EQUALS(0, controller.getWithheldTickets());
+
+    // Tickets released since are withheld by the next adjustments, until the target is reached.
+    for (int i = 0; i < 10; i++) {
+        holder.release();
+    }
+    controller.adjust(0, 128);
+    ASSERT_EQUALS(2, controller.getWithheldTickets());
+    ASSERT_EQUALS(8, holder.available());
+
+    controller.restore();
+    ASSERT_EQUALS(10, holder.available());
+}
+
+TEST(AdmissionControllerTest, ResizeKeepsWithheldTicketsOutOfCirculation) {
+    TicketHolder holder(10);
+    AdmissionController controller(&holder);
+    controller.adjust(1, 128);
+    ASSERT_EQUALS(8, holder.available());
+
+    // Growing the TicketHolder does not put more tickets into circulation.
+    ASSERT_OK(controller.resize(20));
+    ASSERT_EQUALS(20, holder.outof());
+    ASSERT_EQUALS(8, holder.available());
+    ASSERT_EQUALS(12, controller.getWithheldTickets());
+
+    // Shrinking it below the tickets in circulation does not wait for the withheld tickets.
+    ASSERT_OK(controller.resize(6));
+    ASSERT_EQUALS(6, holder.outof());
+    ASSERT_EQUALS(6, holder.available());
+    ASSERT_EQUALS(0, controller.getWithheldTickets());
+
+    controller.restore();
+    ASSERT_EQUALS(6, holder.available());
+}
+
+TEST(AdmissionControllerTest, ResizeConcurrentlyWithAdjust) {
+    TicketHolder holder(64);
+    AdmissionController controller(&holder);
+
+    stdx::thread adjuster([&] {
+        for (int i = 0; i < 2000; i++) {
+            controller.adjust(i % 2, 128);
+            if (i % 3 == 0) {
+                controller.restore();
+            }
+        }
+    });
+    for (int i = 0; i < 2000; i++) {
+        ASSERT_OK(controller.resize(i % 2 ? 16 : 64));
+    }
+    adjuster.join();
+
+    controller.restore();
+    ASSERT_EQUALS(0, controller.getWithheldTickets());
+    ASSERT_EQUALS(holder.outof(), holder.available());
+}
+
+}  // namespace
+}  // namespace mongo
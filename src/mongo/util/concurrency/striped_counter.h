@@ -0,0 +1,107 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/compiler.h"
+#include "mongo/util/concurrency/threadlocal.h"
+
+namespace mongo {
+
+/**
+ * Returns a small integer identifying the calling thread, for choosing which stripe of a striped
+ * data structure the thread should update. Threads are numbered in the order in which they first
+ * call this function, so that threads running at the same time are spread evenly over the stripes.
+ */
+inline size_t currentThreadStripeIndex() {
+    static MONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL uint32_t index;
+
+    // Zero means that no index has been assigned to this thread yet.
+    if (MONGO_unlikely(index == 0)) {
+        static AtomicUInt32 nextIndex;
+        index = nextIndex.addAndFetch(1);
+    }
+    return index - 1;
+}
+
+/**
+ * A 64-bit counter whose value is spread over several cache lines, so that threads updating it
+ * concurrently rarely write to the same line. Each thread always updates the stripe chosen by
+ * currentThreadStripeIndex(), and reading the counter sums all of the stripes.
+ *
+ * Incrementing costs the same as it does for Counter64, but get() is much more expensive. Use this
+ * for counters that are bumped on hot paths by many threads and only read occasionally, such as
+ * the ones reported by serverStatus. The value returned by get() while other threads are updating
+ * the counter is not a point-in-time snapshot, but it reflects every update that completed before
+ * get() was called.
+ */
+class StripedCounter64 {
+    MONGO_DISALLOW_COPYING(StripedCounter64);
+
+public:
+    static const size_t kNumStripes = 32;
+
+    StripedCounter64() = default;
+
+    void increment(uint64_t n = 1) {
+        _stripes[currentThreadStripeIndex() % kNumStripes].value.fetchAndAdd(n);
+    }
+
+    void decrement(uint64_t n = 1) {
+        _stripes[currentThreadStripeIndex() % kNumStripes].value.fetchAndSubtract(n);
+    }
+
+    /** Returns the sum of all stripes. */
+    long long get() const {
+        long long sum = 0;
+        for (const auto& stripe : _stripes) {
+            sum += stripe.value.loadRelaxed();
+        }
+        return sum;
+    }
+
+    operator long long() const {
+        return get();
+    }
+
+private:
+    // Padded out to a cache line so that neighbouring stripes never share one.
+    struct MONGO_COMPILER_ALIGN_TYPE(64) Stripe {
+        AtomicInt64 value;
+        char padding[64 - sizeof(AtomicInt64)];
+    };
+
+    Stripe _stripes[kNumStripes];
+};
+
+}  // namespace mongo
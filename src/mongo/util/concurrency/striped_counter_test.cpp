@@ -0,0 +1,92 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/striped_counter.h"
+
+#include <set>
+#include <vector>
+
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+TEST(StripedCounter64Test, StartsAtZero) {
+    StripedCounter64 counter;
+    ASSERT_EQUALS(0LL, counter.get());
+}
+
+TEST(StripedCounter64Test, IncrementAndDecrement) {
+    StripedCounter64 counter;
+    counter.increment();
+    counter.increment(10);
+    counter.decrement(4);
+    ASSERT_EQUALS(7LL, counter.get());
+    ASSERT_EQUALS(7LL, static_cast<long long>(counter));
+}
+
+TEST(StripedCounter64Test, SumsIncrementsFromManyThreads) {
+    const int kThreads = 2 * StripedCounter64::kNumStripes + 3;
+    const int kIncrementsPerThread = 10000;
+
+    StripedCounter64 counter;
+    std::vector<stdx::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&counter] {
+            for (int j = 0; j < kIncrementsPerThread; ++j) {
+                counter.increment();
+            }
+            counter.decrement(kIncrementsPerThread / 2);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQUALS(static_cast<long long>(kThreads) * kIncrementsPerThread / 2, counter.get());
+}
+
+TEST(StripedCounter64Test, ThreadsAreGivenDistinctStripeIndexes) {
+    const size_t mainIndex = currentThreadStripeIndex();
+    ASSERT_EQUALS(mainIndex, currentThreadStripeIndex());
+
+    std::vector<size_t> indexes(4);
+    for (auto& index : indexes) {
+        stdx::thread([&index] { index = currentThreadStripeIndex(); }).join();
+    }
+
+    std::set<size_t> distinct(indexes.begin(), indexes.end());
+    distinct.insert(mainIndex);
+    ASSERT_EQUALS(indexes.size() + 1, distinct.size());
+}
+
+}  // namespace
+}  // namespace mongo
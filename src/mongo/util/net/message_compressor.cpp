@@ -0,0 +1,311 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_compressor.h"
+
+#include <algorithm>
+#include <snappy.h>
+#include <zlib.h>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/stringutils.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+namespace {
+
+class SnappyMessageCompressor final : public MessageCompressorBase {
+public:
+    SnappyMessageCompressor() : MessageCompressorBase(MessageCompressorId::kSnappy, "snappy") {}
+
+    std::size_t getMaxCompressedSize(std::size_t inputSize) const final {
+        return snappy::MaxCompressedLength(inputSize);
+    }
+
+private:
+    StatusWith<std::size_t> _compress(ConstDataRange input, DataRange output) final {
+        std::size_t outputSize = 0;
+        snappy::RawCompress(
+            input.data(), input.length(), const_cast<char*>(output.data()), &outputSize);
+        return outputSize;
+    }
+
+    StatusWith<std::size_t> _decompress(ConstDataRange input, DataRange output) final {
+        std::size_t expectedSize = 0;
+        if (!snappy::GetUncompressedLength(input.data(), input.length(), &expectedSize) ||
+            expectedSize != output.length() ||
+            !snappy::RawUncompress(
+                input.data(), input.length(), const_cast<char*>(output.data()))) {
+            return Status(ErrorCodes::BadValue, "Compressed message was invalid or corrupted");
+        }
+        return expectedSize;
+    }
+};
+
+class ZlibMessageCompressor final : public MessageCompressorBase {
+public:
+    ZlibMessageCompressor() : MessageCompressorBase(MessageCompressorId::kZlib, "zlib") {}
+
+    std::size_t getMaxCompressedSize(std::size_t inputSize) const final {
+        // zlib's compressBound(), which the vendored zlib does not build.
+        return inputSize + (inputSize >> 12) + (inputSize >> 14) + (inputSize >> 25) + 13;
+    }
+
+private:
+    StatusWith<std::size_t> _compress(ConstDataRange input, DataRange output) final {
+        z_stream stream;
+        stream.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(input.data()));
+        stream.avail_in = input.length();
+        stream.next_out = reinterpret_cast<unsigned char*>(const_cast<char*>(output.data()));
+        stream.avail_out = output.length();
+        stream.zalloc = nullptr;
+        stream.zfree = nullptr;
+        stream.opaque = nullptr;
+
+        int err = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+        if (err != Z_OK) {
+            return {ErrorCodes::ZLibError, str::stream() << "deflateInit failed with " << err};
+        }
+
+        err = deflate(&stream, Z_FINISH);
+        (void)deflateEnd(&stream);
+        if (err != Z_STREAM_END) {
+            return {ErrorCodes::ZLibError, str::stream() << "deflate failed with " << err};
+        }
+        return static_cast<std::size_t>(stream.total_out);
+    }
+
+    StatusWith<std::size_t> _decompress(ConstDataRange input, DataRange output) final {
+        z_stream stream;
+        stream.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(input.data()));
+        stream.avail_in = input.length();
+        stream.next_out = reinterpret_cast<unsigned char*>(const_cast<char*>(output.data()));
+        stream.avail_out = output.length();
+        stream.zalloc = nullptr;
+        stream.zfree = nullptr;
+        stream.opaque = nullptr;
+
+        int err = inflateInit(&stream);
+        if (err != Z_OK) {
+            return {ErrorCodes::ZLibError, str::stream() << "inflateInit failed with " << err};
+        }
+
+        // Anything but the end of the stream means the data does not fill 'output' exactly.
+        err = inflate(&stream, Z_FINISH);
+        (void)inflateEnd(&stream);
+        if (err != Z_STREAM_END || stream.total_out != output.length()) {
+            return Status(ErrorCodes::BadValue, "Compressed message was invalid or corrupted");
+        }
+        return static_cast<std::size_t>(stream.total_out);
+    }
+};
+
+/**
+ * Parses the comma separated networkMessageCompressors list into the global registry. It can
+ * only be set at startup, since connections keep pointers to the compressors they negotiated.
+ */
+class MessageCompressorsServerParameter : public ServerParameter {
+    MONGO_DISALLOW_COPYING(MessageCompressorsServerParameter);
+
+public:
+    MessageCompressorsServerParameter()
+        : ServerParameter(
+              ServerParameterSet::getGlobal(), "networkMessageCompressors", true, false) {}
+
+    void append(OperationContext* txn, BSONObjBuilder& b, const std::string& name) final {
+        b.append(name, MessageCompressorRegistry::get().getEnabledCompressorNames());
+    }
+
+    Status set(const BSONElement& newValueElement) final {
+        if (newValueElement.type() != String) {
+            return Status(ErrorCodes::BadValue, str::stream() << name() << " has to be a string");
+        }
+        return setFromString(newValueElement.String());
+    }
+
+    Status setFromString(const std::string& str) final {
+        std::vector<std::string> names;
+        splitStringDelim(str, &names, ',');
+
+        // "disabled" is accepted so that the default can be spelled out explicitly.
+        names.erase(std::remove_if(names.begin(),
+                                   names.end(),
+                                   [](const std::string& name) {
+                                       return name.empty() || name == "disabled";
+                                   }),
+                    names.end());
+        return MessageCompressorRegistry::get().setEnabledCompressors(names);
+    }
+} messageCompressorsServerParameter;
+
+}  // namespace
+
+StatusWith<std::size_t> MessageCompressorBase::compressData(ConstDataRange input,
+                                                            DataRange output) {
+    Timer timer;
+    auto result = _compress(input, output);
+    if (result.isOK()) {
+        _compressed.messages.addAndFetch(1);
+        _compressed.bytesIn.addAndFetch(input.length());
+        _compressed.bytesOut.addAndFetch(result.getValue());
+        _compressed.micros.addAndFetch(timer.micros());
+    }
+    return result;
+}
+
+Status MessageCompressorBase::decompressData(ConstDataRange input, DataRange output) {
+    Timer timer;
+    auto result = _decompress(input, output);
+    if (!result.isOK()) {
+        return result.getStatus();
+    }
+    _decompressed.messages.addAndFetch(1);
+    _decompressed.bytesIn.addAndFetch(input.length());
+    _decompressed.bytesOut.addAndFetch(result.getValue());
+    _decompressed.micros.addAndFetch(timer.micros());
+    return Status::OK();
+}
+
+void MessageCompressorBase::Counters::append(BSONObjBuilder* b) const {
+    b->appendNumber("messages", messages.load());
+    b->appendNumber("bytesIn", bytesIn.load());
+    b->appendNumber("bytesOut", bytesOut.load());
+    b->appendNumber("micros", micros.load());
+}
+
+void MessageCompressorBase::appendStats(BSONObjBuilder* b) const {
+    {
+        BSONObjBuilder compressor(b->subobjStart("compressor"));
+        _compressed.append(&compressor);
+    }
+    {
+        BSONObjBuilder decompressor(b->subobjStart("decompressor"));
+        _decompressed.append(&decompressor);
+    }
+}
+
+const char MessageCompressorRegistry::kCompressionField[] = "compression";
+
+MessageCompressorRegistry::MessageCompressorRegistry() {
+    _compressors.push_back(stdx::make_unique<SnappyMessageCompressor>());
+    _compressors.push_back(stdx::make_unique<ZlibMessageCompressor>());
+}
+
+MessageCompressorRegistry::~MessageCompressorRegistry() = default;
+
+MessageCompressorRegistry& MessageCompressorRegistry::get() {
+    // Never destroyed, since connections may outlive static destruction.
+    static MessageCompressorRegistry* registry = new MessageCompressorRegistry();
+    return *registry;
+}
+
+MessageCompressorBase* MessageCompressorRegistry::getCompressor(MessageCompressorId id) const {
+    for (const auto& compressor : _compressors) {
+        if (compressor->getId() == id) {
+            return compressor.get();
+        }
+    }
+    return nullptr;
+}
+
+MessageCompressorBase* MessageCompressorRegistry::getCompressor(StringData name) const {
+    for (const auto& compressor : _compressors) {
+        if (compressor->getName() == name) {
+            return compressor.get();
+        }
+    }
+    return nullptr;
+}
+
+Status MessageCompressorRegistry::setEnabledCompressors(const std::vector<std::string>& names) {
+    std::vector<MessageCompressorBase*> enabled;
+    for (const auto& name : names) {
+        MessageCompressorBase* compressor = getCompressor(name);
+        if (!compressor) {
+            return Status(ErrorCodes::BadValue,
+                          str::stream() << "Unknown network message compressor: " << name);
+        }
+        if (std::find(enabled.begin(), enabled.end(), compressor) == enabled.end()) {
+            enabled.push_back(compressor);
+        }
+    }
+    _enabled = std::move(enabled);
+    return Status::OK();
+}
+
+std::vector<std::string> MessageCompressorRegistry::getEnabledCompressorNames() const {
+    std::vector<std::string> names;
+    for (const auto* compressor : _enabled) {
+        names.push_back(compressor->getName());
+    }
+    return names;
+}
+
+MessageCompressorBase* MessageCompressorRegistry::getEnabledCompressor(
+    MessageCompressorId id) const {
+    for (auto* compressor : _enabled) {
+        if (compressor->getId() == id) {
+            return compressor;
+        }
+    }
+    return nullptr;
+}
+
+void MessageCompressorRegistry::serverNegotiate(const BSONObj& isMasterCommand,
+                                                BSONObjBuilder* isMasterReply) const {
+    BSONElement requested = isMasterCommand[kCompressionField];
+    if (requested.type() != Array) {
+        return;
+    }
+
+    BSONArrayBuilder accepted(isMasterReply->subarrayStart(kCompressionField));
+    for (const auto& name : requested.Obj()) {
+        if (name.type() != String) {
+            continue;
+        }
+        MessageCompressorBase* compressor = getCompressor(name.valueStringData());
+        if (compressor && getEnabledCompressor(compressor->getId())) {
+            accepted.append(compressor->getName());
+        }
+    }
+}
+
+void MessageCompressorRegistry::appendStats(BSONObjBuilder* b) const {
+    for (const auto* compressor : _enabled) {
+        BSONObjBuilder sub(b->subobjStart(compressor->getName()));
+        compressor->appendStats(&sub);
+    }
+}
+
+}  // namespace mongo
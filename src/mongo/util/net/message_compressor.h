@@ -0,0 +1,181 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/data_range.h"
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/base/status_with.h"
+#include "mongo/base/string_data.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+class BSONObj;
+class BSONObjBuilder;
+
+/**
+ * Identifies the algorithm used for an OP_COMPRESSED message. The values are part of the wire
+ * protocol and must never change.
+ */
+enum class MessageCompressorId : uint8_t {
+    kNoop = 0,
+    kSnappy = 1,
+    kZlib = 2,
+};
+
+/**
+ * A compression algorithm usable for network messages. Compression and decompression are
+ * stateless, so one instance is shared by every connection. Each instance counts the bytes it
+ * has processed and the time spent doing so, for serverStatus.
+ */
+class MessageCompressorBase {
+    MONGO_DISALLOW_COPYING(MessageCompressorBase);
+
+public:
+    virtual ~MessageCompressorBase() = default;
+
+    const std::string& getName() const {
+        return _name;
+    }
+
+    MessageCompressorId getId() const {
+        return _id;
+    }
+
+    /**
+     * Returns the largest number of bytes compressing 'inputSize' bytes may produce.
+     */
+    virtual std::size_t getMaxCompressedSize(std::size_t inputSize) const = 0;
+
+    /**
+     * Compresses 'input' into 'output', which must hold at least
+     * getMaxCompressedSize(input.length()) bytes. Returns the number of bytes written.
+     */
+    StatusWith<std::size_t> compressData(ConstDataRange input, DataRange output);
+
+    /**
+     * Decompresses 'input' into 'output'. Fails unless the decompressed data exactly fills
+     * 'output', since the envelope records the uncompressed size up front.
+     */
+    Status decompressData(ConstDataRange input, DataRange output);
+
+    /**
+     * Appends {compressor: {...}, decompressor: {...}} counters for this algorithm.
+     */
+    void appendStats(BSONObjBuilder* b) const;
+
+protected:
+    MessageCompressorBase(MessageCompressorId id, std::string name)
+        : _id(id), _name(std::move(name)) {}
+
+private:
+    virtual StatusWith<std::size_t> _compress(ConstDataRange input, DataRange output) = 0;
+    virtual StatusWith<std::size_t> _decompress(ConstDataRange input, DataRange output) = 0;
+
+    struct Counters {
+        AtomicInt64 messages;
+        AtomicInt64 bytesIn;
+        AtomicInt64 bytesOut;
+        AtomicInt64 micros;
+
+        void append(BSONObjBuilder* b) const;
+    };
+
+    const MessageCompressorId _id;
+    const std::string _name;
+
+    Counters _compressed;
+    Counters _decompressed;
+};
+
+/**
+ * Holds every compressor this process knows about, and which of them it is willing to use.
+ *
+ * The enabled compressors are set at startup through the networkMessageCompressors server
+ * parameter, a comma separated list in order of preference. None are enabled by default, in
+ * which case no connection negotiates compression.
+ */
+class MessageCompressorRegistry {
+    MONGO_DISALLOW_COPYING(MessageCompressorRegistry);
+
+public:
+    // The isMaster field in which compressors are negotiated.
+    static const char kCompressionField[];
+
+    MessageCompressorRegistry();
+    ~MessageCompressorRegistry();
+
+    static MessageCompressorRegistry& get();
+
+    /**
+     * Returns the compressor with the given id or name, or nullptr if there is none.
+     */
+    MessageCompressorBase* getCompressor(MessageCompressorId id) const;
+    MessageCompressorBase* getCompressor(StringData name) const;
+
+    /**
+     * Replaces the enabled compressors with those named in 'names', in order of preference.
+     * Fails without changing anything if a name is unknown.
+     */
+    Status setEnabledCompressors(const std::vector<std::string>& names);
+
+    std::vector<std::string> getEnabledCompressorNames() const;
+
+    /**
+     * Returns the compressor with the given id if it is enabled, or nullptr.
+     */
+    MessageCompressorBase* getEnabledCompressor(MessageCompressorId id) const;
+
+    /**
+     * Server side of the isMaster handshake. Appends to the reply the compressors requested in
+     * 'isMasterCommand' which are also enabled here, keeping the client's order. Nothing is
+     * appended if the client did not ask for compression. Replies need no per-connection state,
+     * since the server only compresses a reply when the request it answers was compressed.
+     */
+    void serverNegotiate(const BSONObj& isMasterCommand, BSONObjBuilder* isMasterReply) const;
+
+    /**
+     * Appends the counters of every compressor which has been enabled, keyed by name.
+     */
+    void appendStats(BSONObjBuilder* b) const;
+
+private:
+    std::vector<std::unique_ptr<MessageCompressorBase>> _compressors;
+
+    // Only written during startup, before any connection exists.
+    std::vector<MessageCompressorBase*> _enabled;
+};
+
+}  // namespace mongo
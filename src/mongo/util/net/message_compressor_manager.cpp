@@ -0,0 +1,260 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_compressor_manager.h"
+
+#include <cstring>
+
+#include "mongo/base/data_view.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/util/allocator.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+namespace {
+
+const std::size_t kHeaderSize = MsgData::MsgDataHeaderSize;
+
+// Offsets of the OP_COMPRESSED fields within the message body.
+const std::size_t kOriginalOpcodeOffset = 0;
+const std::size_t kUncompressedSizeOffset = 4;
+const std::size_t kCompressorIdOffset = 8;
+
+/**
+ * Returns the name of the command 'msg' runs, or an empty StringData if it is not a command.
+ */
+StringData getCommandName(const Message& msg) {
+    MsgData::ConstView view(msg.buf());
+    const char* cursor = view.data();
+    const char* const end = view.view2ptr() + view.getLen();
+
+    auto readCString = [&]() -> StringData {
+        const char* terminator =
+            static_cast<const char*>(memchr(cursor, '\0', std::max<ptrdiff_t>(end - cursor, 0)));
+        if (!terminator) {
+            cursor = end;
+            return StringData();
+        }
+        StringData str(cursor, terminator - cursor);
+        cursor = terminator + 1;
+        return str;
+    };
+
+    switch (view.getNetworkOp()) {
+        case dbCommand:
+            readCString();  // database
+            return readCString();
+        case dbQuery: {
+            cursor += 4;  // flags
+            if (cursor >= end || !str::endsWith(readCString().toString(), ".$cmd")) {
+                return StringData();
+            }
+            cursor += 8;  // nToSkip and nToReturn
+            if (end - cursor < 5) {
+                return StringData();
+            }
+            const int objSize = ConstDataView(cursor).read<LittleEndian<int32_t>>();
+            if (objSize < 5 || objSize > end - cursor) {
+                return StringData();
+            }
+            BSONObj query(cursor);
+            BSONElement first = query.firstElement();
+            if ((first.fieldNameStringData() == "$query" ||
+                 first.fieldNameStringData() == "query") &&
+                first.type() == Object) {
+                first = first.Obj().firstElement();
+            }
+            return first.fieldNameStringData();
+        }
+        default:
+            return StringData();
+    }
+}
+
+/**
+ * Whether 'msg' may be sent compressed. Authentication traffic and the isMaster handshake never
+ * are: their compressed size would tell an observer something about credentials, and the
+ * handshake has to be readable before compression is agreed on.
+ */
+bool isCompressible(const Message& msg) {
+    const StringData command = getCommandName(msg);
+    for (const char* excluded : {"isMaster",
+                                 "ismaster",
+                                 "saslStart",
+                                 "saslContinue",
+                                 "getnonce",
+                                 "authenticate",
+                                 "createUser",
+                                 "updateUser",
+                                 "copydbSaslStart",
+                                 "copydbgetnonce",
+                                 "copydb"}) {
+        if (command == excluded) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+MessageCompressorManager::MessageCompressorManager()
+    : MessageCompressorManager(&MessageCompressorRegistry::get()) {}
+
+MessageCompressorManager::MessageCompressorManager(MessageCompressorRegistry* registry)
+    : _registry(registry) {}
+
+void MessageCompressorManager::clientBegin(BSONObjBuilder* isMasterCommand) {
+    _negotiated = nullptr;
+
+    auto names = _registry->getEnabledCompressorNames();
+    if (names.empty()) {
+        return;
+    }
+    isMasterCommand->append(MessageCompressorRegistry::kCompressionField, names);
+}
+
+void MessageCompressorManager::clientFinish(const BSONObj& isMasterReply) {
+    _negotiated = nullptr;
+
+    BSONElement accepted = isMasterReply[MessageCompressorRegistry::kCompressionField];
+    if (accepted.type() != Array) {
+        return;
+    }
+    for (const auto& name : accepted.Obj()) {
+        if (name.type() != String) {
+            continue;
+        }
+        MessageCompressorBase* compressor = _registry->getCompressor(name.valueStringData());
+        if (compressor && _registry->getEnabledCompressor(compressor->getId())) {
+            _negotiated = compressor;
+            return;
+        }
+    }
+}
+
+MessageCompressorBase* MessageCompressorManager::compressorFor(bool isReply) const {
+    return isReply ? _lastReceived : _negotiated;
+}
+
+StatusWith<Message> MessageCompressorManager::compressMessage(const Message& msg,
+                                                              MessageCompressorBase* compressor) {
+    invariant(compressor);
+
+    // Vectored messages are rare enough that gathering them to compress is not worth it.
+    if (!msg.buf() || !isCompressible(msg)) {
+        return Message();
+    }
+
+    MsgData::ConstView input(msg.buf());
+    const std::size_t inputSize = input.dataLen();
+    const std::size_t outputCapacity = compressor->getMaxCompressedSize(inputSize);
+    const std::size_t bufferSize = kHeaderSize + kCompressionHeaderSize + outputCapacity;
+
+    Message output;
+    output.setData(static_cast<char*>(mongoMalloc(bufferSize)), true);
+    MsgData::View outputView(output.buf());
+    char* body = outputView.data();
+
+    auto compressed =
+        compressor->compressData(ConstDataRange(input.data(), inputSize),
+                                 DataRange(body + kCompressionHeaderSize, outputCapacity));
+    if (!compressed.isOK()) {
+        return compressed.getStatus();
+    }
+
+    DataView(body).write(tagLittleEndian<int32_t>(input.getNetworkOp()), kOriginalOpcodeOffset);
+    DataView(body).write(tagLittleEndian<int32_t>(inputSize), kUncompressedSizeOffset);
+    DataView(body).write(static_cast<uint8_t>(compressor->getId()), kCompressorIdOffset);
+
+    outputView.setLen(kHeaderSize + kCompressionHeaderSize + compressed.getValue());
+    outputView.setId(input.getId());
+    outputView.setResponseTo(input.getResponseTo());
+    outputView.setOperation(dbCompressed);
+    return std::move(output);
+}
+
+StatusWith<Message> MessageCompressorManager::decompressMessage(const Message& msg) {
+    MsgData::ConstView input(msg.singleData());
+    invariant(input.getNetworkOp() == dbCompressed);
+
+    if (input.dataLen() < kCompressionHeaderSize) {
+        return Status(ErrorCodes::BadValue, "Compressed message is too short");
+    }
+
+    const char* body = input.data();
+    const int32_t originalOpcode =
+        ConstDataView(body).read<LittleEndian<int32_t>>(kOriginalOpcodeOffset);
+    const int32_t uncompressedSize =
+        ConstDataView(body).read<LittleEndian<int32_t>>(kUncompressedSizeOffset);
+    const auto compressorId =
+        static_cast<MessageCompressorId>(ConstDataView(body).read<uint8_t>(kCompressorIdOffset));
+
+    if (originalOpcode == dbCompressed) {
+        return Status(ErrorCodes::BadValue, "Compressed messages cannot be nested");
+    }
+
+    if (uncompressedSize < 0 ||
+        static_cast<std::size_t>(uncompressedSize) > MaxMessageSizeBytes - kHeaderSize) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "Compressed message claims an invalid size of "
+                                    << uncompressedSize << " bytes");
+    }
+
+    MessageCompressorBase* compressor = _registry->getEnabledCompressor(compressorId);
+    if (!compressor) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "Received a message compressed with compressor id "
+                                    << static_cast<int>(compressorId)
+                                    << ", which is not enabled");
+    }
+
+    Message output;
+    output.setData(static_cast<char*>(mongoMalloc(kHeaderSize + uncompressedSize)), true);
+    MsgData::View outputView(output.buf());
+
+    Status status = compressor->decompressData(
+        ConstDataRange(body + kCompressionHeaderSize, input.dataLen() - kCompressionHeaderSize),
+        DataRange(outputView.data(), uncompressedSize));
+    if (!status.isOK()) {
+        return status;
+    }
+
+    outputView.setLen(kHeaderSize + uncompressedSize);
+    outputView.setId(input.getId());
+    outputView.setResponseTo(input.getResponseTo());
+    outputView.setOperation(originalOpcode);
+
+    _lastReceived = compressor;
+    return std::move(output);
+}
+
+}  // namespace mongo
@@ -0,0 +1,121 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status_with.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compressor.h"
+
+namespace mongo {
+
+class BSONObj;
+class BSONObjBuilder;
+
+/**
+ * Per-connection state of network message compression.
+ *
+ * Compression is negotiated by the isMaster that opens every connection: the client lists the
+ * compressors it has enabled under "compression", and the server answers with those of them it
+ * has enabled too (see MessageCompressorRegistry::serverNegotiate()). From then on the client
+ * sends requests wrapped in OP_COMPRESSED envelopes using the first compressor the server
+ * accepted. The server compresses a reply only when the request it answers was compressed, and
+ * then with the same compressor, so peers which never asked for compression are unaffected.
+ *
+ * An OP_COMPRESSED message is a standard header followed by
+ *     int32 originalOpcode
+ *     int32 uncompressedSize  (excluding the header)
+ *     uint8 compressorId
+ *     the compressed message body
+ *
+ * Messages which carry credentials are never compressed, since the size of a compressed
+ * message leaks information about its content.
+ */
+class MessageCompressorManager {
+    MONGO_DISALLOW_COPYING(MessageCompressorManager);
+
+public:
+    // Size of the OP_COMPRESSED fields which follow the standard header.
+    static const int kCompressionHeaderSize = 9;
+
+    MessageCompressorManager();
+    explicit MessageCompressorManager(MessageCompressorRegistry* registry);
+
+    /**
+     * Client side. Appends the compressors this process is willing to use to an outgoing isMaster.
+     */
+    void clientBegin(BSONObjBuilder* isMasterCommand);
+
+    /**
+     * Client side. Reads the server's choice from an isMaster reply and uses it for every
+     * subsequent request on this connection.
+     */
+    void clientFinish(const BSONObj& isMasterReply);
+
+    /**
+     * Returns the compressor to use for an outgoing message: the negotiated one for requests, and
+     * for replies the one the request being answered was compressed with. Returns nullptr if the
+     * message should be sent uncompressed.
+     */
+    MessageCompressorBase* compressorFor(bool isReply) const;
+
+    /**
+     * Wraps 'msg' into an OP_COMPRESSED envelope using 'compressor', keeping its id and
+     * responseTo. Returns an empty Message if 'msg' should not be compressed, either because it
+     * carries credentials or because it is split over several buffers.
+     */
+    StatusWith<Message> compressMessage(const Message& msg, MessageCompressorBase* compressor);
+
+    /**
+     * Unwraps an OP_COMPRESSED message and remembers its compressor for compressorFor().
+     */
+    StatusWith<Message> decompressMessage(const Message& msg);
+
+    /**
+     * Notes that an uncompressed message was received, so that its reply goes out uncompressed.
+     */
+    void receivedUncompressed() {
+        _lastReceived = nullptr;
+    }
+
+    MessageCompressorBase* getNegotiatedCompressor() const {
+        return _negotiated;
+    }
+
+private:
+    MessageCompressorRegistry* const _registry;
+
+    // Client side: the compressor agreed on in the isMaster handshake.
+    MessageCompressorBase* _negotiated = nullptr;
+
+    // Server side: the compressor of the most recently received request.
+    MessageCompressorBase* _lastReceived = nullptr;
+};
+
+}  // namespace mongo
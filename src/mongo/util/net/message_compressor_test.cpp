@@ -0,0 +1,251 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/base/data_view.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/net/message_compressor.h"
+#include "mongo/util/net/message_compressor_manager.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * Builds an OP_QUERY message against 'ns' whose query is 'query'.
+ */
+void buildQuery(StringData ns, const BSONObj& query, Message* msg) {
+    BufBuilder b;
+    b.appendNum(0);  // flags
+    b.appendStr(ns);
+    b.appendNum(0);  // nToSkip
+    b.appendNum(1);  // nToReturn
+    query.appendSelfToBufBuilder(b);
+    msg->setData(dbQuery, b.buf(), b.len());
+    msg->header().setId(1234);
+    msg->header().setResponseTo(5678);
+}
+
+BSONObj makeCompressibleDocument() {
+    BSONObjBuilder bob;
+    for (int i = 0; i < 100; ++i) {
+        bob.append(BSONObjBuilder::numStr(i), "the same string over and over again");
+    }
+    return bob.obj();
+}
+
+void assertSameMessage(const Message& expected, const Message& actual) {
+    ASSERT_EQUALS(expected.size(), actual.size());
+    ASSERT_EQUALS(expected.operation(), actual.operation());
+    ASSERT_EQUALS(0, memcmp(expected.singleData().view2ptr(),
+                            actual.singleData().view2ptr(),
+                            expected.size()));
+}
+
+void checkRoundTrip(StringData compressorName) {
+    MessageCompressorRegistry registry;
+    ASSERT_OK(registry.setEnabledCompressors({compressorName.toString()}));
+    MessageCompressorBase* compressor = registry.getCompressor(compressorName);
+    ASSERT(compressor);
+
+    MessageCompressorManager manager(&registry);
+    Message original;
+    buildQuery("test.coll", makeCompressibleDocument(), &original);
+
+    auto compressed = manager.compressMessage(original, compressor);
+    ASSERT_OK(compressed.getStatus());
+    const Message& envelope = compressed.getValue();
+    ASSERT_EQUALS(dbCompressed, envelope.operation());
+    ASSERT_EQUALS(1234U, envelope.header().getId());
+    ASSERT_EQUALS(5678U, envelope.header().getResponseTo());
+    ASSERT_LESS_THAN(envelope.size(), original.size());
+
+    auto decompressed = manager.decompressMessage(envelope);
+    ASSERT_OK(decompressed.getStatus());
+    assertSameMessage(original, decompressed.getValue());
+
+    // The reply to a compressed request goes out with the same compressor.
+    ASSERT_EQUALS(compressor, manager.compressorFor(true));
+    manager.receivedUncompressed();
+    ASSERT(!manager.compressorFor(true));
+
+    BSONObjBuilder stats;
+    registry.appendStats(&stats);
+    BSONObj obj = stats.obj();
+    ASSERT_EQUALS(1, obj[compressorName]["compressor"]["messages"].numberLong());
+    ASSERT_EQUALS(original.dataSize(), obj[compressorName]["compressor"]["bytesIn"].numberLong());
+    ASSERT_EQUALS(1, obj[compressorName]["decompressor"]["messages"].numberLong());
+    ASSERT_EQUALS(original.dataSize(),
+                  obj[compressorName]["decompressor"]["bytesOut"].numberLong());
+}
+
+TEST(MessageCompressorTest, SnappyRoundTrip) {
+    checkRoundTrip("snappy");
+}
+
+TEST(MessageCompressorTest, ZlibRoundTrip) {
+    checkRoundTrip("zlib");
+}
+
+TEST(MessageCompressorTest, UnknownCompressorIsRejected) {
+    MessageCompressorRegistry registry;
+    ASSERT_OK(registry.setEnabledCompressors({"zlib"}));
+    ASSERT_NOT_OK(registry.setEnabledCompressors({"snappy", "lz4"}));
+    ASSERT(std::vector<std::string>{"zlib"} == registry.getEnabledCompressorNames());
+}
+
+TEST(MessageCompressorTest, NegotiationPicksFirstAcceptedCompressor) {
+    MessageCompressorRegistry clientRegistry;
+    ASSERT_OK(clientRegistry.setEnabledCompressors({"zlib", "snappy"}));
+    MessageCompressorRegistry serverRegistry;
+    ASSERT_OK(serverRegistry.setEnabledCompressors({"snappy"}));
+
+    MessageCompressorManager client(&clientRegistry);
+    BSONObjBuilder isMaster;
+    isMaster.append("isMaster", 1);
+    client.clientBegin(&isMaster);
+    BSONObj isMasterCommand = isMaster.obj();
+    ASSERT_EQUALS(BSON("isMaster" << 1 << "compression" << BSON_ARRAY("zlib"
+                                                                      << "snappy")),
+                  isMasterCommand);
+
+    BSONObjBuilder reply;
+    serverRegistry.serverNegotiate(isMasterCommand, &reply);
+    BSONObj isMasterReply = reply.obj();
+    ASSERT_EQUALS(BSON("compression" << BSON_ARRAY("snappy")), isMasterReply);
+
+    client.clientFinish(isMasterReply);
+    ASSERT_EQUALS(clientRegistry.getCompressor("snappy"), client.getNegotiatedCompressor());
+    ASSERT_EQUALS(client.getNegotiatedCompressor(), client.compressorFor(false));
+}
+
+TEST(MessageCompressorTest, NoCompressionWithoutNegotiation) {
+    MessageCompressorRegistry registry;
+
+    MessageCompressorManager client(&registry);
+    BSONObjBuilder isMaster;
+    client.clientBegin(&isMaster);
+    ASSERT_EQUALS(BSONObj(), isMaster.obj());
+
+    BSONObjBuilder reply;
+    registry.serverNegotiate(BSON("isMaster" << 1), &reply);
+    ASSERT_EQUALS(BSONObj(), reply.obj());
+
+    ASSERT_OK(registry.setEnabledCompressors({"snappy"}));
+    client.clientFinish(BSON("ismaster" << true));
+    ASSERT(!client.getNegotiatedCompressor());
+    ASSERT(!client.compressorFor(false));
+}
+
+TEST(MessageCompressorTest, CredentialsAreNotCompressed) {
+    MessageCompressorRegistry registry;
+    ASSERT_OK(registry.setEnabledCompressors({"snappy"}));
+    MessageCompressorManager manager(&registry);
+    MessageCompressorBase* compressor = registry.getCompressor("snappy");
+
+    for (auto&& command : {BSON("saslStart" << 1), BSON("isMaster" << 1),
+                           BSON("$query" << BSON("authenticate" << 1))}) {
+        Message msg;
+        buildQuery("admin.$cmd", command, &msg);
+        auto compressed = manager.compressMessage(msg, compressor);
+        ASSERT_OK(compressed.getStatus());
+        ASSERT(compressed.getValue().empty());
+    }
+
+    Message msg;
+    buildQuery("admin.$cmd", BSON("find" << "coll"), &msg);
+    auto compressed = manager.compressMessage(msg, compressor);
+    ASSERT_OK(compressed.getStatus());
+    ASSERT_EQUALS(dbCompressed, compressed.getValue().operation());
+}
+
+TEST(MessageCompressorTest, InvalidEnvelopesAreRejected) {
+    MessageCompressorRegistry registry;
+    ASSERT_OK(registry.setEnabledCompressors({"snappy", "zlib"}));
+    MessageCompressorManager manager(&registry);
+
+    Message original;
+    buildQuery("test.coll", makeCompressibleDocument(), &original);
+    auto compressed = manager.compressMessage(original, registry.getCompressor("zlib"));
+    ASSERT_OK(compressed.getStatus());
+    const Message& envelope = compressed.getValue();
+
+    auto copyEnvelope = [&](Message* copy) {
+        char* buf = static_cast<char*>(malloc(envelope.size()));
+        memcpy(buf, envelope.singleData().view2ptr(), envelope.size());
+        copy->setData(buf, true);
+    };
+
+    // Claimed to be compressed with snappy.
+    {
+        Message copy;
+        copyEnvelope(&copy);
+        const uint8_t snappyId = static_cast<uint8_t>(MessageCompressorId::kSnappy);
+        DataView(copy.singleData().data()).write(snappyId, 8);
+        ASSERT_NOT_OK(manager.decompressMessage(copy).getStatus());
+    }
+
+    // Claims a larger uncompressed size than the data holds.
+    {
+        Message copy;
+        copyEnvelope(&copy);
+        DataView(copy.singleData().data())
+            .write(tagLittleEndian<int32_t>(original.dataSize() + 1), 4);
+        ASSERT_NOT_OK(manager.decompressMessage(copy).getStatus());
+    }
+
+    // Claims an unreasonable uncompressed size.
+    {
+        Message copy;
+        copyEnvelope(&copy);
+        DataView(copy.singleData().data()).write(tagLittleEndian<int32_t>(-1), 4);
+        ASSERT_NOT_OK(manager.decompressMessage(copy).getStatus());
+    }
+
+    // Compressor that was not enabled by the receiver.
+    {
+        MessageCompressorRegistry snappyOnly;
+        ASSERT_OK(snappyOnly.setEnabledCompressors({"snappy"}));
+        MessageCompressorManager receiver(&snappyOnly);
+        ASSERT_NOT_OK(receiver.decompressMessage(envelope).getStatus());
+    }
+
+    // Truncated.
+    {
+        Message copy;
+        copyEnvelope(&copy);
+        copy.header().setLen(MsgData::MsgDataHeaderSize +
+                             MessageCompressorManager::kCompressionHeaderSize + 4);
+        ASSERT_NOT_OK(manager.decompressMessage(copy).getStatus());
+    }
+}
+
+}  // namespace
+}  // namespace mongo
@@ -199,7 +199,7 @@ bool MessagingPort::recv(Message& m) {
 
         guard.Dismiss();
         m.setData(md.view2ptr(), true);
-        return true;
+        return decompressReceived(m);
 
     } catch (const SocketException& e) {
         logger::LogSeverity severity = psock->getLogLevel();
@@ -211,12 +211,29 @@ bool MessagingPort::recv(Message& m) {
     }
 }
 
+bool MessagingPort::decompressReceived(Message& m) {
+    if (m.operation() != dbCompressed) {
+        _compressorManager.receivedUncompressed();
+        return true;
+    }
+
+    auto decompressed = _compressorManager.decompressMessage(m);
+    if (!decompressed.isOK()) {
+        LOG(0) << "recv(): failed to decompress message from " << remote() << ": "
+               << decompressed.getStatus();
+        m.reset();
+        return false;
+    }
+    m = std::move(decompressed.getValue());
+    return true;
+}
+
 void MessagingPort::reply(Message& received, Message& response) {
-    say(/*received.from, */ response, received.header().getId());
+    _say(/*received.from, */ response, received.header().getId(), true);
 }
 
 void MessagingPort::reply(Message& received, Message& response, MSGID responseTo) {
-    say(/*received.from, */ response, responseTo);
+    _say(/*received.from, */ response, responseTo, true);
 }
 
 bool MessagingPort::call(Message& toSend, Message& response) {
@@ -248,10 +265,23 @@ bool MessagingPort::recv(const Message& toSend, Message& response) {
 }
 
 void MessagingPort::say(Message& toSend, int responseTo) {
+    _say(toSend, responseTo, false);
+}
+
+void MessagingPort::_say(Message& toSend, int responseTo, bool isReply) {
     verify(!toSend.empty());
     mmm(log() << "*  say()  thr:" << GetCurrentThreadId() << endl;)
         toSend.header().setId(nextMessageId());
     toSend.header().setResponseTo(responseTo);
+
+    if (MessageCompressorBase* compressor = _compressorManager.compressorFor(isReply)) {
+        auto compressed = _compressorManager.compressMessage(toSend, compressor);
+        uassertStatusOK(compressed.getStatus());
+        if (!compressed.getValue().empty()) {
+            compressed.getValue().send(*this, "say");
+            return;
+        }
+    }
     toSend.send(*this, "say");
 }
 
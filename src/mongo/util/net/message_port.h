@@ -34,6 +34,7 @@
 #include "mongo/config.h"
 #include "mongo/util/net/abstract_message_port.h"
 #include "mongo/util/net/message.h"
+#include "mongo/util/net/message_compressor_manager.h"
 #include "mongo/util/net/sock.h"
 
 namespace mongo {
@@ -78,6 +79,17 @@ public:
      */
     bool recv(const Message& sent, Message& response);
 
+    /**
+     * Unwraps 'm' in place if it arrived as an OP_COMPRESSED message. Returns false, after
+     * logging why, if it could not be decompressed. recv() already does this; it is only needed
+     * by servers which read messages off the socket themselves.
+     */
+    bool decompressReceived(Message& m);
+
+    MessageCompressorManager& compressorManager() {
+        return _compressorManager;
+    }
+
     unsigned remotePort() const {
         return psock->remotePort();
     }
@@ -118,6 +130,10 @@ public:
     }
 
 private:
+    void _say(Message& toSend, int responseTo, bool isReply);
+
+    MessageCompressorManager _compressorManager;
+
     // this is the parsed version of remote
     HostAndPort _remoteParsed;
 
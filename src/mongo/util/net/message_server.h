@@ -36,10 +36,20 @@
 
 #include "mongo/platform/basic.h"
 
+#include <memory>
+
 namespace mongo {
 
 class MessageHandler {
 public:
+    /**
+     * Per-connection state that connected() binds to the calling thread, detached from it.
+     */
+    class ConnectionState {
+    public:
+        virtual ~ConnectionState() {}
+    };
+
     virtual ~MessageHandler() {}
 
     /**
@@ -58,6 +68,29 @@ public:
      * connected() method) is no longer valid.
      */
     virtual void close() = 0;
+
+    /**
+     * Returns true if this handler implements detachConnection() and attachConnection(), so that
+     * consecutive calls for one connection may be made from different threads. Servers that
+     * multiplex many connections over a pool of worker threads require this.
+     */
+    virtual bool supportsDetachedConnections() const {
+        return false;
+    }
+
+    /**
+     * Detaches the state of the connection being served from the calling thread, once connected()
+     * or process() has returned.
+     */
+    virtual std::unique_ptr<ConnectionState> detachConnection() {
+        return nullptr;
+    }
+
+    /**
+     * Binds state returned by detachConnection() to the calling thread, before process() or
+     * close() is called for that connection.
+     */
+    virtual void attachConnection(std::unique_ptr<ConnectionState> state) {}
 };
 
 class MessageServer {
@@ -66,7 +99,11 @@ public:
         int port;            // port to bind to
         std::string ipList;  // addresses to bind to
 
-        Options() : port(0), ipList("") {}
+        // If greater than 0, serve all connections from an event-driven reactor and this many
+        // worker threads, more while they are all busy, instead of one thread per connection.
+        int ingressWorkerThreads;
+
+        Options() : port(0), ipList(""), ingressWorkerThreads(0) {}
     };
 
     virtual ~MessageServer() {}
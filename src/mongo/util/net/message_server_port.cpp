@@ -52,6 +52,7 @@
 #include "mongo/util/net/message.h"
 #include "mongo/util/net/message_port.h"
 #include "mongo/util/net/message_server.h"
+#include "mongo/util/net/message_server_reactor.h"
 #include "mongo/util/net/ssl_manager.h"
 #include "mongo/util/scopeguard.h"
 
@@ -262,6 +263,11 @@ private:
 
 
 MessageServer* createServer(const MessageServer::Options& opts, MessageHandler* handler) {
+    if (opts.ingressWorkerThreads > 0) {
+        if (MessageServer* server = createReactorMessageServer(opts, handler)) {
+            return server;
+        }
+    }
     return new PortMessageServer(opts, handler);
 }
 
@@ -0,0 +1,488 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kNetwork
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_server_reactor.h"
+
+#include "mongo/config.h"
+#include "mongo/util/log.h"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/server_options.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/util/allocator.h"
+#include "mongo/util/concurrency/synchronization.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/concurrency/threadlocal.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/ssl_manager.h"
+#include "mongo/util/net/ssl_options.h"
+
+#endif  // __linux__
+
+namespace mongo {
+
+#ifdef __linux__
+
+namespace {
+
+const int kMaxEventsPerWait = 256;
+const int kEpollWaitTimeoutMillis = 100;
+
+/**
+ * A connection owned by the reactor. Between events a connection is in exactly one place: armed
+ * in the epoll set, being read by the reactor thread, or queued on / running in the worker pool.
+ * EPOLLONESHOT guarantees that no two threads touch the same connection at once.
+ */
+class ReactorConnection {
+    MONGO_DISALLOW_COPYING(ReactorConnection);
+
+public:
+    enum class ReadResult { kComplete, kIncomplete, kClosed };
+
+    ReactorConnection(const std::shared_ptr<Socket>& socket, long long connectionId)
+        : port(socket) {
+        port.setConnectionId(connectionId);
+    }
+
+    ~ReactorConnection() {
+        free(_buffer);
+    }
+
+    /**
+     * Reads as much of the next message as the socket has available without blocking. On
+     * kComplete the message is moved into 'message'; kClosed means the connection must be closed,
+     * either because the peer went away or because it sent something that is not a valid message.
+     *
+     * Validates the header the same way MessagingPort::recv() does.
+     */
+    ReadResult readSome(Message* message) {
+        const int fd = port.psock->rawFD();
+        while (true) {
+            char* target;
+            size_t wanted;
+            if (!_buffer) {
+                target = reinterpret_cast<char*>(&_header) + _bytesRead;
+                wanted = sizeof(_header) - _bytesRead;
+            } else {
+                target = _buffer + _bytesRead;
+                wanted = _messageLength - _bytesRead;
+            }
+
+            const ssize_t got = ::recv(fd, target, wanted, MSG_DONTWAIT);
+            if (got == 0) {
+                return ReadResult::kClosed;
+            }
+            if (got < 0) {
+                const int err = errno;
+                if (err == EINTR) {
+                    continue;
+                }
+                if (err == EAGAIN || err == EWOULDBLOCK) {
+                    return ReadResult::kIncomplete;
+                }
+                LOG(1) << "recv() error on " << port.psock->remoteString() << ": "
+                       << errnoWithDescription(err);
+                return ReadResult::kClosed;
+            }
+
+            _bytesRead += got;
+            bytesIn += got;
+
+            if (!_buffer && _bytesRead == sizeof(_header)) {
+                if (!_startMessage()) {
+                    return ReadResult::kClosed;
+                }
+            }
+
+            if (_buffer && _bytesRead == _messageLength) {
+                message->setData(_buffer, true);
+                _buffer = nullptr;
+                _bytesRead = 0;
+                _messageLength = 0;
+                return ReadResult::kComplete;
+            }
+        }
+    }
+
+    MessagingPort port;
+
+    // Handler state for this connection while no worker thread is serving it.
+    std::unique_ptr<MessageHandler::ConnectionState> state;
+
+    // The most recently completed message, waiting for a worker.
+    Message pending;
+
+    // Bytes received since the last completed request, reported to networkCounter.
+    long long bytesIn = 0;
+
+    // Whether the socket has been added to the epoll set.
+    bool registered = false;
+
+private:
+    /**
+     * Called once the header of a new message has been read. Allocates the buffer for the whole
+     * message, or returns false if the connection should be closed.
+     */
+    bool _startMessage() {
+        const int len = _header.constView().getMessageLength();
+
+        if (len == 542393671) {
+            // an http GET
+            std::string msg =
+                "It looks like you are trying to access MongoDB over HTTP on the native driver "
+                "port.\n";
+            LOG(port.psock->getLogLevel()) << msg;
+            std::stringstream ss;
+            ss << "HTTP/1.0 200 OK\r\nConnection: close\r\nContent-Type: "
+                  "text/plain\r\nContent-Length: " << msg.size() << "\r\n\r\n" << msg;
+            std::string s = ss.str();
+            try {
+                port.send(s.c_str(), s.size(), "http");
+            } catch (const SocketException&) {
+            }
+            return false;
+        }
+
+        if (port.psock->isAwaitingHandshake()) {
+            // The reactor is only used with SSL disabled, so any handshake is refused.
+            if (_header.constView().getResponseTo() != 0 &&
+                _header.constView().getResponseTo() != -1) {
+                log() << "SSL handshake received but server is started without SSL support, "
+                      << "closing connection " << port.psock->remoteString();
+                return false;
+            }
+            port.psock->setHandshakeReceived();
+        }
+
+        if (static_cast<size_t>(len) < sizeof(MSGHEADER::Value) ||
+            static_cast<size_t>(len) > MaxMessageSizeBytes) {
+            LOG(0) << "recv(): message len " << len << " is invalid. "
+                   << "Min " << sizeof(MSGHEADER::Value) << " Max: " << MaxMessageSizeBytes;
+            return false;
+        }
+
+        const size_t allocated = (len + 1023) & 0xfffffc00;
+        _buffer = static_cast<char*>(mongoMalloc(allocated));
+        memcpy(_buffer, &_header, sizeof(_header));
+        _messageLength = len;
+        return true;
+    }
+
+    MSGHEADER::Value _header;
+    char* _buffer = nullptr;
+    size_t _bytesRead = 0;
+    size_t _messageLength = 0;
+};
+
+class ReactorMessageServer : public MessageServer, public Listener {
+public:
+    ReactorMessageServer(const MessageServer::Options& opts, MessageHandler* handler)
+        : Listener("", opts.ipList, opts.port),
+          _handler(handler),
+          _numWorkers(opts.ingressWorkerThreads) {}
+
+    virtual void accepted(std::shared_ptr<Socket> psocket, long long connectionId) {
+        if (!Listener::globalTicketHolder.tryAcquire()) {
+            log() << "connection refused because too many open connections: "
+                  << Listener::globalTicketHolder.used();
+            sleepmillis(2);
+            return;
+        }
+
+        ReactorConnection* conn = new ReactorConnection(psocket, connectionId);
+        conn->port.psock->setLogLevel(logger::LogSeverity::Debug(1));
+        if (!_workers->schedule([this, conn] { _connect(conn); }).isOK()) {
+            delete conn;
+            Listener::globalTicketHolder.release();
+        }
+    }
+
+    virtual void setAsTimeTracker() {
+        Listener::setAsTimeTracker();
+    }
+
+    virtual bool setupSockets() {
+        return Listener::setupSockets();
+    }
+
+    void run() {
+        _epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (_epollFd < 0) {
+            severe() << "epoll_create1 failed: " << errnoWithDescription();
+            fassertFailed(34363);
+        }
+
+        // Created here rather than in the constructor because setupSockets() sets the
+        // connection limit, which bounds the size of the pool.
+        _workers = stdx::make_unique<ThreadPool>(_makePoolOptions(_numWorkers));
+        _workers->startup();
+        stdx::thread reactor([this] { _runReactor(); });
+        reactor.detach();
+
+        initAndListen();
+    }
+
+    virtual bool useUnixSockets() const {
+        return true;
+    }
+
+private:
+    /**
+     * The pool keeps 'numWorkers' threads, but starts more whenever a request is queued while
+     * all of them are busy. Requests can block for a long time (awaitData getMores, fsyncLock,
+     * slow clients), and one of them may be waiting for another request that sits behind it in
+     * the queue. A connection has at most one request in flight, so allowing one thread per
+     * connection is enough to always make progress. Extra threads exit once they have been idle
+     * for a while.
+     */
+    static ThreadPool::Options _makePoolOptions(int numWorkers) {
+        ThreadPool::Options options;
+        options.poolName = "ingress";
+        options.threadNamePrefix = "conn-worker";
+        options.minThreads = numWorkers;
+        options.maxThreads = std::max(numWorkers, Listener::globalTicketHolder.outof());
+        return options;
+    }
+
+    /**
+     * Waits for readable connections and reads whatever they have available. Requests which are
+     * complete are handed to the worker pool; the reactor itself never runs a request.
+     */
+    void _runReactor() {
+        setThreadName("reactor");
+
+        epoll_event events[kMaxEventsPerWait];
+        while (!inShutdown()) {
+            const int ready =
+                epoll_wait(_epollFd, events, kMaxEventsPerWait, kEpollWaitTimeoutMillis);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                severe() << "epoll_wait failed: " << errnoWithDescription();
+                fassertFailed(34364);
+            }
+
+            for (int i = 0; i < ready; ++i) {
+                ReactorConnection* conn = static_cast<ReactorConnection*>(events[i].data.ptr);
+                switch (conn->readSome(&conn->pending)) {
+                    case ReactorConnection::ReadResult::kIncomplete:
+                        _arm(conn);
+                        break;
+                    case ReactorConnection::ReadResult::kComplete:
+                        _dispatch(conn, [this, conn] { _process(conn); });
+                        break;
+                    case ReactorConnection::ReadResult::kClosed:
+                        _dispatch(conn, [this, conn] { _close(conn); });
+                        break;
+                }
+            }
+        }
+    }
+
+    void _dispatch(ReactorConnection* conn, ThreadPool::Task task) {
+        if (!_workers->schedule(std::move(task)).isOK()) {
+            // The pool only refuses work once it is shutting down, along with the server.
+            LOG(1) << "dropping connection " << conn->port.psock->remoteString()
+                   << " because the worker pool is shut down";
+        }
+    }
+
+    /**
+     * (Re)registers interest in the next readable event for 'conn'.
+     */
+    void _arm(ReactorConnection* conn) {
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.ptr = conn;
+        const int op = conn->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (epoll_ctl(_epollFd, op, conn->port.psock->rawFD(), &event) != 0) {
+            log() << "epoll_ctl failed for " << conn->port.psock->remoteString() << ": "
+                  << errnoWithDescription() << ", closing connection";
+            _close(conn);
+            return;
+        }
+        conn->registered = true;
+    }
+
+    void _connect(ReactorConnection* conn) {
+        try {
+            _handler->connected(&conn->port);
+        } catch (const DBException& e) {
+            log() << "DBException accepting connection, closing client connection: " << e;
+            _release(conn);
+            return;
+        }
+        conn->state = _handler->detachConnection();
+        _arm(conn);
+    }
+
+    void _process(ReactorConnection* conn) {
+        static MONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL int64_t counter = 0;
+
+        if (inShutdown()) {
+            return;
+        }
+
+        _handler->attachConnection(std::move(conn->state));
+        if (!conn->port.decompressReceived(conn->pending)) {
+            _closeAttached(conn);
+            return;
+        }
+        try {
+            conn->port.psock->clearCounters();
+            _handler->process(conn->pending, &conn->port);
+            networkCounter.hit(conn->bytesIn, conn->port.psock->getBytesOut());
+        } catch (AssertionException& e) {
+            log() << "AssertionException handling request, closing client connection: " << e;
+            _closeAttached(conn);
+            return;
+        } catch (SocketException& e) {
+            log() << "SocketException handling request, closing client connection: " << e;
+            _closeAttached(conn);
+            return;
+        } catch (const DBException& e) {
+            // must be right above std::exception to avoid catching subclasses
+            log() << "DBException handling request, closing client connection: " << e;
+            _closeAttached(conn);
+            return;
+        } catch (std::exception& e) {
+            error() << "Uncaught std::exception: " << e.what() << ", terminating";
+            dbexit(EXIT_UNCAUGHT);
+        }
+        conn->pending.reset();
+        conn->bytesIn = 0;
+        conn->state = _handler->detachConnection();
+
+        // Occasionally we want to see if we're using too much memory.
+        if ((counter++ & 0xf) == 0) {
+            markThreadIdle();
+        }
+
+        _arm(conn);
+    }
+
+    void _close(ReactorConnection* conn) {
+        _handler->attachConnection(std::move(conn->state));
+        _closeAttached(conn);
+    }
+
+    /**
+     * Closes a connection whose handler state is bound to the calling thread, and releases
+     * everything the reactor holds for it.
+     */
+    void _closeAttached(ReactorConnection* conn) {
+        if (!serverGlobalParams.quiet) {
+            int conns = Listener::globalTicketHolder.used() - 1;
+            const char* word = (conns == 1 ? " connection" : " connections");
+            log() << "end connection " << conn->port.psock->remoteString() << " (" << conns << word
+                  << " now open)";
+        }
+
+        _handler->close();
+        _release(conn);
+    }
+
+    /**
+     * Unregisters and destroys 'conn', and gives back its connection ticket.
+     */
+    void _release(ReactorConnection* conn) {
+        if (conn->registered) {
+            epoll_ctl(_epollFd, EPOLL_CTL_DEL, conn->port.psock->rawFD(), nullptr);
+        }
+        conn->port.shutdown();
+        delete conn;
+        Listener::globalTicketHolder.release();
+
+#ifdef MONGO_CONFIG_SSL
+        SSLManagerInterface* manager = getSSLManager();
+        if (manager)
+            manager->cleanupThreadLocals();
+#endif
+    }
+
+    // Not owned.
+    MessageHandler* const _handler;
+
+    const int _numWorkers;
+    std::unique_ptr<ThreadPool> _workers;
+    int _epollFd = -1;
+};
+
+}  // namespace
+
+MessageServer* createReactorMessageServer(const MessageServer::Options& opts,
+                                          MessageHandler* handler) {
+    if (!handler->supportsDetachedConnections()) {
+        warning() << "ingressWorkerThreads is not supported by this server, "
+                  << "using one thread per connection";
+        return nullptr;
+    }
+#ifdef MONGO_CONFIG_SSL
+    if (sslGlobalParams.sslMode.load() != SSLParams::SSLMode_disabled) {
+        warning() << "ingressWorkerThreads is not supported with SSL, "
+                  << "using one thread per connection";
+        return nullptr;
+    }
+#endif
+    log() << "serving connections with " << opts.ingressWorkerThreads << " worker threads";
+    return new ReactorMessageServer(opts, handler);
+}
+
+#else  // !__linux__
+
+MessageServer* createReactorMessageServer(const MessageServer::Options& opts,
+                                          MessageHandler* handler) {
+    warning() << "ingressWorkerThreads is only supported on Linux, "
+              << "using one thread per connection";
+    return nullptr;
+}
+
+#endif  // __linux__
+
+}  // namespace mongo
@@ -0,0 +1,52 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "mongo/util/net/abstract_message_port.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_server.h"
+
+namespace mongo {
+
+/**
+ * Returns a MessageServer which multiplexes every accepted connection over one epoll reactor
+ * thread and a pool of opts.ingressWorkerThreads worker threads, instead of dedicating a thread to
+ * each connection. The pool grows past that size while every worker is busy, so that requests
+ * which block for a long time cannot starve the others.
+ *
+ * Returns nullptr if the reactor cannot serve this configuration: on platforms other than Linux,
+ * when SSL is enabled, or when 'handler' does not support detached connections. The caller is
+ * expected to fall back to the thread-per-connection server in that case.
+ */
+MessageServer* createReactorMessageServer(const MessageServer::Options& opts,
+                                          MessageHandler* handler);
+
+}  // namespace mongo